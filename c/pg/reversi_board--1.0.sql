@@ -0,0 +1,57 @@
+--
+-- reversi_board--1.0.sql
+--
+-- This file is part of the reversi program
+-- http://github.com/rcrr/reversi
+--
+-- Author: Roberto Corradini mailto:rob_corradini@yahoo.it
+-- Copyright 2017 Roberto Corradini. All rights reserved.
+--
+--
+-- License:
+--
+-- This program is free software; you can redistribute it and/or modify it
+-- under the terms of the GNU General Public License as published by the
+-- Free Software Foundation; either version 3, or (at your option) any
+-- later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+-- or visit the site <http://www.gnu.org/licenses/>.
+--
+--
+-- This script is run by the CREATE EXTENSION reversi_board statement.
+-- The types game_position, square_set, and square have to be already defined in the reversi schema.
+--
+
+\echo Use "CREATE EXTENSION reversi_board" to load this file. \quit
+
+
+
+CREATE FUNCTION board_bitrow_changes_for_player_c(player_row SMALLINT, opponent_row SMALLINT, move_position SMALLINT) RETURNS SMALLINT
+AS 'MODULE_PATHNAME', 'board_bitrow_changes_for_player_c'
+LANGUAGE C IMMUTABLE STRICT;
+
+
+
+CREATE FUNCTION game_position_legal_moves_c(gp game_position) RETURNS square_set
+AS 'MODULE_PATHNAME', 'game_position_legal_moves_c'
+LANGUAGE C IMMUTABLE STRICT;
+
+
+
+CREATE FUNCTION game_position_make_move_c(gp game_position, game_move square) RETURNS game_position
+AS 'MODULE_PATHNAME', 'game_position_make_move_c'
+LANGUAGE C IMMUTABLE STRICT;
+
+
+
+CREATE FUNCTION game_position_hash_c(gp game_position) RETURNS BIGINT
+AS 'MODULE_PATHNAME', 'game_position_hash_c'
+LANGUAGE C IMMUTABLE STRICT;
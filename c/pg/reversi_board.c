@@ -0,0 +1,278 @@
+/**
+ * @file
+ *
+ * @brief PostgreSQL extension exposing the board functions to SQL.
+ * @details This module is a PostgreSQL C extension, loaded by the `CREATE EXTENSION reversi_board` statement.
+ * It wraps the board functions of the C program, giving to SQL queries the same implementation, and the
+ * same AVX2 kernels, used by the solvers.
+ *
+ * The SQL functions defined by the extension are the C counterparts of the PL/pgSQL ones having the
+ * same name without the `_c` suffix:
+ * - `board_bitrow_changes_for_player_c(SMALLINT, SMALLINT, SMALLINT) RETURNS SMALLINT`
+ * - `game_position_legal_moves_c(game_position) RETURNS square_set`
+ * - `game_position_make_move_c(game_position, square) RETURNS game_position`
+ * - `game_position_hash_c(game_position) RETURNS BIGINT`
+ *
+ * The `game_position`, `square_set`, and `square` types are the ones defined by the `create_schema.sql`
+ * script, that has to be run before creating the extension.
+ *
+ * @par reversi_board.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "access/htup_details.h"
+#include "utils/builtins.h"
+
+#include "board.h"
+
+
+
+/** @cond */
+PG_MODULE_MAGIC;
+/** @endcond */
+
+
+
+/*
+ * Prototypes for internal functions.
+ */
+
+static void
+game_position_x_from_datum (HeapTupleHeader t,
+                            GamePositionX *const gpx);
+
+static Datum
+game_position_x_to_datum (FunctionCallInfo fcinfo,
+                          const GamePositionX *const gpx);
+
+static Square
+square_from_datum (Datum d);
+
+
+
+/*
+ * Prototypes for the functions called by PostgreSQL.
+ */
+
+extern void
+_PG_init (void);
+
+extern Datum
+board_bitrow_changes_for_player_c (PG_FUNCTION_ARGS);
+
+extern Datum
+game_position_legal_moves_c (PG_FUNCTION_ARGS);
+
+extern Datum
+game_position_make_move_c (PG_FUNCTION_ARGS);
+
+extern Datum
+game_position_hash_c (PG_FUNCTION_ARGS);
+
+
+
+/** @cond */
+PG_FUNCTION_INFO_V1(board_bitrow_changes_for_player_c);
+PG_FUNCTION_INFO_V1(game_position_legal_moves_c);
+PG_FUNCTION_INFO_V1(game_position_make_move_c);
+PG_FUNCTION_INFO_V1(game_position_hash_c);
+/** @endcond */
+
+
+
+/*
+ * Public functions.
+ */
+
+/**
+ * @brief Module initialization, called by PostgreSQL when the shared library is loaded.
+ *
+ * @details Prepares the tables used by the board module, exactly as the solvers do at start up.
+ */
+void
+_PG_init (void)
+{
+  board_module_init();
+}
+
+/**
+ * @brief Returns the 8-bit row of the player discs after the move.
+ *
+ * @details SQL signature: `board_bitrow_changes_for_player_c(player_row SMALLINT, opponent_row SMALLINT, move_position SMALLINT) RETURNS SMALLINT`.
+ *
+ * Rows must be in the range [0..255], and the move position in the range [0..7].
+ */
+Datum
+board_bitrow_changes_for_player_c (PG_FUNCTION_ARGS)
+{
+  const int16 player_row = PG_GETARG_INT16(0);
+  const int16 opponent_row = PG_GETARG_INT16(1);
+  const int16 move_position = PG_GETARG_INT16(2);
+
+  if (player_row < 0 || player_row > 255 || opponent_row < 0 || opponent_row > 255 || move_position < 0 || move_position > 7)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("bitrow arguments out of range: player_row = %d, opponent_row = %d, move_position = %d",
+                    player_row, opponent_row, move_position)));
+
+  PG_RETURN_INT16((int16) board_bitrow_changes_for_player(player_row, opponent_row, move_position));
+}
+
+/**
+ * @brief Returns the set of the legal moves for the game position.
+ *
+ * @details SQL signature: `game_position_legal_moves_c(gp game_position) RETURNS square_set`.
+ */
+Datum
+game_position_legal_moves_c (PG_FUNCTION_ARGS)
+{
+  GamePositionX gpx;
+  game_position_x_from_datum(PG_GETARG_HEAPTUPLEHEADER(0), &gpx);
+  PG_RETURN_INT64((int64) game_position_x_legal_moves(&gpx));
+}
+
+/**
+ * @brief Executes a game move on the given position.
+ *
+ * @details SQL signature: `game_position_make_move_c(gp game_position, game_move square) RETURNS game_position`.
+ *
+ * Differently from the PL/pgSQL function, an illegal move raises an error.
+ */
+Datum
+game_position_make_move_c (PG_FUNCTION_ARGS)
+{
+  GamePositionX current, updated;
+  game_position_x_from_datum(PG_GETARG_HEAPTUPLEHEADER(0), &current);
+  const Square move = square_from_datum(PG_GETARG_DATUM(1));
+
+  if (!game_position_x_is_move_legal(&current, move))
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("move %s is not legal", square_as_move_to_string(move))));
+
+  game_position_x_make_move(&current, move, &updated);
+  return game_position_x_to_datum(fcinfo, &updated);
+}
+
+/**
+ * @brief Returns the zobrist hash of the game position.
+ *
+ * @details SQL signature: `game_position_hash_c(gp game_position) RETURNS BIGINT`.
+ *
+ * The value is the one written by the solvers in the game tree log.
+ */
+Datum
+game_position_hash_c (PG_FUNCTION_ARGS)
+{
+  GamePositionX gpx;
+  game_position_x_from_datum(PG_GETARG_HEAPTUPLEHEADER(0), &gpx);
+  PG_RETURN_INT64((int64) game_position_x_hash(&gpx));
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Reads the blacks, whites, and player attributes of a game_position composite value.
+ */
+static void
+game_position_x_from_datum (HeapTupleHeader t,
+                            GamePositionX *const gpx)
+{
+  bool blacks_is_null, whites_is_null, player_is_null;
+  const Datum blacks = GetAttributeByName(t, "blacks", &blacks_is_null);
+  const Datum whites = GetAttributeByName(t, "whites", &whites_is_null);
+  const Datum player = GetAttributeByName(t, "player", &player_is_null);
+
+  if (blacks_is_null || whites_is_null || player_is_null)
+    ereport(ERROR,
+            (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+             errmsg("game_position attributes must be not null")));
+
+  gpx->blacks = (SquareSet) DatumGetInt64(blacks);
+  gpx->whites = (SquareSet) DatumGetInt64(whites);
+  gpx->player = DatumGetInt16(player) == 0 ? BLACK_PLAYER : WHITE_PLAYER;
+
+  if (gpx->blacks & gpx->whites)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("game_position has squares being both black and white")));
+}
+
+/*
+ * Builds the game_position composite value returned by the function.
+ */
+static Datum
+game_position_x_to_datum (FunctionCallInfo fcinfo,
+                          const GamePositionX *const gpx)
+{
+  TupleDesc tupdesc;
+  Datum values[3];
+  bool nulls[3] = { false, false, false };
+
+  if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("function returning game_position called in context that cannot accept type record")));
+  tupdesc = BlessTupleDesc(tupdesc);
+
+  values[0] = Int64GetDatum((int64) gpx->blacks);
+  values[1] = Int64GetDatum((int64) gpx->whites);
+  values[2] = Int16GetDatum((int16) gpx->player);
+
+  return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+/*
+ * Converts a square enum value, labeled from 'A1' to 'H8', into the corresponding Square.
+ */
+static Square
+square_from_datum (Datum d)
+{
+  const char *const label = DatumGetCString(DirectFunctionCall1(enum_out, d));
+
+  if (label[0] < 'A' || label[0] > 'H' || label[1] < '1' || label[1] > '8' || label[2] != '\0')
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("invalid square label: \"%s\"", label)));
+
+  return (Square) ((label[0] - 'A') + 8 * (label[1] - '1'));
+}
+
+/**
+ * @endcond
+ */
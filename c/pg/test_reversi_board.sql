@@ -0,0 +1,135 @@
+--
+-- test_reversi_board.sql
+--
+-- This file is part of the reversi program
+-- http://github.com/rcrr/reversi
+--
+-- Author: Roberto Corradini mailto:rob_corradini@yahoo.it
+-- Copyright 2017 Roberto Corradini. All rights reserved.
+--
+--
+-- License:
+--
+-- This program is free software; you can redistribute it and/or modify it
+-- under the terms of the GNU General Public License as published by the
+-- Free Software Foundation; either version 3, or (at your option) any
+-- later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+-- or visit the site <http://www.gnu.org/licenses/>.
+--
+--
+-- This script has been tested with PostgreSQL.
+-- Start psql by running: psql -U es -w -d es -h localhost
+-- Load the file by running the command: \i test_reversi_board.sql
+--
+--
+-- This script tests the functions of the reversi_board extension, checking that they return
+-- the same values computed by the PL/pgSQL functions defined in function_definition.sql.
+-- The reversi schema has to be loaded, and the extension installed, before running it.
+--
+
+SET search_path TO reversi;
+
+\set ON_ERROR_STOP
+
+CREATE EXTENSION IF NOT EXISTS reversi_board;
+
+
+
+--
+-- Tests the board_bitrow_changes_for_player_c function, on all the entries of the board_bitrow_changes_for_player table.
+--
+CREATE OR REPLACE FUNCTION test_board_bitrow_changes_for_player_c() RETURNS VOID AS $$
+DECLARE
+  mismatch_count BIGINT;
+BEGIN
+  PERFORM p_assert(7 = board_bitrow_changes_for_player_c(4::SMALLINT, 2::SMALLINT, 0::SMALLINT), 'Expected value is 7.');
+  PERFORM p_assert(7 = board_bitrow_changes_for_player_c(1::SMALLINT, 2::SMALLINT, 2::SMALLINT), 'Expected value is 7.');
+  PERFORM p_assert(1 = board_bitrow_changes_for_player_c(1::SMALLINT, 0::SMALLINT, 1::SMALLINT), 'Expected value is 1.');
+
+  SELECT count(*) INTO STRICT mismatch_count
+  FROM board_bitrow_changes_for_player
+  WHERE changes != board_bitrow_changes_for_player_c((id & 255)::SMALLINT, ((id >> 8) & 255)::SMALLINT, (id >> 16)::SMALLINT);
+  PERFORM p_assert(0 = mismatch_count, 'The C and PL/pgSQL functions differ on ' || mismatch_count || ' entries.');
+END;
+$$ LANGUAGE plpgsql;
+
+
+
+--
+-- Tests the game_position_legal_moves_c, game_position_make_move_c, and game_position_hash_c functions.
+--
+CREATE OR REPLACE FUNCTION test_game_position_c_functions() RETURNS VOID AS $$
+DECLARE
+  initial CONSTANT game_position := (34628173824, 68853694464, 0);
+
+  fixture RECORD;
+BEGIN
+  PERFORM p_assert(17729692631040 = game_position_legal_moves_c(initial), 'Expected square set is equal to D3(19), C4(26), F5(37), E6(44).');
+  PERFORM p_assert(-4311862654967530986 = game_position_hash_c(initial), 'Expected hash value is not ok.');
+  PERFORM p_assert((34762915840, 68719476736, 1)::game_position = game_position_make_move_c(initial, 'D3'), 'Expected game position after D3 is not ok.');
+  PERFORM p_assert(0 = game_position_hash_c((0::square_set, 0::square_set, 0::player)::game_position), 'Expected hash value is 0.');
+
+  FOR fixture IN SELECT id, gp FROM game_position_test_data ORDER BY id LOOP
+    PERFORM p_assert(game_position_legal_moves(fixture.gp) = game_position_legal_moves_c(fixture.gp),
+                     'Legal moves differ for fixture ' || fixture.id || '.');
+    PERFORM p_assert(game_position_hash(fixture.gp) = game_position_hash_c(fixture.gp),
+                     'Hash differs for fixture ' || fixture.id || '.');
+  END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+
+
+--
+-- Plays game_count random games from the initial position, checking at every node that the C and PL/pgSQL
+-- functions compute the same legal moves, hash, and game positions for all the moves.
+--
+CREATE OR REPLACE FUNCTION test_game_position_c_functions_on_random_games(game_count INTEGER) RETURNS VOID AS $$
+DECLARE
+  gp          game_position;
+  moves       square[];
+  move        square;
+  legal_moves square_set;
+  pass_count  INTEGER;
+BEGIN
+  PERFORM setseed(0.5);
+  FOR i IN 1..game_count LOOP
+    gp := (34628173824, 68853694464, 0);
+    pass_count := 0;
+    WHILE pass_count < 2 LOOP
+      legal_moves := game_position_legal_moves(gp);
+      PERFORM p_assert(legal_moves = game_position_legal_moves_c(gp), 'Legal moves differ for ' || gp::TEXT || '.');
+      PERFORM p_assert(game_position_hash(gp) = game_position_hash_c(gp), 'Hash differs for ' || gp::TEXT || '.');
+      IF legal_moves = 0 THEN
+        gp := game_position_pass(gp);
+        pass_count := pass_count + 1;
+      ELSE
+        pass_count := 0;
+        moves := square_set_to_array(legal_moves);
+        FOREACH move IN ARRAY moves LOOP
+          PERFORM p_assert(game_position_make_move(gp, move) = game_position_make_move_c(gp, move),
+                           'Make move differs for ' || gp::TEXT || ' and move ' || move || '.');
+        END LOOP;
+        gp := game_position_make_move_c(gp, moves[1 + floor(random() * array_length(moves, 1))::INTEGER]);
+      END IF;
+    END LOOP;
+  END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+
+
+
+SELECT test_board_bitrow_changes_for_player_c();
+SELECT test_game_position_c_functions();
+SELECT test_game_position_c_functions_on_random_games(20);
+
+\unset ON_ERROR_STOP
@@ -313,6 +313,10 @@ CREATE TABLE board_bitrow_changes_for_player (id      INTEGER,
 
 
 
+--
+-- Each run has its own game_tree_log partition, see below, so runs must be removed by calling gt_delete_run.
+-- Deleting a row directly from this table cascades to the records of its partition one by one,
+-- and leaves the empty partition table behind.
 --
 -- DROP TABLE IF EXISTS game_tree_log_header;
 --
@@ -324,10 +328,15 @@ CREATE TABLE game_tree_log_header (run_id       SERIAL     PRIMARY KEY,
 
 
 
+--
+-- The game_tree_log table holds no records, each run is stored into a partition, a table inheriting from it,
+-- created by the gt_load_from_staging function, that builds also its primary key, foreign key, and indexes.
+-- Partitions have a check constraint on run_id, so that, with constraint_exclusion set to partition, the default,
+-- queries selecting a run read only its partition.
 --
 -- DROP TABLE IF EXISTS game_tree_log;
 --
-CREATE TABLE game_tree_log (run_id       INTEGER   REFERENCES game_tree_log_header (run_id) ON DELETE CASCADE,
+CREATE TABLE game_tree_log (run_id       INTEGER   NOT NULL,
                             sub_run_id   INTEGER   NOT NULL,
                             call_id      INTEGER   NOT NULL,
                             hash         BIGINT,
@@ -335,11 +344,7 @@ CREATE TABLE game_tree_log (run_id       INTEGER   REFERENCES game_tree_log_head
                             blacks       square_set,
                             whites       square_set,
                             player       player,
-                            json_doc     JSON,
-                            PRIMARY KEY(run_id, sub_run_id, call_id));
-
-CREATE INDEX game_tree_log_hash_idx ON game_tree_log (hash);
-CREATE INDEX game_tree_log_001_idx  ON game_tree_log (run_id, sub_run_id, hash);
+                            json_doc     JSON);
 
 
 
@@ -38,26 +38,75 @@ SET search_path TO reversi;
 
 
 
+--
+-- Returns the name of the game_tree_log partition storing the run.
+--
+CREATE OR REPLACE FUNCTION gt_partition_name (run_id_in INTEGER)
+RETURNS TEXT AS $$
+BEGIN
+  RETURN 'game_tree_log_r' || run_id_in;
+END;
+$$ LANGUAGE plpgsql IMMUTABLE;
+
+
+
 --
 -- Loads everything from table game_tree_log_staging into game_tree_log under a freshly created new record in game_tree_log_header.
 -- Returns the number of record loaded in game_tree_log and the run_id value inserted in game_tree_log_header.
 --
+-- Each run is stored into its own partition, a table inheriting from game_tree_log, named game_tree_log_r<run_id>,
+-- and having a check constraint on run_id, so that queries selecting a run read only its partition.
+-- Records are copied by a single INSERT ... SELECT into the new, empty, partition, then its primary key,
+-- foreign key, and indexes are built. The tables of the previous runs are not touched, and the load time
+-- depends only on the size of the new run.
+--
 CREATE OR REPLACE FUNCTION gt_load_from_staging (    run_label           CHAR(4),
                                                      engine_id           CHAR(20),
                                                      description         TEXT,
                                                  OUT new_run_id          INTEGER,
                                                  OUT record_loaded_count INTEGER)
 AS $$
+DECLARE
+  partition_name TEXT;
 BEGIN
   INSERT INTO game_tree_log_header (run_label, engine_id, run_date, description)
     VALUES (run_label, engine_id, now(), description) RETURNING run_id INTO new_run_id;
-  DROP INDEX IF EXISTS game_tree_log_hash_idx;
-  DROP INDEX IF EXISTS game_tree_log_001_idx;
-  INSERT INTO game_tree_log (run_id, sub_run_id, call_id, hash, parent_hash, blacks, whites, player, json_doc)
-    SELECT new_run_id, sub_run_id, call_id, hash, parent_hash, blacks, whites, player, json_doc FROM game_tree_log_staging;
-  CREATE INDEX game_tree_log_hash_idx ON game_tree_log (hash);
-  CREATE INDEX game_tree_log_001_idx  ON game_tree_log (run_id, sub_run_id, hash);
-  SELECT COUNT(*) INTO STRICT record_loaded_count FROM game_tree_log WHERE run_id = new_run_id;
+  partition_name := gt_partition_name(new_run_id);
+
+  EXECUTE format('CREATE TABLE %I (CHECK (run_id = %s)) INHERITS (game_tree_log)', partition_name, new_run_id);
+  EXECUTE format('INSERT INTO %I (run_id, sub_run_id, call_id, hash, parent_hash, blacks, whites, player, json_doc) '
+                 'SELECT $1, sub_run_id, call_id, hash, parent_hash, blacks, whites, player, json_doc FROM game_tree_log_staging '
+                 'ORDER BY sub_run_id, call_id', partition_name) USING new_run_id;
+  GET DIAGNOSTICS record_loaded_count = ROW_COUNT;
+
+  EXECUTE format('ALTER TABLE %I ADD PRIMARY KEY (run_id, sub_run_id, call_id)', partition_name);
+  EXECUTE format('ALTER TABLE %I ADD FOREIGN KEY (run_id) REFERENCES game_tree_log_header (run_id) ON DELETE CASCADE', partition_name);
+  EXECUTE format('CREATE INDEX %I ON %I (hash)', partition_name || '_hash_idx', partition_name);
+  EXECUTE format('CREATE INDEX %I ON %I (run_id, sub_run_id, hash)', partition_name || '_001_idx', partition_name);
+  EXECUTE format('ANALYZE %I', partition_name);
+END;
+$$ LANGUAGE plpgsql VOLATILE;
+
+
+
+--
+-- Deletes the run from game_tree_log_header, and drops its game_tree_log partition.
+-- Runs must be removed by this function: a DELETE on game_tree_log_header deletes the records
+-- of the partition one by one, by the cascading foreign key, and doesn't drop the partition table.
+-- Returns the run_id of the deleted run, or NULL when the run label is not found.
+--
+CREATE OR REPLACE FUNCTION gt_delete_run (run_label_in CHAR(4))
+RETURNS INTEGER AS $$
+DECLARE
+  run_id_in INTEGER;
+BEGIN
+  SELECT run_id INTO run_id_in FROM game_tree_log_header WHERE run_label = run_label_in;
+  IF run_id_in IS NULL THEN
+    RETURN NULL;
+  END IF;
+  EXECUTE format('DROP TABLE IF EXISTS %I', gt_partition_name(run_id_in));
+  DELETE FROM game_tree_log_header WHERE run_id = run_id_in;
+  RETURN run_id_in;
 END;
 $$ LANGUAGE plpgsql VOLATILE;
 
@@ -43,6 +43,13 @@ fi
 TABLE_NAME=game_tree_log_staging
 TABLE_NAME_AND_COLUMNS="$TABLE_NAME (sub_run_id, call_id, hash, parent_hash, blacks, whites, player, json_doc)"
 
+# Files having the .pgbin extension are written by read_game_tree_log -b in the PostgreSQL binary COPY format,
+# the other ones are CSV.
+case $FILE_NAME in
+  *.pgbin) COPY_OPTIONS="(FORMAT binary)" ;;
+  *)       COPY_OPTIONS="(FORMAT CSV, DELIMITER ';', HEADER true)" ;;
+esac
+
 psql -U $PSQL_USER -w -d $PSQL_DB -h localhost <<EOF
 
 \set ON_ERROR_STOP on
@@ -53,7 +60,7 @@ SELECT COUNT(*) FROM $TABLE_NAME;
 
 TRUNCATE TABLE $TABLE_NAME;
 
-\COPY $TABLE_NAME_AND_COLUMNS FROM $FILE_NAME WITH (FORMAT CSV, DELIMITER ';', HEADER true);
+\COPY $TABLE_NAME_AND_COLUMNS FROM $FILE_NAME WITH $COPY_OPTIONS;
 
 SELECT COUNT(*) FROM $TABLE_NAME;
 
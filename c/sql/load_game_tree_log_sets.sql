@@ -33,6 +33,9 @@
 --
 -- This script loads game tree sets into the db, game_tree_log_header, and game_tree_log tables.
 --
+-- Each set is loaded by gt_load_from_staging into its own game_tree_log partition, that is analyzed
+-- when loaded, so no VACUUM or ANALYZE is run by the script.
+--
 
 SET search_path TO reversi;
 
@@ -54,7 +57,6 @@ SELECT current_user AS reversi_username
 --
 \! ./gt_load_file.sh $REVERSI_USERNAME $REVERSI_DBNAME ../build/out/rab_solver_log-ffo-01-simplified-4_n3_h.csv;
 SELECT gt_load_from_staging('T000', 'C_RAB_SOLVER', 'Test data obtained by the C rab solver on position ffo-01-simplified-4.');
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT gt_check_rab('T000', 0);
 SELECT gt_check_rab('T000', 1);
 SELECT gt_check_rab('T000', 2);
@@ -72,7 +74,6 @@ SELECT gt_check_rab('T000', 2);
 --
 \! ./gt_load_file.sh $REVERSI_USERNAME $REVERSI_DBNAME ../build/out/minimax_log-ffo-01-simplified-4_h.csv;
 SELECT gt_load_from_staging('T001','C_MINIMAX_SOLVER', 'Test data obtained by the C minimax solver on position ffo-01-simplified-4.');
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT p_assert(gt_check('T001', 0) = (20040, 6879, 6879, 8875, 0, 13161, 0, 1, 6201), 'The game tree T001/0 has not been loaded as expected.');
 
 --
@@ -85,7 +86,6 @@ SELECT
   game_position_solve(gp, 'SQL_MINIMAX_SOLVER', TRUE, 'T002', 'Test data obtained by the PL/SQL minimax solver on position ffo-01-simplified-4.')
 FROM
   game_position_test_data WHERE id = 'ffo-01-simplified-4';
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT p_assert(gt_check('T002', 0) = (20040, 6879, 6879, 8875, 0, 13161, 0, 1, 6201), 'The game tree T002/0 has not been loaded as expected.');
 
 --
@@ -112,7 +112,6 @@ END $$;
 --
 \! ./gt_load_file.sh $REVERSI_USERNAME $REVERSI_DBNAME ../build/out/ab_solver_log-ffo-01-simplified-4_h.csv;
 SELECT gt_load_from_staging('T003','C_ALPHABETA_SOLVER', 'Test data obtained by the C alpha-beta solver on position ffo-01-simplified-4.');
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT p_assert(gt_check('T003', 0) = (2029, 1046, 1046, 1228, 0, 983, 0, 1, 538), 'The game tree T003/0 has not been loaded as expected.');
 
 --
@@ -125,7 +124,6 @@ SELECT
   game_position_solve(gp, 'SQL_ALPHABETA_SOLVER', TRUE, 'T004', 'Test data obtained by the PL/SQL alpha-beta solver on position ffo-01-simplified-4.')
 FROM
   game_position_test_data WHERE id = 'ffo-01-simplified-4';
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT p_assert(gt_check('T004', 0) = (2029, 1046, 1046, 1228, 0, 983, 0, 1, 538), 'The game tree T004/0 has not been loaded as expected.');
 
 --
@@ -152,7 +150,6 @@ END $$;
 --
 \! ./gt_load_file.sh $REVERSI_USERNAME $REVERSI_DBNAME ../build/out/random_game_sampler_log-t100_h.csv;
 SELECT gt_load_from_staging('T005','C_RANDOM_SAMPLER', 'Test data obtained by the C random game sampler on position initial.');
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT gt_check_random('T005');
 
 DO $$
@@ -177,7 +174,6 @@ END $$;
 --
 \! ./gt_load_file.sh $REVERSI_USERNAME $REVERSI_DBNAME ../build/out/exact_solver_log-ffo-01_h.csv;
 SELECT gt_load_from_staging('T006','C_ES_SOLVER', 'Test data obtained by the C exact solver on position FFO-01.');
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT * FROM gt_check('T006', 0);
 
 --
@@ -189,7 +185,6 @@ SELECT * FROM gt_check('T006', 0);
 --
 \! ./gt_load_file.sh $REVERSI_USERNAME $REVERSI_DBNAME ../build/out/ifes_solver_log-ffo-01_h.csv;
 SELECT gt_load_from_staging('T007','C_IFES_SOLVER', 'Test data obtained by the C ifes solver on position FFO-01.');
-VACUUM(FULL, ANALYZE) game_tree_log;
 SELECT * FROM gt_check('T007', 0);
 
 --
@@ -274,6 +274,12 @@ bit_works_bitscanMS1B_64 (const uint64_t bit_sequence)
   return result;
 }
 
+/**
+ *
+ */
+extern uint8_t
+bit_works_bitscanMS1B_64_bsr (const uint64_t bit_sequence);
+
 /**
  * @brief Returns the index of the most significant bit set in the `bit_sequence` parameter.
  *
@@ -54,7 +54,7 @@ inline unsigned int
 bit_works_bitcount_64_popcnt (uint64_t x)
 {
   uint64_t out;
-  __asm__ __volatile__ ("popcnt %1, %0" : "=g" (out) : "g" (x));
+  __asm__ __volatile__ ("popcnt %1, %0" : "=r" (out) : "rm" (x));
   return (int) out;
 }
 
@@ -79,6 +79,15 @@ bit_works_fill_in_between (uint8_t bit_sequence);
 extern uint8_t
 bit_works_bitscanMS1B_64 (const uint64_t bit_sequence);
 
+__attribute__((always_inline))
+inline uint8_t
+bit_works_bitscanMS1B_64_bsr (const uint64_t bit_sequence)
+{
+  uint64_t out;
+  __asm__ __volatile__ ("bsr %1, %0" : "=r" (out) : "rm" (bit_sequence));
+  return (uint8_t) out;
+}
+
 extern uint8_t
 bit_works_bitscanMS1B_8 (const uint8_t bit_sequence);
 
@@ -90,7 +99,7 @@ inline uint8_t
 bit_works_bitscanLS1B_64_bsf (const uint64_t bit_sequence)
 {
   uint64_t out;
-  __asm__ __volatile__ ("bsf %1, %0" : "=g" (out) : "g" (bit_sequence));
+  __asm__ __volatile__ ("bsf %1, %0" : "=r" (out) : "rm" (bit_sequence));
   return (uint8_t) out;
 }
 
@@ -102,7 +111,7 @@ inline uint64_t
 bit_works_reset_lowest_bit_set_64_blsr (const uint64_t bit_sequence)
 {
   uint64_t out;
-  __asm__ __volatile__ ("blsr %1, %0" : "=g" (out) : "g" (bit_sequence));
+  __asm__ __volatile__ ("blsr %1, %0" : "=r" (out) : "rm" (bit_sequence));
   return (uint64_t) out;
 }
 
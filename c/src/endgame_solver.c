@@ -37,7 +37,7 @@
  *       - More optional checks could be added to pve_is_invariant_satisfied.
  *       - Tests ....
  *       - Documentation.
- *       - Add game values computation and output for first level moves.
+ *       - [done] Add game values computation and output for first level moves.
  *       - Add a function to compute PV hash code (it is useful for testing and database processing).
  *       - The ExactSolution object should be replaced by a PVE reference.
  *
@@ -60,7 +60,7 @@
  *
  * @todo The output of the solvers is not always appropriate:
  *         - [done] Final board is not reported
- *         - The value of all the first level moves is not recorded
+ *         - [done] The value of all the first level moves is not recorded
  *         - For random game sampler the output is meaningless
  *
  * @todo [done] Refine and refactor the exact_solver implementation.
@@ -126,7 +126,7 @@
  * @todo Remove the dependency from GSL GNU library by replacing it with Mersenne Twister 64bit version foud at http://www.math.sci.hiroshima-u.ac.jp/~m-mat/MT/emt64.html
  *       The reason is to avoid the dependency, but more important to have a 64 bit generator (the gsl library has a 32 bit one).
  *
- * @todo Create a C extension to PostgreSQL that leverages the C game position functions.
+ * @todo [done] Create a C extension to PostgreSQL that leverages the C game position functions.
  *
  * @todo Write a GUI using GTK+.
  *
@@ -166,6 +166,7 @@
  * </tt>
  */
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -244,6 +245,22 @@ static const gchar *program_documentation_string =
   "   It uses the alpha-beta pruning, ordering the moves by mean of a random criteria, a sample call is:\n"
   "     $ endgame_solver -f db/gpdb-sample-games.txt -q ffo-01-simplified-4 -s rab -l out/log -n 3\n"
   "\n"
+  " - es2 (exact solver, iterative rewrite)\n"
+  "   The es solver rewritten without recursion. It supports a selective search, based on Multi-ProbCut,\n"
+  "   turned on by the --selectivity flag. Levels 1 to 4 prune with a confidence of 99%, 95%, 90%, and 75%,\n"
+  "   returning a probably best move and an estimated value. A sample call is:\n"
+  "     $ endgame_solver -f db/gpdb-ffo.txt -q ffo-40 -s es2 --selectivity 1\n"
+  "   The --move-values flag, followed by a number of plies, reports the exact value of every move played\n"
+  "   within the given plies, and the number of distinct optimal lines, without recording the PV. A sample call is:\n"
+  "     $ endgame_solver -f db/gpdb-ffo.txt -q ffo-05 -s es2 --move-values 1\n"
+  "\n"
+  "Checkpoints:\n"
+  "   Solvers es and es2 write a checkpoint after the search of each move of the root position, when the\n"
+  "   --checkpoint flag, followed by a file path, is given. The PV found so far is saved by a PVE dump,\n"
+  "   written beside the checkpoint file. A killed solve is continued adding the --resume flag to the\n"
+  "   same command, when the checkpoint file doesn't exist the search starts from scratch. A sample call is:\n"
+  "     $ endgame_solver -f db/gpdb-ffo.txt -q ffo-40 -s es --pv-full-rec --checkpoint out/ffo-40.ckp --resume\n"
+  "\n"
   "Author:\n"
   "   Written by Roberto Corradini <rob_corradini@yahoo.it>\n"
   "\n"
@@ -265,6 +282,14 @@ static gchar   *pve_dump_file = NULL;
 static gboolean pv_rec        = FALSE;
 static gboolean pv_full_rec   = FALSE;
 static gboolean pv_no_print   = FALSE;
+static gint     selectivity   = 0;
+static gint     move_values   = 0;
+static gchar   *checkpoint_file = NULL;
+static gboolean resume        = FALSE;
+static gint     log_max_depth = -1;
+static gint     log_sample    = 0;
+static gchar   *log_root_moves = NULL;
+static gboolean tree_stats    = FALSE;
 
 static const GOptionEntry entries[] =
   {
@@ -277,6 +302,14 @@ static const GOptionEntry entries[] =
     { "pv-rec",          0, 0, G_OPTION_ARG_NONE,     &pv_rec,        "Collects PV info         - Available only for es solver.",                           NULL },
     { "pv-full-rec",     0, 0, G_OPTION_ARG_NONE,     &pv_full_rec,   "Analyzes all PV variants - Available only for es solver.",                           NULL },
     { "pv-no-print",     0, 0, G_OPTION_ARG_NONE,     &pv_no_print,   "Does't print PV variants - Available only in conjuction with option pv-full-rec.",   NULL },
+    { "selectivity",     0, 0, G_OPTION_ARG_INT,      &selectivity,   "Selectivity level        - Available only for es2 solver. Must be in [0..4], 0 is exact.", NULL },
+    { "move-values",     0, 0, G_OPTION_ARG_INT,      &move_values,   "Move values plies        - Available only for es2 solver. Must be in [0..4], 0 is off.",   NULL },
+    { "checkpoint",      0, 0, G_OPTION_ARG_FILENAME, &checkpoint_file, "Writes checkpoints       - Requires a filename path. Available only for es and es2 solvers.", NULL },
+    { "resume",          0, 0, G_OPTION_ARG_NONE,     &resume,        "Resumes the search       - Available only in conjuction with option checkpoint.",   NULL },
+    { "log-max-depth",   0, 0, G_OPTION_ARG_INT,      &log_max_depth, "Logged depth             - Available only in conjuction with option log. Nodes deeper than the root by more plies are not logged.", NULL },
+    { "log-sample",      0, 0, G_OPTION_ARG_INT,      &log_sample,    "Logged sample            - Available only in conjuction with option log. One node in N, chosen by hash, is logged with its path.", NULL },
+    { "log-root-moves",  0, 0, G_OPTION_ARG_STRING,   &log_root_moves, "Logged root moves        - Available only in conjuction with option log. A comma separated list, e.g. \"d3,c4\".", NULL },
+    { "tree-stats",      0, 0, G_OPTION_ARG_NONE,     &tree_stats,    "Game tree statistics     - Collects statistics on the game tree during the search, and prints them at the end.", NULL },
     { NULL }
   };
 
@@ -289,6 +322,10 @@ static const GOptionEntry entries[] =
 static int
 egs_select_solver (const char *const id);
 
+static bool
+egs_parse_moves (const char *const moves,
+                 SquareSet *const squares);
+
 /**
  * @endcond
  */
@@ -316,8 +353,17 @@ main (int argc, char *argv[])
       .repeats = 0,
       .pv_recording = false,
       .pv_full_recording = false,
-      .pv_no_print = false
+      .pv_no_print = false,
+      .selectivity = 0,
+      .move_values_depth = 0,
+      .checkpoint_file = NULL,
+      .checkpoint = NULL,
+      .log_max_depth = -1,
+      .log_sample_rate = 0,
+      .log_root_moves = empty_square_set,
+      .tree_stats = false
     };
+  search_checkpoint_t checkpoint;
 
   /* GLib command line options and argument parsing. */
   GError *error = NULL;
@@ -365,6 +411,55 @@ main (int argc, char *argv[])
     g_print("Option --pv-no-print can be used only with solver \"es\", and when option --pv-full-rec is turned on.\n");
     return -11;
   }
+  if (selectivity < 0 || selectivity >= ES2_SELECTIVITY_LEVEL_COUNT) {
+    g_print("Option --selectivity is out of range.\n");
+    return -12;
+  }
+  if (selectivity && strcmp(solver->id, "es2")) {
+    g_print("Option --selectivity can be used only with solver \"es2\".\n");
+    return -13;
+  }
+  if (selectivity && (pv_rec || pv_full_rec)) {
+    g_print("Option --selectivity is not compatible with options --pv-rec, or --pv-full-rec.\n");
+    return -14;
+  }
+  if (move_values < 0 || move_values > EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH) {
+    g_print("Option --move-values is out of range.\n");
+    return -15;
+  }
+  if (move_values && strcmp(solver->id, "es2")) {
+    g_print("Option --move-values can be used only with solver \"es2\".\n");
+    return -16;
+  }
+  if (move_values && selectivity) {
+    g_print("Option --move-values is not compatible with option --selectivity.\n");
+    return -17;
+  }
+  if (checkpoint_file && strcmp(solver->id, "es") && strcmp(solver->id, "es2")) {
+    g_print("Option --checkpoint can be used only with solver \"es\" or \"es2\".\n");
+    return -18;
+  }
+  if (checkpoint_file && move_values) {
+    g_print("Option --checkpoint is not compatible with option --move-values.\n");
+    return -19;
+  }
+  if (resume && !checkpoint_file) {
+    g_print("Option --resume can be used only when option --checkpoint is turned on.\n");
+    return -20;
+  }
+  if ((log_max_depth >= 0 || log_sample || log_root_moves) && !log_file) {
+    g_print("Options --log-max-depth, --log-sample, and --log-root-moves can be used only when option -l, --log is turned on.\n");
+    return -23;
+  }
+  if (log_sample < 0) {
+    g_print("Option --log-sample is out of range.\n");
+    return -24;
+  }
+  SquareSet root_moves = empty_square_set;
+  if (log_root_moves && !egs_parse_moves(log_root_moves, &root_moves)) {
+    g_print("Option --log-root-moves is not a valid list of moves.\n");
+    return -25;
+  }
 
   /* Opens the source file for reading. */
   fp = fopen(input_file, "r");
@@ -413,10 +508,43 @@ main (int argc, char *argv[])
   env.pv_recording = pv_rec || pv_full_rec;
   env.pv_full_recording = pv_full_rec;
   env.pv_no_print = pv_no_print;
+  env.selectivity = selectivity;
+  env.move_values_depth = move_values;
+  env.checkpoint_file = checkpoint_file;
+  env.log_max_depth = log_max_depth;
+  env.log_sample_rate = log_sample;
+  env.log_root_moves = root_moves;
+  env.tree_stats = tree_stats;
 
   /* Solves the position. */
   //GamePosition *gp = entry->game_position;
   GamePositionX *gpx = game_position_x_gp_to_gpx(entry->game_position);
+
+  /* Reads the checkpoint, it has to match the solver, the game position, and the PV recording options. */
+  if (resume) {
+    FILE *ckp_fp = fopen(checkpoint_file, "r");
+    if (ckp_fp) {
+      fclose(ckp_fp);
+      if (!search_checkpoint_read(checkpoint_file, &checkpoint)) {
+        g_print("The checkpoint file \"%s\" is not valid.\n", checkpoint_file);
+        return -21;
+      }
+      const bool pv_is_recorded = env.pv_recording || !strcmp(solver->id, "es");
+      if (strcmp(checkpoint.solver, solver->id) ||
+          checkpoint.root_blacks != gpx->blacks ||
+          checkpoint.root_whites != gpx->whites ||
+          checkpoint.root_player != gpx->player ||
+          !(checkpoint.pv_flags & SEARCH_CHECKPOINT_PV_RECORDING) != !pv_is_recorded ||
+          !(checkpoint.pv_flags & SEARCH_CHECKPOINT_PV_FULL_RECORDING) != !env.pv_full_recording) {
+        g_print("The checkpoint file \"%s\" doesn't match the solver, the game position, or the PV options.\n", checkpoint_file);
+        return -22;
+      }
+      env.checkpoint = &checkpoint;
+      g_print("Resuming the search from checkpoint file \"%s\", %u root moves already searched.\n", checkpoint_file, checkpoint.searched_move_count);
+    } else {
+      g_print("Checkpoint file \"%s\" not found, the search starts from scratch.\n", checkpoint_file);
+    }
+  }
   ExactSolution *solution = NULL;
   g_print("Solving game position %s, from source %s, using solver %s (%s) ...\n", entry->id, input_file, solver->id, solver->description);
   solution = solver->fn(gpx, &env);
@@ -469,6 +597,34 @@ egs_select_solver (const char *const id)
   return -1;
 }
 
+/**
+ * @brief Parses a comma separated list of moves, like "d3,c4".
+ *
+ * @param [in]  moves   the list of moves
+ * @param [out] squares the set of squares named by the moves
+ * @return              true when the list is well formed
+ */
+static bool
+egs_parse_moves (const char *const moves,
+                 SquareSet *const squares)
+{
+  g_assert(moves);
+  g_assert(squares);
+  SquareSet s = empty_square_set;
+  const char *m = moves;
+  for (;;) {
+    const int col = tolower((unsigned char) m[0]) - 'a';
+    const int row = (m[0] ? m[1] : 0) - '1';
+    if (col < 0 || col > 7 || row < 0 || row > 7) return false;
+    s |= (SquareSet) 1 << (8 * row + col);
+    m += 2;
+    if (*m == '\0') break;
+    if (*m++ != ',') return false;
+  }
+  *squares = s;
+  return true;
+}
+
 /**
  * @endcond
  */
@@ -51,6 +51,14 @@ typedef struct {
   bool  pv_recording;      /**< @brief Turns on the principal variation recording. */
   bool  pv_full_recording; /**< @brief Drives the logic governing game tree pruning to consider the branches with equal value. */
   bool  pv_no_print;       /**< @brief Turns off the PV variants printing when `pv_full_recording` is `true`. */
+  int   selectivity;       /**< @brief Selectivity level, zero means exact search. Used only by the es2 solver. */
+  int   move_values_depth; /**< @brief Number of plies having move values and optimal line counts collected, zero turns it off. Used only by the es2 solver. */
+  char *checkpoint_file;   /**< @brief When not NULL a search checkpoint is written to the file after each root move. Used only by the es and es2 solvers. */
+  const search_checkpoint_t *checkpoint; /**< @brief When not NULL the search is resumed from the checkpoint, read from `checkpoint_file`. */
+  int       log_max_depth;     /**< @brief Nodes deeper than this are not logged, a negative value means no limit. */
+  uint32_t  log_sample_rate;   /**< @brief One node in this many is logged with its path from the root, zero or one log all the nodes. */
+  SquareSet log_root_moves;    /**< @brief When not empty, only the subtrees of these root moves are logged. */
+  bool      tree_stats;        /**< @brief Turns on the game tree statistics, collected during the search and printed at the end. */
 } endgame_solver_env_t;
 
 /**
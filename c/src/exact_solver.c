@@ -40,6 +40,7 @@
 #include <glib/gstdio.h>
 
 #include "game_tree_logger.h"
+#include "game_tree_stats.h"
 #include "game_tree_utils.h"
 
 #include "exact_solver.h"
@@ -95,6 +96,11 @@ game_position_solve_impl (ExactSolution *const result,
 static void
 move_list_init (MoveList *ml);
 
+static void
+write_checkpoint (const ExactSolution *const result,
+                  const SearchNode *const node,
+                  const uint32_t searched_move_count);
+
 /*
  * Internal variables and constants.
  */
@@ -105,6 +111,9 @@ static PVEnv *pve = NULL;
 /* The logging environment structure. */
 static LogEnv *log_env = NULL;
 
+/* The game tree statistics, NULL when turned off. */
+static GameTreeStats *tree_stats = NULL;
+
 /* The total number of call to the recursive function that traverse the game DAG. */
 static uint64_t call_count = 0;
 
@@ -117,6 +126,12 @@ static int gp_hash_stack_fill_point = 0;
 /* Drives the analysis to consider all variants of equal value (slower, but complete).*/
 static bool pv_full_recording = false;
 
+/* When not NULL a checkpoint is written to the file after the search of each root move. */
+static const char *checkpoint_file = NULL;
+
+/* When not NULL the search of the root node is resumed from the checkpoint. */
+static const search_checkpoint_t *resumed_checkpoint = NULL;
+
 /* The sub_run_id used for logging. */
 static const int sub_run_id = 0;
 
@@ -174,17 +189,27 @@ game_position_es_solve (const GamePositionX *const root,
   int            beta;
 
   pv_full_recording = env->pv_full_recording;
+  checkpoint_file = env->checkpoint_file;
+  resumed_checkpoint = env->checkpoint;
 
   log_env = game_tree_log_init(env->log_file);
 
-  //GamePositionX *rootx = game_position_x_gp_to_gpx(root);
-  pve = pve_new(root);
-  //game_position_x_free(rootx);
+  if (resumed_checkpoint) {
+    pve = search_checkpoint_load_pve(checkpoint_file, resumed_checkpoint);
+    if (!pve) {
+      fprintf(stderr, "Unable to load the PVE dump of checkpoint file \"%s\".\n", checkpoint_file);
+      abort();
+    }
+  } else {
+    pve = pve_new(root);
+  }
 
   if (log_env->log_is_on) {
     gp_hash_stack[0] = 0;
+    game_tree_log_set_filters(log_env, env->log_max_depth, env->log_sample_rate, env->log_root_moves);
     game_tree_log_open_h(log_env);
   }
+  if (env->tree_stats) tree_stats = game_tree_stats_new();
 
   if (pv_full_recording) {
     alpha = out_of_range_defeat_score;
@@ -198,6 +223,12 @@ game_position_es_solve (const GamePositionX *const root,
 
   result->solved_game_position = game_position_clone(game_position_x_gpx_to_gp(root));
 
+  /* The root node is going to be counted again. */
+  if (resumed_checkpoint) {
+    result->node_count = resumed_checkpoint->node_count - 1;
+    result->leaf_count = resumed_checkpoint->leaf_count;
+  }
+
   sn = game_position_solve_impl(result,
                                 result->solved_game_position,
                                 alpha,
@@ -251,7 +282,8 @@ game_position_es_solve (const GamePositionX *const root,
 
   if (env->pve_dump_file) {
     printf("\n --- --- pve_dump_to_binary_file() START --- ---\n");
-    pve_dump_to_binary_file(pve, env->pve_dump_file);
+    if (!pve_dump_to_binary_file(pve, env->pve_dump_file))
+      fprintf(stderr, "Unable to write the PVE dump file \"%s\".\n", env->pve_dump_file);
     printf(" --- --- pve_dump_to_binary_file() COMPLETED --- ---\n");
   }
 
@@ -260,6 +292,12 @@ game_position_es_solve (const GamePositionX *const root,
 
   game_tree_log_close(log_env);
 
+  if (tree_stats) {
+    game_tree_stats_print(tree_stats, stdout);
+    game_tree_stats_free(tree_stats);
+    tree_stats = NULL;
+  }
+
   return result;
 }
 
@@ -316,6 +354,10 @@ sort_moves_by_mobility_count (MoveList *move_list,
 
 /*
  * Main recursive search function.
+ *
+ * The root node is the one receiving the root line of the PVE as parent line.
+ * When checkpoints are on, the state of the root node is saved after the search of each move,
+ * and when resuming, the moves already searched are skipped.
  */
 static SearchNode *
 game_position_solve_impl (ExactSolution *const result,
@@ -329,9 +371,9 @@ game_position_solve_impl (ExactSolution *const result,
   SearchNode *node2 = NULL;
   PVCell **pve_line = NULL;
 
+  if (log_env->log_is_on || tree_stats) gp_hash_stack_fill_point++;
   if (log_env->log_is_on) {
     call_count++;
-    gp_hash_stack_fill_point++;
     LogDataH log_data;
     log_data.sub_run_id = 0;
     log_data.call_id = call_count;
@@ -344,9 +386,15 @@ game_position_solve_impl (ExactSolution *const result,
     gchar *json_doc = game_tree_log_data_h_json_doc(gp_hash_stack_fill_point, gp);
     log_data.json_doc = json_doc;
     log_data.json_doc_len = strlen(json_doc);
+    log_data.call_level = gp_hash_stack_fill_point;
     game_tree_log_write_h(log_env, &log_data);
     g_free(json_doc);
   }
+  if (tree_stats) {
+    GamePositionX gpx;
+    game_position_x_copy_from_gp(gp, &gpx);
+    game_tree_stats_add_node(tree_stats, gp_hash_stack_fill_point - 1, &gpx);
+  }
 
   const SquareSet moves = game_position_legal_moves(gp);
   if (0ULL == moves) {
@@ -365,9 +413,18 @@ game_position_solve_impl (ExactSolution *const result,
   } else {
     MoveList move_list;
     bool branch_is_active = false;
+    const bool is_root = pve_parent_line_p == &(pve->root_line);
+    uint32_t searched_move_count = 0;
     move_list_init(&move_list);
     sort_moves_by_mobility_count(&move_list, gp);
-    for (MoveListElement *element = move_list.head.succ; element != &move_list.tail; element = element->succ) {
+    MoveListElement *element = move_list.head.succ;
+    if (is_root && resumed_checkpoint) {
+      node = search_node_new(resumed_checkpoint->best_move, resumed_checkpoint->value);
+      branch_is_active = true;
+      for ( ; searched_move_count < resumed_checkpoint->searched_move_count; searched_move_count++) element = element->succ;
+      resumed_checkpoint = NULL;
+    }
+    for ( ; element != &move_list.tail; element = element->succ) {
       const Square move = element->sq;
       if (!node) node = search_node_new(move, (pv_full_recording) ? achievable - 1 : achievable);
       GamePosition *gp2 = game_position_make_move(gp, move);
@@ -395,10 +452,11 @@ game_position_solve_impl (ExactSolution *const result,
         search_node_free(node2);
         game_position_free(gp2);
       }
+      if (is_root && checkpoint_file) write_checkpoint(result, node, ++searched_move_count);
     }
   }
  out:
-  if (log_env->log_is_on) {
+  if (log_env->log_is_on || tree_stats) {
     gp_hash_stack_fill_point--;
   }
   return node;
@@ -426,6 +484,32 @@ move_list_init (MoveList *ml)
   ml->tail.succ = NULL;
 }
 
+/*
+ * Writes the checkpoint of the root node, after the search of searched_move_count moves.
+ */
+static void
+write_checkpoint (const ExactSolution *const result,
+                  const SearchNode *const node,
+                  const uint32_t searched_move_count)
+{
+  search_checkpoint_t c;
+  memset(&c, 0, sizeof(c));
+  strcpy(c.solver, "es");
+  c.pv_flags = SEARCH_CHECKPOINT_PV_RECORDING;
+  if (pv_full_recording) c.pv_flags |= SEARCH_CHECKPOINT_PV_FULL_RECORDING;
+  c.root_blacks = pve->root_game_position->blacks;
+  c.root_whites = pve->root_game_position->whites;
+  c.root_player = pve->root_game_position->player;
+  c.searched_move_count = searched_move_count;
+  c.value = node->value;
+  c.best_move = node->move;
+  c.node_count = result->node_count;
+  c.leaf_count = result->leaf_count;
+  if (!search_checkpoint_write(checkpoint_file, &c, pve)) {
+    fprintf(stderr, "Warning: unable to write checkpoint file \"%s\".\n", checkpoint_file);
+  }
+}
+
 /**
  * @endcond
  */
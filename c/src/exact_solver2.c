@@ -38,6 +38,7 @@
 #include <stdbool.h>
 
 #include "game_tree_logger.h"
+#include "game_tree_stats.h"
 #include "game_tree_utils.h"
 
 #include "exact_solver2.h"
@@ -53,25 +54,52 @@
  */
 
 /*
- * Elements of a doubly linked list that collects moves.
+ * The maximum number of legal moves that a game position can have.
  */
-typedef struct MoveListElement_ {
-  Square                   sq;           /**< @brief The square field. */
-  uint8_t                  mobility;     /**< @brief The mobility field. */
-  SquareSet                moves;        /**< @brief The move set. */
-  GamePositionX            gpx;          /**< @brief The game position. */
-  struct MoveListElement_ *next;         /**< @brief A pointer to the successor element. */
-} MoveListElement;
+#define MOVE_LIST_MAX_SIZE 64
 
 /*
- * Move list, having head, tail, and elements fields.
+ * A child node record, it collects the game position reached by a move and its legal move set.
+ */
+typedef struct {
+  GamePositionX gpx;                     /**< @brief The game position. */
+  SquareSet     move_set;                /**< @brief The legal move set. */
+} ChildNode;
+
+/*
+ * Weights used by the move ordering score, applied to nodes having at least min_empties empty squares.
+ */
+typedef struct {
+  int min_empties;                       /**< @brief Lower bound of the empties range. */
+  int mobility;                          /**< @brief Weight of the opponent mobility. */
+  int corner_mobility;                   /**< @brief Weight of the corners available to the opponent. */
+  int potential_mobility;                /**< @brief Weight of the opponent potential mobility. */
+} MoveOrderingWeights;
+
+/*
+ * An entry of the transposition table, it caches the shallow search score of a game position.
+ */
+typedef struct {
+  SquareSet blacks;                      /**< @brief The blacks field of the game position. */
+  SquareSet whites;                      /**< @brief The whites field of the game position. */
+  int16_t   score;                       /**< @brief The shallow search score. */
+  int8_t    depth;                       /**< @brief The depth of the search that computed the score. */
+  int8_t    player;                      /**< @brief The player field of the game position, -1 when empty. */
+} TranspositionTableEntry;
+
+/*
+ * Multi-ProbCut parameters for a given empty count.
  *
- * Head and tail are not part of the list.
+ * The value of the exact search is estimated by the linear model a * shallow + b,
+ * where shallow is the value returned by the game_position_es2_shallow_value function,
+ * sigma is the standard deviation of the residual.
  */
 typedef struct {
-  MoveListElement *head;                 /**< @brief Head element, it is not part of the list. */
-  MoveListElement elements[32];          /**< @brief Elements array. */
-} MoveList;
+  int    empties;                        /**< @brief The empty count of the game position. */
+  double a;                              /**< @brief Slope of the linear model. */
+  double b;                              /**< @brief Intercept of the linear model. */
+  double sigma;                          /**< @brief Standard deviation of the residual. */
+} MpcParameters;
 
 
 
@@ -81,14 +109,25 @@ typedef struct {
 
 static void
 game_position_solve_impl (ExactSolution *const result,
-                          GameTreeStack *const stack,
-                          PVCell ***pve_parent_line_p,
-                          MoveListElement *mle);
+                          GameTreeStack *const stack);
 
 static void
-sort_moves_by_mobility_count (MoveList *ml,
-                              const GamePositionX *const gpx,
-                              const SquareSet moves);
+sort_moves_by_mobility_count (GameTreeStack *const stack);
+
+static void
+init_legal_moves_priority_rank (void);
+
+static int
+shallow_search (const GamePositionX *const gpx,
+                const SquareSet moves,
+                const int depth,
+                int alpha,
+                const int beta);
+
+static void
+write_checkpoint (const ExactSolution *const result,
+                  const NodeInfo *const c,
+                  PVCell **const line);
 
 /*
  * Internal variables and constants.
@@ -100,6 +139,16 @@ static PVEnv *pve = NULL;
 /* The logging environment structure. */
 static LogEnv *log_env = NULL;
 
+/* The game tree statistics, NULL when turned off. */
+static GameTreeStats *tree_stats = NULL;
+
+/*
+ * Child nodes reached by the moves piled up into the legal move stack.
+ * The array is indexed in parallel with the legal_move_stack field of the game tree stack,
+ * so the children of a node are contiguous and sorted in the search order.
+ */
+static ChildNode child_node_stack[MAX_LEGAL_MOVE_STACK_COUNT];
+
 /* Drives the PV recording. */
 static bool pv_recording = false;
 
@@ -127,6 +176,80 @@ static const uint64_t legal_moves_priority_mask[] = {
 static const int legal_moves_priority_cluster_count =
   sizeof(legal_moves_priority_mask) / sizeof(legal_moves_priority_mask[0]);
 
+/* The rank of each square, ordered by the legal_moves_priority_mask clusters and then by the square index. */
+static uint8_t legal_moves_priority_rank[64];
+
+/* The four corners. */
+static const SquareSet corner_mask = 0x8100000000000081;
+
+/*
+ * Move ordering weights, sorted by decreasing min_empties.
+ * The first entry having min_empties not greater than the node empty count is selected.
+ * The last entry must have min_empties equal to zero.
+ */
+static const MoveOrderingWeights move_ordering_weights[] = {
+  { 12, 8, 16, 1 },
+  {  0, 1, 0, 0 }
+};
+
+/*
+ * Nodes having at least this count of empty squares sort the moves by the score of a shallow search
+ * executed on each child, instead of the move_ordering_score heuristic.
+ */
+static const int shallow_search_min_empties = 16;
+
+/* The depth of the shallow search used for move ordering. */
+static const int shallow_search_depth = 4;
+
+/* Final values are scaled by this factor to dominate the quick evaluation into the shallow search. */
+static const int shallow_search_final_value_scale = 64;
+
+/* The shallow search window bound, greater than any score it can return. */
+static const int shallow_search_infinity = 8192;
+
+/* The number of bits used to index the transposition table. */
+#define TRANSPOSITION_TABLE_BITS 16
+
+/* The transposition table, caching the shallow search scores. */
+static TranspositionTableEntry transposition_table[1 << TRANSPOSITION_TABLE_BITS];
+
+/*
+ * Multi-ProbCut parameters, sorted by increasing empties, computed by the mpc_fit utility
+ * on db/gpdb-ffo.txt, from 16 to 20 empties, as shallow_search_min_empties is 16.
+ * Nodes having more empties than the last entry use the last entry.
+ */
+static const MpcParameters mpc_parameters[] = {
+  { 16, 1.6098, -0.5037, 11.6040 },
+  { 17, 1.5452, -0.3502, 10.3085 },
+  { 18, 1.5865, +1.7123, 12.7470 },
+  { 19, 1.5718, +1.5916, 11.4657 },
+  { 20, 1.7711, +0.5715, 12.5364 }
+};
+
+/* The size of the mpc_parameters array. */
+static const int mpc_parameters_count = sizeof(mpc_parameters) / sizeof(mpc_parameters[0]);
+
+/*
+ * Multiplier of sigma, indexed by the selectivity level, giving the cut margin.
+ * Confidence levels are 100% (exact search), 99%, 95%, 90%, and 75%.
+ */
+static const double mpc_sigma_factor[ES2_SELECTIVITY_LEVEL_COUNT] = { 0.0, 2.58, 1.96, 1.64, 1.15 };
+
+/* Number of plies having the move values collected, zero turns off line counting. */
+static int move_values_depth = 0;
+
+/* Turns on the search of all the moves having the best value, it is required by full PV recording and by line counting. */
+static bool tie_search = false;
+
+/* The sigma multiplier selected for the search, zero turns off Multi-ProbCut. */
+static double mpc_margin_factor = 0.0;
+
+/* When not NULL a checkpoint is written to the file after the search of each root move. */
+static const char *checkpoint_file = NULL;
+
+/* When not NULL the search of the root node is resumed from the checkpoint. */
+static const search_checkpoint_t *resumed_checkpoint = NULL;
+
 /* Print debugging info ... */
 static const bool pv_internals_to_stream = false;
 
@@ -157,39 +280,69 @@ game_position_es2_solve (const GamePositionX *const root,
   assert(root);
   assert(env);
 
-  const GamePosition *const root_gp = game_position_x_gpx_to_gp(root);
-
   ExactSolution *result = exact_solution_new();
-  result->solved_game_position = game_position_clone(root_gp);
+  exact_solution_set_solved_game_position_x(result, root);
 
   GameTreeStack *stack = game_tree_stack_new();
   game_tree_stack_init(root, stack);
+  NodeInfo *ground_node_info = &stack->nodes[0];
   NodeInfo *first_node_info = &stack->nodes[1];
 
   pv_recording = env->pv_recording;
   pv_full_recording = env->pv_full_recording;
-  if (pv_full_recording) {
-    first_node_info->alpha = out_of_range_defeat_score;
-    first_node_info->beta = out_of_range_win_score;
+  move_values_depth = env->move_values_depth;
+  tie_search = pv_full_recording || move_values_depth > 0;
+  checkpoint_file = env->checkpoint_file;
+  resumed_checkpoint = env->checkpoint;
+
+  assert(env->selectivity >= 0 && env->selectivity < ES2_SELECTIVITY_LEVEL_COUNT);
+  assert(env->selectivity == 0 || !pv_recording);
+  assert(move_values_depth >= 0 && move_values_depth <= EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH);
+  assert(env->selectivity == 0 || move_values_depth == 0);
+  assert(!checkpoint_file || move_values_depth == 0);
+  mpc_margin_factor = mpc_sigma_factor[env->selectivity];
+
+  init_legal_moves_priority_rank();
+  for (size_t i = 0; i < sizeof(transposition_table) / sizeof(transposition_table[0]); i++)
+    transposition_table[i].player = -1;
+
+  /* The root node receives its search window from the ground node. */
+  if (tie_search) {
+    ground_node_info->alpha = - out_of_range_win_score;
+    ground_node_info->beta = - out_of_range_defeat_score;
   } else {
-    first_node_info->alpha = worst_score;
-    first_node_info->beta = best_score;
+    ground_node_info->alpha = - best_score;
+    ground_node_info->beta = - worst_score;
   }
 
   if (pv_recording) {
-    //GamePositionX *rootx = game_position_x_gp_to_gpx(root);
-    pve = pve_new(root);
-    //game_position_x_free(rootx);
+    if (resumed_checkpoint) {
+      pve = search_checkpoint_load_pve(checkpoint_file, resumed_checkpoint);
+      if (!pve) {
+        fprintf(stderr, "Unable to load the PVE dump of checkpoint file \"%s\".\n", checkpoint_file);
+        abort();
+      }
+    } else {
+      pve = pve_new(root);
+    }
+  }
+
+  /* The root node is going to be counted again. */
+  if (resumed_checkpoint) {
+    result->node_count = resumed_checkpoint->node_count - 1;
+    result->leaf_count = resumed_checkpoint->leaf_count;
   }
 
   log_env = game_tree_log_init(env->log_file);
   if (log_env->log_is_on) {
+    game_tree_log_set_filters(log_env, env->log_max_depth, env->log_sample_rate, env->log_root_moves);
     game_tree_log_open_h(log_env);
+    stack->hash_is_on = true;
   }
+  if (env->tree_stats) tree_stats = game_tree_stats_new();
 
-  MoveListElement root_mle;
-  root_mle.moves = game_position_x_legal_moves(root);
-  game_position_solve_impl(result, stack, &(pve->root_line), &root_mle);
+  first_node_info->move_set = game_position_x_legal_moves(root);
+  game_position_solve_impl(result, stack);
 
   if (pv_recording && pv_full_recording && !env->pv_no_print) {
     printf("\n --- --- pve_line_with_variants_to_string() START --- ---\n");
@@ -240,7 +393,8 @@ game_position_es2_solve (const GamePositionX *const root,
     exact_solution_compute_final_board(result);
     if (env->pve_dump_file) {
       printf("\n --- --- pve_dump_to_binary_file() START --- ---\n");
-      pve_dump_to_binary_file(pve, env->pve_dump_file);
+      if (!pve_dump_to_binary_file(pve, env->pve_dump_file))
+        fprintf(stderr, "Unable to write the PVE dump file \"%s\".\n", env->pve_dump_file);
       printf(" --- --- pve_dump_to_binary_file() COMPLETED --- ---\n");
     }
     pve_free(pve);
@@ -248,9 +402,37 @@ game_position_es2_solve (const GamePositionX *const root,
 
   game_tree_log_close(log_env);
 
+  if (tree_stats) {
+    game_tree_stats_print(tree_stats, stdout);
+    game_tree_stats_free(tree_stats);
+    tree_stats = NULL;
+  }
+
   return result;
 }
 
+/**
+ * @brief Returns the value of the shallow search used by the Multi-ProbCut selective search.
+ *
+ * @details The value is the one computed at the nodes where the cut is tried, it is not
+ *          a disc count, and it is mapped to the exact value by the Multi-ProbCut parameters.
+ *          The function is the hook used by the `mpc_fit` utility to learn them.
+ *
+ * @invariant Parameter `gpx` must be not `NULL`, and must have at least one legal move.
+ *             The invariants are guarded by assertions.
+ *
+ * @param [in] gpx the game position
+ * @return         the shallow search value
+ */
+int
+game_position_es2_shallow_value (const GamePositionX *const gpx)
+{
+  assert(gpx);
+  const SquareSet moves = game_position_x_legal_moves(gpx);
+  assert(moves);
+  return shallow_search(gpx, moves, shallow_search_depth + 1, -shallow_search_infinity, shallow_search_infinity);
+}
+
 
 
 /**
@@ -262,167 +444,482 @@ game_position_es2_solve (const GamePositionX *const root,
  */
 
 /*
- * TODO
- * What to try:
- * - Make a stack of moves with pointers ...... integrated into the tree stack .....
+ * Returns the empty squares adjacent to at least one square belonging to `squares`.
  */
-static void
-sort_moves_by_mobility_count (MoveList *ml,
-                              const GamePositionX *const gpx,
-                              const SquareSet moves)
+static inline SquareSet
+empty_neighbours (const SquareSet squares,
+                  const SquareSet empties)
 {
-  assert(game_position_x_legal_moves(gpx) == moves);
+  const SquareSet not_a_file = 0xfefefefefefefefe;
+  const SquareSet not_h_file = 0x7f7f7f7f7f7f7f7f;
+  const SquareSet w = (squares >> 1) & not_h_file;
+  const SquareSet e = (squares << 1) & not_a_file;
+  const SquareSet row = squares | w | e;
+  return (row | row >> 8 | row << 8) & empties;
+}
 
-  ml->head = NULL;
-  MoveListElement *e = ml->elements;
+/*
+ * Returns the move ordering weights for a node having `empty_count` empty squares.
+ */
+static inline const MoveOrderingWeights *
+select_move_ordering_weights (const int empty_count)
+{
+  const MoveOrderingWeights *w = move_ordering_weights;
+  while (w->min_empties > empty_count) w++;
+  return w;
+}
 
-  SquareSet moves_to_search = moves;
-  for (int i = 0; i < legal_moves_priority_cluster_count; i++) {
-    moves_to_search = legal_moves_priority_mask[i] & moves;
-    while (moves_to_search) {
-      const Square move = bit_works_bitscanLS1B_64_bsf(moves_to_search);
-      moves_to_search &= ~(1ULL << move);
-      game_position_x_make_move(gpx, move, &e->gpx);
-      const SquareSet next_moves = game_position_x_legal_moves(&e->gpx);
-      const int next_move_count = bit_works_bitcount_64_popcnt(next_moves);
-      e->sq = move;
-      e->mobility = next_move_count;
-      e->moves = next_moves;
-
-      MoveListElement **epp = &(ml->head);
-      if (!*epp) {
-        ml->head = e;
-        e->next = NULL;
-        goto out;
-      }
-      while (true) {
-        if (e->mobility < (*epp)->mobility) { /* Insert e before cursor. */
-          e->next = *epp;
-          *epp = e;
-          goto out;
-        }
-        if ((*epp)->next == NULL) {
-          (*epp)->next = e;
-          e->next = NULL;
-          goto out;
-        }
-        epp = &((*epp)->next);
+/*
+ * Returns the move ordering score of the child node, the lower the better.
+ *
+ * The score combines the mobility left to the opponent, the corners it can play,
+ * and its potential mobility, measured as the count of empty squares adjacent
+ * to the discs of the player that has just moved.
+ */
+static inline uint32_t
+move_ordering_score (const ChildNode *const child,
+                     const MoveOrderingWeights *const w)
+{
+  uint32_t score = w->mobility * bit_works_bitcount_64_popcnt(child->move_set);
+  if (w->corner_mobility) score += w->corner_mobility * bit_works_bitcount_64_popcnt(child->move_set & corner_mask);
+  if (w->potential_mobility) {
+    const SquareSet empties = ~(child->gpx.blacks | child->gpx.whites);
+    const SquareSet mover = game_position_x_get_opponent(&child->gpx);
+    score += w->potential_mobility * bit_works_bitcount_64_popcnt(empty_neighbours(mover, empties));
+  }
+  return score;
+}
+
+/*
+ * Returns a quick evaluation of the game position, from the point of view of the player to move.
+ *
+ * The evaluation combines the mobility difference and the corner occupation difference.
+ * Parameter `moves` is the legal move set of the game position.
+ */
+static inline int
+quick_evaluation (const GamePositionX *const gpx,
+                  const SquareSet moves)
+{
+  GamePositionX next;
+  game_position_x_pass(gpx, &next);
+  const SquareSet opponent_moves = game_position_x_legal_moves(&next);
+  const SquareSet player = game_position_x_get_player(gpx);
+  const SquareSet opponent = game_position_x_get_opponent(gpx);
+  return bit_works_bitcount_64_popcnt(moves)
+    - bit_works_bitcount_64_popcnt(opponent_moves)
+    + 4 * (bit_works_bitcount_64_popcnt(moves & corner_mask)
+           - bit_works_bitcount_64_popcnt(opponent_moves & corner_mask))
+    + 8 * (bit_works_bitcount_64_popcnt(player & corner_mask)
+           - bit_works_bitcount_64_popcnt(opponent & corner_mask));
+}
+
+/*
+ * Depth limited alpha-beta search, leaves are scored by the quick_evaluation function.
+ *
+ * Parameter `moves` is the legal move set of the game position.
+ * A pass does not consume depth, a game end returns the scaled final value.
+ */
+static int
+shallow_search (const GamePositionX *const gpx,
+                const SquareSet moves,
+                const int depth,
+                int alpha,
+                const int beta)
+{
+  if (depth == 0) return quick_evaluation(gpx, moves);
+
+  GamePositionX next;
+  if (!moves) {
+    game_position_x_pass(gpx, &next);
+    const SquareSet next_moves = game_position_x_legal_moves(&next);
+    if (!next_moves) return shallow_search_final_value_scale * game_position_x_final_value(gpx);
+    return - shallow_search(&next, next_moves, depth, -beta, -alpha);
+  }
+
+  int best = -shallow_search_infinity;
+  SquareSet remaining_moves = moves;
+  while (remaining_moves) {
+    const Square move = bit_works_bitscanLS1B_64_bsf(remaining_moves);
+    remaining_moves = bit_works_reset_lowest_bit_set_64_blsr(remaining_moves);
+    game_position_x_make_move(gpx, move, &next);
+    const int v = - shallow_search(&next, game_position_x_legal_moves(&next), depth - 1, -beta, -alpha);
+    if (v > best) {
+      best = v;
+      if (v > alpha) {
+        alpha = v;
+        if (alpha >= beta) break;
       }
-    out:
-      e++;
     }
   }
+  return best;
+}
 
-  return;
+/*
+ * Returns the transposition table entry assigned to the game position.
+ */
+static inline TranspositionTableEntry *
+transposition_table_entry (const GamePositionX *const gpx)
+{
+  const uint64_t h = (gpx->blacks * 0x9e3779b97f4a7c15ULL) ^ (gpx->whites * 0xc2b2ae3d27d4eb4fULL) ^ gpx->player;
+  return &transposition_table[h >> (64 - TRANSPOSITION_TABLE_BITS)];
 }
 
+/*
+ * Returns the shallow search score of the child node, from the point of view of the opponent.
+ *
+ * The score is looked up into the transposition table, and computed and saved when missing.
+ */
+static int
+shallow_search_score (const ChildNode *const child)
+{
+  TranspositionTableEntry *const e = transposition_table_entry(&child->gpx);
+  if (e->player == child->gpx.player && e->blacks == child->gpx.blacks && e->whites == child->gpx.whites
+      && e->depth >= shallow_search_depth)
+    return e->score;
+  const int score = shallow_search(&child->gpx, child->move_set, shallow_search_depth,
+                                   -shallow_search_infinity, shallow_search_infinity);
+  e->blacks = child->gpx.blacks;
+  e->whites = child->gpx.whites;
+  e->player = child->gpx.player;
+  e->depth = shallow_search_depth;
+  e->score = score;
+  return score;
+}
+
+/*
+ * Returns the Multi-ProbCut parameters for a node having `empty_count` empty squares.
+ */
+static inline const MpcParameters *
+select_mpc_parameters (const int empty_count)
+{
+  int i = 0;
+  while (i < mpc_parameters_count - 1 && mpc_parameters[i].empties < empty_count) i++;
+  return &mpc_parameters[i];
+}
 
 /*
- * TODO
- * What to try:
- * - Avoid recursion .... write a "compact" iterative function.
- * - Avoid the special case of PASSING .....
+ * Sorts in ascending order the short array of packed keys `a`, having length `n`.
+ */
+static inline void
+sort_packed_keys (uint32_t *const a,
+                  const int n)
+{
+  for (int i = 1; i < n; i++) {
+    const uint32_t key = a[i];
+    int j = i - 1;
+    for ( ; j >= 0 && a[j] > key; j--) a[j + 1] = a[j];
+    a[j + 1] = key;
+  }
+}
+
+/*
+ * Computes the legal move list of the active node, sorting it by the move ordering score.
+ *
+ * The legal move set of the node must be already assigned.
+ * Moves are written into the legal move stack, starting from the head of the legal
+ * move list of the node, in ascending order of the score assigned by the move_ordering_score
+ * function, using the weights selected by the node empty count.
+ * Nodes having at least shallow_search_min_empties empty squares are sorted instead
+ * by the shallow_search_score of the children.
+ * Ties are broken by the legal_moves_priority_rank ordering.
+ * The child node reached by each move is saved into the child_node_stack array,
+ * at the same index of the move.
+ * When no legal move is available the list is made by the pass move only.
+ *
+ * The sort key packs, from the most significant bits, the score, the priority rank,
+ * and the index of the child into the local array.
  */
 static void
-game_position_solve_impl (ExactSolution *const result,
-                          GameTreeStack *const stack,
-                          PVCell ***pve_parent_line_p,
-                          MoveListElement *mle)
+sort_moves_by_mobility_count (GameTreeStack *const stack)
 {
-  result->node_count++;
-  PVCell **pve_line = NULL;
+  NodeInfo *const c = stack->active_node;
+  const SquareSet moves = c->move_set;
+  uint8_t *const holml = c->head_of_legal_move_list;
 
-  NodeInfo *const current_node_info = ++stack->active_node;
-  NodeInfo *const next_node_info = current_node_info + 1;
-  NodeInfo *const previous_node_info = current_node_info - 1;
+  assert(game_position_x_legal_moves(&c->gpx) == moves);
 
-  const int sub_run_id = 0;
+  c->move_cursor = holml;
 
-  const GamePositionX *const current_gpx = &current_node_info->gpx;
-  GamePositionX *const next_gpx = &next_node_info->gpx;
-  const SquareSet move_set = mle->moves;
-  current_node_info->move_count = bit_works_bitcount_64_popcnt(move_set);
+  if (!moves) {
+    *holml = pass_move;
+    c->move_count = 1;
+    (c + 1)->head_of_legal_move_list = holml + 1;
+    return;
+  }
 
-  if (log_env->log_is_on) {
-    current_node_info->hash = game_position_x_hash(current_gpx);
-    LogDataH log_data;
-    log_data.sub_run_id = sub_run_id;
-    log_data.call_id = result->node_count;
-    log_data.hash = current_node_info->hash;
-    log_data.parent_hash = previous_node_info->hash;
-    log_data.blacks = current_gpx->blacks;
-    log_data.whites = current_gpx->whites;
-    log_data.player = current_gpx->player;
-    gchar *json_doc = game_tree_log_data_h_json_doc2(stack->active_node - stack->nodes, current_gpx);
-    log_data.json_doc = json_doc;
-    log_data.json_doc_len = strlen(json_doc);
-    game_tree_log_write_h(log_env, &log_data);
-    g_free(json_doc);
+  const int empty_count = bit_works_bitcount_64_popcnt(~(c->gpx.blacks | c->gpx.whites));
+  const MoveOrderingWeights *const w = select_move_ordering_weights(empty_count);
+
+  ChildNode children[MOVE_LIST_MAX_SIZE];
+  Square squares[MOVE_LIST_MAX_SIZE];
+  uint32_t keys[MOVE_LIST_MAX_SIZE];
+
+  int n = 0;
+  SquareSet remaining_moves = moves;
+  while (remaining_moves) {
+    const Square move = bit_works_bitscanLS1B_64_bsf(remaining_moves);
+    remaining_moves = bit_works_reset_lowest_bit_set_64_blsr(remaining_moves);
+    ChildNode *const child = &children[n];
+    game_position_x_make_move(&c->gpx, move, &child->gpx);
+    child->move_set = game_position_x_legal_moves(&child->gpx);
+    const uint32_t score = (empty_count >= shallow_search_min_empties)
+      ? shallow_search_score(child) + shallow_search_infinity
+      : move_ordering_score(child, w);
+    squares[n] = move;
+    keys[n] = score << 16 | legal_moves_priority_rank[move] << 8 | n;
+    n++;
   }
 
-  if (move_set == empty_square_set) {
-    if (pv_recording) pve_line = pve_line_create(pve);
-    const int previous_move_count = previous_node_info->move_count;
-    //const SquareSet empties = game_position_x_empties(current_gpx); // TODO:
-    //if (empties != empty_square_set && previous_move_count != 0) {
-    if (previous_move_count != 0) {
-      game_position_x_pass(current_gpx, next_gpx);
-      next_node_info->alpha = -current_node_info->beta;
-      next_node_info->beta = -current_node_info->alpha;
-      MoveListElement next_mle;
-      next_mle.moves = game_position_x_legal_moves(next_gpx);
-      game_position_solve_impl(result, stack, &pve_line, &next_mle);
-      current_node_info->alpha = -next_node_info->alpha;
-      current_node_info->best_move = next_node_info->best_move;
-    } else {
-      result->leaf_count++;
-      current_node_info->alpha = game_position_x_final_value(current_gpx);
-      current_node_info->best_move = pass_move;
+  sort_packed_keys(keys, n);
+
+  ChildNode *const child_nodes = &child_node_stack[holml - stack->legal_move_stack];
+  for (int i = 0; i < n; i++) {
+    const int k = keys[i] & 0xFF;
+    child_nodes[i] = children[k];
+    holml[i] = squares[k];
+  }
+
+  c->move_count = n;
+  (c + 1)->head_of_legal_move_list = holml + n;
+}
+
+/*
+ * Computes the legal_moves_priority_rank table from the legal_moves_priority_mask clusters.
+ */
+static void
+init_legal_moves_priority_rank (void)
+{
+  uint8_t rank = 0;
+  for (int i = 0; i < legal_moves_priority_cluster_count; i++) {
+    SquareSet cluster = legal_moves_priority_mask[i];
+    while (cluster) {
+      const Square sq = bit_works_bitscanLS1B_64_bsf(cluster);
+      cluster = bit_works_reset_lowest_bit_set_64_blsr(cluster);
+      legal_moves_priority_rank[sq] = rank++;
+    }
+  }
+}
+
+/*
+ * Iterative search function.
+ *
+ * The game tree is traversed without recursion, the state of each level is kept
+ * by the node info structures of the stack, legal moves are piled up into the
+ * legal move stack. Passing is handled as a regular move, the pass move being
+ * the only element of the move list.
+ *
+ * When Multi-ProbCut is on, nodes having at least shallow_search_min_empties empty squares,
+ * the root excluded, are cut when the value of the shallow search, mapped by the linear model,
+ * falls outside the search window by more than the selected margin. The first move in the
+ * ordered list is the best child of the shallow search, and it is taken as the best move.
+ *
+ * When PV recording is on, lines[i] is the line collecting the principal variation
+ * of the node i. It is created when the node is entered, and it is replaced by the
+ * line of the best child when the child value is accepted.
+ * When full PV recording is on, child lines are shared among the cells reaching the same
+ * game position. The search window given to the child is the sharing context, being the
+ * search deterministic given the game position and the window.
+ *
+ * When line counting is on, counts[i] is the number of distinct optimal lines of the node i.
+ * It is computed as lines are, the count of the best child is taken, and the ones of the
+ * children having the same value are added, without recording any line.
+ * Nodes within the first move_values_depth plies search their children with the full window,
+ * so that the value of every move is exact, and is collected into the result.
+ *
+ * When checkpoints are on, the state of the root node is saved after the search of each move,
+ * and when the root node is a leaf, so that the last checkpoint is written on every exit path.
+ * When resuming, the root node takes its value, best move, and line from the checkpoint,
+ * and the moves already searched are skipped, being the move order deterministic.
+ * The checkpoint is applied before the leaf and pass handling, a root node having all of
+ * its moves searched, the pass included, is not searched again.
+ */
+static void
+game_position_solve_impl (ExactSolution *const result,
+                          GameTreeStack *const stack)
+{
+  PVCell **lines[GAME_TREE_MAX_DEPTH];
+  uint64_t counts[GAME_TREE_MAX_DEPTH];
+  NodeInfo *c;
+  bool resumed;
+  const NodeInfo *const root = stack->active_node;
+
+ begin:
+  result->node_count++;
+  c = ++stack->active_node;
+  c->alpha = - (c - 1)->beta;
+  c->beta = - (c - 1)->alpha;
+  c->best_move = invalid_move;
+  if (c - root - 1 <= move_values_depth && c - root > 1) {
+    c->alpha = out_of_range_defeat_score;
+    c->beta = out_of_range_win_score;
+  }
+  counts[c - stack->nodes] = 0;
+
+  sort_moves_by_mobility_count(stack);
+  if (stack->hash_is_on) gts_compute_hash(stack);
+  if (log_env->log_is_on) do_log(result, stack, sub_run_id, log_env);
+  if (tree_stats) game_tree_stats_add_node(tree_stats, c - root - 1, &c->gpx);
+  if (pv_recording) lines[c - stack->nodes] = pve_line_create(pve);
+
+  resumed = c == root + 1 && resumed_checkpoint;
+  if (resumed) {
+    c->alpha = resumed_checkpoint->value;
+    c->best_move = resumed_checkpoint->best_move;
+    c->move_cursor += resumed_checkpoint->searched_move_count;
+    if (pv_recording) {
+      /* The line created by the interrupted search is already counted. */
+      PVCell **const empty_line = lines[c - stack->nodes];
+      lines[c - stack->nodes] = pve->root_line;
+      pve->root_line = empty_line;
+      pve->line_create_count--;
     }
+    resumed_checkpoint = NULL;
+    /* Terminal and pass root nodes are checkpointed only once completed. */
+    if (c->move_cursor == (c + 1)->head_of_legal_move_list) goto end;
+  }
+
+  if (gts_is_terminal_node(stack)) {
+    result->leaf_count++;
+    c->alpha = game_position_x_final_value(&c->gpx);
+    c->best_move = pass_move;
+    counts[c - stack->nodes] = 1;
     if (pv_recording) {
-      pve_line_add_move2(pve, pve_line, pass_move, next_gpx);
-      pve_line_delete(pve, *pve_parent_line_p);
-      *pve_parent_line_p = pve_line;
+      game_position_x_pass(&c->gpx, &(c + 1)->gpx);
+      pve_line_add_move2(pve, lines[c - stack->nodes], pass_move, &(c + 1)->gpx);
     }
-  } else {
-    MoveList ml;
-    bool branch_is_active = false;
-    sort_moves_by_mobility_count(&ml, current_gpx, move_set);
-    if (pv_full_recording) current_node_info->alpha -= 1;
-    for (MoveListElement *element = ml.head; element; element = element->next) {
-      const Square move = element->sq;
-      game_position_x_copy(&element->gpx, next_gpx);
-      if (pv_recording) pve_line = pve_line_create(pve);
-      next_node_info->alpha = -current_node_info->beta;
-      next_node_info->beta = -current_node_info->alpha;
-      game_position_solve_impl(result, stack, &pve_line, element);
-      const int current_alpha = current_node_info->alpha;
-      if (-next_node_info->alpha > current_alpha || (!branch_is_active && -next_node_info->alpha == current_alpha)) {
-        branch_is_active = true;
-        current_node_info->alpha = -next_node_info->alpha;
-        current_node_info->best_move = move;
+    if (c == root + 1 && checkpoint_file) write_checkpoint(result, c, pv_recording ? lines[c - stack->nodes] : NULL);
+    goto end;
+  }
+
+  if (!c->move_set) {
+    if (stack->hash_is_on) {
+      stack->flip_count = 1;
+      *stack->flips = pass_move;
+    }
+    goto begin;
+  }
+
+  if (mpc_margin_factor > 0.0 && c != root + 1) {
+    const int empty_count = bit_works_bitcount_64_popcnt(~(c->gpx.blacks | c->gpx.whites));
+    if (empty_count >= shallow_search_min_empties) {
+      const MpcParameters *const p = select_mpc_parameters(empty_count);
+      const int shallow = - shallow_search_score(&child_node_stack[c->move_cursor - stack->legal_move_stack]);
+      const double estimate = p->a * shallow + p->b;
+      const double margin = mpc_margin_factor * p->sigma;
+      if (estimate - margin >= c->beta) {
+        c->alpha = c->beta;
+        c->best_move = *c->move_cursor;
+        goto end;
+      }
+      if (estimate + margin <= c->alpha) {
+        c->best_move = *c->move_cursor;
+        goto end;
+      }
+    }
+  }
+
+  /* The value taken from the checkpoint has already been adjusted. */
+  if (tie_search && !resumed) c->alpha -= 1;
+
+  for ( ; c->move_cursor < (c + 1)->head_of_legal_move_list; c->move_cursor++) {
+    const ChildNode *const child = &child_node_stack[c->move_cursor - stack->legal_move_stack];
+    if (stack->hash_is_on) {
+      gts_make_move(stack);
+    } else {
+      (c + 1)->gpx = child->gpx;
+    }
+    (c + 1)->move_set = child->move_set;
+    goto begin;
+  entry:
+    {
+      const Square move = *c->move_cursor;
+      const int value = - (c + 1)->alpha;
+      PVCell **const child_line = lines[c - stack->nodes + 1];
+      const uint64_t child_context = (uint64_t) (uint32_t) c->alpha << 32 | (uint32_t) c->beta;
+      const uint64_t child_count = counts[c - stack->nodes + 1];
+      bool cut = false;
+      if (c - root - 1 < move_values_depth) {
+        Square path[EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH];
+        const int ply = c - root - 1;
+        for (int i = 0; i < ply; i++) path[i] = *(root + 1 + i)->move_cursor;
+        exact_solution_add_move_value(result, path, ply, move, value, child_count);
+      }
+      if (value > c->alpha || (c->best_move == invalid_move && value == c->alpha) || move == pass_move) {
+        if (pv_full_recording) {
+          pve_line_add_move_shared(pve, child_line, move, &(c + 1)->gpx, child_context);
+        } else if (pv_recording) {
+          pve_line_add_move2(pve, child_line, move, &(c + 1)->gpx);
+        }
+        c->alpha = value;
+        c->best_move = move;
+        counts[c - stack->nodes] = child_count;
         if (pv_recording) {
-          pve_line_add_move2(pve, pve_line, move, next_gpx);
-          pve_line_delete(pve, *pve_parent_line_p);
-          *pve_parent_line_p = pve_line;
+          pve_line_delete(pve, lines[c - stack->nodes]);
+          lines[c - stack->nodes] = child_line;
         }
-        if (current_node_info->alpha > current_node_info->beta) goto out;
-        if (!pv_full_recording && current_node_info->alpha == current_node_info->beta) goto out;
+        cut = c->alpha > c->beta || (!tie_search && c->alpha == c->beta);
       } else {
+        if (tie_search && value == c->alpha) {
+          uint64_t *const count = &counts[c - stack->nodes];
+          *count = (*count > UINT64_MAX - child_count) ? UINT64_MAX : *count + child_count;
+        }
         if (pv_recording) {
-          if (pv_full_recording && -next_node_info->alpha == current_alpha) {
-            pve_line_add_move2(pve, pve_line, move, next_gpx);
-            pve_line_add_variant(pve, *pve_parent_line_p, pve_line);
+          if (pv_full_recording && value == c->alpha) {
+            pve_line_add_move_shared(pve, child_line, move, &(c + 1)->gpx, child_context);
+            pve_line_add_variant(pve, lines[c - stack->nodes], child_line);
           } else {
-            pve_line_delete(pve, pve_line);
+            pve_line_delete(pve, child_line);
           }
         }
       }
+      if (c == root + 1 && checkpoint_file) write_checkpoint(result, c, pv_recording ? lines[c - stack->nodes] : NULL);
+      if (cut) goto end;
     }
   }
- out:
-  stack->active_node--;
-  return;
+
+ end:
+  if (log_env->log_is_on) do_log_exit(result, stack, sub_run_id, log_env);
+  c = --stack->active_node;
+  if (stack->active_node != root) goto entry;
+
+  if (move_values_depth) result->optimal_line_count = counts[root - stack->nodes + 1];
+
+  if (pv_recording) {
+    pve_line_delete(pve, pve->root_line);
+    pve->root_line = lines[root - stack->nodes + 1];
+  }
+}
+
+/*
+ * Writes the checkpoint of the root node c, after the search of the move under the cursor.
+ * Parameter line is the best line of the root node, NULL when the PV is not recorded.
+ */
+static void
+write_checkpoint (const ExactSolution *const result,
+                  const NodeInfo *const c,
+                  PVCell **const line)
+{
+  search_checkpoint_t ckp;
+  memset(&ckp, 0, sizeof(ckp));
+  strcpy(ckp.solver, "es2");
+  if (pv_recording) ckp.pv_flags |= SEARCH_CHECKPOINT_PV_RECORDING;
+  if (pv_full_recording) ckp.pv_flags |= SEARCH_CHECKPOINT_PV_FULL_RECORDING;
+  ckp.root_blacks = c->gpx.blacks;
+  ckp.root_whites = c->gpx.whites;
+  ckp.root_player = c->gpx.player;
+  ckp.searched_move_count = c->move_cursor - c->head_of_legal_move_list + 1;
+  ckp.value = c->alpha;
+  ckp.best_move = c->best_move;
+  ckp.node_count = result->node_count;
+  ckp.leaf_count = result->leaf_count;
+
+  /* The dump starts from the root line, that is temporarily replaced by the best line. */
+  PVCell **const root_line = pv_recording ? pve->root_line : NULL;
+  if (pv_recording) pve->root_line = line;
+  if (!search_checkpoint_write(checkpoint_file, &ckp, pv_recording ? pve : NULL)) {
+    fprintf(stderr, "Warning: unable to write checkpoint file \"%s\".\n", checkpoint_file);
+  }
+  if (pv_recording) pve->root_line = root_line;
 }
 
 /**
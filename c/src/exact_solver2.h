@@ -42,6 +42,16 @@
 
 
 
+/**
+ * @brief The number of selectivity levels accepted by the es2 solver.
+ *
+ * @details Level zero is the exact search, levels from one onward turn on the
+ *          Multi-ProbCut selective search with decreasing confidence.
+ */
+#define ES2_SELECTIVITY_LEVEL_COUNT 5
+
+
+
 /*********************************************************/
 /* Function implementations for the GamePosition entity. */
 /*********************************************************/
@@ -50,5 +60,8 @@ extern ExactSolution *
 game_position_es2_solve (const GamePositionX *const root,
                          const endgame_solver_env_t *const env);
 
+extern int
+game_position_es2_shallow_value (const GamePositionX *const gpx);
+
 
 #endif /* EXACT_SOLVER2_H */
@@ -0,0 +1,357 @@
+/**
+ * @file
+ *
+ * @brief Looks up records of a game tree log dat file by hash.
+ * @details This executable queries the head log file written by the solvers, by means of a sidecar
+ * hash index, that is built by the first query, and rebuilt when the head file changes.
+ *
+ * @par game_tree_log_lookup.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "game_tree_logger.h"
+
+
+
+/**
+ * @cond
+ */
+
+/* Static constants. */
+
+static const gchar *program_documentation_string =
+  "Description:\n"
+  "Game Tree Log Lookup is a program that queries a game tree log by hash, without loading it into the database.\n"
+  "The file is the head log written by the solvers when logging is turned on.\n"
+  "Queries are:\n"
+  "  nodes:    the records having the given hash\n"
+  "  children: the records having the given hash as parent hash\n"
+  "  path:     the records on the path from the root to the first record having the given hash\n"
+  "Records are written to the standard output as CSV, in the format of the read_game_tree_log program,\n"
+  "exit records are not written.\n"
+  "Hash values are given as signed decimal numbers, as found in the CSV output, or as hexadecimal numbers prefixed by 0x.\n"
+  "The sidecar hash index is written next to the input file, with the .hix suffix, by the first query, and\n"
+  "it is rebuilt when the input file changes.\n"
+  "\n"
+  "Author:\n"
+  "   Written by Roberto Corradini <rob_corradini@yahoo.it>\n"
+  "\n"
+  "Copyright (c) 2017 Roberto Corradini. All rights reserved.\n"
+  "License GPLv3+: GNU GPL version 3 or later <http://gnu.org/licenses/gpl.html>.\n"
+  "This is free software: you are free to change and redistribute it. There is NO WARRANTY, to the extent permitted by law.\n"
+  ;
+
+
+
+/* Static variables. */
+
+static gchar *input_file = NULL;
+static gchar *index_file = NULL;
+static gchar *hash_arg = NULL;
+static gchar *query = NULL;
+static gboolean rebuild = FALSE;
+
+static const GOptionEntry entries[] =
+  {
+    { "input-file",  'f', 0, G_OPTION_ARG_FILENAME, &input_file, "Input file name - Mandatory", NULL },
+    { "hash",        'x', 0, G_OPTION_ARG_STRING,   &hash_arg,   "Hash value - Mandatory, unless option rebuild is given", NULL },
+    { "query",       'q', 0, G_OPTION_ARG_STRING,   &query,      "Query - Must be in [nodes|children|path], defaults to nodes", NULL },
+    { "index-file",  'i', 0, G_OPTION_ARG_FILENAME, &index_file, "Hash index file name - Defaults to the input file name followed by .hix", NULL },
+    { "rebuild",     'r', 0, G_OPTION_ARG_NONE,     &rebuild,    "Rebuilds the hash index", NULL },
+    { NULL }
+  };
+
+
+
+/* Static functions. */
+
+static bool
+parse_hash (const char *const s,
+            uint64_t *const hash);
+
+static int
+build_hash_index (FILE *const log_fp,
+                  const char *const file_name);
+
+static int
+print_record (FILE *const fp,
+              const LogBlockIndexEntryH *const blocks,
+              const size_t block_count,
+              const uint64_t ordinal,
+              LogBlockH *const block);
+
+/**
+ * @endcond
+ */
+
+
+
+/**
+ * @brief Main entry for the Game Tree Log Lookup utility.
+ */
+int
+main (int argc, char *argv[])
+{
+  /* GLib command line options and argument parsing. */
+  GError *error = NULL;
+  GOptionGroup *option_group = g_option_group_new("name", "description", "help_description", NULL, NULL);
+  GOptionContext *context = g_option_context_new("- Looks up records of a Game Tree Log dump file by hash");
+  g_option_context_add_main_entries(context, entries, NULL);
+  g_option_context_add_group(context, option_group);
+  g_option_context_set_description(context, program_documentation_string);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_print("Option parsing failed: %s\n", error->message);
+    return -1;
+  }
+
+  /* Checks command line options for consistency. */
+  if (!input_file) {
+    g_print("Option -f, --input-file is mandatory.\n");
+    return -2;
+  }
+  uint64_t hash = 0;
+  if (!hash_arg && !rebuild) {
+    g_print("Option -x, --hash is mandatory.\n");
+    return -2;
+  }
+  if (hash_arg && !parse_hash(hash_arg, &hash)) {
+    g_print("Option -x, --hash is not a valid hash value.\n");
+    return -3;
+  }
+  if (!query) query = "nodes";
+  if (strcmp(query, "nodes") && strcmp(query, "children") && strcmp(query, "path")) {
+    g_print("Option -q, --query must be in [nodes|children|path].\n");
+    return -3;
+  }
+  gchar *const index_file_name = index_file ? g_strdup(index_file) : g_strconcat(input_file, ".hix", NULL);
+
+  board_module_init();
+
+  /* Opens the binary file for reading, and reads the block index. */
+  FILE *fp = fopen(input_file, "r");
+  if (!fp) {
+    fprintf(stderr, "Unable to open file \"%s\".\n", input_file);
+    return -4;
+  }
+  if (game_tree_log_h_read_header(fp) != 0) {
+    fprintf(stderr, "File \"%s\" is not a game tree head log, or its format version is not supported.\n", input_file);
+    fclose(fp);
+    return -5;
+  }
+  LogBlockIndexEntryH *blocks = NULL;
+  size_t block_count = 0;
+  if (game_tree_log_h_read_index(fp, &blocks, &block_count) != 0 || fseeko(fp, 0, SEEK_END) != 0) {
+    fprintf(stderr, "File \"%s\" is corrupted.\n", input_file);
+    fclose(fp);
+    return -6;
+  }
+  const uint64_t log_size = ftello(fp);
+
+  /* Opens the hash index, and builds it when missing or stale. */
+  LogHashIndexH index;
+  FILE *ifp = rebuild ? NULL : fopen(index_file_name, "r");
+  if (ifp && (game_tree_log_h_hash_index_open(&index, ifp) != 0 || index.log_size != log_size)) {
+    fclose(ifp);
+    ifp = NULL;
+  }
+  if (!ifp) {
+    const int ret = build_hash_index(fp, index_file_name);
+    if (ret) {
+      fclose(fp);
+      return ret;
+    }
+    ifp = fopen(index_file_name, "r");
+    if (!ifp || game_tree_log_h_hash_index_open(&index, ifp) != 0) {
+      fprintf(stderr, "Unable to read the hash index file \"%s\".\n", index_file_name);
+      fclose(fp);
+      return -8;
+    }
+  }
+  if (!hash_arg) {
+    fclose(ifp);
+    fclose(fp);
+    free(blocks);
+    g_free(index_file_name);
+    return 0;
+  }
+
+  /* Runs the query. */
+  uint64_t *ordinals = NULL;
+  size_t ordinal_count = 0;
+  const LogHashIndexKeyH key = strcmp(query, "children") ? LOG_HASH_INDEX_BY_HASH : LOG_HASH_INDEX_BY_PARENT_HASH;
+  if (game_tree_log_h_hash_index_lookup(&index, key, hash, &ordinals, &ordinal_count) != 0) {
+    fprintf(stderr, "Unable to read the hash index file \"%s\".\n", index_file_name);
+    return -8;
+  }
+  if (!strcmp(query, "path") && ordinal_count > 0) {
+    /* Collects the ancestors of the first record, then reverses them. */
+    size_t capacity = ordinal_count;
+    ordinal_count = 1;
+    for (uint64_t parent = ordinals[0]; ; ) {
+      if (game_tree_log_h_hash_index_parent(&index, parent, &parent) != 0) {
+        fprintf(stderr, "Unable to read the hash index file \"%s\".\n", index_file_name);
+        return -8;
+      }
+      if (parent == GAME_TREE_LOG_H_NO_PARENT) break;
+      if (ordinal_count == capacity) {
+        capacity *= 2;
+        ordinals = (uint64_t *) realloc(ordinals, capacity * sizeof(uint64_t));
+        g_assert(ordinals);
+      }
+      ordinals[ordinal_count++] = parent;
+    }
+    for (size_t i = 0; i < ordinal_count / 2; i++) {
+      const uint64_t tmp = ordinals[i];
+      ordinals[i] = ordinals[ordinal_count - 1 - i];
+      ordinals[ordinal_count - 1 - i] = tmp;
+    }
+  }
+
+  fprintf(stdout, "%s;%s;%s;%s;%s;%s;%s;%s\n",
+          "SUB_RUN_ID",
+          "CALL_ID",
+          "HASH",
+          "PARENT_HASH",
+          "BLACKS",
+          "WHITES",
+          "PLAYER",
+          "JSON_DOC");
+  int ret = 0;
+  LogBlockH block;
+  game_tree_log_block_h_init(&block);
+  for (size_t i = 0; i < ordinal_count && ret == 0; i++) {
+    if (print_record(fp, blocks, block_count, ordinals[i], &block) != 0) {
+      fprintf(stderr, "File \"%s\" is corrupted, or it does not match the hash index file \"%s\".\n", input_file, index_file_name);
+      ret = -6;
+    }
+  }
+
+  game_tree_log_block_h_release(&block);
+  free(ordinals);
+  fclose(ifp);
+  fclose(fp);
+  free(blocks);
+  g_free(index_file_name);
+  return ret;
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Parses a signed decimal, or a hexadecimal prefixed by 0x, hash value.
+ */
+static bool
+parse_hash (const char *const s,
+            uint64_t *const hash)
+{
+  char *end;
+  errno = 0;
+  if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+    *hash = strtoull(s + 2, &end, 16);
+    if (end == s + 2) return false;
+  } else {
+    *hash = (uint64_t) strtoll(s, &end, 10);
+    if (end == s) return false;
+  }
+  return errno == 0 && *end == '\0';
+}
+
+/*
+ * Writes the hash index file, returns zero or the exit status of the program.
+ */
+static int
+build_hash_index (FILE *const log_fp,
+                  const char *const file_name)
+{
+  FILE *fp = fopen(file_name, "w");
+  if (!fp) {
+    fprintf(stderr, "Unable to open file \"%s\" for writing.\n", file_name);
+    return -7;
+  }
+  fprintf(stderr, "Building the hash index file \"%s\".\n", file_name);
+  const int ret = game_tree_log_h_hash_index_write(log_fp, fp);
+  if (fclose(fp) != 0 || ret == -3) {
+    fprintf(stderr, "Unable to write file \"%s\".\n", file_name);
+    remove(file_name);
+    return -7;
+  }
+  if (ret) {
+    fprintf(stderr, "The input file is corrupted.\n");
+    remove(file_name);
+    return -6;
+  }
+  return 0;
+}
+
+/*
+ * Reads the record, and writes it as a CSV row, in the format of the read_game_tree_log program.
+ * Exit records are skipped.
+ */
+static int
+print_record (FILE *const fp,
+              const LogBlockIndexEntryH *const blocks,
+              const size_t block_count,
+              const uint64_t ordinal,
+              LogBlockH *const block)
+{
+  LogDataH record;
+  char json_doc[game_tree_log_max_json_doc_len];
+
+  if (game_tree_log_h_read_record(fp, blocks, block_count, ordinal, block, &record, json_doc) != 0) return -1;
+  if (record.type == LOG_RECORD_EXIT) return 0;
+  if (!record.json_doc) {
+    GamePositionX gpx = { .blacks = record.blacks, .whites = record.whites, .player = record.player };
+    game_tree_log_data_h_json_doc3(json_doc, record.call_level, &gpx);
+  }
+  fprintf(stdout, "%6d;%8" PRIu64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%1d;%s\n",
+          record.sub_run_id,
+          record.call_id,
+          (int64_t) record.hash,
+          (int64_t) record.parent_hash,
+          (int64_t) record.blacks,
+          (int64_t) record.whites,
+          record.player,
+          json_doc);
+  return 0;
+}
+
+/**
+ * @endcond
+ */
@@ -36,17 +36,158 @@
 #include <string.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 
 #include "game_tree_logger.h"
+#include "lz_block.h"
+#include "sort_utils.h"
 
 
 /**
  * @cond
  */
 
+/*
+ * Flags of the encoded record.
+ */
+#define LOG_REC_JSON          0x01 /* The record has a json field. */
+#define LOG_REC_WHITE_PLAYER  0x02 /* The player is the white one. */
+#define LOG_REC_SUB_RUN_ID    0x04 /* The sub run id differs from the one of the previous record. */
+#define LOG_REC_PARENT_REF    0x08 /* The parent hash is the last hash met at the previous call level. */
+#define LOG_REC_HASH_COMPUTED 0x10 /* The hash is the one computed from the game position. */
+#define LOG_REC_RAW_POSITION  0x20 /* Blacks and whites are stored as they are. */
+#define LOG_REC_EXIT          0x40 /* The record is an exit record. */
+
+/*
+ * Exit records share the bit of LOG_REC_PARENT_REF: hash and parent hash are the ones of the last record met at the call level.
+ */
+#define LOG_REC_NODE_REF      0x08
+
+/*
+ * The largest size of an encoded record: flags, call id, sub run id, call level,
+ * parent hash, hash, position, json length and json field.
+ */
+#define LOG_REC_MAX_SIZE (1 + 10 + 10 + 1 + 8 + 8 + 16 + 10 + game_tree_log_max_json_doc_len)
+
+/*
+ * The size of the file header, and of the block header.
+ */
+#define LOG_FILE_HEADER_SIZE 16
+#define LOG_BLOCK_HEADER_SIZE 16
+
+/*
+ * The largest size of a block, larger values read from a file are rejected.
+ */
+#define LOG_BLOCK_MAX_SIZE (64 << 20)
+
+/*
+ * The size of the hash index file header: magic, version, a reserved field, the head file size, and the record count.
+ */
+#define LOG_HASH_INDEX_HEADER_SIZE 32
+
+/*
+ * An entry of the sorted sections of the hash index file.
+ */
+typedef struct {
+  uint64_t   key;              /* The hash, or the parent hash, of the record. */
+  uint64_t   ordinal;          /* The position of the record in the head file. */
+} LogHashIndexEntry;
+
+/*
+ * The count of records collected in memory, by the hash index writer, before being sorted and spilled
+ * to the temporary files as a run. The memory used is forty bytes for each record.
+ */
+#define LOG_HASH_INDEX_RUN_SIZE (1 << 20)
+
+/*
+ * The count of entries read at once from a run, while merging.
+ */
+#define LOG_HASH_INDEX_MERGE_BUFFER_SIZE 4096
+
+/*
+ * The temporary files collecting the runs of the hash index writer.
+ * Runs are appended one after the other, all of them but the last have LOG_HASH_INDEX_RUN_SIZE entries.
+ */
+typedef struct {
+  FILE      *by_hash;          /* The sorted runs of the entries keyed by hash. */
+  FILE      *by_parent_hash;   /* The sorted runs of the entries keyed by parent hash. */
+  FILE      *parents;          /* The parents section, already in the format of the index file. */
+  size_t     run_count;        /* The count of runs. */
+} LogHashIndexRuns;
+
+/*
+ * A run being merged, the buffer holds the entries read from the temporary file and not yet merged.
+ */
+typedef struct {
+  off_t              offset;    /* The offset of the next entry to be read from the temporary file. */
+  uint64_t           remaining; /* The count of entries not yet read from the temporary file. */
+  LogHashIndexEntry *buf;       /* The buffer. */
+  size_t             count;     /* The count of entries in the buffer. */
+  size_t             next;      /* The next entry of the buffer to be merged. */
+} LogHashIndexRun;
+
+/*
+ * A slot of the ring buffer, it has room for the longest json field.
+ */
+typedef struct {
+  LogDataH   data;             /* The record. */
+  char       json_doc[];       /* The copy of the json field, followed by the terminating null. */
+} LogWriterSlot;
+
+/*
+ * The head writer is a single producer single consumer queue: the search thread appends records
+ * to the ring buffer, the writer thread removes them, collects them into the batch buffer, and writes them.
+ * Head and tail are counters that are never wrapped, they are accessed by means of atomic operations.
+ * Threads wait on the condition only when the ring is empty, or full, and they set the waiting flag before.
+ */
+struct log_writer_s {
+  FILE            *file;             /* The head file. */
+  char            *slots;            /* The ring buffer. */
+  size_t           slot_size;        /* The size of a slot. */
+  uint64_t         head;             /* Count of records appended by the search thread. */
+  uint64_t         tail;             /* Count of records removed by the writer thread. */
+  bool             is_closing;       /* Set when no more records are going to be appended. */
+  bool             producer_waiting; /* Set when the search thread waits for a free slot. */
+  bool             consumer_waiting; /* Set when the writer thread waits for a record. */
+  pthread_mutex_t  mutex;            /* The mutex guarding the condition. */
+  pthread_cond_t   cond;             /* The condition signaled when a waiting thread can proceed. */
+  pthread_t        thread;           /* The writer thread. */
+  bool             has_thread;       /* False when records are written synchronously. */
+  bool             compression;      /* True when blocks are compressed. */
+  uint8_t         *batch;            /* The buffer collecting the encoded records of a block. */
+  size_t           batch_len;        /* The bytes collected by the batch buffer. */
+  uint32_t         batch_count;      /* The records collected by the batch buffer. */
+  uint8_t         *stored;           /* The buffer receiving the compressed block. */
+  LogCodecH        codec;            /* The state of the encoder. */
+  LogWriterStats   stats;            /* Statistics. */
+  bool             filter_is_on;     /* True when any of the filters is set. */
+  int              max_depth;        /* The depth filter, negative when off. */
+  uint32_t         sample_rate;      /* The sampling filter, zero or one when off. */
+  SquareSet        root_moves;       /* The root moves filter, empty when off. */
+  bool             has_root;         /* True when the root of the current tree has been met. */
+  int              root_level;       /* The call level of the root. */
+  int              root_sub_run_id;  /* The sub run id of the root. */
+  SquareSet        root_occupied;    /* The squares occupied at the root. */
+  bool             is_selected;      /* True when the current root subtree is one of the selected moves. */
+  char            *path;             /* The records on the path from the root to the current node, used by sampling. */
+  bool             path_is_written[256]; /* True when the record on the path has been written. */
+  uint64_t         offset;           /* The offset of the next block in the file. */
+  uint64_t         record_ordinal;   /* The number of records written in the previous blocks. */
+  LogBlockIndexEntryH *index;        /* The block index. */
+  size_t           index_count;      /* The number of blocks in the index. */
+  size_t           index_capacity;   /* The number of entries allocated for the index. */
+  uint64_t         level_call_id[256]; /* The call id of the last node entered at each call level, it is accessed by the search thread. */
+};
+
+typedef bool
+log_writer_is_ready_f (LogWriter *const w);
+
+
+
 /*
  * Prototypes for internal functions.
  */
@@ -57,12 +198,145 @@ game_tree_log_filename_check (const gchar * const filename);
 static void
 game_tree_log_dirname_recursive_check (const gchar * const filename);
 
+static inline uint8_t *
+log_put_u32 (uint8_t *p,
+             const uint32_t v);
+
+static inline uint8_t *
+log_put_u64 (uint8_t *p,
+             const uint64_t v);
+
+static inline uint8_t *
+log_put_varint (uint8_t *p,
+                uint64_t v);
+
+static inline uint32_t
+log_get_u32 (const uint8_t *const p);
+
+static inline uint64_t
+log_get_u64 (const uint8_t *const p);
+
+static inline const uint8_t *
+log_get_varint (const uint8_t *p,
+                const uint8_t *const end,
+                uint64_t *const v);
+
+static void
+log_codec_reset (LogCodecH *const codec);
+
+static size_t
+log_record_encode (LogCodecH *const codec,
+                   uint8_t *const buf,
+                   const LogDataH *const data,
+                   const char *const json_doc);
+
+static LogWriter *
+log_writer_new (FILE *const file,
+                const LogEnv *const env);
+
+static void
+log_writer_put (LogWriter *const w,
+                const LogDataH *const data);
+
+static void
+log_writer_filter (LogWriter *const w,
+                   const LogDataH *const data);
+
+static inline bool
+log_writer_is_sampled (const uint64_t hash,
+                       const uint32_t sample_rate);
+
+static void
+log_writer_free (LogWriter *w);
+
+static inline LogWriterSlot *
+log_writer_slot (const LogWriter *const w,
+                 const uint64_t i);
+
+static void
+log_writer_wait (LogWriter *const w,
+                 bool *const waiting,
+                 log_writer_is_ready_f *const is_ready);
+
+static void
+log_writer_wake (LogWriter *const w,
+                 const bool *const waiting);
+
+static bool
+log_writer_has_records (LogWriter *const w);
+
+static bool
+log_writer_has_free_slot (LogWriter *const w);
+
+static void
+log_writer_append (LogWriter *const w,
+                   const LogDataH *const data,
+                   const char *const json_doc);
+
+static void
+log_writer_flush (LogWriter *const w);
+
+static void
+log_writer_write_index (LogWriter *const w);
+
+static int
+log_hash_index_entry_cmp (const void *const a,
+                          const void *const b);
+
+static bool
+log_hash_index_put_u64_array (FILE *const fp,
+                              const uint64_t *const v,
+                              const size_t count);
+
+static bool
+log_hash_index_spill_run (LogHashIndexRuns *const runs,
+                          LogHashIndexEntry *const by_hash,
+                          LogHashIndexEntry *const by_parent_hash,
+                          const uint64_t *const parents,
+                          const size_t count);
+
+static bool
+log_hash_index_merge_runs (FILE *const runs_fp,
+                           const size_t run_count,
+                           const uint64_t entry_count,
+                           FILE *const fp);
+
+static bool
+log_hash_index_run_fill (LogHashIndexRun *const run,
+                         FILE *const runs_fp);
+
+static void
+log_hash_index_heap_sift_down (size_t *const heap,
+                               const size_t heap_size,
+                               size_t i,
+                               const LogHashIndexRun *const runs);
+
+static bool
+log_hash_index_copy (FILE *const from,
+                     FILE *const to);
+
+static inline char *
+log_json_put_str (char *p,
+                  const char *s);
+
+static inline char *
+log_json_put_2d (char *p,
+                 const int v);
+
+static void *
+log_writer_run (void *arg);
+
 
 
 /*
  * Internal variables and constants.
  */
 
+/*
+ * The longest time, in nanoseconds, a thread waits before checking again the ring buffer.
+ */
+static const long log_writer_wait_timeout_ns = 10000000;
+
 /**
  * @endcond
  */
@@ -74,7 +348,43 @@ game_tree_log_dirname_recursive_check (const gchar * const filename);
 /********************************************************/
 
 /**
- * @brief Opens the head file for logging.
+ * @brief Opens the head file for logging, writes the file header, and starts the thread writing the records.
+ *
+ * @details The head file starts with a sixteen byte header: the #GAME_TREE_LOG_H_MAGIC string,
+ *          the format version, and a reserved field.
+ *          Records follow, grouped into blocks, each one having a sixteen byte header: the count of records,
+ *          the size of the encoded records, the size of the block as stored, and the compression method.
+ *          Integers are little endian.
+ *
+ *          When the file is closed, the block index is written after the last block of records, as a block
+ *          having the #LOG_BLOCK_INDEX method, and the count of blocks as record count. Each entry of the
+ *          index is the offset of a block and the number of records preceding it.
+ *          The file ends with the offset of the index, followed by the #GAME_TREE_LOG_H_INDEX_MAGIC string.
+ *
+ *          Records are encoded one after the other, relative to the ones preceding them in the block.
+ *          A record starts with a flags byte, followed by:
+ *          - the difference from the previous call id, zigzag and varint encoded
+ *          - the sub run id, varint encoded, when it differs from the previous one
+ *          - the call level, one byte
+ *          - the parent hash, omitted when it is the hash of the last record met at the previous call level
+ *          - the hash, omitted when it is the one computed from the game position
+ *          - the occupied squares, followed by a color bit for each of them, player is a flag
+ *          - the json field length, varint encoded, and the field, when present
+ *
+ *          Records having the exit flag are written by #game_tree_log_write_t when the search leaves a node,
+ *          and are part of the same stream, in the same blocks, as the records entering nodes.
+ *          They have no game position, and the call id is the one of the node entered, stored as the difference
+ *          from the value expected when no node of the subtree has been filtered out. The call level is followed by:
+ *          - the parent hash and the hash, omitted when they are the ones of the last record met at the call level
+ *          - the node value, zigzag and varint encoded
+ *          - the best move, one byte
+ *          - the count of the nodes of the subtree, varint encoded
+ *          - the json field length, varint encoded, and the field, when present
+ *
+ *          When the writer thread cannot be started, records are written synchronously
+ *          by #game_tree_log_write_h.
+ *
+ *          Filters set by #game_tree_log_set_filters are read when the file is opened.
  *
  * @invariant Parameter `env` must not be empty.
  * The invariant is guarded by an assertion.
@@ -88,29 +398,49 @@ game_tree_log_open_h (LogEnv *const env)
   if (env->log_is_on) {
     game_tree_log_filename_check(env->h_file_name);
     env->h_file = fopen(env->h_file_name, "w");
+    if (env->h_file) env->h_writer = log_writer_new(env->h_file, env);
   }
 }
 
 /**
- * @brief Opens the tail file for logging and writes the header.
+ * @brief Writes one record to the head logging binary file.
+ *
+ * @details The record is copied into the ring buffer of the head writer, the json field included,
+ *          and the call returns without waiting for the file to be written.
+ *          When the ring buffer is full the call waits for a free slot.
+ *
+ *          Records must be written in the order the nodes are visited, parents before children,
+ *          when filters are set.
  *
  * @invariant Parameter `env` must not be empty.
  * The invariant is guarded by an assertion.
  *
- * @param [in] env a pointer to the logging environment
+ * @param [in] env  a pointer to the logging environment
+ * @param [in] data a pointer to the log record
  */
 void
-game_tree_log_open_t (LogEnv *const env)
+game_tree_log_write_h (const LogEnv *const env,
+                       const LogDataH *const data)
 {
-  g_assert(env);
-  if (env->log_is_on) {
-    game_tree_log_filename_check(env->t_file_name);
-    env->t_file = fopen(env->t_file_name, "w");
+  g_assert(env && env->h_writer);
+
+  if (data->json_doc && data->json_doc_len >= game_tree_log_max_json_doc_len) {
+    fprintf(stderr, "Json field of the head log record is too long: %zu characters.\n", data->json_doc_len);
+    abort();
   }
+
+  LogWriter *const w = env->h_writer;
+  w->level_call_id[data->call_level] = data->call_id;
+  if (w->filter_is_on) log_writer_filter(w, data);
+  else log_writer_put(w, data);
 }
 
 /**
- * @brief Writes one record to the head logging binary file.
+ * @brief Writes one exit record to the head logging binary file.
+ *
+ * @details The record is written when the search leaves the node, after the records of its subtree,
+ *          and it is queued, and flushed, as the records written by #game_tree_log_write_h.
+ *          Filters drop the exit record when they have dropped the record entering the node.
  *
  * @invariant Parameter `env` must not be empty.
  * The invariant is guarded by an assertion.
@@ -119,56 +449,774 @@ game_tree_log_open_t (LogEnv *const env)
  * @param [in] data a pointer to the log record
  */
 void
-game_tree_log_write_h (const LogEnv *const env,
-                       const LogDataH *const data)
+game_tree_log_write_t (const LogEnv *const env,
+                       const LogDataT *const data)
 {
-  g_assert(env && env->h_file);
-  fwrite(data, sizeof(LogDataH), 1, env->h_file);
-  if (data->json_doc) {
-    fwrite(data->json_doc, data->json_doc_len + 1, 1, env->h_file);
+  g_assert(env && env->h_writer);
+
+  if (data->json_doc && data->json_doc_len >= game_tree_log_max_json_doc_len) {
+    fprintf(stderr, "Json field of the exit log record is too long: %zu characters.\n", data->json_doc_len);
+    abort();
   }
+
+  const LogDataH record =
+    { .sub_run_id   = data->sub_run_id,
+      .call_id      = data->call_id,
+      .hash         = data->hash,
+      .parent_hash  = data->parent_hash,
+      .blacks       = empty_square_set,
+      .whites       = empty_square_set,
+      .player       = BLACK_PLAYER,
+      .json_doc     = data->json_doc,
+      .json_doc_len = data->json_doc_len,
+      .call_level   = data->call_level,
+      .type         = LOG_RECORD_EXIT,
+      .value        = data->value,
+      .best_move    = data->best_move,
+      .node_count   = data->node_count };
+  LogWriter *const w = env->h_writer;
+  if (w->filter_is_on) log_writer_filter(w, &record);
+  else log_writer_put(w, &record);
 }
 
 /**
- * @brief Writes one record to the tail logging file.
+ * @brief Frees the `env` structure after closing the open files.
  *
  * @invariant Parameter `env` must not be empty.
  * The invariant is guarded by an assertion.
  *
- * @param [in] env  a pointer to the logging environment
- * @param [in] data a pointer to the log record
+ * @param env the logging environment
  */
 void
-game_tree_log_write_t (const LogEnv *const env,
-                       const LogDataT *const data)
+game_tree_log_close (LogEnv *const env)
+{
+  g_assert(env);
+  if (env->h_writer) {
+    LogWriter *const w = env->h_writer;
+    if (w->has_thread) {
+      __atomic_store_n(&w->is_closing, true, __ATOMIC_SEQ_CST);
+      pthread_mutex_lock(&w->mutex);
+      pthread_cond_broadcast(&w->cond);
+      pthread_mutex_unlock(&w->mutex);
+      pthread_join(w->thread, NULL);
+    } else {
+      log_writer_flush(w);
+    }
+    log_writer_write_index(w);
+    printf("Head log: %" PRIu64 " records, %" PRIu64 " filtered out, %" PRIu64 " bytes encoded, %" PRIu64 " bytes written in %" PRIu64 " blocks, "
+           "waits for a free slot %" PRIu64 ", waits for a record %" PRIu64 ", max ring usage %zu/%zu.\n",
+           w->stats.record_count, w->stats.filtered_count, w->stats.raw_byte_count, w->stats.byte_count, w->stats.batch_count,
+           w->stats.full_wait_count, w->stats.empty_wait_count, w->stats.max_ring_usage, game_tree_log_ring_size);
+    log_writer_free(w);
+  }
+  if (env->log_is_on) {
+    g_free(env->file_name_prefix);
+    g_free(env->h_file_name);
+  }
+  if (env->h_file) fclose(env->h_file);
+  free(env);
+}
+
+/**
+ * @brief Sets the filters selecting the nodes written to the head file.
+ *
+ * @details Filters are combined, a node is written when it passes all of them.
+ *          Depth is counted from the root of the tree, that is the first node written,
+ *          or the first one of a new sub run.
+ *          The set of written nodes is closed under the parent relation, so that the parent hash
+ *          of every written node, but the root, is the hash of another written node:
+ *          - the depth filter drops nodes deeper than `max_depth`
+ *          - the root moves filter drops the subtrees of the root moves not in `root_moves`
+ *          - the sampling filter selects a node in `sample_rate`, by its hash, so that the choice is
+ *            the same across runs, and writes it together with the nodes on its path from the root
+ *            not written yet
+ *
+ *          Filters have to be set before opening the head file.
+ *
+ * @invariant Parameter `env` must not be empty.
+ * The invariant is guarded by an assertion.
+ *
+ * @param [in,out] env         the logging environment
+ * @param [in]     max_depth   the largest depth written, a negative value turns off the filter
+ * @param [in]     sample_rate the sampling rate, zero or one turn off the filter
+ * @param [in]     root_moves  the selected root moves, an empty set turns off the filter
+ */
+void
+game_tree_log_set_filters (LogEnv *const env,
+                           const int max_depth,
+                           const uint32_t sample_rate,
+                           const SquareSet root_moves)
+{
+  g_assert(env);
+  g_assert(!env->h_writer);
+  env->h_max_depth = max_depth;
+  env->h_sample_rate = sample_rate;
+  env->h_root_moves = root_moves;
+}
+
+/**
+ * @brief Returns a snapshot of the statistics of the head writer.
+ *
+ * @details Statistics are all zero when the head file is not open.
+ *
+ * @invariant Parameters `env` and `stats` must not be empty.
+ * The invariant is guarded by an assertion.
+ *
+ * @param [in]  env   the logging environment
+ * @param [out] stats the statistics
+ */
+void
+game_tree_log_h_stats (const LogEnv *const env,
+                       LogWriterStats *const stats)
+{
+  g_assert(env && stats);
+  const LogWriter *const w = env->h_writer;
+  if (!w) {
+    memset(stats, 0, sizeof(LogWriterStats));
+    return;
+  }
+  stats->record_count     = __atomic_load_n(&w->stats.record_count, __ATOMIC_RELAXED);
+  stats->raw_byte_count   = __atomic_load_n(&w->stats.raw_byte_count, __ATOMIC_RELAXED);
+  stats->byte_count       = __atomic_load_n(&w->stats.byte_count, __ATOMIC_RELAXED);
+  stats->batch_count      = __atomic_load_n(&w->stats.batch_count, __ATOMIC_RELAXED);
+  stats->filtered_count   = __atomic_load_n(&w->stats.filtered_count, __ATOMIC_RELAXED);
+  stats->full_wait_count  = __atomic_load_n(&w->stats.full_wait_count, __ATOMIC_RELAXED);
+  stats->empty_wait_count = __atomic_load_n(&w->stats.empty_wait_count, __ATOMIC_RELAXED);
+  stats->max_ring_usage   = __atomic_load_n(&w->stats.max_ring_usage, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Reads and checks the header of the head log file.
+ *
+ * @param [in] fp the head log file, positioned at its start
+ * @return        zero on success, a negative value when the file is not a head log file,
+ *                or when its version is not supported
+ */
+int
+game_tree_log_h_read_header (FILE *const fp)
 {
-  g_assert(env && env->t_file);
-  fprintf(env->t_file, "%6d;%8" PRIu64 ";x%s\n",
-          data->sub_run_id,
-          data->call_id,
-          data->json_doc);
+  g_assert(fp);
+  uint8_t header[LOG_FILE_HEADER_SIZE];
+  if (fread(header, sizeof(header), 1, fp) != 1) return -1;
+  if (memcmp(header, GAME_TREE_LOG_H_MAGIC, 8) != 0) return -2;
+  const uint32_t version = log_get_u32(header + 8);
+  if (version < 1 || version > GAME_TREE_LOG_H_VERSION) return -3;
+  return 0;
 }
 
-/**
- * @brief Frees the `env` structure after closing the open files.
- *
- * @invariant Parameter `env` must not be empty.
- * The invariant is guarded by an assertion.
- *
- * @param env the logging environment
- */
-void
-game_tree_log_close (LogEnv *const env)
-{
-  g_assert(env);
-  if (env->log_is_on) {
-    g_free(env->file_name_prefix);
-    g_free(env->h_file_name);
-    g_free(env->t_file_name);
+/**
+ * @brief Reads the block index of the head log file.
+ *
+ * @details The index is read from the end of the file. When it is missing, as for files written
+ *          by the first version of the format, or by a run that has not closed the file,
+ *          it is built by reading the block headers one after the other.
+ *          The file position is left undefined.
+ *
+ *          Blocks are decoded independently, the index lets callers split the file into chunks
+ *          of blocks, and read them in parallel.
+ *
+ * @param [in]  fp          the head log file
+ * @param [out] entries     the index, an array that the caller frees
+ * @param [out] entry_count the number of blocks
+ * @return                  zero on success, a negative value when the file is truncated or not valid
+ */
+int
+game_tree_log_h_read_index (FILE *const fp,
+                            LogBlockIndexEntryH **const entries,
+                            size_t *const entry_count)
+{
+  g_assert(fp && entries && entry_count);
+
+  uint8_t buf[LOG_BLOCK_HEADER_SIZE];
+  LogBlockIndexEntryH *index = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+
+  /* Reads the index written when the file has been closed. */
+  if (fseeko(fp, 0, SEEK_END) == 0) {
+    const off_t file_size = ftello(fp);
+    if (file_size >= LOG_FILE_HEADER_SIZE + LOG_BLOCK_HEADER_SIZE + 16 &&
+        fseeko(fp, file_size - 16, SEEK_SET) == 0 &&
+        fread(buf, 16, 1, fp) == 1 &&
+        memcmp(buf + 8, GAME_TREE_LOG_H_INDEX_MAGIC, 8) == 0) {
+      const uint64_t index_offset = log_get_u64(buf);
+      if (index_offset < LOG_FILE_HEADER_SIZE || index_offset + LOG_BLOCK_HEADER_SIZE + 16 > (uint64_t) file_size) return -2;
+      if (fseeko(fp, index_offset, SEEK_SET) != 0 || fread(buf, sizeof(buf), 1, fp) != 1) return -1;
+      count = log_get_u32(buf);
+      const uint64_t size = log_get_u32(buf + 4);
+      if (log_get_u32(buf + 12) != LOG_BLOCK_INDEX || size != 16 * count || log_get_u32(buf + 8) != size ||
+          index_offset + LOG_BLOCK_HEADER_SIZE + size + 16 != (uint64_t) file_size) return -2;
+      index = (LogBlockIndexEntryH *) malloc((count ? count : 1) * sizeof(LogBlockIndexEntryH));
+      g_assert(index);
+      for (size_t i = 0; i < count; i++) {
+        if (fread(buf, 16, 1, fp) != 1) {
+          free(index);
+          return -1;
+        }
+        index[i].offset = log_get_u64(buf);
+        index[i].first_record = log_get_u64(buf + 8);
+        if (index[i].offset >= index_offset || (i > 0 && index[i].offset <= index[i - 1].offset)) {
+          free(index);
+          return -2;
+        }
+      }
+      *entries = index;
+      *entry_count = count;
+      return 0;
+    }
+  }
+
+  /* Builds the index from the block headers. */
+  uint64_t offset = LOG_FILE_HEADER_SIZE;
+  uint64_t first_record = 0;
+  if (fseeko(fp, offset, SEEK_SET) != 0) return -1;
+  for (;;) {
+    const size_t n = fread(buf, 1, sizeof(buf), fp);
+    if (n == 0 || (n == sizeof(buf) && log_get_u32(buf + 12) == LOG_BLOCK_INDEX)) break;
+    const uint32_t stored_size = log_get_u32(buf + 8);
+    if (n != sizeof(buf) || stored_size > LOG_BLOCK_MAX_SIZE || fseeko(fp, stored_size, SEEK_CUR) != 0) {
+      free(index);
+      return -1;
+    }
+    if (count == capacity) {
+      capacity = capacity ? 2 * capacity : 64;
+      index = (LogBlockIndexEntryH *) realloc(index, capacity * sizeof(LogBlockIndexEntryH));
+      g_assert(index);
+    }
+    index[count].offset = offset;
+    index[count].first_record = first_record;
+    count++;
+    offset += LOG_BLOCK_HEADER_SIZE + stored_size;
+    first_record += log_get_u32(buf);
+  }
+  *entries = index;
+  *entry_count = count;
+  return 0;
+}
+
+/**
+ * @brief Reads the record having the given ordinal.
+ *
+ * @details The block holding the record is found by means of the block index, it is read,
+ *          and its records are decoded up to the requested one.
+ *          The json field is returned as by #game_tree_log_block_h_next.
+ *
+ * @param [in]     fp          the head log file
+ * @param [in]     entries     the block index
+ * @param [in]     entry_count the number of blocks
+ * @param [in]     ordinal     the position of the record in the file, the first record has ordinal zero
+ * @param [in,out] block       the block used to decode the records
+ * @param [out]    record      the record
+ * @param [out]    json_doc    a buffer of #game_tree_log_max_json_doc_len characters
+ * @return                     zero on success, -1 when the ordinal is out of range, -2 when the file is not valid
+ */
+int
+game_tree_log_h_read_record (FILE *const fp,
+                             const LogBlockIndexEntryH *const entries,
+                             const size_t entry_count,
+                             const uint64_t ordinal,
+                             LogBlockH *const block,
+                             LogDataH *const record,
+                             char *const json_doc)
+{
+  g_assert(fp && block && record && json_doc);
+
+  if (entry_count == 0 || ordinal < entries[0].first_record) return -1;
+
+  /* Finds the last block starting at, or before, the record. */
+  size_t lo = 0;
+  size_t hi = entry_count;
+  while (hi - lo > 1) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (entries[mid].first_record <= ordinal) lo = mid;
+    else hi = mid;
+  }
+
+  if (fseeko(fp, entries[lo].offset, SEEK_SET) != 0) return -2;
+  if (game_tree_log_block_h_read(block, fp) != 1) return -2;
+  if (ordinal - entries[lo].first_record >= block->record_count) return -1;
+  for (uint64_t i = entries[lo].first_record; i <= ordinal; i++) {
+    if (game_tree_log_block_h_next(block, record, json_doc) != 1) return -2;
+  }
+  return 0;
+}
+
+/**
+ * @brief Writes the hash index of the head log file.
+ *
+ * @details The head file is read once, and the index is written to `fp`, that has to be open for writing at its start.
+ *          Records are collected in memory, forty bytes each, up to one run of 2^20 records, about 40 MB.
+ *          When the head file has more records, each run is sorted and spilled to temporary files,
+ *          and the runs are then merged into `fp`. The merge reads 64 kB at a time from each run,
+ *          so the memory used is bounded by 40 MB plus 64 kB for each million of records.
+ *
+ *          The parent of a record is the last record met at the previous call level, in the same sub run,
+ *          when its hash matches the parent hash of the record. Records not having it,
+ *          as the roots, or the records of a file truncated by filters, have no parent.
+ *          Exit records are indexed as the records entering their nodes, and have the same parent.
+ *
+ * @param [in] log_fp the head log file
+ * @param [in] fp     the hash index file
+ * @return            zero on success, -1 when the head file is not valid, -2 when it is corrupted,
+ *                    -3 on a write error, also of the temporary files
+ */
+int
+game_tree_log_h_hash_index_write (FILE *const log_fp,
+                                  FILE *const fp)
+{
+  g_assert(log_fp && fp);
+
+  if (fseeko(log_fp, 0, SEEK_SET) != 0 || game_tree_log_h_read_header(log_fp) != 0) return -1;
+  LogBlockIndexEntryH *blocks = NULL;
+  size_t block_count = 0;
+  if (game_tree_log_h_read_index(log_fp, &blocks, &block_count) != 0) return -2;
+  if (fseeko(log_fp, 0, SEEK_END) != 0) {
+    free(blocks);
+    return -2;
+  }
+  const uint64_t log_size = ftello(log_fp);
+
+  LogHashIndexEntry *by_hash = NULL;
+  LogHashIndexEntry *by_parent_hash = NULL;
+  uint64_t *parents = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  uint64_t record_count = 0;
+  LogHashIndexRuns runs = { NULL, NULL, NULL, 0 };
+
+  uint64_t level_ordinal[256];
+  uint64_t level_hash[256];
+  bool level_is_set[256];
+  int sub_run_id = 0;
+
+  LogBlockH block;
+  LogDataH record;
+  char json_doc[game_tree_log_max_json_doc_len];
+  int ret = 0;
+  game_tree_log_block_h_init(&block);
+  for (size_t k = 0; k < block_count && ret == 0; k++) {
+    if (fseeko(log_fp, blocks[k].offset, SEEK_SET) != 0 || game_tree_log_block_h_read(&block, log_fp) != 1) {
+      ret = -2;
+      break;
+    }
+    int r;
+    while ((r = game_tree_log_block_h_next(&block, &record, json_doc)) > 0) {
+      if (count == LOG_HASH_INDEX_RUN_SIZE) {
+        if (!log_hash_index_spill_run(&runs, by_hash, by_parent_hash, parents, count)) {
+          ret = -3;
+          break;
+        }
+        count = 0;
+      }
+      if (count == capacity) {
+        capacity = capacity ? 2 * capacity : 4096;
+        by_hash = (LogHashIndexEntry *) realloc(by_hash, capacity * sizeof(LogHashIndexEntry));
+        by_parent_hash = (LogHashIndexEntry *) realloc(by_parent_hash, capacity * sizeof(LogHashIndexEntry));
+        parents = (uint64_t *) realloc(parents, capacity * sizeof(uint64_t));
+        g_assert(by_hash && by_parent_hash && parents);
+      }
+      if (record_count == 0 || record.sub_run_id != sub_run_id) {
+        memset(level_is_set, 0, sizeof(level_is_set));
+        sub_run_id = record.sub_run_id;
+      }
+      const int level = record.call_level;
+      uint64_t parent = GAME_TREE_LOG_H_NO_PARENT;
+      if (level > 0 && level_is_set[level - 1] && level_hash[level - 1] == record.parent_hash) parent = level_ordinal[level - 1];
+      if (record.type == LOG_RECORD_ENTER) {
+        level_ordinal[level] = record_count;
+        level_hash[level] = record.hash;
+        level_is_set[level] = true;
+      }
+
+      by_hash[count].key = record.hash;
+      by_hash[count].ordinal = record_count;
+      by_parent_hash[count].key = record.parent_hash;
+      by_parent_hash[count].ordinal = record_count;
+      parents[count] = parent;
+      count++;
+      record_count++;
+    }
+    if (r < 0 && ret == 0) ret = -2;
+  }
+  game_tree_log_block_h_release(&block);
+  free(blocks);
+
+  /* When runs have been spilled, the last one is spilled as well, and all of them are merged. */
+  if (ret == 0 && runs.run_count > 0 && count > 0) {
+    if (!log_hash_index_spill_run(&runs, by_hash, by_parent_hash, parents, count)) ret = -3;
+    count = 0;
+  }
+
+  if (ret == 0) {
+    uint8_t header[LOG_HASH_INDEX_HEADER_SIZE];
+    memcpy(header, GAME_TREE_LOG_H_HASH_INDEX_MAGIC, 8);
+    uint8_t *p = log_put_u32(header + 8, GAME_TREE_LOG_H_HASH_INDEX_VERSION);
+    p = log_put_u32(p, 0);
+    p = log_put_u64(p, log_size);
+    log_put_u64(p, record_count);
+    bool is_written = fwrite(header, sizeof(header), 1, fp) == 1;
+    if (runs.run_count == 0) {
+      sort_utils_quicksort(by_hash, count, sizeof(LogHashIndexEntry), log_hash_index_entry_cmp);
+      sort_utils_quicksort(by_parent_hash, count, sizeof(LogHashIndexEntry), log_hash_index_entry_cmp);
+      is_written = is_written &&
+        log_hash_index_put_u64_array(fp, (const uint64_t *) by_hash, 2 * count) &&
+        log_hash_index_put_u64_array(fp, (const uint64_t *) by_parent_hash, 2 * count) &&
+        log_hash_index_put_u64_array(fp, parents, count);
+    } else {
+      free(by_hash);
+      free(by_parent_hash);
+      free(parents);
+      by_hash = by_parent_hash = NULL;
+      parents = NULL;
+      is_written = is_written &&
+        log_hash_index_merge_runs(runs.by_hash, runs.run_count, record_count, fp) &&
+        log_hash_index_merge_runs(runs.by_parent_hash, runs.run_count, record_count, fp) &&
+        log_hash_index_copy(runs.parents, fp);
+    }
+    if (!is_written || fflush(fp) != 0) ret = -3;
+  }
+
+  if (runs.by_hash) fclose(runs.by_hash);
+  if (runs.by_parent_hash) fclose(runs.by_parent_hash);
+  if (runs.parents) fclose(runs.parents);
+  free(by_hash);
+  free(by_parent_hash);
+  free(parents);
+  return ret;
+}
+
+/**
+ * @brief Opens the hash index, reading and checking its header.
+ *
+ * @details The index keeps the file, that is not closed by the module.
+ *          Callers compare the `log_size` field with the size of the head file, to tell a stale index.
+ *
+ * @param [out] index the hash index
+ * @param [in]  fp    the hash index file, positioned at its start
+ * @return            zero on success, -1 when the file is not a hash index, or its version is not supported,
+ *                    -2 when it is truncated
+ */
+int
+game_tree_log_h_hash_index_open (LogHashIndexH *const index,
+                                 FILE *const fp)
+{
+  g_assert(index && fp);
+
+  uint8_t header[LOG_HASH_INDEX_HEADER_SIZE];
+  if (fread(header, sizeof(header), 1, fp) != 1) return -1;
+  if (memcmp(header, GAME_TREE_LOG_H_HASH_INDEX_MAGIC, 8) != 0) return -1;
+  if (log_get_u32(header + 8) != GAME_TREE_LOG_H_HASH_INDEX_VERSION) return -1;
+  const uint64_t log_size = log_get_u64(header + 16);
+  const uint64_t record_count = log_get_u64(header + 24);
+  if (fseeko(fp, 0, SEEK_END) != 0) return -2;
+  if ((uint64_t) ftello(fp) != LOG_HASH_INDEX_HEADER_SIZE + 40 * record_count) return -2;
+
+  index->fp = fp;
+  index->log_size = log_size;
+  index->record_count = record_count;
+  return 0;
+}
+
+/**
+ * @brief Looks up the records having the given hash, or parent hash.
+ *
+ * @details The sorted section of the index file is searched by bisection, reading one entry per step.
+ *          Looking up the parent hash returns the children of all the records having that hash.
+ *
+ * @param [in]  index         the hash index
+ * @param [in]  key           selects the hash, or the parent hash, of the records
+ * @param [in]  hash          the hash value
+ * @param [out] ordinals      the ordinals of the records, in the order of the head file, an array that the caller frees
+ * @param [out] ordinal_count the number of records
+ * @return                    zero on success, a negative value on a read error
+ */
+int
+game_tree_log_h_hash_index_lookup (const LogHashIndexH *const index,
+                                   const LogHashIndexKeyH key,
+                                   const uint64_t hash,
+                                   uint64_t **const ordinals,
+                                   size_t *const ordinal_count)
+{
+  g_assert(index && ordinals && ordinal_count);
+
+  const off_t section = LOG_HASH_INDEX_HEADER_SIZE + (key == LOG_HASH_INDEX_BY_HASH ? 0 : 16 * index->record_count);
+  uint8_t buf[16];
+
+  /* Finds the first entry not lower than the hash. */
+  uint64_t lo = 0;
+  uint64_t hi = index->record_count;
+  while (lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    if (fseeko(index->fp, section + 16 * mid, SEEK_SET) != 0 || fread(buf, 16, 1, index->fp) != 1) return -1;
+    if (log_get_u64(buf) < hash) lo = mid + 1;
+    else hi = mid;
+  }
+
+  uint64_t *result = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  if (lo < index->record_count && fseeko(index->fp, section + 16 * lo, SEEK_SET) != 0) return -1;
+  for (uint64_t i = lo; i < index->record_count; i++) {
+    if (fread(buf, 16, 1, index->fp) != 1) {
+      free(result);
+      return -1;
+    }
+    if (log_get_u64(buf) != hash) break;
+    if (count == capacity) {
+      capacity = capacity ? 2 * capacity : 16;
+      result = (uint64_t *) realloc(result, capacity * sizeof(uint64_t));
+      g_assert(result);
+    }
+    result[count++] = log_get_u64(buf + 8);
+  }
+  *ordinals = result;
+  *ordinal_count = count;
+  return 0;
+}
+
+/**
+ * @brief Returns the ordinal of the parent of a record.
+ *
+ * @param [in]  index   the hash index
+ * @param [in]  ordinal the ordinal of the record
+ * @param [out] parent  the ordinal of the parent, or #GAME_TREE_LOG_H_NO_PARENT
+ * @return              zero on success, -1 when the ordinal is out of range, -2 on a read error
+ */
+int
+game_tree_log_h_hash_index_parent (const LogHashIndexH *const index,
+                                   const uint64_t ordinal,
+                                   uint64_t *const parent)
+{
+  g_assert(index && parent);
+
+  if (ordinal >= index->record_count) return -1;
+  uint8_t buf[8];
+  const off_t offset = LOG_HASH_INDEX_HEADER_SIZE + 32 * index->record_count + 8 * ordinal;
+  if (fseeko(index->fp, offset, SEEK_SET) != 0 || fread(buf, 8, 1, index->fp) != 1) return -2;
+  *parent = log_get_u64(buf);
+  return 0;
+}
+
+/**
+ * @brief Initializes an empty block.
+ *
+ * @param [out] block the block
+ */
+void
+game_tree_log_block_h_init (LogBlockH *const block)
+{
+  g_assert(block);
+  memset(block, 0, sizeof(LogBlockH));
+}
+
+/**
+ * @brief Frees the buffers of the block.
+ *
+ * @param [in,out] block the block
+ */
+void
+game_tree_log_block_h_release (LogBlockH *const block)
+{
+  g_assert(block);
+  free(block->data);
+  free(block->stored);
+  game_tree_log_block_h_init(block);
+}
+
+/**
+ * @brief Reads the next block of the head log file, and decompresses it.
+ *
+ * @details Buffers of the block are reused, and grown when needed.
+ *
+ * @param [in,out] block the block
+ * @param [in]     fp    the head log file
+ * @return               one when a block has been read, zero at the end of the file, or when the block index is met,
+ *                       a negative value when the block is truncated or not valid
+ */
+int
+game_tree_log_block_h_read (LogBlockH *const block,
+                            FILE *const fp)
+{
+  g_assert(block && fp);
+
+  uint8_t header[LOG_BLOCK_HEADER_SIZE];
+  const size_t n = fread(header, 1, sizeof(header), fp);
+  if (n == 0) return 0;
+  if (n != sizeof(header)) return -1;
+  block->record_count = log_get_u32(header);
+  block->raw_size = log_get_u32(header + 4);
+  block->stored_size = log_get_u32(header + 8);
+  block->compression = log_get_u32(header + 12);
+  if (block->compression == LOG_BLOCK_INDEX) return 0;
+  block->next = 0;
+  block->next_record = 0;
+  log_codec_reset(&block->codec);
+
+  if (block->raw_size > LOG_BLOCK_MAX_SIZE || block->stored_size > LOG_BLOCK_MAX_SIZE) return -2;
+  if (block->data_capacity < block->raw_size) {
+    free(block->data);
+    block->data = (uint8_t *) malloc(block->raw_size);
+    g_assert(block->data);
+    block->data_capacity = block->raw_size;
+  }
+
+  switch (block->compression) {
+  case LOG_BLOCK_RAW:
+    if (block->stored_size != block->raw_size) return -2;
+    if (block->raw_size && fread(block->data, block->raw_size, 1, fp) != 1) return -1;
+    break;
+  case LOG_BLOCK_LZ:
+    if (block->stored_capacity < block->stored_size) {
+      free(block->stored);
+      block->stored = (uint8_t *) malloc(block->stored_size);
+      g_assert(block->stored);
+      block->stored_capacity = block->stored_size;
+    }
+    if (block->stored_size && fread(block->stored, block->stored_size, 1, fp) != 1) return -1;
+    if (lz_block_decompress(block->stored, block->stored_size, block->data, block->raw_size) != block->raw_size) return -3;
+    break;
+  default:
+    return -2;
+  }
+  return 1;
+}
+
+/**
+ * @brief Decodes the next record of the block.
+ *
+ * @details When the record has a json field, it is copied into `json_doc`, followed by the terminating null,
+ *          and the json field of the record points to it, otherwise the json field of the record is `NULL`.
+ *          The type field tells the records entering nodes from the exit records, readers interested
+ *          only in the game tree skip the latter.
+ *
+ * @param [in,out] block    the block
+ * @param [out]    record   the decoded record
+ * @param [out]    json_doc a buffer of #game_tree_log_max_json_doc_len characters
+ * @return                  one when a record has been decoded, zero at the end of the block,
+ *                          a negative value when the record is not valid
+ */
+int
+game_tree_log_block_h_next (LogBlockH *const block,
+                            LogDataH *const record,
+                            char *const json_doc)
+{
+  g_assert(block && record && json_doc);
+
+  if (block->next_record == block->record_count) return block->next == block->raw_size ? 0 : -1;
+
+  LogCodecH *const codec = &block->codec;
+  const uint8_t *p = block->data + block->next;
+  const uint8_t *const end = block->data + block->raw_size;
+  uint64_t v;
+
+  if (p >= end) return -1;
+  const uint8_t flags = *p++;
+
+  if (!(p = log_get_varint(p, end, &v))) return -1;
+  const uint64_t call_id_delta = (v >> 1) ^ -(v & 1);
+
+  if (flags & LOG_REC_SUB_RUN_ID) {
+    if (!(p = log_get_varint(p, end, &v))) return -1;
+    codec->sub_run_id = (int) (uint32_t) v;
+  }
+  record->sub_run_id = codec->sub_run_id;
+
+  if (p >= end) return -1;
+  const uint8_t level = *p++;
+  record->call_level = level;
+
+  if (flags & LOG_REC_EXIT) {
+    if (flags & LOG_REC_NODE_REF) {
+      if (!codec->level_is_set[level]) return -1;
+      record->parent_hash = codec->level_parent_hash[level];
+      record->hash = codec->level_hash[level];
+    } else {
+      if (end - p < 16) return -1;
+      record->parent_hash = log_get_u64(p);
+      record->hash = log_get_u64(p + 8);
+      p += 16;
+    }
+    if (!(p = log_get_varint(p, end, &v))) return -1;
+    record->value = (int) (int64_t) ((v >> 1) ^ -(v & 1));
+    if (p >= end) return -1;
+    record->best_move = (Square) *p++;
+    if (!(p = log_get_varint(p, end, &v))) return -1;
+    record->node_count = v;
+    record->call_id = codec->call_id - record->node_count + 1 + call_id_delta;
+    record->blacks = empty_square_set;
+    record->whites = empty_square_set;
+    record->player = BLACK_PLAYER;
+    record->type = LOG_RECORD_EXIT;
+  } else {
+    record->call_id = codec->call_id + call_id_delta;
+    codec->call_id = record->call_id;
+    record->type = LOG_RECORD_ENTER;
+    record->value = 0;
+    record->best_move = invalid_move;
+    record->node_count = 0;
+
+    if (flags & LOG_REC_PARENT_REF) {
+      if (level == 0 || !codec->level_is_set[level - 1]) return -1;
+      record->parent_hash = codec->level_hash[level - 1];
+    } else {
+      if (end - p < 8) return -1;
+      record->parent_hash = log_get_u64(p);
+      p += 8;
+    }
+
+    if (!(flags & LOG_REC_HASH_COMPUTED)) {
+      if (end - p < 8) return -1;
+      record->hash = log_get_u64(p);
+      p += 8;
+    }
+
+    if (flags & LOG_REC_RAW_POSITION) {
+      if (end - p < 16) return -1;
+      record->blacks = log_get_u64(p);
+      record->whites = log_get_u64(p + 8);
+      p += 16;
+    } else {
+      if (end - p < 8) return -1;
+      const SquareSet occupied = log_get_u64(p);
+      p += 8;
+      const int color_size = (bit_works_bitcount_64(occupied) + 7) >> 3;
+      if (end - p < color_size) return -1;
+      SquareSet blacks = 0;
+      int k = 0;
+      for (SquareSet m = occupied; m; m &= m - 1, k++) {
+        if (p[k >> 3] & (1 << (k & 7))) blacks |= m & -m;
+      }
+      p += color_size;
+      record->blacks = blacks;
+      record->whites = occupied & ~blacks;
+    }
+    record->player = (flags & LOG_REC_WHITE_PLAYER) ? WHITE_PLAYER : BLACK_PLAYER;
+
+    if (flags & LOG_REC_HASH_COMPUTED) {
+      const GamePositionX gpx = { .blacks = record->blacks, .whites = record->whites, .player = record->player };
+      record->hash = game_position_x_hash(&gpx);
+    }
+    codec->level_hash[level] = record->hash;
+    codec->level_parent_hash[level] = record->parent_hash;
+    codec->level_is_set[level] = true;
+  }
+
+  if (flags & LOG_REC_JSON) {
+    if (!(p = log_get_varint(p, end, &v))) return -1;
+    if (v >= game_tree_log_max_json_doc_len || (uint64_t) (end - p) < v) return -1;
+    memcpy(json_doc, p, v);
+    json_doc[v] = '\0';
+    p += v;
+    record->json_doc = json_doc;
+    record->json_doc_len = v;
+  } else {
+    record->json_doc = NULL;
+    record->json_doc_len = 0;
   }
-  if (env->h_file) fclose(env->h_file);
-  if (env->t_file) fclose(env->t_file);
-  free(env);
+
+  block->next = p - block->data;
+  block->next_record++;
+  return 1;
 }
 
 /**
@@ -188,19 +1236,21 @@ game_tree_log_init (const gchar *const file_name_prefix)
 
   gchar* file_name_prefix_copy = g_strdup(file_name_prefix);
 
-  env->t_file = NULL;
   env->h_file = NULL;
+  env->h_writer = NULL;
+  env->h_compression = true;
+  env->h_max_depth = -1;
+  env->h_sample_rate = 0;
+  env->h_root_moves = empty_square_set;
 
   if (file_name_prefix_copy) {
     env->log_is_on = TRUE;
     env->file_name_prefix = file_name_prefix_copy;
     env->h_file_name      = g_strconcat(file_name_prefix_copy, "_h.dat", NULL);
-    env->t_file_name      = g_strconcat(file_name_prefix_copy, "_t.dat", NULL);
   } else {
     env->log_is_on        = FALSE;
     env->file_name_prefix = NULL;
     env->h_file_name      = NULL;
-    env->t_file_name      = NULL;
   }
 
   return env;
@@ -311,7 +1361,6 @@ game_tree_log_data_h_json_doc3 (char *const json_doc,
   const SquareSet empties = game_position_x_empties(gpx);
   const int empty_count = bit_works_bitcount_64(empties);
   const int legal_move_count_adj = legal_move_count + ((legal_moves == 0 && !is_leaf) ? 1 : 0);
-  gchar *legal_moves_pg_json_array = square_set_to_pg_json_array(legal_moves);
   /*
    * cl:   call level
    * ec:   empty count
@@ -319,16 +1368,35 @@ game_tree_log_data_h_json_doc3 (char *const json_doc,
    * lmc:  legal move count
    * lmca: legal move count adjusted
    * lma:  legal move array ([""A1"", ""B4"", ""H8""])
+   *
+   * The document is the same written by game_tree_log_data_h_json_doc2, it is formatted without
+   * allocations, being called once for each record by the log reader.
    */
-  const int len = sprintf(json_doc,
-                          "\"{ \"\"cl\"\": %2d, \"\"ec\"\": %2d, \"\"il\"\": %s, \"\"lmc\"\": %2d, \"\"lmca\"\": %2d, \"\"lma\"\": %s }\"",
-                          call_level,
-                          empty_count,
-                          is_leaf ? "true" : "false",
-                          legal_move_count,
-                          legal_move_count_adj,
-                          legal_moves_pg_json_array);
-  return len;
+  char *p = json_doc;
+  p = log_json_put_str(p, "\"{ \"\"cl\"\": ");
+  p = log_json_put_2d(p, call_level);
+  p = log_json_put_str(p, ", \"\"ec\"\": ");
+  p = log_json_put_2d(p, empty_count);
+  p = log_json_put_str(p, ", \"\"il\"\": ");
+  p = log_json_put_str(p, is_leaf ? "true" : "false");
+  p = log_json_put_str(p, ", \"\"lmc\"\": ");
+  p = log_json_put_2d(p, legal_move_count);
+  p = log_json_put_str(p, ", \"\"lmca\"\": ");
+  p = log_json_put_2d(p, legal_move_count_adj);
+  p = log_json_put_str(p, ", \"\"lma\"\": [");
+  for (SquareSet m = legal_moves; m; m &= m - 1) {
+    const int sq = bit_works_bitscanLS1B_64(m);
+    if (m != legal_moves) p = log_json_put_str(p, ", ");
+    *p++ = '"';
+    *p++ = '"';
+    *p++ = 'A' + sq % 8;
+    *p++ = '1' + sq / 8;
+    *p++ = '"';
+    *p++ = '"';
+  }
+  p = log_json_put_str(p, "] }\"");
+  *p = '\0';
+  return p - json_doc;
 }
 
 void
@@ -352,6 +1420,40 @@ do_log (const ExactSolution *const result,
   game_tree_log_write_h(log_env, &log_data);
 }
 
+/**
+ * @brief Writes the exit record of the active node, when the search leaves it.
+ *
+ * @details The node count of the subtree is computed from the call id of the node,
+ *          that is the one written by the last call to #do_log at the same call level.
+ *
+ * @param [in] result     the solution, its node count is the call id of the last node of the subtree
+ * @param [in] stack      the game tree stack, the active node is the one exited
+ * @param [in] sub_run_id the sub run id
+ * @param [in] log_env    the logging environment
+ */
+void
+do_log_exit (const ExactSolution *const result,
+             const GameTreeStack *const stack,
+             const unsigned long int sub_run_id,
+             const LogEnv *const log_env)
+{
+  const NodeInfo* const c = stack->active_node;
+  const uint8_t call_level = c - stack->nodes;
+  const uint64_t call_id = log_env->h_writer->level_call_id[call_level];
+  LogDataT log_data =
+    { .sub_run_id   = sub_run_id,
+      .call_id      = call_id,
+      .hash         = c->hash,
+      .parent_hash  = (c - 1)->hash,
+      .json_doc     = NULL,
+      .json_doc_len = 0,
+      .call_level   = call_level,
+      .value        = c->alpha,
+      .best_move    = c->best_move,
+      .node_count   = result->node_count - call_id + 1 };
+  game_tree_log_write_t(log_env, &log_data);
+}
+
 
 
 /**
@@ -404,6 +1506,719 @@ game_tree_log_dirname_recursive_check (const gchar * const filename)
   }
 }
 
+static inline uint8_t *
+log_put_u32 (uint8_t *p,
+             const uint32_t v)
+{
+  for (int i = 0; i < 4; i++) *p++ = (uint8_t) (v >> (8 * i));
+  return p;
+}
+
+static inline uint8_t *
+log_put_u64 (uint8_t *p,
+             const uint64_t v)
+{
+  for (int i = 0; i < 8; i++) *p++ = (uint8_t) (v >> (8 * i));
+  return p;
+}
+
+/*
+ * Writes seven bits per byte, the highest bit is set when more bytes follow.
+ */
+static inline uint8_t *
+log_put_varint (uint8_t *p,
+                uint64_t v)
+{
+  while (v >= 0x80) {
+    *p++ = (uint8_t) (v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t) v;
+  return p;
+}
+
+static inline uint32_t
+log_get_u32 (const uint8_t *const p)
+{
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++) v |= (uint32_t) p[i] << (8 * i);
+  return v;
+}
+
+static inline uint64_t
+log_get_u64 (const uint8_t *const p)
+{
+  uint64_t v = 0;
+  for (int i = 0; i < 8; i++) v |= (uint64_t) p[i] << (8 * i);
+  return v;
+}
+
+/*
+ * Returns the pointer to the byte following the varint, or NULL when it runs past the end.
+ */
+static inline const uint8_t *
+log_get_varint (const uint8_t *p,
+                const uint8_t *const end,
+                uint64_t *const v)
+{
+  *v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p >= end) return NULL;
+    const uint8_t b = *p++;
+    *v |= (uint64_t) (b & 0x7F) << shift;
+    if (!(b & 0x80)) return p;
+  }
+  return NULL;
+}
+
+static void
+log_codec_reset (LogCodecH *const codec)
+{
+  codec->call_id = 0;
+  codec->sub_run_id = 0;
+  memset(codec->level_is_set, 0, sizeof(codec->level_is_set));
+}
+
+/*
+ * Encodes the record into buf, that must have room for LOG_REC_MAX_SIZE bytes, and returns the encoded size.
+ */
+static size_t
+log_record_encode (LogCodecH *const codec,
+                   uint8_t *const buf,
+                   const LogDataH *const data,
+                   const char *const json_doc)
+{
+  uint8_t flags = 0;
+  uint8_t *p = buf + 1;
+
+  /* The call id of an exit record is expected to be the one of the last node entered, less the nodes of the subtree. */
+  const bool is_exit = data->type == LOG_RECORD_EXIT;
+  const uint64_t expected_call_id = is_exit ? codec->call_id - data->node_count + 1 : codec->call_id;
+  const int64_t call_id_delta = (int64_t) (data->call_id - expected_call_id);
+  p = log_put_varint(p, ((uint64_t) call_id_delta << 1) ^ (uint64_t) (call_id_delta >> 63));
+  if (!is_exit) codec->call_id = data->call_id;
+
+  if (data->sub_run_id != codec->sub_run_id) {
+    flags |= LOG_REC_SUB_RUN_ID;
+    p = log_put_varint(p, (uint32_t) data->sub_run_id);
+    codec->sub_run_id = data->sub_run_id;
+  }
+
+  const uint8_t level = data->call_level;
+  *p++ = level;
+
+  if (is_exit) {
+    flags |= LOG_REC_EXIT;
+    if (codec->level_is_set[level] && codec->level_hash[level] == data->hash && codec->level_parent_hash[level] == data->parent_hash) {
+      flags |= LOG_REC_NODE_REF;
+    } else {
+      p = log_put_u64(p, data->parent_hash);
+      p = log_put_u64(p, data->hash);
+    }
+    const int64_t value = data->value;
+    p = log_put_varint(p, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+    *p++ = (uint8_t) data->best_move;
+    p = log_put_varint(p, data->node_count);
+  } else {
+    if (level > 0 && codec->level_is_set[level - 1] && codec->level_hash[level - 1] == data->parent_hash) {
+      flags |= LOG_REC_PARENT_REF;
+    } else {
+      p = log_put_u64(p, data->parent_hash);
+    }
+    codec->level_hash[level] = data->hash;
+    codec->level_parent_hash[level] = data->parent_hash;
+    codec->level_is_set[level] = true;
+
+    const GamePositionX gpx = { .blacks = data->blacks, .whites = data->whites, .player = data->player };
+    if (data->player == WHITE_PLAYER) flags |= LOG_REC_WHITE_PLAYER;
+    if (game_position_x_hash(&gpx) == data->hash) {
+      flags |= LOG_REC_HASH_COMPUTED;
+    } else {
+      p = log_put_u64(p, data->hash);
+    }
+
+    if (data->blacks & data->whites) {
+      flags |= LOG_REC_RAW_POSITION;
+      p = log_put_u64(p, data->blacks);
+      p = log_put_u64(p, data->whites);
+    } else {
+      const SquareSet occupied = data->blacks | data->whites;
+      p = log_put_u64(p, occupied);
+      int k = 0;
+      for (SquareSet m = occupied; m; m &= m - 1, k++) {
+        if ((k & 7) == 0) p[k >> 3] = 0;
+        if (data->blacks & m & -m) p[k >> 3] |= 1 << (k & 7);
+      }
+      p += (k + 7) >> 3;
+    }
+  }
+
+  if (json_doc) {
+    flags |= LOG_REC_JSON;
+    p = log_put_varint(p, data->json_doc_len);
+    memcpy(p, json_doc, data->json_doc_len);
+    p += data->json_doc_len;
+  }
+
+  buf[0] = flags;
+  return p - buf;
+}
+
+/*
+ * Allocates the head writer, writes the file header, and starts the writer thread.
+ * When the thread cannot be started, the writer is used synchronously.
+ */
+static LogWriter *
+log_writer_new (FILE *const file,
+                const LogEnv *const env)
+{
+  LogWriter *const w = (LogWriter *) malloc(sizeof(LogWriter));
+  g_assert(w);
+  w->file = file;
+  w->slot_size = (sizeof(LogWriterSlot) + game_tree_log_max_json_doc_len + 63) & ~((size_t) 63);
+  w->slots = (char *) malloc(game_tree_log_ring_size * w->slot_size);
+  g_assert(w->slots);
+  w->head = 0;
+  w->tail = 0;
+  w->is_closing = false;
+  w->producer_waiting = false;
+  w->consumer_waiting = false;
+  w->compression = env->h_compression;
+  w->batch = (uint8_t *) malloc(game_tree_log_batch_size);
+  g_assert(w->batch);
+  w->batch_len = 0;
+  w->batch_count = 0;
+  w->stored = (uint8_t *) malloc(lz_block_bound(game_tree_log_batch_size));
+  g_assert(w->stored);
+  log_codec_reset(&w->codec);
+  memset(&w->stats, 0, sizeof(LogWriterStats));
+  w->offset = LOG_FILE_HEADER_SIZE;
+  w->record_ordinal = 0;
+  w->index = NULL;
+  w->index_count = 0;
+  w->index_capacity = 0;
+
+  w->max_depth = env->h_max_depth;
+  w->sample_rate = env->h_sample_rate;
+  w->root_moves = env->h_root_moves;
+  w->filter_is_on = w->max_depth >= 0 || w->sample_rate > 1 || w->root_moves;
+  w->has_root = false;
+  w->path = NULL;
+  if (w->sample_rate > 1) {
+    w->path = (char *) malloc(256 * w->slot_size);
+    g_assert(w->path);
+  }
+
+  uint8_t header[LOG_FILE_HEADER_SIZE];
+  memcpy(header, GAME_TREE_LOG_H_MAGIC, 8);
+  log_put_u32(header + 8, GAME_TREE_LOG_H_VERSION);
+  log_put_u32(header + 12, 0);
+  fwrite(header, sizeof(header), 1, file);
+
+  pthread_mutex_init(&w->mutex, NULL);
+  pthread_cond_init(&w->cond, NULL);
+  w->has_thread = pthread_create(&w->thread, NULL, log_writer_run, w) == 0;
+  return w;
+}
+
+/*
+ * Passes the record to the writer thread, or writes it when there is no thread.
+ */
+static void
+log_writer_put (LogWriter *const w,
+                const LogDataH *const data)
+{
+  if (!w->has_thread) {
+    log_writer_append(w, data, data->json_doc);
+    return;
+  }
+
+  const uint64_t head = w->head;
+  uint64_t tail = __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE);
+  if (head - tail == game_tree_log_ring_size) {
+    __atomic_store_n(&w->stats.full_wait_count, w->stats.full_wait_count + 1, __ATOMIC_RELAXED);
+    do {
+      log_writer_wait(w, &w->producer_waiting, log_writer_has_free_slot);
+      tail = __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE);
+    } while (head - tail == game_tree_log_ring_size);
+  }
+
+  LogWriterSlot *const slot = log_writer_slot(w, head);
+  slot->data = *data;
+  if (data->json_doc) memcpy(slot->json_doc, data->json_doc, data->json_doc_len + 1);
+  __atomic_store_n(&w->head, head + 1, __ATOMIC_SEQ_CST);
+
+  const size_t usage = head + 1 - tail;
+  if (usage > w->stats.max_ring_usage) __atomic_store_n(&w->stats.max_ring_usage, usage, __ATOMIC_RELAXED);
+
+  /* A writer waiting for records is waken up when a batch is ready, or else it wakes up after a timeout. */
+  if (usage >= game_tree_log_ring_size / 4) log_writer_wake(w, &w->consumer_waiting);
+}
+
+/*
+ * Applies the filters to the record, and passes it to log_writer_put when it is selected.
+ * Nodes arrive in the order they are visited, so the root is met before any other node of a tree,
+ * the root move of a subtree before the nodes below it, and the path from the root to a node
+ * is the list of the last nodes met at each depth.
+ */
+static void
+log_writer_filter (LogWriter *const w,
+                   const LogDataH *const data)
+{
+  const int level = data->call_level;
+
+  if (data->type == LOG_RECORD_EXIT) {
+    /* The exit record of a node is written when the record entering it has been written. */
+    if (!w->has_root || data->sub_run_id != w->root_sub_run_id || level < w->root_level) goto drop;
+    const int depth = level - w->root_level;
+    if (w->max_depth >= 0 && depth > w->max_depth) goto drop;
+    if (w->root_moves && depth > 0 && !w->is_selected) goto drop;
+    if (w->sample_rate > 1 && !w->path_is_written[depth]) goto drop;
+    log_writer_put(w, data);
+    return;
+  }
+
+  if (!w->has_root || data->sub_run_id != w->root_sub_run_id || level <= w->root_level) {
+    w->has_root = true;
+    w->root_level = level;
+    w->root_sub_run_id = data->sub_run_id;
+    w->root_occupied = data->blacks | data->whites;
+  }
+  const int depth = level - w->root_level;
+
+  if (w->max_depth >= 0 && depth > w->max_depth) goto drop;
+
+  if (w->root_moves) {
+    if (depth == 1) {
+      /* The root move is the square occupied by the child and empty at the root, a pass is always selected. */
+      const SquareSet move = (data->blacks | data->whites) & ~w->root_occupied;
+      w->is_selected = !move || (move & w->root_moves);
+    }
+    if (depth > 0 && !w->is_selected) goto drop;
+  }
+
+  if (w->sample_rate > 1) {
+    LogWriterSlot *const slot = (LogWriterSlot *) (w->path + depth * w->slot_size);
+    slot->data = *data;
+    if (data->json_doc) {
+      memcpy(slot->json_doc, data->json_doc, data->json_doc_len + 1);
+      slot->data.json_doc = slot->json_doc;
+    }
+    w->path_is_written[depth] = false;
+    if (!log_writer_is_sampled(data->hash, w->sample_rate)) goto drop;
+    /* Ancestors not written yet have been counted as filtered out when met. */
+    uint64_t filtered_count = w->stats.filtered_count;
+    for (int d = 0; d <= depth; d++) {
+      if (w->path_is_written[d]) continue;
+      log_writer_put(w, &((LogWriterSlot *) (w->path + d * w->slot_size))->data);
+      w->path_is_written[d] = true;
+      if (d < depth) filtered_count--;
+    }
+    __atomic_store_n(&w->stats.filtered_count, filtered_count, __ATOMIC_RELAXED);
+    return;
+  }
+
+  log_writer_put(w, data);
+  return;
+
+ drop:
+  __atomic_store_n(&w->stats.filtered_count, w->stats.filtered_count + 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Returns true for one hash value in sample_rate, hash values are mixed first,
+ * so that the choice doesn't depend on their lowest bits only.
+ */
+static inline bool
+log_writer_is_sampled (const uint64_t hash,
+                       const uint32_t sample_rate)
+{
+  uint64_t h = hash;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h % sample_rate == 0;
+}
+
+static void
+log_writer_free (LogWriter *w)
+{
+  pthread_cond_destroy(&w->cond);
+  pthread_mutex_destroy(&w->mutex);
+  free(w->index);
+  free(w->path);
+  free(w->stored);
+  free(w->batch);
+  free(w->slots);
+  free(w);
+}
+
+static inline LogWriterSlot *
+log_writer_slot (const LogWriter *const w,
+                 const uint64_t i)
+{
+  return (LogWriterSlot *) (w->slots + (i % game_tree_log_ring_size) * w->slot_size);
+}
+
+/*
+ * Waits until the is_ready predicate is true.
+ * The waiting flag is set before checking the predicate, and the other thread checks the flag
+ * after changing the ring, so that one of the two always sees the change of the other.
+ * The wait has a timeout, then a thread woken up only by the timeout checks again the ring.
+ */
+static void
+log_writer_wait (LogWriter *const w,
+                 bool *const waiting,
+                 log_writer_is_ready_f *const is_ready)
+{
+  pthread_mutex_lock(&w->mutex);
+  __atomic_store_n(waiting, true, __ATOMIC_SEQ_CST);
+  if (!is_ready(w)) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += log_writer_wait_timeout_ns;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+    while (!is_ready(w)) {
+      if (pthread_cond_timedwait(&w->cond, &w->mutex, &deadline) != 0) break;
+    }
+  }
+  __atomic_store_n(waiting, false, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&w->mutex);
+}
+
+/*
+ * Wakes up the other thread when its waiting flag is set.
+ */
+static void
+log_writer_wake (LogWriter *const w,
+                 const bool *const waiting)
+{
+  if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&w->mutex);
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+  }
+}
+
+static bool
+log_writer_has_records (LogWriter *const w)
+{
+  return __atomic_load_n(&w->head, __ATOMIC_SEQ_CST) != w->tail || __atomic_load_n(&w->is_closing, __ATOMIC_SEQ_CST);
+}
+
+static bool
+log_writer_has_free_slot (LogWriter *const w)
+{
+  return w->head - __atomic_load_n(&w->tail, __ATOMIC_SEQ_CST) < game_tree_log_ring_size;
+}
+
+/*
+ * Encodes the record into the batch buffer, the buffer is written as a block when there is no room left.
+ */
+static void
+log_writer_append (LogWriter *const w,
+                   const LogDataH *const data,
+                   const char *const json_doc)
+{
+  if (w->batch_len + LOG_REC_MAX_SIZE > game_tree_log_batch_size) log_writer_flush(w);
+  w->batch_len += log_record_encode(&w->codec, w->batch + w->batch_len, data, json_doc);
+  w->batch_count++;
+  __atomic_store_n(&w->stats.record_count, w->stats.record_count + 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Writes the records collected by the batch buffer as a block, compressed when it is smaller.
+ * The encoder state is reset, the next block is independent from this one.
+ */
+static void
+log_writer_flush (LogWriter *const w)
+{
+  if (w->batch_len == 0) return;
+
+  const uint8_t *block = w->batch;
+  size_t block_size = w->batch_len;
+  uint32_t compression = LOG_BLOCK_RAW;
+  if (w->compression) {
+    const size_t compressed_size = lz_block_compress(w->batch, w->batch_len, w->stored, lz_block_bound(game_tree_log_batch_size));
+    if (compressed_size > 0 && compressed_size < w->batch_len) {
+      block = w->stored;
+      block_size = compressed_size;
+      compression = LOG_BLOCK_LZ;
+    }
+  }
+
+  uint8_t header[LOG_BLOCK_HEADER_SIZE];
+  uint8_t *p = header;
+  p = log_put_u32(p, w->batch_count);
+  p = log_put_u32(p, w->batch_len);
+  p = log_put_u32(p, block_size);
+  p = log_put_u32(p, compression);
+  fwrite(header, sizeof(header), 1, w->file);
+  fwrite(block, block_size, 1, w->file);
+
+  if (w->index_count == w->index_capacity) {
+    w->index_capacity = w->index_capacity ? 2 * w->index_capacity : 64;
+    w->index = (LogBlockIndexEntryH *) realloc(w->index, w->index_capacity * sizeof(LogBlockIndexEntryH));
+    g_assert(w->index);
+  }
+  w->index[w->index_count].offset = w->offset;
+  w->index[w->index_count].first_record = w->record_ordinal;
+  w->index_count++;
+  w->offset += sizeof(header) + block_size;
+  w->record_ordinal += w->batch_count;
+
+  __atomic_store_n(&w->stats.raw_byte_count, w->stats.raw_byte_count + w->batch_len, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->stats.byte_count, w->stats.byte_count + sizeof(header) + block_size, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->stats.batch_count, w->stats.batch_count + 1, __ATOMIC_RELAXED);
+  w->batch_len = 0;
+  w->batch_count = 0;
+  log_codec_reset(&w->codec);
+}
+
+/*
+ * Copies the string, without the terminating null, and returns the end of the copy.
+ */
+static inline char *
+log_json_put_str (char *p,
+                  const char *s)
+{
+  while (*s) *p++ = *s++;
+  return p;
+}
+
+/*
+ * Writes the non negative value as the "%2d" format does.
+ */
+static inline char *
+log_json_put_2d (char *p,
+                 const int v)
+{
+  if (v < 10) *p++ = ' ';
+  else if (v >= 100) return p + sprintf(p, "%d", v);
+  else *p++ = '0' + v / 10;
+  *p++ = '0' + v % 10;
+  return p;
+}
+
+/*
+ * Writes the block index, and the trailer pointing to it, after the last block.
+ */
+static void
+log_writer_write_index (LogWriter *const w)
+{
+  uint8_t buf[LOG_BLOCK_HEADER_SIZE];
+  uint8_t *p = buf;
+  p = log_put_u32(p, w->index_count);
+  p = log_put_u32(p, 16 * w->index_count);
+  p = log_put_u32(p, 16 * w->index_count);
+  p = log_put_u32(p, LOG_BLOCK_INDEX);
+  fwrite(buf, sizeof(buf), 1, w->file);
+  for (size_t i = 0; i < w->index_count; i++) {
+    p = log_put_u64(buf, w->index[i].offset);
+    log_put_u64(p, w->index[i].first_record);
+    fwrite(buf, 16, 1, w->file);
+  }
+  p = log_put_u64(buf, w->offset);
+  memcpy(p, GAME_TREE_LOG_H_INDEX_MAGIC, 8);
+  fwrite(buf, 16, 1, w->file);
+}
+
+/*
+ * The writer thread, it runs until the ring is empty and the env is closing.
+ * The batch buffer is written when it is full, when the ring stays empty for the wait timeout, and at the end.
+ */
+static void *
+log_writer_run (void *arg)
+{
+  LogWriter *const w = (LogWriter *) arg;
+  for (;;) {
+    const uint64_t head = __atomic_load_n(&w->head, __ATOMIC_ACQUIRE);
+    if (head == w->tail) {
+      if (__atomic_load_n(&w->is_closing, __ATOMIC_SEQ_CST) && __atomic_load_n(&w->head, __ATOMIC_SEQ_CST) == w->tail) break;
+      __atomic_store_n(&w->stats.empty_wait_count, w->stats.empty_wait_count + 1, __ATOMIC_RELAXED);
+      log_writer_wait(w, &w->consumer_waiting, log_writer_has_records);
+      if (__atomic_load_n(&w->head, __ATOMIC_ACQUIRE) == w->tail) log_writer_flush(w);
+      continue;
+    }
+    for (uint64_t i = w->tail; i < head; i++) {
+      const LogWriterSlot *const slot = log_writer_slot(w, i);
+      log_writer_append(w, &slot->data, slot->data.json_doc ? slot->json_doc : NULL);
+    }
+    __atomic_store_n(&w->tail, head, __ATOMIC_SEQ_CST);
+    log_writer_wake(w, &w->producer_waiting);
+  }
+  log_writer_flush(w);
+  return NULL;
+}
+
+/*
+ * Entries are sorted by key, then by ordinal, so that records sharing the key are in the order of the head file.
+ */
+static int
+log_hash_index_entry_cmp (const void *const a,
+                          const void *const b)
+{
+  const LogHashIndexEntry *const x = (const LogHashIndexEntry *) a;
+  const LogHashIndexEntry *const y = (const LogHashIndexEntry *) b;
+  if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+  return (x->ordinal > y->ordinal) - (x->ordinal < y->ordinal);
+}
+
+/*
+ * Writes the values in little endian order, returns false on a write error.
+ */
+static bool
+log_hash_index_put_u64_array (FILE *const fp,
+                              const uint64_t *const v,
+                              const size_t count)
+{
+  uint8_t buf[8 * 512];
+  for (size_t i = 0; i < count; ) {
+    uint8_t *p = buf;
+    for (size_t j = 0; j < 512 && i < count; j++, i++) p = log_put_u64(p, v[i]);
+    if (fwrite(buf, p - buf, 1, fp) != 1) return false;
+  }
+  return true;
+}
+
+/*
+ * Sorts the entries collected in memory, and appends them as a new run to the temporary files,
+ * that are created by the first call. Returns false on a write error.
+ */
+static bool
+log_hash_index_spill_run (LogHashIndexRuns *const runs,
+                          LogHashIndexEntry *const by_hash,
+                          LogHashIndexEntry *const by_parent_hash,
+                          const uint64_t *const parents,
+                          const size_t count)
+{
+  if (runs->run_count == 0) {
+    runs->by_hash = tmpfile();
+    runs->by_parent_hash = tmpfile();
+    runs->parents = tmpfile();
+    if (!runs->by_hash || !runs->by_parent_hash || !runs->parents) return false;
+  }
+  sort_utils_quicksort(by_hash, count, sizeof(LogHashIndexEntry), log_hash_index_entry_cmp);
+  sort_utils_quicksort(by_parent_hash, count, sizeof(LogHashIndexEntry), log_hash_index_entry_cmp);
+  if (fwrite(by_hash, sizeof(LogHashIndexEntry), count, runs->by_hash) != count ||
+      fwrite(by_parent_hash, sizeof(LogHashIndexEntry), count, runs->by_parent_hash) != count ||
+      !log_hash_index_put_u64_array(runs->parents, parents, count)) return false;
+  runs->run_count++;
+  return true;
+}
+
+/*
+ * Merges the sorted runs of the temporary file, and writes the entries to `fp`.
+ * The runs are the heads of a binary heap, ordered by means of the current entry of each run.
+ * Returns false on a read or write error.
+ */
+static bool
+log_hash_index_merge_runs (FILE *const runs_fp,
+                           const size_t run_count,
+                           const uint64_t entry_count,
+                           FILE *const fp)
+{
+  if (fflush(runs_fp) != 0) return false;
+
+  LogHashIndexRun *const runs = (LogHashIndexRun *) malloc(run_count * sizeof(LogHashIndexRun));
+  LogHashIndexEntry *const bufs = (LogHashIndexEntry *) malloc((run_count + 1) * LOG_HASH_INDEX_MERGE_BUFFER_SIZE * sizeof(LogHashIndexEntry));
+  size_t *const heap = (size_t *) malloc(run_count * sizeof(size_t));
+  g_assert(runs && bufs && heap);
+  LogHashIndexEntry *const out = bufs + run_count * LOG_HASH_INDEX_MERGE_BUFFER_SIZE;
+
+  bool ok = true;
+  size_t heap_size = 0;
+  for (size_t i = 0; i < run_count && ok; i++) {
+    const uint64_t first = (uint64_t) i * LOG_HASH_INDEX_RUN_SIZE;
+    runs[i].offset = first * sizeof(LogHashIndexEntry);
+    runs[i].remaining = entry_count - first < LOG_HASH_INDEX_RUN_SIZE ? entry_count - first : LOG_HASH_INDEX_RUN_SIZE;
+    runs[i].buf = bufs + i * LOG_HASH_INDEX_MERGE_BUFFER_SIZE;
+    ok = log_hash_index_run_fill(&runs[i], runs_fp);
+    heap[heap_size++] = i;
+  }
+  if (ok) for (size_t i = heap_size / 2; i-- > 0; ) log_hash_index_heap_sift_down(heap, heap_size, i, runs);
+
+  size_t out_count = 0;
+  while (ok && heap_size) {
+    LogHashIndexRun *const run = &runs[heap[0]];
+    out[out_count++] = run->buf[run->next++];
+    if (out_count == LOG_HASH_INDEX_MERGE_BUFFER_SIZE) {
+      ok = log_hash_index_put_u64_array(fp, (const uint64_t *) out, 2 * out_count);
+      out_count = 0;
+    }
+    if (run->next == run->count) {
+      if (run->remaining) ok = ok && log_hash_index_run_fill(run, runs_fp);
+      else heap[0] = heap[--heap_size];
+    }
+    log_hash_index_heap_sift_down(heap, heap_size, 0, runs);
+  }
+  if (ok && out_count) ok = log_hash_index_put_u64_array(fp, (const uint64_t *) out, 2 * out_count);
+
+  free(runs);
+  free(bufs);
+  free(heap);
+  return ok;
+}
+
+/*
+ * Reads the next entries of the run from the temporary file into its buffer.
+ */
+static bool
+log_hash_index_run_fill (LogHashIndexRun *const run,
+                         FILE *const runs_fp)
+{
+  const size_t n = run->remaining < LOG_HASH_INDEX_MERGE_BUFFER_SIZE ? run->remaining : LOG_HASH_INDEX_MERGE_BUFFER_SIZE;
+  if (fseeko(runs_fp, run->offset, SEEK_SET) != 0 || fread(run->buf, sizeof(LogHashIndexEntry), n, runs_fp) != n) return false;
+  run->offset += n * sizeof(LogHashIndexEntry);
+  run->remaining -= n;
+  run->count = n;
+  run->next = 0;
+  return true;
+}
+
+/*
+ * Moves down the heap item at position `i`, until it is not greater than its children.
+ */
+static void
+log_hash_index_heap_sift_down (size_t *const heap,
+                               const size_t heap_size,
+                               size_t i,
+                               const LogHashIndexRun *const runs)
+{
+  for (;;) {
+    size_t smallest = i;
+    for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < heap_size; child++) {
+      const LogHashIndexRun *const c = &runs[heap[child]];
+      const LogHashIndexRun *const m = &runs[heap[smallest]];
+      if (log_hash_index_entry_cmp(&c->buf[c->next], &m->buf[m->next]) < 0) smallest = child;
+    }
+    if (smallest == i) return;
+    const size_t tmp = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = tmp;
+    i = smallest;
+  }
+}
+
+/*
+ * Copies the content of the temporary file `from`, starting at its beginning, to `to`.
+ */
+static bool
+log_hash_index_copy (FILE *const from,
+                     FILE *const to)
+{
+  uint8_t buf[64 * 1024];
+  if (fflush(from) != 0 || fseeko(from, 0, SEEK_SET) != 0) return false;
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), from)) > 0) {
+    if (fwrite(buf, 1, n, to) != n) return false;
+  }
+  return !ferror(from);
+}
+
 /**
  * @endcond
  */
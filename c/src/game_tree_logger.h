@@ -35,6 +35,7 @@
 #define GAME_TREE_LOGGER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "board.h"
 #include "endgame_solver.h"
@@ -42,20 +43,86 @@
 
 
 
+/**
+ * @brief The magic string opening the head log file.
+ */
+#define GAME_TREE_LOG_H_MAGIC "RVGTLOGH"
+
+/**
+ * @brief The version of the head log file format.
+ */
+#define GAME_TREE_LOG_H_VERSION 3
+
+/**
+ * @brief The magic string closing the head log file, preceded by the offset of the block index.
+ */
+#define GAME_TREE_LOG_H_INDEX_MAGIC "RVGTLIDX"
+
+/**
+ * @brief The magic string opening the hash index sidecar file of the head log file.
+ */
+#define GAME_TREE_LOG_H_HASH_INDEX_MAGIC "RVGTLHIX"
+
+/**
+ * @brief The version of the hash index file format.
+ */
+#define GAME_TREE_LOG_H_HASH_INDEX_VERSION 1
+
+/**
+ * @brief The parent ordinal of the records having no parent in the head log file.
+ */
+#define GAME_TREE_LOG_H_NO_PARENT UINT64_MAX
+
+/**
+ * @brief The writer of the head file, it is private to the logger module.
+ */
+typedef struct log_writer_s LogWriter;
+
 /**
  * @brief Environment in wich the logger operates.
  */
 typedef struct {
   bool       log_is_on;        /**< @brief True when logging is turned on. */
   char      *file_name_prefix; /**< @brief The log file name prefix received by the caller. */
-  char      *t_file_name;      /**< @brief The complete name for the tail file. */
-  FILE      *t_file;           /**< @brief Tail file. */
   char      *h_file_name;      /**< @brief The complete name for the binary data head file. */
   FILE      *h_file;           /**< @brief Head binary data file. */
+  LogWriter *h_writer;         /**< @brief Background writer of the head file. */
+  bool       h_compression;    /**< @brief True when blocks of the head file are compressed, it is read when opening the file. */
+  int        h_max_depth;      /**< @brief Nodes deeper than this are not written, a negative value means no limit. */
+  uint32_t   h_sample_rate;    /**< @brief One node in this many, chosen by hash, is written with its path from the root, zero or one write all. */
+  SquareSet  h_root_moves;     /**< @brief When not empty, only the subtrees rooted at these root moves are written. */
 } LogEnv;
 
+/**
+ * @brief Statistics collected by the background writer of the head file.
+ *
+ * @details Wait counts measure the back pressure: the search waits when the ring buffer is full,
+ *          the writer waits when it is empty.
+ */
+typedef struct {
+  uint64_t   record_count;     /**< @brief Records written. */
+  uint64_t   raw_byte_count;   /**< @brief Bytes of the encoded records, before compression. */
+  uint64_t   byte_count;       /**< @brief Bytes written. */
+  uint64_t   batch_count;      /**< @brief Blocks written, each one collecting a batch of records. */
+  uint64_t   filtered_count;   /**< @brief Records dropped by the filters. */
+  uint64_t   full_wait_count;  /**< @brief Times the search waited for a free slot. */
+  uint64_t   empty_wait_count; /**< @brief Times the writer waited for a record. */
+  size_t     max_ring_usage;   /**< @brief The largest count of slots in use. */
+} LogWriterStats;
+
+/**
+ * @brief The types of the records of the head file.
+ */
+typedef enum {
+  LOG_RECORD_ENTER,          /**< @brief The node is entered, the record has the game position. */
+  LOG_RECORD_EXIT            /**< @brief The node is exited, the record has the node value, the best move, and the node count. */
+} LogRecordTypeH;
+
 /**
  * @brief It is collecting the info logged into a record by the head write function.
+ *
+ * @details Exit records, written by #game_tree_log_write_t, have the call id, the call level, the hash,
+ *          and the parent hash of the node entered, and an empty game position.
  */
 typedef struct {
   int        sub_run_id;     /**< @brief Sub run id field. */
@@ -68,15 +135,98 @@ typedef struct {
   char      *json_doc;       /**< @brief Json field. */
   size_t     json_doc_len;   /**< @brief Json field length. */
   uint8_t    call_level;     /**< @brief Call level, or depth. */
+  uint8_t    type;           /**< @brief Record type, one of #LogRecordTypeH. */
+  int        value;          /**< @brief Node value, exit records only. */
+  Square     best_move;      /**< @brief Best move, exit records only. */
+  uint64_t   node_count;     /**< @brief Count of the nodes of the subtree, the node included, exit records only. */
 } LogDataH;
 
 /**
- * @brief It is collecting the info logged into a record by the tail write function.
+ * @brief The compression methods of the blocks of the head file.
+ */
+typedef enum {
+  LOG_BLOCK_RAW,             /**< @brief Records are stored as they are. */
+  LOG_BLOCK_LZ,              /**< @brief Records are compressed by the LZ block module. */
+  LOG_BLOCK_INDEX            /**< @brief The block is the index of the file, it follows the last block of records. */
+} LogBlockCompression;
+
+/**
+ * @brief An entry of the block index of the head file.
+ */
+typedef struct {
+  uint64_t   offset;           /**< @brief The offset of the block header from the start of the file. */
+  uint64_t   first_record;     /**< @brief The number of records preceding the block in the file. */
+} LogBlockIndexEntryH;
+
+/**
+ * @brief The keys of the hash index of the head file.
+ */
+typedef enum {
+  LOG_HASH_INDEX_BY_HASH,        /**< @brief Records are looked up by their hash. */
+  LOG_HASH_INDEX_BY_PARENT_HASH  /**< @brief Records are looked up by their parent hash. */
+} LogHashIndexKeyH;
+
+/**
+ * @brief The hash index of the head file, it is a sidecar file, searched without loading it.
+ *
+ * @details Records are addressed by their ordinal, that is their position in the head file,
+ *          and are read by means of the block index.
+ *          The file has a header, followed by three sections, all having a record count of entries:
+ *          - the pairs (hash, ordinal), sorted
+ *          - the pairs (parent hash, ordinal), sorted
+ *          - the ordinal of the parent of each record, or #GAME_TREE_LOG_H_NO_PARENT
+ */
+typedef struct {
+  FILE      *fp;               /**< @brief The hash index file. */
+  uint64_t   log_size;         /**< @brief The size of the head file when it has been indexed. */
+  uint64_t   record_count;     /**< @brief The number of records of the head file. */
+} LogHashIndexH;
+
+/**
+ * @brief The state shared by the encoder and the decoder of the records of a block.
+ *
+ * @details Records are encoded relative to the ones preceding them in the block,
+ *          the state is reset at the start of every block, so that blocks are decoded independently.
+ */
+typedef struct {
+  uint64_t   call_id;           /**< @brief The call id of the previous record. */
+  int        sub_run_id;        /**< @brief The sub run id of the previous record. */
+  uint64_t   level_hash[256];   /**< @brief The hash of the last record met at each call level. */
+  uint64_t   level_parent_hash[256]; /**< @brief The parent hash of the last record met at each call level. */
+  bool       level_is_set[256]; /**< @brief True when the corresponding level hash has been set. */
+} LogCodecH;
+
+/**
+ * @brief A block of the head file, read by #game_tree_log_block_h_read, and decoded by #game_tree_log_block_h_next.
+ */
+typedef struct {
+  uint32_t   record_count;     /**< @brief The number of records in the block. */
+  uint32_t   raw_size;         /**< @brief The size of the encoded records. */
+  uint32_t   stored_size;      /**< @brief The size of the block in the file. */
+  uint32_t   compression;      /**< @brief The compression method, one of #LogBlockCompression. */
+  uint8_t   *data;             /**< @brief The encoded records. */
+  size_t     data_capacity;    /**< @brief The size of the data buffer. */
+  uint8_t   *stored;           /**< @brief The block as read from the file. */
+  size_t     stored_capacity;  /**< @brief The size of the stored buffer. */
+  size_t     next;             /**< @brief The offset of the next record to be decoded. */
+  uint32_t   next_record;      /**< @brief The index of the next record to be decoded. */
+  LogCodecH  codec;            /**< @brief The state of the decoder. */
+} LogBlockH;
+
+/**
+ * @brief It is collecting the info logged into an exit record by the tail write function.
  */
 typedef struct {
-  int        sub_run_id;  /**< @brief Sub run id field. */
-  uint64_t   call_id;     /**< @brief Call id. */
-  char      *json_doc;    /**< @brief Json field. */
+  int        sub_run_id;     /**< @brief Sub run id field. */
+  uint64_t   call_id;        /**< @brief Call id of the node entered. */
+  uint64_t   hash;           /**< @brief Game position hash. */
+  uint64_t   parent_hash;    /**< @brief Parent game position hash. */
+  char      *json_doc;       /**< @brief Json field. */
+  size_t     json_doc_len;   /**< @brief Json field length. */
+  uint8_t    call_level;     /**< @brief Call level, or depth. */
+  int        value;          /**< @brief Node value. */
+  Square     best_move;      /**< @brief Best move. */
+  uint64_t   node_count;     /**< @brief Count of the nodes of the subtree, the node included. */
 } LogDataT;
 
 
@@ -90,6 +240,16 @@ typedef struct {
  */
 static const size_t game_tree_log_max_json_doc_len = 4096;
 
+/**
+ * @brief The count of records queued by the ring buffer of the head writer.
+ */
+static const size_t game_tree_log_ring_size = 1024;
+
+/**
+ * @brief The size of the buffer collecting the records written in a batch by the head writer.
+ */
+static const size_t game_tree_log_batch_size = 1 << 20;
+
 
 
 /********************************************************/
@@ -99,9 +259,6 @@ static const size_t game_tree_log_max_json_doc_len = 4096;
 extern void
 game_tree_log_open_h (LogEnv *const env);
 
-extern void
-game_tree_log_open_t (LogEnv *const env);
-
 extern void
 game_tree_log_write_h (const LogEnv *const env,
                        const LogDataH *const data);
@@ -113,6 +270,68 @@ game_tree_log_write_t (const LogEnv *const env,
 extern void
 game_tree_log_close (LogEnv *const env);
 
+extern void
+game_tree_log_set_filters (LogEnv *const env,
+                           const int max_depth,
+                           const uint32_t sample_rate,
+                           const SquareSet root_moves);
+
+extern void
+game_tree_log_h_stats (const LogEnv *const env,
+                       LogWriterStats *const stats);
+
+extern int
+game_tree_log_h_read_header (FILE *const fp);
+
+extern int
+game_tree_log_h_read_index (FILE *const fp,
+                            LogBlockIndexEntryH **const entries,
+                            size_t *const entry_count);
+
+extern int
+game_tree_log_h_read_record (FILE *const fp,
+                             const LogBlockIndexEntryH *const entries,
+                             const size_t entry_count,
+                             const uint64_t ordinal,
+                             LogBlockH *const block,
+                             LogDataH *const record,
+                             char *const json_doc);
+
+extern int
+game_tree_log_h_hash_index_write (FILE *const log_fp,
+                                  FILE *const fp);
+
+extern int
+game_tree_log_h_hash_index_open (LogHashIndexH *const index,
+                                 FILE *const fp);
+
+extern int
+game_tree_log_h_hash_index_lookup (const LogHashIndexH *const index,
+                                   const LogHashIndexKeyH key,
+                                   const uint64_t hash,
+                                   uint64_t **const ordinals,
+                                   size_t *const ordinal_count);
+
+extern int
+game_tree_log_h_hash_index_parent (const LogHashIndexH *const index,
+                                   const uint64_t ordinal,
+                                   uint64_t *const parent);
+
+extern void
+game_tree_log_block_h_init (LogBlockH *const block);
+
+extern void
+game_tree_log_block_h_release (LogBlockH *const block);
+
+extern int
+game_tree_log_block_h_read (LogBlockH *const block,
+                            FILE *const fp);
+
+extern int
+game_tree_log_block_h_next (LogBlockH *const block,
+                            LogDataH *const record,
+                            char *const json_doc);
+
 extern LogEnv *
 game_tree_log_init (const char *const file_name_prefix);
 
@@ -135,6 +354,12 @@ do_log (const ExactSolution *const result,
         const unsigned long int sub_run_id,
         const LogEnv *const log_env);
 
+extern void
+do_log_exit (const ExactSolution *const result,
+             const GameTreeStack *const stack,
+             const unsigned long int sub_run_id,
+             const LogEnv *const log_env);
+
 
 
 #endif /* GAME_TREE_LOGGER_H */
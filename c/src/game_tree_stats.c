@@ -0,0 +1,385 @@
+/**
+ * @file
+ *
+ * @brief Game tree statistics module implementation.
+ *
+ * @par game_tree_stats.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "bit_works.h"
+#include "sort_utils.h"
+#include "game_tree_stats.h"
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * A game position met by the search, with the count of its visits.
+ */
+typedef struct {
+  SquareSet blacks;
+  SquareSet whites;
+  Player    player;
+  uint64_t  hash;
+  uint64_t  count;
+} gts_position_t;
+
+
+
+/*
+ * Prototypes for internal functions.
+ */
+
+static uint64_t
+gts_position_hash (const void *item,
+                   void *param);
+
+static bool
+gts_position_equal (const void *item,
+                    const void *key,
+                    void *param);
+
+static void
+gts_close_node (GameTreeStats *const stats);
+
+static double
+gts_ratio (const uint64_t n,
+           const uint64_t d);
+
+/**
+ * @endcond
+ */
+
+
+
+/*********************************************************/
+/* Function implementations for the GameTreeStats entity. */
+/*********************************************************/
+
+/**
+ * @brief Creates a new empty statistics structure.
+ *
+ * @return the new structure
+ */
+GameTreeStats *
+game_tree_stats_new (void)
+{
+  GameTreeStats *const stats = (GameTreeStats *) malloc(sizeof(GameTreeStats));
+  assert(stats);
+  memset(stats, 0, sizeof(GameTreeStats));
+  stats->positions = hs_create(sizeof(gts_position_t), gts_position_hash, gts_position_equal, NULL);
+  stats->depth = -1;
+  stats->max_depth = -1;
+  return stats;
+}
+
+/**
+ * @brief Frees the statistics structure.
+ *
+ * @param [in,out] stats the structure, when `NULL` no action occurs
+ */
+void
+game_tree_stats_free (GameTreeStats *stats)
+{
+  if (!stats) return;
+  hs_destroy(stats->positions);
+  free(stats);
+}
+
+/**
+ * @brief Adds a node to the statistics.
+ *
+ * @details Nodes must be added in the order they are visited, the root node of a search having depth zero.
+ *          The open nodes having a depth equal or greater than `depth` are closed,
+ *          and the node is counted as a child searched by the open node at the previous depth.
+ *
+ * @param [in,out] stats the statistics structure
+ * @param [in]     depth the depth of the node
+ * @param [in]     gpx   the game position of the node
+ */
+void
+game_tree_stats_add_node (GameTreeStats *const stats,
+                          const int depth,
+                          const GamePositionX *const gpx)
+{
+  assert(stats);
+  assert(gpx);
+  assert(depth >= 0 && depth < GAME_TREE_STATS_MAX_DEPTH);
+
+  while (stats->depth >= depth) gts_close_node(stats);
+  if (depth > 0 && stats->depth == depth - 1) stats->open_searched_count[depth - 1]++;
+
+  GameTreeStatsLevel *const level = &stats->levels[depth];
+  const SquareSet moves = game_position_x_legal_moves(gpx);
+  const int mobility = bit_works_bitcount_64(moves);
+  uint32_t child_count = mobility;
+  level->node_count++;
+  level->legal_move_count += mobility;
+  if (mobility) {
+    stats->mobility[bit_works_bitcount_64(game_position_x_empties(gpx))][mobility]++;
+  } else if (game_position_x_has_any_player_any_legal_move(gpx)) {
+    level->pass_count++;
+    child_count = 1;
+  } else {
+    level->leaf_count++;
+  }
+
+  stats->open_child_count[depth] = child_count;
+  stats->open_searched_count[depth] = 0;
+  stats->depth = depth;
+  if (depth > stats->max_depth) stats->max_depth = depth;
+
+  const uint64_t hash = game_position_x_hash(gpx);
+  bool inserted;
+  gts_position_t *const p = (gts_position_t *) hs_probe(stats->positions, hash, gpx, &inserted);
+  if (inserted) {
+    p->blacks = gpx->blacks;
+    p->whites = gpx->whites;
+    p->player = gpx->player;
+    p->hash = hash;
+    p->count = 0;
+  }
+  p->count++;
+}
+
+/**
+ * @brief Closes all the open nodes.
+ *
+ * @details It has to be called when a search is completed, before reading the cut counts,
+ *          #game_tree_stats_print calls it.
+ *
+ * @param [in,out] stats the statistics structure
+ */
+void
+game_tree_stats_close_nodes (GameTreeStats *const stats)
+{
+  assert(stats);
+  while (stats->depth >= 0) gts_close_node(stats);
+}
+
+/**
+ * @brief Returns the count of the distinct hash values of the game positions met.
+ *
+ * @details When lower than the count of distinct positions, some positions share the hash value.
+ *
+ * @param [in] stats the statistics structure
+ * @return           the count of distinct hash values
+ */
+uint64_t
+game_tree_stats_distinct_hash_count (const GameTreeStats *const stats)
+{
+  assert(stats);
+
+  const size_t n = hs_count(stats->positions);
+  if (n == 0) return 0;
+  uint64_t *const hashes = (uint64_t *) malloc(n * sizeof(uint64_t));
+  assert(hashes);
+  size_t cursor = 0;
+  size_t i = 0;
+  for (const gts_position_t *p = hs_next(stats->positions, &cursor); p; p = hs_next(stats->positions, &cursor))
+    hashes[i++] = p->hash;
+  sort_utils_quicksort(hashes, n, sizeof(uint64_t), sort_utils_uint64_t_cmp);
+  uint64_t distinct = 1;
+  for (i = 1; i < n; i++) if (hashes[i] != hashes[i - 1]) distinct++;
+  free(hashes);
+  return distinct;
+}
+
+/**
+ * @brief Prints the statistics report.
+ *
+ * @details Open nodes are closed before printing.
+ *
+ * The report has four sections:
+ * - a summary, telling the node count, and the duplicated positions
+ * - a table by depth, having the horizon node count, the average mobility, the effective branching factor, the cut ratio,
+ *   the ratio of the cuts done by the first child, and the efficiency, that is the ratio between
+ *   the children searched and the children available
+ * - a table by empty square count, having the mobility average and standard deviation
+ * - the distribution of the visit count of the game positions
+ *
+ * @param [in,out] stats  the statistics structure
+ * @param [in]     stream the output stream
+ */
+void
+game_tree_stats_print (GameTreeStats *const stats,
+                       FILE *const stream)
+{
+  assert(stats);
+  assert(stream);
+
+  game_tree_stats_close_nodes(stats);
+
+  uint64_t node_count = 0, leaf_count = 0, pass_count = 0, horizon_count = 0, child_count = 0, searched_count = 0;
+  for (int d = 0; d <= stats->max_depth; d++) {
+    const GameTreeStatsLevel *const l = &stats->levels[d];
+    node_count += l->node_count;
+    leaf_count += l->leaf_count;
+    pass_count += l->pass_count;
+    horizon_count += l->horizon_count;
+    child_count += l->child_count;
+    searched_count += l->searched_count;
+  }
+  const uint64_t position_count = hs_count(stats->positions);
+  const uint64_t hash_count = game_tree_stats_distinct_hash_count(stats);
+
+  fprintf(stream, "Game tree statistics:\n");
+  fprintf(stream, "  nodes: %" PRIu64 ", leaves: %" PRIu64 ", passes: %" PRIu64 ", horizon nodes: %" PRIu64 ", max depth: %d\n",
+          node_count, leaf_count, pass_count, horizon_count, stats->max_depth);
+  fprintf(stream, "  distinct positions: %" PRIu64 ", duplicated visits: %" PRIu64 " (%.2f%%)\n",
+          position_count, node_count - position_count, 100.0 * gts_ratio(node_count - position_count, node_count));
+  fprintf(stream, "  distinct hashes: %" PRIu64 ", hash collisions: %" PRIu64 "\n",
+          hash_count, position_count - hash_count);
+  fprintf(stream, "  children searched: %" PRIu64 ", of available: %" PRIu64 ", efficiency: %.4f\n",
+          searched_count, child_count, gts_ratio(searched_count, child_count));
+
+  fprintf(stream, "\n  %5s %12s %12s %10s %12s %10s %10s %10s %10s %10s\n",
+          "depth", "nodes", "leaves", "passes", "horizon", "mobility", "branching", "cut_ratio", "first_cut", "efficiency");
+  for (int d = 0; d <= stats->max_depth; d++) {
+    const GameTreeStatsLevel *const l = &stats->levels[d];
+    const uint64_t next_node_count = d + 1 < GAME_TREE_STATS_MAX_DEPTH ? stats->levels[d + 1].node_count : 0;
+    fprintf(stream, "  %5d %12" PRIu64 " %12" PRIu64 " %10" PRIu64 " %12" PRIu64 " %10.3f %10.3f %10.4f %10.4f %10.4f\n",
+            d, l->node_count, l->leaf_count, l->pass_count, l->horizon_count,
+            gts_ratio(l->legal_move_count, l->node_count - l->pass_count - l->leaf_count),
+            gts_ratio(next_node_count, l->node_count),
+            gts_ratio(l->cut_count, l->interior_count),
+            gts_ratio(l->first_child_cut_count, l->cut_count),
+            gts_ratio(l->searched_count, l->child_count));
+  }
+
+  fprintf(stream, "\n  %7s %12s %10s %10s %10s\n", "empties", "nodes", "mobility", "variance", "std_dev");
+  for (int e = GAME_TREE_STATS_MOBILITY_SIZE - 1; e >= 0; e--) {
+    uint64_t n = 0, sum = 0, sum_sq = 0;
+    for (int m = 0; m < GAME_TREE_STATS_MOBILITY_SIZE; m++) {
+      const uint64_t c = stats->mobility[e][m];
+      n += c;
+      sum += c * m;
+      sum_sq += c * m * m;
+    }
+    if (!n) continue;
+    const double avg = (double) sum / n;
+    const double var = (double) sum_sq / n - avg * avg;
+    fprintf(stream, "  %7d %12" PRIu64 " %10.3f %10.3f %10.3f\n", e, n, avg, var, sqrt(var > 0.0 ? var : 0.0));
+  }
+
+  fprintf(stream, "\n  %10s %12s\n", "visits", "positions");
+  if (position_count) {
+    uint64_t *const counts = (uint64_t *) malloc(position_count * sizeof(uint64_t));
+    assert(counts);
+    size_t cursor = 0;
+    size_t i = 0;
+    for (const gts_position_t *p = hs_next(stats->positions, &cursor); p; p = hs_next(stats->positions, &cursor))
+      counts[i++] = p->count;
+    sort_utils_quicksort(counts, position_count, sizeof(uint64_t), sort_utils_uint64_t_cmp);
+    size_t run_start = 0;
+    for (i = 1; i <= position_count; i++) {
+      if (i == position_count || counts[i] != counts[run_start]) {
+        fprintf(stream, "  %10" PRIu64 " %12zu\n", counts[run_start], i - run_start);
+        run_start = i;
+      }
+    }
+    free(counts);
+  }
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+static uint64_t
+gts_position_hash (const void *item,
+                   void *param)
+{
+  return ((const gts_position_t *) item)->hash;
+}
+
+/*
+ * Keys are game positions, compared with the position fields of the item.
+ */
+static bool
+gts_position_equal (const void *item,
+                    const void *key,
+                    void *param)
+{
+  const gts_position_t *const p = (const gts_position_t *) item;
+  const GamePositionX *const gpx = (const GamePositionX *) key;
+  return p->blacks == gpx->blacks && p->whites == gpx->whites && p->player == gpx->player;
+}
+
+/*
+ * Closes the open node having the greatest depth, its children searched are compared with the available ones.
+ * A node having children, but none searched, is a horizon node: it is not an interior node, nor a cut one.
+ */
+static void
+gts_close_node (GameTreeStats *const stats)
+{
+  const int d = stats->depth;
+  GameTreeStatsLevel *const level = &stats->levels[d];
+  const uint32_t child_count = stats->open_child_count[d];
+  const uint32_t searched_count = stats->open_searched_count[d];
+  if (child_count && !searched_count) {
+    level->horizon_count++;
+  } else if (child_count) {
+    level->interior_count++;
+    level->child_count += child_count;
+    level->searched_count += searched_count;
+    if (searched_count < child_count) {
+      level->cut_count++;
+      if (searched_count == 1) level->first_child_cut_count++;
+    }
+  }
+  stats->depth--;
+}
+
+/*
+ * Returns n / d, or zero when d is zero.
+ */
+static double
+gts_ratio (const uint64_t n,
+           const uint64_t d)
+{
+  return d ? (double) n / d : 0.0;
+}
+
+/**
+ * @endcond
+ */
@@ -0,0 +1,142 @@
+/**
+ * @file
+ *
+ * @brief Game tree statistics module definitions.
+ *
+ * @details This module collects statistics on the game tree visited by a solver, while the search runs.
+ *          It computes in process the figures that are otherwise computed by the SQL functions
+ *          `gt_check`, `gt_nfa`, and `gt_mobility_statistics_on_random` on the game tree log,
+ *          without writing, or loading, the log.
+ *
+ * Solvers call #game_tree_stats_add_node once for each node, in the order nodes are visited,
+ *    giving its depth and game position. Nodes are never closed explicitly: a node is closed when a
+ *    node having the same depth, or a lower one, is added, and the count of its children searched
+ *    is then compared with its legal moves, telling the nodes cut by the alpha-beta pruning.
+ *
+ * The statistics collected are:
+ * - node, leaf, and pass counts for each depth
+ * - the average mobility, and the effective branching factor, for each depth
+ * - the cut ratio, and the ratio of cuts done by the first child searched, for each depth,
+ *   a measure of the move ordering efficiency
+ * - the count of horizon nodes for each depth, nodes having moves but no child searched, as the ones
+ *   solved by a search that is not hooked to the statistics, they are not counted as cut nodes
+ * - the mobility distribution for each empty square count
+ * - the distinct game positions and hashes, and the distribution of the visits of each position
+ *
+ * @par game_tree_stats.h
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#ifndef GAME_TREE_STATS_H
+#define GAME_TREE_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "hash_set.h"
+
+
+
+/****************************/
+/* Pre-processor constants. */
+/****************************/
+
+/**
+ * @brief The number of depths tracked, a game has at most sixty moves, and passes are never consecutive.
+ */
+#define GAME_TREE_STATS_MAX_DEPTH 128
+
+/**
+ * @brief The number of mobility values tracked, mobility never exceeds the empty square count.
+ */
+#define GAME_TREE_STATS_MOBILITY_SIZE 61
+
+
+
+/*********************/
+/* Type definitions. */
+/*********************/
+
+/**
+ * @brief Statistics collected for the nodes at a given depth.
+ */
+typedef struct {
+  uint64_t   node_count;            /**< @brief Nodes met. */
+  uint64_t   leaf_count;            /**< @brief Nodes having no legal move for both players. */
+  uint64_t   pass_count;            /**< @brief Nodes where the player has to pass. */
+  uint64_t   legal_move_count;      /**< @brief Sum of the legal moves of the nodes. */
+  uint64_t   interior_count;        /**< @brief Closed nodes having searched at least one child, a pass counts as one child. */
+  uint64_t   horizon_count;         /**< @brief Closed nodes having children, but none searched, as the ones at the search horizon. */
+  uint64_t   child_count;           /**< @brief Sum of the children of the interior nodes. */
+  uint64_t   searched_count;        /**< @brief Sum of the children searched by the interior nodes. */
+  uint64_t   cut_count;             /**< @brief Interior nodes closed before searching all their children. */
+  uint64_t   first_child_cut_count; /**< @brief Cut nodes that have searched only their first child. */
+} GameTreeStatsLevel;
+
+/**
+ * @brief Game tree statistics structure.
+ */
+typedef struct {
+  GameTreeStatsLevel  levels[GAME_TREE_STATS_MAX_DEPTH];                      /**< @brief Statistics by depth. */
+  uint64_t            mobility[GAME_TREE_STATS_MOBILITY_SIZE][GAME_TREE_STATS_MOBILITY_SIZE]; /**< @brief Node counts by empty square count and mobility, pass nodes excluded. */
+  hs_table_t         *positions;                                              /**< @brief The distinct game positions met, with their visit count. */
+  int                 depth;                                                  /**< @brief The depth of the last node added, -1 when all nodes are closed. */
+  int                 max_depth;                                              /**< @brief The largest depth met. */
+  uint32_t            open_child_count[GAME_TREE_STATS_MAX_DEPTH];            /**< @brief Children of the open node at each depth. */
+  uint32_t            open_searched_count[GAME_TREE_STATS_MAX_DEPTH];         /**< @brief Children searched by the open node at each depth. */
+} GameTreeStats;
+
+
+
+/******************************************************/
+/* Function prototypes for the GameTreeStats entity. */
+/******************************************************/
+
+extern GameTreeStats *
+game_tree_stats_new (void);
+
+extern void
+game_tree_stats_free (GameTreeStats *stats);
+
+extern void
+game_tree_stats_add_node (GameTreeStats *const stats,
+                          const int depth,
+                          const GamePositionX *const gpx);
+
+extern void
+game_tree_stats_close_nodes (GameTreeStats *const stats);
+
+extern uint64_t
+game_tree_stats_distinct_hash_count (const GameTreeStats *const stats);
+
+extern void
+game_tree_stats_print (GameTreeStats *const stats,
+                       FILE *const stream);
+
+
+
+#endif /* GAME_TREE_STATS_H */
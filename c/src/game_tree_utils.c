@@ -5,8 +5,8 @@
  *
  * @details Provides functions to support the game tree expansion.
  *
- *          The function pve_is_invariant_satisfied is quite inefficient, but the check can
- *          be diseabled by a macro.
+ *          The function pve_is_invariant_satisfied, when checking links and reachability,
+ *          visits every cell and line, the passes are split by segments among threads.
  *
  *          A consideration: should we introduce a typedef for PVLine and so get rid of
  *          the three star sin?
@@ -43,11 +43,17 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 
-#include "game_tree_utils.h"
 #include "sort_utils.h"
+#include "game_tree_utils.h"
 
 
 
@@ -55,11 +61,16 @@
  * @cond
  */
 
-#define PVE_LOAD_DUMP_LINES_SEGMENTS_SIZE 64
-#define PVE_LOAD_DUMP_CELLS_SEGMENTS_SIZE 64
+#define PVE_DUMP_ALIGNMENT 8
+#define PVE_DUMP_BUFFER_FIRST_SIZE 1024
+
+#define PVE_POSITIONS_FIRST_SIZE 64
+
+#define PVE_MAX_THREADS 64
+#define PVE_CHK_WALK_ROOTS_X_THREAD 16
 
 #define PVE_VERIFY_INVARIANT FALSE
-#define PVE_VERIFY_INVARIANT_MASK 0xFFFF
+#define PVE_VERIFY_INVARIANT_MASK (0xFFFF & ~pve_chk_inv_reachability)
 #define pve_verify_invariant(chk_mask)                                  \
   if (PVE_VERIFY_INVARIANT) do {                                        \
       pve_error_code_t error_code = 0;                                  \
@@ -80,44 +91,154 @@ typedef struct {
   GamePositionX gp;
 } pve_row_t;
 
+/*
+ * A growable array used to collect the sections of a dump file.
+ */
+typedef struct {
+  void   *data;
+  size_t  count;
+  size_t  capacity;
+  size_t  item_size;
+} pve_dump_buffer_t;
+
+/*
+ * A line waiting to be translated, paired with its index in the dump file.
+ */
+typedef struct {
+  PVCell  **line;
+  uint32_t  index;
+} pve_dump_line_ref_t;
+
+/*
+ * A game position of a dump file, paired with the index it had before the positions section was sorted.
+ */
+typedef struct {
+  pve_dump_position_t position;
+  uint32_t            index;
+} pve_dump_position_ref_t;
+
+/*
+ * The shared state of the invariant checks that visit all cells and lines.
+ * Counters and bitmaps are updated by concurrent threads by means of atomic operations.
+ */
+typedef struct {
+  const PVEnv    *pve;
+  size_t          thread_count;                 /* The maximum number of threads running a pass. */
+  uint32_t        root_line;                    /* The index of the root line. */
+  uint64_t       *free_cells;                   /* Bitmap of the free cells. */
+  uint64_t       *free_lines;                   /* Bitmap of the free lines. */
+  uint32_t       *cell_refs;                    /* Count of the lines and cells referring to each cell. */
+  uint32_t       *line_refs;                    /* Count of the cells having each line as variant. */
+  uint64_t       *reached_cells;                /* Bitmap of the cells reached from the root line. */
+  uint64_t       *reached_lines;                /* Bitmap of the lines reached from the root line. */
+  const uint32_t *walk_roots;                   /* Lines where the parallel walk starts. */
+} pve_chk_t;
+
+/*
+ * A pass of the invariant checks, it visits the objects in the [begin, end) range.
+ */
+typedef pve_error_code_t
+pve_chk_pass_f (pve_chk_t *const chk,
+                const size_t begin,
+                const size_t end);
+
+/*
+ * The range of a pass assigned to a thread.
+ */
+typedef struct {
+  pve_chk_t        *chk;
+  pve_chk_pass_f   *pass;
+  size_t            begin;
+  size_t            end;
+  pve_error_code_t  error_code;
+} pve_chk_task_t;
+
 
 
 /*
  * Prototypes for internal functions.
  */
 
-static void
-pve_double_lines_size (PVEnv *const pve);
+static PVCell *
+pve_cell_new (PVEnv *pve,
+              const Square move,
+              const GamePositionX *const gpx);
 
-static void
-pve_double_cells_size (PVEnv *const pve);
+static uint32_t
+pve_cell_to_index (const PVEnv *const pve,
+                   const PVCell *const cell);
 
-static void
-pve_sort_lines_in_place (PVEnv *const pve);
+static uint32_t
+pve_line_to_index (const PVEnv *const pve,
+                   PVCell **const line);
 
-static void
-pve_state_unset_lines_stack_sorted (PVEnv *const pve);
+static inline void
+pve_cell_ref (PVCell *const cell);
 
-static void
-pve_sort_cells_segments (PVEnv *const pve);
+static inline int64_t
+pve_index_to_int64 (const uint32_t index);
+
+static inline uint64_t
+pve_gpx_hash (const GamePositionX *const gpx);
+
+static uint64_t
+pve_position_hash (const void *item,
+                   void *param);
+
+static bool
+pve_position_equal (const void *item,
+                    const void *key,
+                    void *param);
+
+static uint32_t
+pve_position_acquire (PVEnv *pve,
+                      const GamePositionX *const gpx_ref);
 
 static void
-pve_sort_lines_segments (PVEnv *const pve);
+pve_position_release (PVEnv *pve,
+                      const uint32_t position);
+
+static inline bool
+pve_gpx_equal (const GamePositionX *const a,
+               const GamePositionX *const b);
+
+static inline uint64_t
+pve_dump_align (const uint64_t offset);
 
 static void *
-pve_translate_ref (size_t active_segments_count,
-                   size_t *segments_sizes,
-                   size_t element_size,
-                   size_t *from_to_segments_sorted_map,
-                   void **from_segments,
-                   void **to_segments,
-                   void *from_element);
+pve_dump_buffer_push (pve_dump_buffer_t *const b);
+
+static uint32_t
+pve_dump_position_append (pve_dump_buffer_t *const positions,
+                          const GamePositionX *const gpx);
+
+static inline int
+pve_dump_position_cmp (const pve_dump_position_t *const a,
+                       const pve_dump_position_t *const b);
+
+static bool
+pve_dump_indexes_are_valid (const pve_dump_header_t *const h,
+                            const pve_dump_cell_t *const cells,
+                            const uint32_t *const lines);
+
+static bool
+pve_dump_chains_are_valid (const pve_dump_header_t *const h,
+                           const pve_dump_cell_t *const cells,
+                           const uint32_t *const lines);
+
+static int
+pve_dump_position_ref_cmp (const void *const a,
+                           const void *const b);
 
 static void
-pve_populate_segments_sorted_map (size_t *const segments_sorted_map,
-                                  const size_t active_segments_count,
-                                  const void **const unsorted_segments,
-                                  const void **const sorted_segments);
+pve_dump_walker (const pve_dump_t *const dump,
+                 FILE *const stream,
+                 const bool as_table);
+
+static uint32_t
+pve_dump_smallest_alternative (const pve_dump_t *const dump,
+                               uint32_t cell,
+                               const int lower_bound);
 
 static void
 pve_tree_walker (const PVEnv *const pve,
@@ -152,10 +273,105 @@ static void pve_twa_cell_csv (const PVEnv *const pve,
                               pve_row_t *const row,
                               const PVCell *const cell);
 
-static int
-pve_compare_cells (const void *item_a,
-                   const void *item_b,
-                   void *param);
+static void
+pve_release_cells (PVEnv *pve,
+                   PVCell *cell,
+                   const GamePositionX *const gpx);
+
+static uint64_t
+pve_line_index_hash (const void *item,
+                     void *param);
+
+static bool
+pve_line_index_equal (const void *item,
+                      const void *key,
+                      void *param);
+
+static PVCell *
+pve_line_index_lookup (const PVEnv *const pve,
+                       const GamePositionX *const gpx,
+                       const uint64_t context);
+
+static void
+pve_line_index_insert (PVEnv *pve,
+                       const GamePositionX *const gpx,
+                       const uint64_t context,
+                       PVCell *const head);
+
+static void
+pve_line_index_remove (PVEnv *pve,
+                       const GamePositionX *const gpx,
+                       const PVCell *const head);
+
+static inline bool
+pve_chk_bit (const uint64_t *const bitmap,
+             const uint32_t i);
+
+static inline bool
+pve_chk_claim (uint64_t *const bitmap,
+               const uint32_t i);
+
+static inline bool
+pve_chk_is_used (const mem_obj_allocator_t *const a,
+                 const uint64_t *const free_bitmap,
+                 const uint32_t i);
+
+static size_t
+pve_thread_count (void);
+
+static void *
+pve_chk_task_run (void *arg);
+
+static pve_error_code_t
+pve_chk_run (pve_chk_t *const chk,
+             pve_chk_pass_f *const pass,
+             const size_t count,
+             const size_t grain);
+
+static pve_error_code_t
+pve_chk_count_line_refs (pve_chk_t *const chk,
+                         const size_t begin,
+                         const size_t end);
+
+static pve_error_code_t
+pve_chk_count_cell_refs (pve_chk_t *const chk,
+                         const size_t begin,
+                         const size_t end);
+
+static pve_error_code_t
+pve_chk_verify_cell_refs (pve_chk_t *const chk,
+                          const size_t begin,
+                          const size_t end);
+
+static pve_error_code_t
+pve_chk_verify_line_refs (pve_chk_t *const chk,
+                          const size_t begin,
+                          const size_t end);
+
+static pve_error_code_t
+pve_chk_walk_line (pve_chk_t *const chk,
+                   const uint32_t line,
+                   pve_dump_buffer_t *const pending);
+
+static pve_error_code_t
+pve_chk_walk (pve_chk_t *const chk,
+              const size_t begin,
+              const size_t end);
+
+static pve_error_code_t
+pve_chk_verify_reached_cells (pve_chk_t *const chk,
+                              const size_t begin,
+                              const size_t end);
+
+static pve_error_code_t
+pve_chk_verify_reached_lines (pve_chk_t *const chk,
+                              const size_t begin,
+                              const size_t end);
+
+static pve_error_code_t
+pve_chk_links (const PVEnv *const pve,
+               const bool check_links,
+               const bool check_reachability);
 
 
 
@@ -196,6 +412,10 @@ exact_solution_new (void)
   es->final_board = NULL;
   es->node_count = 0;
   es->leaf_count = 0;
+  es->optimal_line_count = 0;
+  es->move_values = NULL;
+  es->move_values_count = 0;
+  es->move_values_size = 0;
 
   return es;
 }
@@ -213,6 +433,7 @@ exact_solution_free (ExactSolution *es)
   if (es) {
     if (es->solved_game_position) game_position_free(es->solved_game_position);
     if (es->final_board) board_free(es->final_board);
+    free(es->move_values);
     free(es);
   }
 }
@@ -252,6 +473,24 @@ exact_solution_to_string (const ExactSolution *const es)
     g_free(pv_to_s);
   }
 
+  if (es->optimal_line_count) {
+    g_string_append_printf(tmp, "Optimal line count: %" PRIu64 "\n", es->optimal_line_count);
+  }
+
+  if (es->move_values_count) {
+    g_string_append_printf(tmp, "Move values:\n");
+    for (size_t i = 0; i < es->move_values_count; i++) {
+      const ExactSolutionMoveValue *const mv = &es->move_values[i];
+      gchar *path_to_s = square_as_move_array_to_string(mv->path, mv->ply);
+      g_string_append_printf(tmp, "  [%s] %s:%+d (%" PRIu64 ")\n",
+                             path_to_s,
+                             square_as_move_to_string(mv->move),
+                             mv->value,
+                             mv->optimal_line_count);
+      g_free(path_to_s);
+    }
+  }
+
   if (es->final_board) {
     gchar *b_to_s = board_print(es->final_board);
     g_string_append_printf(tmp, "\nFinal board configuration:\n%s\n", b_to_s);
@@ -304,6 +543,45 @@ exact_solution_set_solved_game_position_x (ExactSolution *const es,
   es->solved_game_position = gp;
 }
 
+/**
+ * @brief Appends a move value to the `move_values` array.
+ *
+ * @details The array is allocated on the first call, and doubled when full.
+ *
+ * @invariant Parameter `ply` must be in the range [0, EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH).
+ *            Invariants are guarded by assertions.
+ *
+ * @param [in,out] es                 a pointer to the exact solution structure
+ * @param [in]     path               the moves leading from the root to the node
+ * @param [in]     ply                the number of moves in the path
+ * @param [in]     move               the move played at the node
+ * @param [in]     value              the move value
+ * @param [in]     optimal_line_count the number of optimal lines following the move
+ */
+void
+exact_solution_add_move_value (ExactSolution *const es,
+                               const Square *const path,
+                               const int ply,
+                               const Square move,
+                               const int value,
+                               const uint64_t optimal_line_count)
+{
+  g_assert(es);
+  g_assert(ply >= 0 && ply < EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH);
+
+  if (es->move_values_count == es->move_values_size) {
+    es->move_values_size = es->move_values_size ? 2 * es->move_values_size : 64;
+    es->move_values = (ExactSolutionMoveValue *) realloc(es->move_values, es->move_values_size * sizeof(ExactSolutionMoveValue));
+    g_assert(es->move_values);
+  }
+  ExactSolutionMoveValue *const mv = &es->move_values[es->move_values_count++];
+  for (int i = 0; i < EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH; i++) mv->path[i] = i < ply ? path[i] : invalid_move;
+  mv->ply = ply;
+  mv->move = move;
+  mv->value = value;
+  mv->optimal_line_count = optimal_line_count;
+}
+
 
 
 /**************************************************/
@@ -331,21 +609,6 @@ exact_solution_set_solved_game_position_x (ExactSolution *const es,
 PVEnv *
 pve_new (const GamePositionX *const root_game_position)
 {
-  /*
-   * Sixteen segments, having the first hosting 32 lines, leads to a maximum
-   * of 1,048,576 lines.
-   * The total memory required is 8,388,608 bytes for lines and the same for the stack,
-   * leading to a total of 16 MBytes.
-   */
-  static const size_t lines_segments_size = PVE_LINES_SEGMENTS_SIZE;
-  static const size_t lines_first_size = PVE_LINES_FIRST_SIZE;
-
-  /*
-   * TBD
-   */
-  static const size_t cells_segments_size = PVE_CELLS_SEGMENTS_SIZE;
-  static const size_t cells_first_size = PVE_CELLS_FIRST_SIZE;
-
   /* Allocates the PVE structure. */
   PVEnv *const pve = (PVEnv*) malloc(sizeof(PVEnv));
   g_assert(pve);
@@ -359,88 +622,9 @@ pve_new (const GamePositionX *const root_game_position)
   /* Sets the state switches. */
   pve->state = 0x0000000000000000;
 
-  /* Sets to zero the max number of cells, and lines ever used. */
-  pve->cells_max_usage = 0;
-  pve->lines_max_usage = 0;
-
-  /* Prepares the cells segments. */
-  pve->cells_segments_size = cells_segments_size;
-  pve->cells_first_size = cells_first_size;
-  pve->cells_segments = (PVCell **) malloc(sizeof(PVCell *) * cells_segments_size);
-  g_assert(pve->cells_segments);
-  for (size_t i = 0; i < cells_segments_size; i++) {
-    *(pve->cells_segments + i) = NULL;
-  }
-  pve->cells_segments_head = pve->cells_segments;
-
-  /* Prepares the first segment of cells. */
-  pve->cells_size = cells_first_size;
-  PVCell *cells = (PVCell *) malloc(cells_first_size * sizeof(PVCell));
-  g_assert(cells);
-  *(pve->cells_segments_head) = cells;
-  pve->cells_segments_head++;
-  for (size_t i = 0; i < cells_first_size; i++) {
-    (cells + i)->move = invalid_move;
-    (cells + i)->is_active = FALSE;
-    (cells + i)->next = NULL;
-    (cells + i)->variant = NULL;
-  }
-
-  /* Prepares the sorted cells segments and the sorted sizes. */
-  pve->cells_segments_sorted_sizes = (size_t *) malloc(sizeof(size_t) * cells_segments_size);
-  pve->cells_segments_sorted = (PVCell **) malloc(sizeof(PVCell *) * cells_segments_size);
-  for (size_t i = 0; i < cells_segments_size; i++) {
-    *(pve->cells_segments_sorted_sizes + i) = 0;
-    *(pve->cells_segments_sorted + i) = NULL;
-  }
-  *(pve->cells_segments_sorted_sizes + 0) = cells_first_size;
-  *(pve->cells_segments_sorted + 0) = cells;
-
-  /* Creates the cells stack and load it with the cells held in the first segment. */
-  pve->cells_stack = (PVCell **) malloc(cells_first_size * sizeof(PVCell *));
-  g_assert(pve->cells_stack);
-  for (size_t i = 0; i < cells_first_size; i++) {
-    *(pve->cells_stack + i) = cells + i;
-  }
-  pve->cells_stack_head = pve->cells_stack;
-
-  /* Prepares the lines segments. */
-  pve->lines_segments_size = lines_segments_size;
-  pve->lines_first_size = lines_first_size;
-  pve->lines_segments = (PVCell ***) malloc(sizeof(PVCell **) * lines_segments_size);
-  g_assert(pve->lines_segments);
-  for (size_t i = 0; i < lines_segments_size; i++) {
-    *(pve->lines_segments + i) = NULL;
-  }
-  pve->lines_segments_head = pve->lines_segments;
-
-  /* Prepares the first segment of lines. */
-  pve->lines_size = lines_first_size;
-  PVCell **lines = (PVCell **) malloc(lines_first_size * sizeof(PVCell *));
-  g_assert(lines);
-  *(pve->lines_segments_head) = lines;
-  pve->lines_segments_head++;
-  for (size_t i = 0; i < lines_first_size; i++) {
-    *(lines + i) = NULL;
-  }
-
-  /* Prepares the sorted lines segments and the sorted sizes. */
-  pve->lines_segments_sorted_sizes = (size_t *) malloc(sizeof(size_t) * lines_segments_size);
-  pve->lines_segments_sorted = (PVCell ***) malloc(sizeof(PVCell **) * lines_segments_size);
-  for (size_t i = 0; i < lines_segments_size; i++) {
-    *(pve->lines_segments_sorted_sizes + i) = 0;
-    *(pve->lines_segments_sorted + i) = NULL;
-  }
-  *(pve->lines_segments_sorted_sizes + 0) = lines_first_size;
-  *(pve->lines_segments_sorted + 0) = lines;
-
-  /* Creates the lines stack and load it with the lines held in the first segment. */
-  pve->lines_stack = (PVCell ***) malloc(lines_first_size * sizeof(PVCell **));
-  g_assert(pve->lines_stack);
-  for (size_t i = 0; i < lines_first_size; i++) {
-    *(pve->lines_stack + i) = lines + i;
-  }
-  pve->lines_stack_head = pve->lines_stack;
+  /* Creates the arenas of cells and lines, segments are allocated on demand. */
+  pve->cells = mem_obj_allocator_new(sizeof(PVCell), (size_t) 1 << PVE_CELLS_SEGMENT_SHIFT, PVE_SEGMENTS_FIRST_SIZE);
+  pve->lines = mem_obj_allocator_new(sizeof(PVCell *), (size_t) 1 << PVE_LINES_SEGMENT_SHIFT, PVE_SEGMENTS_FIRST_SIZE);
 
   /* Sets the statistical counters to zero. */
   pve->line_create_count = 0;
@@ -451,8 +635,21 @@ pve_new (const GamePositionX *const root_game_position)
   /* Creates the root line and assigns the reference to the dedicated field. */
   pve->root_line = pve_line_create(pve);
 
-  /* Prepares the game position table. */
-  pve->gp_table = rbt_create(pve_compare_cells, NULL, NULL);
+  /* Prepares the game position table, entries are all free, and the index is empty. */
+  pve->positions_size = PVE_POSITIONS_FIRST_SIZE;
+  pve->positions_count = 0;
+  pve->positions = (PVPosition *) malloc(pve->positions_size * sizeof(PVPosition));
+  g_assert(pve->positions);
+  for (size_t i = 0; i < pve->positions_size; i++) {
+    pve->positions[i].ref_count = 0;
+    pve->positions[i].next_free = (i + 1 < pve->positions_size) ? i + 1 : PVE_NULL_INDEX;
+  }
+  pve->positions_free = 0;
+  pve->positions_index = hs_create(sizeof(uint32_t), pve_position_hash, pve_position_equal, pve);
+
+  /* The line index is allocated on demand. */
+  pve->line_index = NULL;
+  pve->line_share_count = 0;
 
   g_assert(pve_is_invariant_satisfied(pve, NULL, 0xFF));
 
@@ -471,35 +668,15 @@ pve_free (PVEnv *pve)
 {
   if (pve) {
 
-    free(pve->cells_stack);
-
-    /* Frees cells_segments. */
-    size_t cells_segments_size = pve->cells_segments_head - pve->cells_segments;
-    while (cells_segments_size) {
-      pve->cells_segments_head--;
-      free(*(pve->cells_segments_head));
-      cells_segments_size--;
-    }
-    free(pve->cells_segments);
-    free(pve->cells_segments_sorted_sizes);
-    free(pve->cells_segments_sorted);
-
-    free(pve->lines_stack);
-
-    /* Frees lines_segments. */
-    size_t lines_segments_size = pve->lines_segments_head - pve->lines_segments;
-    while (lines_segments_size) {
-      pve->lines_segments_head--;
-      free(*(pve->lines_segments_head));
-      lines_segments_size--;
-    }
-    free(pve->lines_segments);
-    free(pve->lines_segments_sorted_sizes);
-    free(pve->lines_segments_sorted);
+    mem_obj_allocator_free(pve->cells);
+    mem_obj_allocator_free(pve->lines);
 
     game_position_x_free(pve->root_game_position);
 
-    rbt_destroy(pve->gp_table, NULL);
+    free(pve->positions);
+    hs_destroy(pve->positions_index);
+
+    hs_destroy(pve->line_index);
 
     free(pve);
   }
@@ -509,13 +686,18 @@ pve_free (PVEnv *pve)
  * @brief Verifies that the PVE invariant is satisfied.
  *
  * @details Invariants verified are:
- *          - Lines stack must have NULL values from the
- *
- * Tests that free lines and free cells are unique has to be added.
- * Tests that active lines and active cells are unique has to be added.
- * Tests that all active lines have active cells, and then that the
- *   active lines and cells count are consistent with their stack pointers.
- *
+ *          - The arenas of lines and cells are the ones created by #pve_new, and are consistent.
+ *          - The count of lines in use matches the lines created and deleted.
+ *          - The count of cells in use matches the cells added and released.
+ *          - Lines in use point to cells in use, cells in use link cells and lines in use,
+ *            and game positions in use. The reference count of each cell matches the lines and cells
+ *            pointing to it, and each line is the variant of one cell at most.
+ *            Switch #pve_chk_inv_links turns the check on.
+ *          - All the cells and lines in use are reachable from the root line.
+ *            Switch #pve_chk_inv_reachability turns the check on.
+ *
+ *          The last two checks visit every cell and line, and are split by segments among
+ *          as many threads as the online processors.
  *
  * @param [in]  pve                a pointer to the principal variation environment
  * @param [out] error_code         a pointer to the error code
@@ -527,230 +709,80 @@ pve_is_invariant_satisfied (const PVEnv *const pve,
                             pve_error_code_t *const error_code,
                             const switches_t checked_invariants)
 {
-  const ptrdiff_t active_lines_segments_count = pve->lines_segments_head - pve->lines_segments;
-
   /*
    * Lines basic checks.
    *
-   * A set of very basic checks on lines storage.
-   * Pointers boundaries are checked to be consistent with sizes and the first position
-   * in each array.
+   * The arena of lines must be the one created by pve_new, and its internal structure,
+   * segments and free list, must be consistent.
    */
   if (pve_chk_inv_lines_basic & checked_invariants) {
-    if (pve->lines_segments_size != PVE_LINES_SEGMENTS_SIZE) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_SIZE_IS_INCORRECT;
+    if (!pve->lines) {
+      if (error_code) *error_code = PVE_ERROR_CODE_LINES_ARENA_IS_NULL;
       return FALSE;
     }
-    if (pve->lines_first_size != PVE_LINES_FIRST_SIZE) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_FIRST_SIZE_IS_INCORRECT;
+    if (pve->lines->object_size != sizeof(PVCell *)) {
+      if (error_code) *error_code = PVE_ERROR_CODE_LINES_ARENA_OBJECT_SIZE_IS_INCORRECT;
       return FALSE;
     }
-    if (!pve->lines_segments_head) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_HEAD_IS_NULL;
+    if (pve->lines->segment_shift != PVE_LINES_SEGMENT_SHIFT) {
+      if (error_code) *error_code = PVE_ERROR_CODE_LINES_ARENA_SEGMENT_SHIFT_IS_INCORRECT;
       return FALSE;
     }
-    if (!pve->lines_segments) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_IS_NULL;
+    if (!mem_obj_allocator_is_consistent(pve->lines)) {
+      if (error_code) *error_code = PVE_ERROR_CODE_LINES_ARENA_IS_NOT_CONSISTENT;
       return FALSE;
     }
-    if (active_lines_segments_count < 0) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_HEADS_PRECEDES_ARRAY_INDEX_0;
-      return FALSE;
-    }
-    if (active_lines_segments_count > pve->lines_segments_size) {
-      if (error_code) *error_code = PVE_ERROR_CODE_ACTIVE_LINES_SEGMENTS_COUNT_EXCEEDS_BOUND;
-      return FALSE;
-    }
-    const size_t expected_lines_size = (size_t) (active_lines_segments_count == 0
-                                                 ? 0 : (1ULL << (active_lines_segments_count - 1)) * PVE_LINES_FIRST_SIZE);
-    if (expected_lines_size != pve->lines_size) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SIZE_MISMATCH;
-      return FALSE;
-    }
-
-    for (size_t i = 0; i < active_lines_segments_count; i++) {
-      PVCell **ls = *(pve->lines_segments + i);
-      if (!ls) {
-        if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_HAS_AN_INVALID_NULL_VALUE;
-        return FALSE;
-      }
-    }
-
-    for (size_t i = active_lines_segments_count; i < pve->lines_segments_size; i++) {
-      PVCell **ls = *(pve->lines_segments + i);
-      if (ls) {
-        if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_HAS_AN_INVALID_NOT_NULL_VALUE;
-        return FALSE;
-      }
-    }
+  }
 
-    size_t cumulated_lines_size_from_sorted_segments = 0;
-    bool ls_p0_found = FALSE;
-    bool ls_p1_found = FALSE;
-    PVCell **ls_position_0 = *(pve->lines_segments + 0);
-    PVCell **ls_position_1 = *(pve->lines_segments + 1);
-    for (size_t i = 0; i < active_lines_segments_count; i++) {
-      const size_t segment_size = (size_t) *(pve->lines_segments_sorted_sizes + i);
-      cumulated_lines_size_from_sorted_segments += segment_size;
-      PVCell **ls = *(pve->lines_segments_sorted + i);
-      const size_t ls_index = bit_works_bitscanMS1B_64((size_t) (segment_size / PVE_LINES_FIRST_SIZE)) + 1;
-      if (ls_index > active_lines_segments_count) {
-        if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENT_COMPUTED_INDEX_OUT_OF_RANGE;
-        return FALSE;
-      }
-      if (ls_index == 1) {
-        if (!ls_p0_found && ls == ls_position_0) {
-          ls_p0_found = TRUE;
-          goto positions_1_and_2_found;
-        }
-        if (!ls_p1_found && ls == ls_position_1) {
-          ls_p1_found = TRUE;
-          goto positions_1_and_2_found;
-        }
-        if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_POS_0_AND_1_ANOMALY;
-        return FALSE;
-      } else {
-        PVCell **ls_unsorted = *(pve->lines_segments + ls_index);
-        if (ls != ls_unsorted) {
-          if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_SORTED_AND_UNSORTED_DO_NOT_MATCH;
-          return FALSE;
-        }
-      }
-    positions_1_and_2_found:
-      if (i > 0) {
-        PVCell **ls_prec = *(pve->lines_segments_sorted + i - 1);
-        ls_prec++;
-        if (ls <= ls_prec) {
-          if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_ARE_NOT_PROPERLY_SORTED;
-          return FALSE;
-        }
-      }
-    }
-    if (expected_lines_size != cumulated_lines_size_from_sorted_segments) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SIZE_DOESNT_MATCH_WITH_CUMULATED;
+  /*
+   * Cells basic checks, the same as for lines.
+   */
+  if (pve_chk_inv_cells_basic & checked_invariants) {
+    if (!pve->cells) {
+      if (error_code) *error_code = PVE_ERROR_CODE_CELLS_ARENA_IS_NULL;
       return FALSE;
     }
-    if (active_lines_segments_count == 1 && !ls_p0_found) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENT_POSITION_0_NOT_FOUND;
+    if (pve->cells->object_size != sizeof(PVCell)) {
+      if (error_code) *error_code = PVE_ERROR_CODE_CELLS_ARENA_OBJECT_SIZE_IS_INCORRECT;
       return FALSE;
     }
-    if (active_lines_segments_count > 1 && !ls_p0_found && !ls_p1_found) {
-      if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENT_POSITION_0_OR_1_NOT_FOUND;
+    if (pve->cells->segment_shift != PVE_CELLS_SEGMENT_SHIFT) {
+      if (error_code) *error_code = PVE_ERROR_CODE_CELLS_ARENA_SEGMENT_SHIFT_IS_INCORRECT;
       return FALSE;
     }
-
-    for (size_t i = active_lines_segments_count; i < pve->lines_segments_size; i++) {
-      const size_t segment_size = *(pve->lines_segments_sorted_sizes + i);
-      if (segment_size != 0) {
-        if (error_code) *error_code = PVE_ERROR_CODE_LINES_SEGMENTS_UNUSED_SEGMENT_HAS_SIZE;
-        return FALSE;
-      }
+    if (!mem_obj_allocator_is_consistent(pve->cells)) {
+      if (error_code) *error_code = PVE_ERROR_CODE_CELLS_ARENA_IS_NOT_CONSISTENT;
+      return FALSE;
     }
   }
 
-  /*
-   * Lines stack invariants checks.
-   */
-
-  /* Lines stack pointers are in the proper range. */
-  if (!pve->lines_stack_head) {
-    if (error_code) *error_code = 1001;
-    return FALSE;
-  }
-  if (!pve->lines_stack) {
-    if (error_code) *error_code = 1002;
-    return FALSE;
-  }
-  const size_t used_lines_count = pve->lines_stack_head - pve->lines_stack;
-  if (used_lines_count < 0) {
-    if (error_code) *error_code = 1003;
-    return FALSE;
-  }
-  if (used_lines_count > pve->lines_size) {
-    if (error_code) *error_code = 1004;
-    return FALSE;
-  }
-
-  /* Verifies that the line reference is contained into a segment. */
-  if (pve->state & pve_state_lines_stack_sorted) { // Lines stack is sorted.
-    PVCell ***lines_stack_cursor_prev;
-    PVCell ***lines_stack_cursor;
-    for (lines_stack_cursor = pve->lines_stack, lines_stack_cursor_prev = NULL;
-         lines_stack_cursor < pve->lines_stack_head;
-         lines_stack_cursor++) {
-      if (*lines_stack_cursor == NULL) {
-        if (error_code) *error_code = 1005;
-        printf("lines_stack_cursor=%p\n", (void *) lines_stack_cursor);
-        return FALSE;
-      } else {
-        if (lines_stack_cursor_prev && *lines_stack_cursor <= *lines_stack_cursor_prev) {
-          if (error_code) *error_code = 1006;
-          return FALSE;
-        }
-        lines_stack_cursor_prev = lines_stack_cursor;
-      }
-    }
-    for (lines_stack_cursor = pve->lines_stack_head, lines_stack_cursor_prev = NULL;
-         lines_stack_cursor < pve->lines_stack + pve->lines_size;
-         lines_stack_cursor++) {
-      if (*lines_stack_cursor == NULL) {
-        if (error_code) *error_code = 1007;
-        printf("lines_stack_cursor=%p\n", (void *) lines_stack_cursor);
-        return FALSE;
-      } else {
-        if (lines_stack_cursor_prev && *lines_stack_cursor <= *lines_stack_cursor_prev) {
-          if (error_code) *error_code = 1008;
-          return FALSE;
-        }
-        lines_stack_cursor_prev = lines_stack_cursor;
-      }
-    }
-  } else { // Lines stack is not sorted.
-    for (size_t i = 0; i < used_lines_count; i++) {
-      const PVCell **line = (const PVCell **) *(pve->lines_stack + i);
-      if (line) {
-        if (error_code) *error_code = 1009;
-        return FALSE;
-      }
-    }
-
-    for (size_t i = used_lines_count; i < pve->lines_size; i++) {
-      const PVCell **line = (const PVCell **) *(pve->lines_stack + i);
-      if (!line) {
-        if (error_code) *error_code = 1010;
-        return FALSE;
-      }
-      // Moving on lines_segments is linear, a bisection approach would be better, but a lot more sophisticated .....
-      for (size_t lsi = active_lines_segments_count - 1; ; lsi--) { // lsi: lines_segment_index
-        const PVCell **first_line_in_segment = (const PVCell **) *(pve->lines_segments_sorted + lsi);
-        if (line >= first_line_in_segment) {
-          if (line - first_line_in_segment < *(pve->lines_segments_sorted_sizes + lsi)) {
-            break;
-          } else {
-            if (error_code) *error_code = 1011;
-            return FALSE;
-          }
-        }
-        if (lsi == 0) {
-          if (error_code) *error_code = 1012;
-          return FALSE;
-        }
-      }
-    }
-  }
+  const size_t used_lines_count = pve->lines->used_count;
 
   if (pve->line_create_count - pve->line_delete_count != used_lines_count) {
     if (error_code) *error_code = 1100;
     return FALSE;
   }
 
-  const size_t used_cells_count = pve->cells_stack_head - pve->cells_stack;
+  const size_t used_cells_count = pve->cells->used_count;
 
   if (pve->line_add_move_count - pve->line_release_cell_count != used_cells_count) {
     if (error_code) *error_code = 1101;
     return FALSE;
   }
 
+  /*
+   * Links and reachability checks, they run on top of a consistent arena.
+   */
+  if ((pve_chk_inv_links | pve_chk_inv_reachability) & checked_invariants) {
+    const pve_error_code_t ec = pve_chk_links(pve,
+                                              pve_chk_inv_links & checked_invariants,
+                                              pve_chk_inv_reachability & checked_invariants);
+    if (ec != PVE_ERROR_CODE_OK) {
+      if (error_code) *error_code = ec;
+      return FALSE;
+    }
+  }
+
   return TRUE;
 }
 
@@ -766,16 +798,13 @@ pve_is_invariant_satisfied (const PVEnv *const pve,
  *          - A csv table reporting cells segments
  *          - A csv table reporting sorted cells segments
  *          - A csv table reporting cells
- *          - A csv table reporting the stack of pointers to cells
+ *          - A csv table reporting the free list of cells
  *          - A csv table reporting lines segments
  *          - A csv table reporting sorted lines segments
  *          - A csv table reporting lines
- *          - A csv table reporting the stack of pointers to lines
+ *          - A csv table reporting the free list of lines
  *          - The root game position
  *
- *          The block on active lines makes a call to the function `pve_sort_lines_in_place`
- *          that sort, and so modify, the lines stack.
- *
  *          Sections are turned on and off according to the `shown_sections` parameter.
  *          The header file defines this list of constants, taht document the relationship
  *          between the switches and the sections:
@@ -838,11 +867,11 @@ pve_internals_to_stream (PVEnv *const pve,
     fprintf(stream, " -06- PVE CELLS SEGMENTS ... ... ... ... 0x0040, or .. 64\n");
     fprintf(stream, " -07- PVE SORTED CELLS SEGMENTS  ... ... 0x0080, or . 128\n");
     fprintf(stream, " -08- PVE CELLS  ... ... ... ... ... ... 0x0100, or . 256\n");
-    fprintf(stream, " -09- PVE CELLS STACK    ... ... ... ... 0x0200, or . 512\n");
+    fprintf(stream, " -09- PVE CELLS FREE LIST    ... ... ... 0x0200, or . 512\n");
     fprintf(stream, " -10- PVE LINES SEGMENTS ... ... ... ... 0x0400, or  1024\n");
     fprintf(stream, " -11- PVE SORTED LINES SEGMENTS  ... ... 0x0800, or  2048\n");
     fprintf(stream, " -12- PVE LINES  ... ... ... ... ... ... 0x1000, or  4096\n");
-    fprintf(stream, " -13- PVE LINES STACK    ... ... ... ... 0x2000, or  8192\n");
+    fprintf(stream, " -13- PVE LINES FREE LIST    ... ... ... 0x2000, or  8192\n");
     fprintf(stream, " -14- PVE ROOT GAME POSITION ... ... ... 0x4000, or 16384\n");
     fprintf(stream, "\n");
   }
@@ -862,88 +891,77 @@ pve_internals_to_stream (PVEnv *const pve,
     fprintf(stream, "state:                         0x%016lx  --  The internal state of the structure.\n", pve->state);
     fprintf(stream, "root_game_position:          %20p  --  Root game position.\n", (void *) pve->root_game_position);
     fprintf(stream, "root_line:                   %20p  --  Root line.\n", (void *) pve->root_line);
-    fprintf(stream, "cells_size:                  %20zu  --  Count of cells contained by the cells segments.\n", pve->cells_size);
-    fprintf(stream, "cells_segments_size:         %20zu  --  Count of cells segments.\n", pve->cells_segments_size);
-    fprintf(stream, "cells_first_size:            %20zu  --  Number of cells contained by the first segment.\n", pve->cells_first_size);
-    fprintf(stream, "cells_segments:              %20p  --  Segments are pointers to array of cells.\n", (void *) pve->cells_segments);
-    fprintf(stream, "cells_segments_head:         %20p  --  Next cells segment to be used.\n", (void *) pve->cells_segments_head);
-    fprintf(stream, "cells_segments_sorted_sizes: %20p  --  Array of sizes of cells segments in the sorted order.\n", (void *) pve->cells_segments_sorted_sizes);
-    fprintf(stream, "cells_segments_sorted:       %20p  --  Sorted cells segments, by means of the natural order of the memory adress.\n", (void *) pve->cells_segments_sorted);
-    fprintf(stream, "cells_stack:                 %20p  --  Array of pointers used to manage the cells.\n", (void *) pve->cells_stack);
-    fprintf(stream, "cells_stack_head:            %20p  --  Next, free to be assigned, pointer in the cells stack.\n", (void *) pve->cells_stack_head);
-    fprintf(stream, "cells_max_usage:             %20zu  --  The maximum number of cells in use.\n", pve->cells_max_usage);
-    fprintf(stream, "lines_size:                  %20zu  --  Count of lines contained by the lines segments.\n", pve->lines_size);
-    fprintf(stream, "lines_segments_size:         %20zu  --  Count of lines segments.\n", pve->lines_segments_size);
-    fprintf(stream, "lines_first_size:            %20zu  --  Number of lines contained by the first segment.\n", pve->lines_first_size);
-    fprintf(stream, "lines_segments:              %20p  --  Segments are pointers to array of lines.\n", (void *) pve->lines_segments);
-    fprintf(stream, "lines_segments_head:         %20p  --  Next lines segment to be used.\n", (void *) pve->lines_segments_head);
-    fprintf(stream, "lines_segments_sorted_sizes: %20p  --  Array of sizes of lines segments in the sorted order.\n", (void *) pve->lines_segments_sorted_sizes);
-    fprintf(stream, "lines_segments_sorted:       %20p  --  Sorted lines segments, by means of the natural order of the memory adress.\n", (void *) pve->lines_segments_sorted);
-    fprintf(stream, "lines_stack:                 %20p  --  Array of pointers used to manage the lines.\n", (void *) pve->lines_stack);
-    fprintf(stream, "lines_stack_head:            %20p  --  Next, free to be assigned, pointer in the lines stack.\n", (void *) pve->lines_stack_head);
-    fprintf(stream, "lines_max_usage:             %20zu  --  The maximum number of lines in use.\n", pve->lines_max_usage);
+    fprintf(stream, "cells:                       %20p  --  Arena of the cells.\n", (void *) pve->cells);
+    fprintf(stream, "cells->object_size:          %20zu  --  Bytes used by a cell in the arena.\n", pve->cells->object_size);
+    fprintf(stream, "cells->segment_shift:        %20u  --  A cells segment holds 2 to the power of segment_shift cells.\n", pve->cells->segment_shift);
+    fprintf(stream, "cells->segments:             %20p  --  Cells segments in the allocation order.\n", (void *) pve->cells->segments);
+    fprintf(stream, "cells->segments_sorted:      %20p  --  Cells segments sorted by means of the natural order of the memory address.\n", (void *) pve->cells->segments_sorted);
+    fprintf(stream, "cells->segments_size:        %20zu  --  Capacity of the cells segments tables.\n", pve->cells->segments_size);
+    fprintf(stream, "cells->segments_count:       %20zu  --  Count of cells segments.\n", pve->cells->segments_count);
+    fprintf(stream, "cells->top:                  %20u  --  Count of cells ever assigned, the index of the next fresh cell.\n", pve->cells->top);
+    fprintf(stream, "cells->free_head:            %20" PRId64 "  --  Index of the first cell in the free list.\n", pve_index_to_int64(pve->cells->free_head));
+    fprintf(stream, "cells->used_count:           %20zu  --  The number of cells in use.\n", pve->cells->used_count);
+    fprintf(stream, "cells->max_used_count:       %20zu  --  The maximum number of cells in use.\n", pve->cells->max_used_count);
+    fprintf(stream, "lines:                       %20p  --  Arena of the lines.\n", (void *) pve->lines);
+    fprintf(stream, "lines->object_size:          %20zu  --  Bytes used by a line in the arena.\n", pve->lines->object_size);
+    fprintf(stream, "lines->segment_shift:        %20u  --  A lines segment holds 2 to the power of segment_shift lines.\n", pve->lines->segment_shift);
+    fprintf(stream, "lines->segments:             %20p  --  Lines segments in the allocation order.\n", (void *) pve->lines->segments);
+    fprintf(stream, "lines->segments_sorted:      %20p  --  Lines segments sorted by means of the natural order of the memory address.\n", (void *) pve->lines->segments_sorted);
+    fprintf(stream, "lines->segments_size:        %20zu  --  Capacity of the lines segments tables.\n", pve->lines->segments_size);
+    fprintf(stream, "lines->segments_count:       %20zu  --  Count of lines segments.\n", pve->lines->segments_count);
+    fprintf(stream, "lines->top:                  %20u  --  Count of lines ever assigned, the index of the next fresh line.\n", pve->lines->top);
+    fprintf(stream, "lines->free_head:            %20" PRId64 "  --  Index of the first line in the free list.\n", pve_index_to_int64(pve->lines->free_head));
+    fprintf(stream, "lines->used_count:           %20zu  --  The number of lines in use.\n", pve->lines->used_count);
+    fprintf(stream, "lines->max_used_count:       %20zu  --  The maximum number of lines in use.\n", pve->lines->max_used_count);
     fprintf(stream, "line_create_count:           %20zu  --  The number of calls to the function pve_line_create().\n", pve->line_create_count);
     fprintf(stream, "line_delete_count:           %20zu  --  The number of calls to the function pve_line_delete().\n", pve->line_delete_count);
     fprintf(stream, "line_add_move_count:         %20zu  --  The number of calls to the function pve_line_add_move().\n", pve->line_add_move_count);
     fprintf(stream, "line_release_cell_count:     %20zu  --  The number of times a cell is released in the pve_line_delete() function.\n", pve->line_release_cell_count);
+    fprintf(stream, "line_share_count:            %20zu  --  The number of times a line has been shared in the pve_line_add_move_shared() function.\n", pve->line_share_count);
     fprintf(stream, "\n");
   }
 
-  g_assert(pve->cells_segments_head >= pve->cells_segments);
-  g_assert(pve->lines_segments_head >= pve->lines_segments);
-  g_assert(pve->cells_stack_head >= pve->cells_stack);
-  g_assert(pve->lines_stack_head >= pve->lines_stack);
-  const size_t lines_in_use_count = pve->lines_stack_head - pve->lines_stack;
-  const size_t cells_in_use_count = pve->cells_stack_head - pve->cells_stack;
-  const size_t lines_segments_in_use_count = pve->lines_segments_head - pve->lines_segments;
-  const size_t cells_segments_in_use_count = pve->cells_segments_head - pve->cells_segments;
-  const size_t lines_max_size = (1ULL << (pve->lines_segments_size - 1)) * pve->lines_first_size;
-  const size_t cells_max_size = (1ULL << (pve->cells_segments_size - 1)) * pve->cells_first_size;
-  const size_t lines_actual_max_size = (1ULL << (lines_segments_in_use_count - 1)) * pve->lines_first_size;
-  const size_t cells_actual_max_size = (1ULL << (cells_segments_in_use_count - 1)) * pve->cells_first_size;
-  const size_t pve_max_allowed_mem_consum =
-    sizeof(PVEnv) +
-    sizeof(PVCell *) * pve->cells_segments_size +
-    sizeof(PVCell **) * pve->lines_segments_size +
-    (sizeof(size_t) + sizeof(PVCell *)) * pve->cells_segments_size +
-    (sizeof(size_t) + sizeof(PVCell **)) * pve->lines_segments_size +
-    (sizeof(PVCell) + sizeof(PVCell *)) * cells_max_size +
-    (sizeof(PVCell *) + sizeof(PVCell **)) * lines_max_size;
+  const mem_obj_allocator_t *const ca = pve->cells;
+  const mem_obj_allocator_t *const la = pve->lines;
+  const size_t cells_x_segment = (size_t) 1 << ca->segment_shift;
+  const size_t lines_x_segment = (size_t) 1 << la->segment_shift;
+  const size_t cells_actual_max_size = ca->segments_count * cells_x_segment;
+  const size_t lines_actual_max_size = la->segments_count * lines_x_segment;
+  const size_t cells_max_size = PVE_NULL_INDEX;
+  const size_t lines_max_size = PVE_NULL_INDEX;
   const size_t pve_current_mem_consum =
     sizeof(PVEnv) +
-    sizeof(PVCell *) * pve->cells_segments_size +
-    sizeof(PVCell **) * pve->lines_segments_size +
-    (sizeof(size_t) + sizeof(PVCell *)) * pve->cells_segments_size +
-    (sizeof(size_t) + sizeof(PVCell **)) * pve->lines_segments_size +
-    (sizeof(PVCell) + sizeof(PVCell *)) * cells_actual_max_size +
-    (sizeof(PVCell *) + sizeof(PVCell **)) * lines_actual_max_size;
+    2 * sizeof(mem_obj_allocator_t) +
+    (sizeof(char *) + sizeof(mem_obj_segment_t)) * (ca->segments_size + la->segments_size) +
+    sizeof(PVCell) * cells_actual_max_size +
+    sizeof(PVCell *) * lines_actual_max_size;
   if (shown_sections & pve_internals_computed_properties_section) {
     fprintf(stream, "# PVE COMPUTED PROPERTIES\n");
-    fprintf(stream, "cells_segments_in_use_count: %20zu  --  Cells segments being allocated.\n", cells_segments_in_use_count);
-    fprintf(stream, "cells_in_use_count:          %20zu  --  Cells actively assigned to lines.\n", cells_in_use_count);
+    fprintf(stream, "cells_segments_in_use_count: %20zu  --  Cells segments being allocated.\n", ca->segments_count);
+    fprintf(stream, "cells_in_use_count:          %20zu  --  Cells actively assigned to lines.\n", ca->used_count);
     fprintf(stream, "cells_actual_max_size:       %20zu  --  Actual maximum number of cells without allocating new segments.\n", cells_actual_max_size);
     fprintf(stream, "cells_max_size:              %20zu  --  Overall maximum number of cells.\n", cells_max_size);
-    fprintf(stream, "lines_segments_in_use_count: %20zu  --  Lines segments being allocated.\n", lines_segments_in_use_count);
-    fprintf(stream, "lines_in_use_count:          %20zu  --  Active lines.\n", lines_in_use_count);
+    fprintf(stream, "lines_segments_in_use_count: %20zu  --  Lines segments being allocated.\n", la->segments_count);
+    fprintf(stream, "lines_in_use_count:          %20zu  --  Active lines.\n", la->used_count);
     fprintf(stream, "lines_actual_max_size:       %20zu  --  Actual maximum number of lines without allocating new segments.\n", lines_actual_max_size);
     fprintf(stream, "lines_max_size:              %20zu  --  Overall maximum number of lines.\n", lines_max_size);
-    fprintf(stream, "pve_max_allowed_mem_consum:  %20zu  --  PV environment max allowed memory consumption.\n", pve_max_allowed_mem_consum);
     fprintf(stream, "pve_current_mem_consum:      %20zu  --  PV environment current memory consumption.\n", pve_current_mem_consum);
     fprintf(stream, "\n");
   }
 
   if (shown_sections & pve_internals_active_lines_section) {
-    pve_sort_lines_in_place(pve);
+    uint64_t *const free_lines = mem_obj_allocator_free_bitmap(la);
     fprintf(stream, "# PVE ACTIVE LINES\n");
     fprintf(stream, "   ORDINAL; L_COUNT; C_POS;      LINE_ADDRESS;        FIRST_CELL;              CELL; MOVE;              NEXT;           VARIANT\n");
     size_t ordinal = 0;
     size_t line_counter = 0;
-    for (PVCell ***line_p = pve->lines_stack; line_p < pve->lines_stack_head; line_p++) {
-      PVCell **line = *line_p;
+    for (uint32_t i = 0; i < la->top; i++) {
+      if (free_lines[i / 64] & (1ULL << (i % 64))) continue;
+      PVCell **line = pve_line_at(pve, i);
       PVCell *first_cell = *line;
       size_t cell_position = 0;
-      for (PVCell *c = first_cell; c != NULL; c = c->next) {
-        fprintf(stream, "%10zu;%8zu;%6zu;%18p;%18p;%18p;%5s;%18p;%18p\n",
+      for (PVCell *c = first_cell; c != NULL; c = pve_cell_at(pve, c->next)) {
+        fprintf(stream, "%10zu;%8zu;%6zu;%18p;%18p;%18p;%5s;%18" PRId64 ";%18" PRId64 "\n",
                 ordinal,
                 line_counter,
                 cell_position,
@@ -951,71 +969,67 @@ pve_internals_to_stream (PVEnv *const pve,
                 (void *) first_cell,
                 (void *) c,
                 square_as_move_to_string(c->move),
-                (void *) c->next,
-                (void *) c->variant);
+                pve_index_to_int64(c->next),
+                pve_index_to_int64(c->variant));
         cell_position++;
         ordinal++;
       }
       line_counter++;
     }
+    free(free_lines);
     fprintf(stream, "\n");
   }
 
   if (shown_sections & pve_internals_cells_segments_section) {
     fprintf(stream, "# PVE CELLS SEGMENTS\n");
     fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO;      SIZE\n");
-    for (size_t i = 0; i < pve->cells_segments_size; i++) {
+    for (size_t i = 0; i < ca->segments_count; i++) {
       fprintf(stream, "%7zu;%20p;%20p;%10zu\n",
               i,
-              (void *) (pve->cells_segments + i),
-              (void *) *(pve->cells_segments + i),
-              (size_t) ((i == 0) ? 1 : (1ULL << (i - 1))) * pve->cells_first_size);
+              (void *) (ca->segments + i),
+              (void *) ca->segments[i],
+              cells_x_segment);
     }
     fprintf(stream, "\n");
   }
 
   if (shown_sections & pve_internals_sorted_cells_segments_section) {
     fprintf(stream, "# PVE SORTED CELLS SEGMENTS\n");
-    fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO;      SIZE\n");
-    for (size_t i = 0; i < pve->cells_segments_size; i++) {
+    fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO;   SEGMENT\n");
+    for (size_t i = 0; i < ca->segments_count; i++) {
       fprintf(stream, "%7zu;%20p;%20p;%10zu\n",
               i,
-              (void *) (pve->cells_segments_sorted + i),
-              (void *) *(pve->cells_segments_sorted + i),
-              *(pve->cells_segments_sorted_sizes + i));
+              (void *) (ca->segments_sorted + i),
+              (void *) ca->segments_sorted[i].content,
+              ca->segments_sorted[i].ordinal);
     }
     fprintf(stream, "\n");
   }
 
-  size_t cells_segment_size = pve->cells_first_size;
-  size_t cells_segment_size_incr = 0;
   if (shown_sections & pve_internals_cells_section) {
     fprintf(stream, "# PVE CELLS\n");
-    fprintf(stream, "SEGMENT; ORDINAL;             ADDRESS; MOVE; IS_ACTIVE;                NEXT;             VARIANT\n");
-    for (size_t i = 0; i < cells_segments_in_use_count; i++, cells_segment_size += cells_segment_size_incr, cells_segment_size_incr = cells_segment_size) {
-      for (size_t j = 0; j < cells_segment_size; j++) {
-        PVCell *cell = (PVCell *) (*(pve->cells_segments + i) + j);
-        fprintf(stream, "%7zu;%8zu;%20p;%5s;%10d;%20p;%20p\n",
-                i,
-                j,
-                (void *) cell,
-                square_as_move_to_string(cell->move),
-                cell->is_active,
-                (void *) cell->next,
-                (void *) cell->variant);
-      }
+    fprintf(stream, "SEGMENT; ORDINAL;             ADDRESS; MOVE; REF_COUNT;                NEXT;             VARIANT;            POSITION\n");
+    for (uint32_t i = 0; i < ca->top; i++) {
+      PVCell *cell = pve_cell_at(pve, i);
+      fprintf(stream, "%7zu;%8zu;%20p;%5s;%10u;%20" PRId64 ";%20" PRId64 ";%20" PRId64 "\n",
+              (size_t) (i >> ca->segment_shift),
+              (size_t) (i & (cells_x_segment - 1)),
+              (void *) cell,
+              square_as_move_to_string(cell->move),
+              (unsigned int) cell->ref_count,
+              pve_index_to_int64(cell->next),
+              pve_index_to_int64(cell->variant),
+              pve_index_to_int64(cell->position));
     }
     fprintf(stream, "\n");
   }
 
   if (shown_sections & pve_internals_cells_stack_section) {
-    fprintf(stream, "# PVE CELLS STACK\n");
-    fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO\n");
-    for (size_t i = 0; i < pve->cells_size; i++) {
-      fprintf(stream, "%7zu;%20p;%20p\n",
-              i,
-              (void *) (pve->cells_stack + i),
-              (void *) *(pve->cells_stack + i));
+    fprintf(stream, "# PVE CELLS FREE LIST\n");
+    fprintf(stream, "ORDINAL;     INDEX;             ADDRESS\n");
+    size_t ordinal = 0;
+    for (uint32_t i = ca->free_head; i != PVE_NULL_INDEX; i = pve_cell_at(pve, i)->next) {
+      fprintf(stream, "%7zu;%10u;%20p\n", ordinal++, i, (void *) pve_cell_at(pve, i));
     }
     fprintf(stream, "\n");
   }
@@ -1023,54 +1037,54 @@ pve_internals_to_stream (PVEnv *const pve,
   if (shown_sections & pve_internals_lines_segments_section) {
     fprintf(stream, "# PVE LINES SEGMENTS\n");
     fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO;      SIZE\n");
-    for (size_t i = 0; i < pve->lines_segments_size; i++) {
+    for (size_t i = 0; i < la->segments_count; i++) {
       fprintf(stream, "%7zu;%20p;%20p;%10zu\n",
               i,
-              (void *) (pve->lines_segments + i),
-              (void *) *(pve->lines_segments + i),
-              (size_t) ((i == 0) ? 1 : (1ULL << (i - 1))) * pve->lines_first_size);
+              (void *) (la->segments + i),
+              (void *) la->segments[i],
+              lines_x_segment);
     }
     fprintf(stream, "\n");
   }
 
   if (shown_sections & pve_internals_sorted_lines_segments_section) {
     fprintf(stream, "# PVE SORTED LINES SEGMENTS\n");
-    fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO;      SIZE\n");
-    for (size_t i = 0; i < pve->lines_segments_size; i++) {
+    fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO;   SEGMENT\n");
+    for (size_t i = 0; i < la->segments_count; i++) {
       fprintf(stream, "%7zu;%20p;%20p;%10zu\n",
               i,
-              (void *) (pve->lines_segments_sorted + i),
-              (void *) *(pve->lines_segments_sorted + i),
-              *(pve->lines_segments_sorted_sizes + i));
+              (void *) (la->segments_sorted + i),
+              (void *) la->segments_sorted[i].content,
+              la->segments_sorted[i].ordinal);
     }
     fprintf(stream, "\n");
   }
 
-  size_t lines_segment_size = pve->lines_first_size;
-  size_t lines_segment_size_incr = 0;
   if (shown_sections & pve_internals_lines_section) {
+    uint64_t *const free_lines = mem_obj_allocator_free_bitmap(la);
     fprintf(stream, "# PVE LINES\n");
     fprintf(stream, "SEGMENT; ORDINAL;             ADDRESS;           POINTS_TO\n");
-    for (size_t i = 0; i < lines_segments_in_use_count; i++, lines_segment_size += lines_segment_size_incr, lines_segment_size_incr = lines_segment_size) {
-      for (size_t j = 0; j < lines_segment_size; j++) {
-        fprintf(stream, "%7zu;%8zu;%20p;%20p\n",
-                i,
-                j,
-                (void *) (*(pve->lines_segments + i) + j),
-                (void *) *(*(pve->lines_segments + i) + j));
-      }
+    for (uint32_t i = 0; i < la->top; i++) {
+      PVCell **line = pve_line_at(pve, i);
+      const bool is_free = free_lines[i / 64] & (1ULL << (i % 64));
+      fprintf(stream, "%7zu;%8zu;%20p;%20p\n",
+              (size_t) (i >> la->segment_shift),
+              (size_t) (i & (lines_x_segment - 1)),
+              (void *) line,
+              is_free ? NULL : (void *) *line);
     }
+    free(free_lines);
     fprintf(stream, "\n");
   }
 
   if (shown_sections & pve_internals_lines_stack_section) {
-    fprintf(stream, "# PVE LINES STACK\n");
-    fprintf(stream, "ORDINAL;             ADDRESS;           POINTS_TO\n");
-    for (size_t i = 0; i < pve->lines_size; i++) {
-      fprintf(stream, "%7zu;%20p;%20p\n",
-              i,
-              (void *) (pve->lines_stack + i),
-              (void *) *(pve->lines_stack + i));
+    fprintf(stream, "# PVE LINES FREE LIST\n");
+    fprintf(stream, "ORDINAL;     INDEX;             ADDRESS\n");
+    size_t ordinal = 0;
+    for (uint32_t i = la->free_head; i != PVE_NULL_INDEX; ) {
+      PVCell **line = pve_line_at(pve, i);
+      fprintf(stream, "%7zu;%10u;%20p\n", ordinal++, i, (void *) line);
+      memcpy(&i, line, sizeof(uint32_t));
     }
     fprintf(stream, "\n");
   }
@@ -1086,8 +1100,8 @@ pve_internals_to_stream (PVEnv *const pve,
 /**
  * @brief Returns a free line pointer.
  *
- * @details The environment is modified because the line stack fill pointer,
- *          lines_stack_head, is incremented.
+ * @details The line is taken from the free list of the lines arena, or when the list is empty,
+ *          from the first never used slot.
  *
  * @param [in,out] pve a pointer to the principal variation environment
  * @return             a pointer to the next free line
@@ -1096,49 +1110,12 @@ PVCell **
 pve_line_create (PVEnv *pve)
 {
   pve_verify_invariant(PVE_VERIFY_INVARIANT_MASK);
-  pve_state_unset_lines_stack_sorted(pve);
   pve->line_create_count++;
-  PVCell **line_p = *(pve->lines_stack_head);
+  PVCell **line_p = pve_line_at(pve, mem_obj_alloc_index(pve->lines));
   *(line_p) = NULL;
-  *(pve->lines_stack_head) = NULL; /* Set to NULL the stack cell. */
-  pve->lines_stack_head++;
-  if (pve->lines_stack_head - pve->lines_stack > pve->lines_max_usage) pve->lines_max_usage++;
-  if (pve->lines_stack_head - pve->lines_stack == pve->lines_size) pve_double_lines_size(pve);
   return line_p;
 }
 
-typedef struct pve_gp_table_entry {
-  size_t ref_count;
-  GamePositionX gpx;
-} pve_gp_table_entry_t;
-
-static pve_gp_table_entry_t *
-pve_gp_table_entry_new (const GamePositionX *gpx)
-{
-  assert(gpx);
-
-  pve_gp_table_entry_t *entry;
-  static const size_t size_of_entry = sizeof(pve_gp_table_entry_t);
-
-  entry = (pve_gp_table_entry_t *) malloc(size_of_entry);
-  assert(entry);
-
-  entry->ref_count = 0;
-  entry->gpx.blacks = gpx->blacks;
-  entry->gpx.whites = gpx->whites;
-  entry->gpx.player = gpx->player;
-
-  return entry;
-}
-
-static void
-pve_gp_table_entry_free (pve_gp_table_entry_t *entry)
-{
-  free(entry);
-}
-
-
-
 /**
  * @brief Adds the `move` to the given `line`.
  *
@@ -1162,29 +1139,10 @@ pve_line_add_move (PVEnv *pve,
 {
   pve_verify_invariant(PVE_VERIFY_INVARIANT_MASK);
   pve->line_add_move_count++;
-  PVCell *added_cell = *(pve->cells_stack_head);
-  *(pve->cells_stack_head) = NULL; /* Set to NULL the stack element. */
-  pve->cells_stack_head++;
-  if (pve->cells_stack_head - pve->cells_stack > pve->cells_max_usage) pve->cells_max_usage++;
-  if (pve->cells_stack_head - pve->cells_stack == pve->cells_size) pve_double_cells_size(pve);
-  added_cell->move = move;
-  added_cell->is_active = TRUE;
-  added_cell->next = *line;
-  added_cell->ref_count = 0;
-  added_cell->gpx.blacks = gp->board->blacks;
-  added_cell->gpx.whites = gp->board->whites;
-  added_cell->gpx.player = gp->player;
+  const GamePositionX gpx = { .blacks = gp->board->blacks, .whites = gp->board->whites, .player = gp->player };
+  PVCell *added_cell = pve_cell_new(pve, move, &gpx);
+  added_cell->next = pve_cell_to_index(pve, *line);
   *line = added_cell;
-
-  pve_gp_table_entry_t table_entry;
-  table_entry.gpx.blacks = gp->board->blacks;
-  table_entry.gpx.whites = gp->board->whites;
-  table_entry.gpx.player = gp->player;
-  pve_gp_table_entry_t **entry_ref = (pve_gp_table_entry_t **) rbt_probe(pve->gp_table, &table_entry);
-  if (*entry_ref == &table_entry) {
-    *entry_ref = pve_gp_table_entry_new(&table_entry.gpx);
-  }
-  (*entry_ref)->ref_count++;
 }
 
 void
@@ -1195,29 +1153,50 @@ pve_line_add_move2 (PVEnv *pve,
 {
   pve_verify_invariant(PVE_VERIFY_INVARIANT_MASK);
   pve->line_add_move_count++;
-  PVCell *added_cell = *(pve->cells_stack_head);
-  *(pve->cells_stack_head) = NULL; /* Set to NULL the stack element. */
-  pve->cells_stack_head++;
-  if (pve->cells_stack_head - pve->cells_stack > pve->cells_max_usage) pve->cells_max_usage++;
-  if (pve->cells_stack_head - pve->cells_stack == pve->cells_size) pve_double_cells_size(pve);
-  added_cell->move = move;
-  added_cell->is_active = TRUE;
-  added_cell->next = *line;
-  added_cell->ref_count = 0;
-  added_cell->gpx.blacks = gpx->blacks;
-  added_cell->gpx.whites = gpx->whites;
-  added_cell->gpx.player = gpx->player;
+  PVCell *added_cell = pve_cell_new(pve, move, gpx);
+  added_cell->next = pve_cell_to_index(pve, *line);
   *line = added_cell;
+}
 
-  pve_gp_table_entry_t table_entry;
-  table_entry.gpx.blacks = gpx->blacks;
-  table_entry.gpx.whites = gpx->whites;
-  table_entry.gpx.player = gpx->player;
-  pve_gp_table_entry_t **entry_ref = (pve_gp_table_entry_t **) rbt_probe(pve->gp_table, &table_entry);
-  if (*entry_ref == &table_entry) {
-    *entry_ref = pve_gp_table_entry_new(&table_entry.gpx);
+/**
+ * @brief Adds the `move` to the given `line`, sharing the line that follows the game position.
+ *
+ * @details The function works as #pve_line_add_move2, but before adding the move it looks up the line index
+ *          for a line already recorded after the game position `gpx` within the same `context`.
+ *          When found, the cells of `line` are released and the new cell refers to the shared line,
+ *          whose reference count is incremented. When not found, the first cell of `line` is added to the index.
+ *          The structure becomes a DAG, memory scales with the unique game positions instead of with the lines.
+ *
+ *          The caller is responsible for giving a `context` that makes lines interchangeable: two lines
+ *          indexed by the same game position and context must be equal.
+ *          The `line` must be active, it is an error to call the function on free lines.
+ *
+ * @param [in,out] pve     a pointer to the principal variation environment
+ * @param [in,out] line    the line to be updated
+ * @param [in]     move    the move value to add to the line
+ * @param [in]     gpx     the game position after the move
+ * @param [in]     context the search context
+ */
+void
+pve_line_add_move_shared (PVEnv *pve,
+                          PVCell **line,
+                          Square move,
+                          GamePositionX *gpx,
+                          uint64_t context)
+{
+  PVCell *const head = *line;
+  if (head) {
+    PVCell *const shared = pve_line_index_lookup(pve, gpx, context);
+    if (!shared) {
+      pve_line_index_insert(pve, gpx, context, head);
+    } else if (shared != head) {
+      pve_release_cells(pve, head, NULL);
+      pve_cell_ref(shared);
+      *line = shared;
+      pve->line_share_count++;
+    }
   }
-  (*entry_ref)->ref_count++;
+  pve_line_add_move2(pve, line, move, gpx);
 }
 
 void
@@ -1230,17 +1209,18 @@ pve_line_add_variant (PVEnv *pve,
   g_assert(*line);
   g_assert(line_variant);
   g_assert(*line_variant);
-  PVCell **tmp_line = (*line)->variant;
-  (*line)->variant = line_variant;
+  const uint32_t tmp_line = (*line)->variant;
+  (*line)->variant = pve_line_to_index(pve, line_variant);
   (*line_variant)->variant = tmp_line;
 }
 
 /**
  * @brief Deletes the `line`.
  *
- * @details Traverses the linked list of cells and returns them to the cell stack.
+ * @details Traverses the linked list of cells and returns them to the cells arena.
  *          For each cell traverse recurvively all the variants.
- *          Finally returns the line to the line stack.
+ *          The traversal stops at the first cell that is still shared by other lines.
+ *          Finally returns the line to the lines arena.
  *
  * @param [in,out] pve  a pointer to the principal variation environment
  * @param [in,out] line the line to be deleted
@@ -1250,35 +1230,9 @@ pve_line_delete (PVEnv *pve,
                  PVCell **line)
 {
   pve_verify_invariant(PVE_VERIFY_INVARIANT_MASK);
-  pve_state_unset_lines_stack_sorted(pve);
   pve->line_delete_count++;
-  PVCell *cell = *line; // A poiter to the first cell, or null if the line is empty.
-  while (cell) {
-    pve_gp_table_entry_t table_key;
-    table_key.gpx.blacks = cell->gpx.blacks;
-    table_key.gpx.whites = cell->gpx.whites;
-    table_key.gpx.player = cell->gpx.player;
-    pve_gp_table_entry_t *table_entry = (pve_gp_table_entry_t *) rbt_find(pve->gp_table, &table_key);
-    assert(table_entry);
-    table_entry->ref_count--;
-    if (table_entry->ref_count == 0) {
-      rbt_delete(pve->gp_table, &table_key);
-      pve_gp_table_entry_free(table_entry);
-    }
-    PVCell **v_line = cell->variant;
-    if (v_line) pve_line_delete(pve, v_line);
-    pve->cells_stack_head--;
-    *(pve->cells_stack_head) = cell;
-    cell->is_active = FALSE;
-    cell->variant = NULL;
-    pve->line_release_cell_count++;
-    cell->move = invalid_move;
-    PVCell *next = cell->next;
-    cell->next = NULL;
-    cell = next;
-  }
-  pve->lines_stack_head--;
-  *(pve->lines_stack_head) = line;
+  pve_release_cells(pve, *line, NULL);
+  mem_obj_free_index(pve->lines, pve_line_to_index(pve, line));
 }
 
 /**
@@ -1296,12 +1250,12 @@ pve_line_internals_to_stream (const PVEnv *const pve,
   if (line) {
     fprintf(stream, "line_address=%p, first_cell=%p", (void *) line, (void *) *line);
     if (*line) fprintf(stream, ", chain: ");
-    for (const PVCell *c = *line; c != NULL; c = c->next) {
-      fprintf(stream, "(c=%p, m=%s, n=%p, v=%p)",
+    for (const PVCell *c = *line; c != NULL; c = pve_cell_at(pve, c->next)) {
+      fprintf(stream, "(c=%p, m=%s, n=%" PRId64 ", v=%" PRId64 ")",
               (void *) c,
               square_as_move_to_string(c->move),
-              (void *) c->next,
-              (void *) c->variant);
+              pve_index_to_int64(c->next),
+              pve_index_to_int64(c->variant));
     }
   } else {
     fprintf(stream, "Line is NULL, it shouldn't.\n");
@@ -1369,7 +1323,7 @@ pve_line_copy_to_exact_solution (const PVEnv *const pve,
                                  ExactSolution *const es)
 {
   g_assert(es->pv_length == 0);
-  for (const PVCell *c = *line; c != NULL; c = c->next) {
+  for (const PVCell *c = *line; c != NULL; c = pve_cell_at(pve, c->next)) {
     es->pv[(es->pv_length)++] = c->move;
   }
 }
@@ -1377,425 +1331,555 @@ pve_line_copy_to_exact_solution (const PVEnv *const pve,
 /**
  * @brief Dumps the pve structure to a binary file.
  *
- * @details TBD.
+ * @details The file has the relocatable format described by #pve_dump_header_t.
+ *          The lines reachable from the root line are traversed, each cell is written once,
+ *          also when it is shared by more lines, and all the references are translated
+ *          into indexes. Game positions, already unique in the PVE table, are collected when first met,
+ *          then sorted by the multi-threaded merge-sort, and the cells are remapped to the sorted order.
+ *          Unused cells and lines, and the memory layout of the segments, are not dumped.
+ *
+ *          The dump is written to a temporary file, having the `.tmp` suffix, that is renamed
+ *          to `out_file_path` when complete. On failure the temporary file is removed, and
+ *          a previous file at `out_file_path` is left untouched.
  *
  * @param [in]     pve           a pointer to the principal variation environment
  * @param [in]     out_file_path the path of the output file
+ * @return                       true when the file has been written
  */
-void
+bool
 pve_dump_to_binary_file (const PVEnv *const pve,
                          const char *const out_file_path)
 {
   g_assert(pve);
   g_assert(out_file_path);
 
-  FILE *fp = fopen(out_file_path, "w");
-  g_assert(fp);
-
-  fwrite(pve, sizeof(PVEnv), 1, fp);
-  fwrite(pve->root_game_position, sizeof(GamePositionX), 1, fp);
-  fwrite(pve->cells_segments, sizeof(PVCell *), pve->cells_segments_size, fp);
-  fwrite(pve->cells_segments_sorted, sizeof(PVCell *), pve->cells_segments_size, fp);
-  fwrite(pve->cells_segments_sorted_sizes, sizeof(size_t), pve->cells_segments_size, fp);
-  for (PVCell **segment_p = pve->cells_segments; segment_p < pve->cells_segments_head; segment_p++) {
-    const ptrdiff_t i = segment_p - pve->cells_segments;
-    PVCell *segment = *segment_p;
-    size_t segment_size = (size_t) (((i == 0) ? 1 : (1ULL << (i - 1))) * pve->cells_first_size);
-    fwrite(segment, sizeof(PVCell), segment_size, fp);
-  }
-  fwrite(pve->cells_stack, sizeof(PVCell **), pve->cells_size, fp);
-  fwrite(pve->lines_segments, sizeof(PVCell **), pve->lines_segments_size, fp);
-  fwrite(pve->lines_segments_sorted, sizeof(PVCell **), pve->lines_segments_size, fp);
-  fwrite(pve->lines_segments_sorted_sizes, sizeof(size_t), pve->lines_segments_size, fp);
-  for (PVCell ***segment_p = pve->lines_segments; segment_p < pve->lines_segments_head; segment_p++) {
-    const ptrdiff_t i = segment_p - pve->lines_segments;
-    PVCell **segment = *segment_p;
-    size_t segment_size = (size_t) (((i == 0) ? 1 : (1ULL << (i - 1))) * pve->lines_first_size);
-    fwrite(segment, sizeof(PVCell *), segment_size, fp);
-  }
-  fwrite(pve->lines_stack, sizeof(PVCell ***), pve->lines_size, fp);
-
-  int fclose_ret = fclose(fp);
-  g_assert(fclose_ret == 0);
-  (void) fclose_ret; /* Suppress the warning "unused variable" rised when compiling without assertions. */
+  pve_dump_buffer_t cells = { NULL, 0, 0, sizeof(pve_dump_cell_t) };
+  pve_dump_buffer_t lines = { NULL, 0, 0, sizeof(uint32_t) };
+  pve_dump_buffer_t positions = { NULL, 0, 0, sizeof(pve_dump_position_ref_t) };
+  pve_dump_buffer_t stack = { NULL, 0, 0, sizeof(pve_dump_line_ref_t) };
+
+  /* Maps the entries of the PVE game position table to the positions of the dump. */
+  uint32_t *const position_map = (uint32_t *) malloc(pve->positions_size * sizeof(uint32_t));
+  g_assert(position_map);
+  for (size_t i = 0; i < pve->positions_size; i++) position_map[i] = PVE_DUMP_NULL_INDEX;
+
+  /* Maps the shared cells of the PVE, by their index in the arena, to the cells of the dump. */
+  uint32_t *const shared_cell_map = (uint32_t *) malloc(pve->cells->top * sizeof(uint32_t));
+  g_assert(shared_cell_map || pve->cells->top == 0);
+  for (size_t i = 0; i < pve->cells->top; i++) shared_cell_map[i] = PVE_DUMP_NULL_INDEX;
+
+  /* The root game position is in the table only when a cell has it, that happens after two passes. */
+  uint32_t root_position = pve_dump_position_append(&positions, pve->root_game_position);
+  const uint32_t *const root_entry = hs_find(pve->positions_index, pve_gpx_hash(pve->root_game_position), pve->root_game_position);
+  if (root_entry) position_map[*root_entry] = root_position;
+  *(uint32_t *) pve_dump_buffer_push(&lines) = PVE_DUMP_NULL_INDEX;
+  pve_dump_line_ref_t *const root_ref = pve_dump_buffer_push(&stack);
+  root_ref->line = pve->root_line;
+  root_ref->index = 0;
+
+  /*
+   * Lines are translated one at a time, cells are numbered in the order they are met,
+   * so that the cells of a line are contiguous in the file.
+   * A shared cell, already translated, closes the line.
+   */
+  while (stack.count) {
+    const pve_dump_line_ref_t ref = ((pve_dump_line_ref_t *) stack.data)[--stack.count];
+    uint32_t *link = &((uint32_t *) lines.data)[ref.index];
+    uint32_t link_cell = PVE_DUMP_NULL_INDEX;
+    uint32_t ci = pve_cell_to_index(pve, *ref.line);
+    for (const PVCell *c = *ref.line; c != NULL; ci = c->next, c = pve_cell_at(pve, c->next)) {
+      if (c->ref_count > 1) {
+        const uint32_t shared = shared_cell_map[ci];
+        if (shared != PVE_DUMP_NULL_INDEX) {
+          if (link) *link = shared;
+          else ((pve_dump_cell_t *) cells.data)[link_cell].next = shared;
+          break;
+        }
+        shared_cell_map[ci] = cells.count;
+      }
+      g_assert(cells.count < PVE_DUMP_NULL_INDEX);
+      const uint32_t index = cells.count;
+      pve_dump_cell_t *const dc = pve_dump_buffer_push(&cells);
+      dc->next = PVE_DUMP_NULL_INDEX;
+      dc->variant = PVE_DUMP_NULL_INDEX;
+      if (position_map[c->position] == PVE_DUMP_NULL_INDEX)
+        position_map[c->position] = pve_dump_position_append(&positions, &pve->positions[c->position].gpx);
+      dc->position = position_map[c->position];
+      dc->move = c->move;
+      memset(dc->padding, 0, sizeof(dc->padding));
+      if (c->variant != PVE_NULL_INDEX) {
+        g_assert(lines.count < PVE_DUMP_NULL_INDEX);
+        dc->variant = lines.count;
+        *(uint32_t *) pve_dump_buffer_push(&lines) = PVE_DUMP_NULL_INDEX;
+        pve_dump_line_ref_t *const v = pve_dump_buffer_push(&stack);
+        v->line = pve_line_at(pve, c->variant);
+        v->index = dc->variant;
+      }
+      if (link) *link = index;
+      else ((pve_dump_cell_t *) cells.data)[link_cell].next = index;
+      link = NULL;
+      link_cell = index;
+    }
+  }
+
+  /*
+   * Game positions are sorted, and the indexes given when positions were met are translated
+   * into the sorted ones. The sorted positions are then packed in place, dropping the original index.
+   */
+  pve_dump_position_ref_t *const refs = (pve_dump_position_ref_t *) positions.data;
+  sort_utils_mergesort_mt(refs, positions.count, sizeof(pve_dump_position_ref_t), pve_dump_position_ref_cmp, pve_thread_count());
+  /* The root game position is always the first one appended, so positions are never empty. */
+  g_assert(positions.count > 0);
+  uint32_t *const sorted_index = (uint32_t *) calloc(positions.count, sizeof(uint32_t));
+  g_assert(sorted_index);
+  for (size_t k = 0; k < positions.count; k++) sorted_index[refs[k].index] = k;
+  for (size_t i = 0; i < cells.count; i++) {
+    pve_dump_cell_t *const dc = &((pve_dump_cell_t *) cells.data)[i];
+    dc->position = sorted_index[dc->position];
+  }
+  root_position = sorted_index[root_position];
+  for (size_t k = 0; k < positions.count; k++) {
+    memmove((pve_dump_position_t *) positions.data + k, &refs[k].position, sizeof(pve_dump_position_t));
+  }
+  free(sorted_index);
+
+  pve_dump_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PVE_DUMP_MAGIC, sizeof(header.magic));
+  header.version = PVE_DUMP_VERSION;
+  header.header_size = sizeof(pve_dump_header_t);
+  header.cells_offset = sizeof(pve_dump_header_t);
+  header.cell_count = cells.count;
+  header.lines_offset = header.cells_offset + cells.count * sizeof(pve_dump_cell_t);
+  header.line_count = lines.count;
+  header.positions_offset = pve_dump_align(header.lines_offset + lines.count * sizeof(uint32_t));
+  header.position_count = positions.count;
+  header.file_size = header.positions_offset + positions.count * sizeof(pve_dump_position_t);
+  header.root_line = 0;
+  header.root_position = root_position;
+  header.cells_max_usage = pve->cells->max_used_count;
+  header.lines_max_usage = pve->lines->max_used_count;
+  header.line_create_count = pve->line_create_count;
+  header.line_delete_count = pve->line_delete_count;
+  header.line_add_move_count = pve->line_add_move_count;
+  header.line_release_cell_count = pve->line_release_cell_count;
+  header.line_share_count = pve->line_share_count;
+
+  static const uint8_t padding[PVE_DUMP_ALIGNMENT] = { 0 };
+  const size_t lines_padding = header.positions_offset - (header.lines_offset + lines.count * sizeof(uint32_t));
+  char *const tmp_file_path = g_strdup_printf("%s.tmp", out_file_path);
+  FILE *const fp = fopen(tmp_file_path, "w");
+  bool is_written = fp &&
+    fwrite(&header, sizeof(pve_dump_header_t), 1, fp) == 1 &&
+    fwrite(cells.data, sizeof(pve_dump_cell_t), cells.count, fp) == cells.count &&
+    fwrite(lines.data, sizeof(uint32_t), lines.count, fp) == lines.count &&
+    fwrite(padding, 1, lines_padding, fp) == lines_padding &&
+    fwrite(positions.data, sizeof(pve_dump_position_t), positions.count, fp) == positions.count;
+  if (fp && fclose(fp) != 0) is_written = false;
+  if (is_written) is_written = rename(tmp_file_path, out_file_path) == 0;
+  if (fp && !is_written) remove(tmp_file_path);
+  g_free(tmp_file_path);
+
+  free(cells.data);
+  free(lines.data);
+  free(positions.data);
+  free(stack.data);
+  free(position_map);
+  free(shared_cell_map);
+
+  return is_written;
 }
 
 /**
- * @brief Loads the pve structure from a binary file.
+ * @brief Maps a binary file, written by #pve_dump_to_binary_file, into memory.
  *
- * @details Reads a binary file previously written by calling the function #pve_dump_to_binary_file.
+ * @details The file is mapped read only, and is never copied nor translated:
+ *          cells, lines and game positions are accessed directly through the returned view.
+ *          The file is validated, the magic string, the version, and the section bounds are checked,
+ *          as well as every cell, line, and game position index stored in the sections.
+ *          The next and variant links must have no cycle, and no line may be longer than #PV_MAX_LENGTH.
+ *          The view must be released by calling #pve_dump_close.
  *
  * @param [in] in_file_path the path of the input file
- * @return                  the pve stucture loaded from file
+ * @return                  the dump view, or `NULL` when the file cannot be mapped or is not a valid dump
  */
-PVEnv *
-pve_load_from_binary_file (const char *const in_file_path)
+pve_dump_t *
+pve_dump_open (const char *const in_file_path)
 {
   g_assert(in_file_path);
 
-  int fread_result;
-  PVEnv from_file_pve;
-
-  PVCell **from_file_lines_segments[PVE_LOAD_DUMP_LINES_SEGMENTS_SIZE];
-  PVCell **from_file_lines_segments_sorted[PVE_LOAD_DUMP_LINES_SEGMENTS_SIZE];
-  size_t from_file_lines_segments_sorted_sizes[PVE_LOAD_DUMP_LINES_SEGMENTS_SIZE];
-
-  PVCell *from_file_cells_segments[PVE_LOAD_DUMP_CELLS_SEGMENTS_SIZE];
-  PVCell *from_file_cells_segments_sorted[PVE_LOAD_DUMP_CELLS_SEGMENTS_SIZE];
-  size_t from_file_cells_segments_sorted_sizes[PVE_LOAD_DUMP_CELLS_SEGMENTS_SIZE];
-
-  /* Opens the binary file for reading. */
-  FILE *fp = fopen(in_file_path, "r");
-  g_assert(fp);
-
-  /* Reads the pve structure from the file. */
-  fread_result = fread(&from_file_pve, sizeof(PVEnv), 1, fp);
-  g_assert(fread_result == 1);
-  (void) fread_result;
-  g_assert(from_file_pve.cells_segments_size <= PVE_LOAD_DUMP_CELLS_SEGMENTS_SIZE);
+  const int fd = open(in_file_path, O_RDONLY);
+  if (fd == -1) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size < (off_t) sizeof(pve_dump_header_t)) {
+    close(fd);
+    return NULL;
+  }
+
+  const size_t size = st.st_size;
+  void *const base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return NULL;
+
+  const pve_dump_header_t *const h = base;
+  const bool is_valid =
+    memcmp(h->magic, PVE_DUMP_MAGIC, sizeof(h->magic)) == 0 &&
+    h->version == PVE_DUMP_VERSION &&
+    h->header_size == sizeof(pve_dump_header_t) &&
+    h->file_size == size &&
+    h->cell_count < PVE_DUMP_NULL_INDEX &&
+    h->line_count < PVE_DUMP_NULL_INDEX &&
+    h->position_count < PVE_DUMP_NULL_INDEX &&
+    h->cells_offset >= h->header_size &&
+    h->cells_offset <= size &&
+    h->lines_offset <= size &&
+    h->positions_offset <= size &&
+    h->cells_offset + h->cell_count * sizeof(pve_dump_cell_t) <= h->lines_offset &&
+    h->lines_offset + h->line_count * sizeof(uint32_t) <= h->positions_offset &&
+    h->positions_offset + h->position_count * sizeof(pve_dump_position_t) <= size &&
+    h->cells_offset % PVE_DUMP_ALIGNMENT == 0 &&
+    h->lines_offset % PVE_DUMP_ALIGNMENT == 0 &&
+    h->positions_offset % PVE_DUMP_ALIGNMENT == 0 &&
+    h->root_line < h->line_count &&
+    h->root_position < h->position_count &&
+    pve_dump_indexes_are_valid(h,
+                               (const pve_dump_cell_t *) ((const char *) base + h->cells_offset),
+                               (const uint32_t *) ((const char *) base + h->lines_offset)) &&
+    pve_dump_chains_are_valid(h,
+                              (const pve_dump_cell_t *) ((const char *) base + h->cells_offset),
+                              (const uint32_t *) ((const char *) base + h->lines_offset));
+  if (!is_valid) {
+    munmap(base, size);
+    return NULL;
+  }
+
+  pve_dump_t *const dump = (pve_dump_t *) malloc(sizeof(pve_dump_t));
+  g_assert(dump);
+  dump->base = base;
+  dump->size = size;
+  dump->header = h;
+  dump->cells = (const pve_dump_cell_t *) ((const char *) base + h->cells_offset);
+  dump->lines = (const uint32_t *) ((const char *) base + h->lines_offset);
+  dump->positions = (const pve_dump_position_t *) ((const char *) base + h->positions_offset);
+  return dump;
+}
 
-  /* Computes usefull pve properties and dimensions. */
-  const ptrdiff_t active_cells_segments_count = from_file_pve.cells_segments_head - from_file_pve.cells_segments;
-  const ptrdiff_t active_lines_segments_count = from_file_pve.lines_segments_head - from_file_pve.lines_segments;
-  const ptrdiff_t cells_in_use_count = from_file_pve.cells_stack_head - from_file_pve.cells_stack;
-  const ptrdiff_t lines_in_use_count = from_file_pve.lines_stack_head - from_file_pve.lines_stack;
+/**
+ * @brief Unmaps the dump view, and frees it.
+ *
+ * @param [in,out] dump the dump view to be released
+ */
+void
+pve_dump_close (pve_dump_t *dump)
+{
+  if (dump) {
+    munmap(dump->base, dump->size);
+    free(dump);
+  }
+}
 
-  /* Allocates the space for the new pve structure. */
-  PVEnv *const pve = (PVEnv *) malloc(sizeof(PVEnv));
-  g_assert(pve);
+/**
+ * @brief Returns the index of the game position in the positions section of the dump.
+ *
+ * @details Positions are sorted by blacks, then whites, then player, the search is a bisection.
+ *
+ * @param [in] dump the dump view
+ * @param [in] gpx  the game position searched
+ * @return          the index of the position, or #PVE_DUMP_NULL_INDEX when missing
+ */
+uint32_t
+pve_dump_find_position (const pve_dump_t *const dump,
+                        const GamePositionX *const gpx)
+{
+  g_assert(dump);
+  g_assert(gpx);
+
+  const pve_dump_position_t key = { .blacks = gpx->blacks, .whites = gpx->whites, .player = gpx->player, .padding = 0 };
+  size_t lo = 0, hi = dump->header->position_count;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (pve_dump_position_cmp(&dump->positions[mid], &key) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo < dump->header->position_count && pve_dump_position_cmp(&dump->positions[lo], &key) == 0) return lo;
+  return PVE_DUMP_NULL_INDEX;
+}
 
-  /* Sets fields from the read structure. */
-  pve->state = from_file_pve.state;
-  pve->root_line = from_file_pve.root_line;
-  pve->cells_size = from_file_pve.cells_size;
-  pve->cells_segments_size = from_file_pve.cells_segments_size;
-  pve->cells_first_size = from_file_pve.cells_first_size;
-  pve->cells_max_usage = from_file_pve.cells_max_usage;
-  pve->lines_size = from_file_pve.lines_size;
-  pve->lines_segments_size = from_file_pve.lines_segments_size;
-  pve->lines_first_size = from_file_pve.lines_first_size;
-  pve->lines_max_usage = from_file_pve.lines_max_usage;
-  pve->line_create_count = from_file_pve.line_create_count;
-  pve->line_delete_count = from_file_pve.line_delete_count;
-  pve->line_add_move_count = from_file_pve.line_add_move_count;
-  pve->line_release_cell_count = from_file_pve.line_release_cell_count;
-
-  /* Allocates the space for the new game position structure. */
-  pve->root_game_position = (GamePositionX *) malloc(sizeof(GamePositionX));
-  g_assert(pve->root_game_position);
-
-  /* Reads the root_game_position structure. */
-  fread_result = fread(pve->root_game_position, sizeof(GamePositionX), 1, fp);
-  g_assert(fread_result == 1);
+/**
+ * @brief Prints the header of the dump view to stream.
+ *
+ * @param [in] dump   the dump view
+ * @param [in] stream the file handler destination of the report
+ */
+void
+pve_dump_summary_to_stream (const pve_dump_t *const dump,
+                            FILE *const stream)
+{
+  g_assert(dump);
+  g_assert(stream);
 
-  /*
-   * *************************************************************************
-   * CELLS_START: reads and sets up cells from here up to the CELLS_END label.
-   * *************************************************************************
-   */
+  const pve_dump_header_t *const h = dump->header;
+  fprintf(stream, "# PVE DUMP HEADER\n");
+  fprintf(stream, "version:                     %20" PRIu32 "  --  Version of the file format.\n", h->version);
+  fprintf(stream, "file_size:                   %20" PRIu64 "  --  Size of the file in bytes.\n", h->file_size);
+  fprintf(stream, "cell_count:                  %20" PRIu64 "  --  Count of cells, shared cells are counted once.\n", h->cell_count);
+  fprintf(stream, "cells_offset:                %20" PRIu64 "  --  Offset of the cells section.\n", h->cells_offset);
+  fprintf(stream, "line_count:                  %20" PRIu64 "  --  Count of lines, the root line and the variants.\n", h->line_count);
+  fprintf(stream, "lines_offset:                %20" PRIu64 "  --  Offset of the lines section.\n", h->lines_offset);
+  fprintf(stream, "position_count:              %20" PRIu64 "  --  Count of unique game positions.\n", h->position_count);
+  fprintf(stream, "positions_offset:            %20" PRIu64 "  --  Offset of the game positions section.\n", h->positions_offset);
+  fprintf(stream, "root_line:                   %20" PRIu32 "  --  Index of the root line.\n", h->root_line);
+  fprintf(stream, "root_position:               %20" PRIu32 "  --  Index of the root game position.\n", h->root_position);
+  fprintf(stream, "cells_max_usage:             %20" PRIu64 "  --  The maximum number of cells in use.\n", h->cells_max_usage);
+  fprintf(stream, "lines_max_usage:             %20" PRIu64 "  --  The maximum number of lines in use.\n", h->lines_max_usage);
+  fprintf(stream, "line_create_count:           %20" PRIu64 "  --  The number of calls to the function pve_line_create().\n", h->line_create_count);
+  fprintf(stream, "line_delete_count:           %20" PRIu64 "  --  The number of calls to the function pve_line_delete().\n", h->line_delete_count);
+  fprintf(stream, "line_add_move_count:         %20" PRIu64 "  --  The number of calls to the function pve_line_add_move().\n", h->line_add_move_count);
+  fprintf(stream, "line_release_cell_count:     %20" PRIu64 "  --  The number of times a cell is released in the pve_line_delete() function.\n", h->line_release_cell_count);
+  fprintf(stream, "line_share_count:            %20" PRIu64 "  --  The number of times a line has been shared in the pve_line_add_move_shared() function.\n", h->line_share_count);
+  fprintf(stream, "\n");
+}
 
-  /*
-   * First it reads the cells segments array from the file.
-   * Then it reads the cells segments sorted array from the file.
-   * Finally it reads the cells segments sorted sizes array from the file.
-   */
-  fread_result = fread(&from_file_cells_segments, sizeof(PVCell *), pve->cells_segments_size, fp);
-  g_assert(fread_result == pve->cells_segments_size);
-  fread_result = fread(&from_file_cells_segments_sorted, sizeof(PVCell *), pve->cells_segments_size, fp);
-  g_assert(fread_result == pve->cells_segments_size);
-  fread_result = fread(&from_file_cells_segments_sorted_sizes, sizeof(size_t), pve->cells_segments_size, fp);
-  g_assert(fread_result == pve->cells_segments_size);
+/**
+ * @brief Prints the root line with variants of the dump view into the given stream.
+ *
+ * @details The output is the same printed by #pve_line_with_variants_to_stream for the dumped pve.
+ *
+ * @param [in] dump   the dump view
+ * @param [in] stream the stream collecting the output
+ */
+void
+pve_dump_line_with_variants_to_stream (const pve_dump_t *const dump,
+                                       FILE *const stream)
+{
+  g_assert(dump);
+  g_assert(stream);
+  pve_dump_walker(dump, stream, false);
+}
 
-  /*
-   * - Allocates space for the cells segments array.
-   * - Set the head pointer at the beginning of the array.
-   * - For the active segments, allocates the proper space for cells,
-   *   read the element data from file, and increment the head pointer.
-   * - Sets the the cells segments element to point to the segment, or null if unsused.
-   */
-  pve->cells_segments = (PVCell **) malloc(sizeof(PVCell *) * pve->cells_segments_size);
-  g_assert(pve->cells_segments);
-  pve->cells_segments_head = pve->cells_segments;
-  for (size_t i = 0; i < pve->cells_segments_size; i++) {
-    PVCell *segment = NULL;
-    if (i < active_cells_segments_count) {
-      size_t segment_size = (size_t) (((i == 0) ? 1 : (1ULL << (i - 1))) * pve->cells_first_size);
-      segment = (PVCell *) malloc(segment_size * sizeof(PVCell));
-      g_assert(segment);
-      fread_result = fread(segment, sizeof(PVCell), segment_size, fp);
-      g_assert(fread_result == segment_size);
-      pve->cells_segments_head++;
-    }
-    *(pve->cells_segments + i) = segment;
-  }
+/**
+ * @brief Prints the root line with variants of the dump view as a table into the given stream.
+ *
+ * @details Identifiers are the dump indexes plus one, zero means no reference.
+ *          Shared cells are printed once, the line that reaches them first owns them,
+ *          the other lines refer to them by the `NEXT_ID` field.
+ *
+ * @param [in] dump   the dump view
+ * @param [in] stream the stream collecting the output
+ */
+void
+pve_dump_root_line_as_table_to_stream (const pve_dump_t *const dump,
+                                       FILE *const stream)
+{
+  g_assert(dump);
+  g_assert(stream);
 
-  /* Prepares the sorted cells segments and the sorted sizes. */
-  pve->cells_segments_sorted_sizes = (size_t *) malloc(sizeof(size_t) * pve->cells_segments_size);
-  g_assert(pve->cells_segments_sorted_sizes);
-  pve->cells_segments_sorted = (PVCell **) malloc(sizeof(PVCell *) * pve->cells_segments_size);
-  g_assert(pve->cells_segments_sorted);
-  for (size_t i = 0; i < pve->cells_segments_size; i++) {
-    *(pve->cells_segments_sorted_sizes + i) = 0;
-    *(pve->cells_segments_sorted + i) = NULL;
-  }
-  pve_sort_cells_segments(pve);
+  fprintf(stream, "%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s\n",
+          "LINE_ID",
+          "MOVE_ID",
+          "VARIANT_ID",
+          "NEXT_ID",
+          "MOVE",
+          "HEAD_LEVEL",
+          "REL_LEVEL",
+          "GP_HASH",
+          "GP_B",
+          "GP_W",
+          "GP_P");
 
-  /*
-   * Allocates the cells stack and load it with the cells read from file.
-   */
-  pve->cells_stack = (PVCell **) malloc(pve->cells_size * sizeof(PVCell *));
-  g_assert(pve->cells_stack);
-  fread_result = fread(pve->cells_stack, sizeof(PVCell *), pve->cells_size, fp);
-  g_assert(fread_result == pve->cells_size);
-  pve->cells_stack_head = pve->cells_stack + cells_in_use_count;
+  pve_dump_walker(dump, stream, true);
+}
 
-  /*
-   * ****************************************
-   * CELLS_END: cells reading completes here.
-   * ****************************************
-   */
+/**
+ * @brief Initializes the cursor on the given dump view.
+ *
+ * @param [out] cursor the cursor to be initialized
+ * @param [in]  dump   the dump view
+ */
+void
+pve_dump_cursor_init (pve_dump_cursor_t *const cursor,
+                      const pve_dump_t *const dump)
+{
+  g_assert(cursor);
+  g_assert(dump);
+  cursor->dump = dump;
+  cursor->depth = 0;
+  cursor->line_count = 0;
+  cursor->is_started = false;
+}
 
-  /*
-   * *************************************************************************
-   * LINES_START: reads and sets up lines from here up to the LINES_END label.
-   * *************************************************************************
-   */
+/**
+ * @brief Advances the cursor to the next complete line.
+ *
+ * @details The first call positions the cursor on the first line.
+ *          The next line is found by replacing the deepest move that has a greater alternative
+ *          with the smallest of them, and then by following the smallest alternatives down to the end of the line.
+ *
+ *          A line longer than #PV_MAX_LENGTH ends the iteration, the same as when lines are exhausted.
+ *
+ * @param [in,out] cursor the cursor
+ * @return                true when the cursor is positioned on a line, false when lines are exhausted
+ */
+bool
+pve_dump_cursor_next (pve_dump_cursor_t *const cursor)
+{
+  g_assert(cursor);
 
-  /*
-   * First it reads the lines segments array from the file.
-   * Then it reads the lines segments sorted array from the file.
-   * Finally it reads the lines segments sorted sizes array from the file.
-   */
-  fread_result = fread(&from_file_lines_segments, sizeof(PVCell **), pve->lines_segments_size, fp);
-  g_assert(fread_result == pve->lines_segments_size);
-  fread_result = fread(&from_file_lines_segments_sorted, sizeof(PVCell **), pve->lines_segments_size, fp);
-  g_assert(fread_result == pve->lines_segments_size);
-  fread_result = fread(&from_file_lines_segments_sorted_sizes, sizeof(size_t), pve->lines_segments_size, fp);
-  g_assert(fread_result == pve->lines_segments_size);
+  const pve_dump_t *const dump = cursor->dump;
+  uint32_t head;
 
-  /*
-   * - Allocates space for the lines segments array.
-   * - Set the head pointer at the beginning of the array.
-   * - For the active segments, allocates the proper space for lines,
-   *   read the element data from file, and increment the head pointer.
-   * - Sets the the lines segments element to point to the segment, or null if unsused.
-   */
-  pve->lines_segments = (PVCell ***) malloc(sizeof(PVCell **) * pve->lines_segments_size);
-  g_assert(pve->lines_segments);
-  pve->lines_segments_head = pve->lines_segments;
-  for (size_t i = 0; i < pve->lines_segments_size; i++) {
-    PVCell **segment = NULL;
-    if (i < active_lines_segments_count) {
-      size_t segment_size = (size_t) (((i == 0) ? 1 : (1ULL << (i - 1))) * pve->lines_first_size);
-      segment = (PVCell **) malloc(segment_size * sizeof(PVCell *));
-      g_assert(segment);
-      fread_result = fread(segment, sizeof(PVCell *), segment_size, fp);
-      g_assert(fread_result == segment_size);
-      pve->lines_segments_head++;
+  if (!cursor->is_started) {
+    cursor->is_started = true;
+    head = dump->lines[dump->header->root_line];
+    if (head == PVE_DUMP_NULL_INDEX) return false;
+  } else {
+    uint32_t alternative = PVE_DUMP_NULL_INDEX;
+    while (cursor->depth) {
+      const size_t d = cursor->depth - 1;
+      alternative = pve_dump_smallest_alternative(dump, cursor->heads[d], dump->cells[cursor->cells[d]].move);
+      if (alternative != PVE_DUMP_NULL_INDEX) break;
+      cursor->depth--;
     }
-    *(pve->lines_segments + i) = segment;
+    if (alternative == PVE_DUMP_NULL_INDEX) return false;
+    cursor->cells[cursor->depth - 1] = alternative;
+    head = dump->cells[alternative].next;
   }
 
-  /* Prepares the sorted lines segments and the sorted sizes. */
-  pve->lines_segments_sorted_sizes = (size_t *) malloc(sizeof(size_t) * pve->lines_segments_size);
-  g_assert(pve->lines_segments_sorted_sizes);
-  pve->lines_segments_sorted = (PVCell ***) malloc(sizeof(PVCell **) * pve->lines_segments_size);
-  g_assert(pve->lines_segments_sorted);
-  for (size_t i = 0; i < pve->lines_segments_size; i++) {
-    *(pve->lines_segments_sorted_sizes + i) = 0;
-    *(pve->lines_segments_sorted + i) = NULL;
+  while (head != PVE_DUMP_NULL_INDEX) {
+    if (cursor->depth == PV_MAX_LENGTH) return false;
+    const uint32_t cell = pve_dump_smallest_alternative(dump, head, -1);
+    cursor->heads[cursor->depth] = head;
+    cursor->cells[cursor->depth] = cell;
+    cursor->depth++;
+    head = dump->cells[cell].next;
   }
-  pve_sort_lines_segments(pve);
 
-  /*
-   * Allocates the lines stack and load it with the lines read from file.
-   */
-  pve->lines_stack = (PVCell ***) malloc(pve->lines_size * sizeof(PVCell **));
-  g_assert(pve->lines_stack);
-  fread_result = fread(pve->lines_stack, sizeof(PVCell **), pve->lines_size, fp);
-  g_assert(fread_result == pve->lines_size);
-  pve->lines_stack_head = pve->lines_stack + lines_in_use_count;
+  cursor->line_count++;
+  return true;
+}
 
-  /*
-   * ****************************************
-   * LINES_END: lines reading completes here.
-   * ****************************************
-   */
+/**
+ * @brief Prints all the complete lines of the dump view, one for each row, into the given stream.
+ *
+ * @details Lines are streamed by a #pve_dump_cursor_t, in lexicographic order.
+ *          When `as_csv` is true, each row has the line number, the line length, the moves,
+ *          and the final game position.
+ *
+ * @param [in] dump   the dump view
+ * @param [in] stream the stream collecting the output
+ * @param [in] as_csv selects the csv format
+ */
+void
+pve_dump_lines_to_stream (const pve_dump_t *const dump,
+                          FILE *const stream,
+                          const bool as_csv)
+{
+  g_assert(dump);
+  g_assert(stream);
 
-  /*
-   * *************************************************************************************************
-   * ADDRESS_TRANSLATION_START: pointer translation from here up to the ADDRESS_TRANSLATION_END label.
-   * *************************************************************************************************
-   */
+  pve_dump_cursor_t cursor;
+  pve_dump_cursor_init(&cursor, dump);
 
-  /*
-   * First step is about generating the mappings between sorted and unsorted segments.
-   * Cells first and then lines.
-   */
-  size_t from_file_cells_segments_sorted_map[PVE_LOAD_DUMP_CELLS_SEGMENTS_SIZE];
-  size_t from_file_lines_segments_sorted_map[PVE_LOAD_DUMP_LINES_SEGMENTS_SIZE];
+  if (as_csv) fprintf(stream, "%s;%s;%s;%s;%s;%s\n", "LINE_ID", "LINE_LENGTH", "MOVES", "GP_B", "GP_W", "GP_P");
 
-  pve_populate_segments_sorted_map(from_file_cells_segments_sorted_map,
-                                   active_cells_segments_count,
-                                   (const void ** const) from_file_cells_segments,
-                                   (const void ** const) from_file_cells_segments_sorted);
+  while (pve_dump_cursor_next(&cursor)) {
+    if (as_csv) fprintf(stream, "%" PRIu64 ";%zu;", cursor.line_count, cursor.depth);
+    for (size_t i = 0; i < cursor.depth; i++) {
+      fprintf(stream, "%s%s", (i == 0) ? "" : " ", square_as_move_to_string(dump->cells[cursor.cells[i]].move));
+    }
+    if (as_csv) {
+      const pve_dump_position_t *const p = (cursor.depth == 0) ?
+        &dump->positions[dump->header->root_position] :
+        &dump->positions[dump->cells[cursor.cells[cursor.depth - 1]].position];
+      fprintf(stream, ";%+20" PRId64 ";%+20" PRId64 ";%1d", (int64_t) p->blacks, (int64_t) p->whites, (int) p->player);
+    }
+    fprintf(stream, "\n");
+  }
+}
 
-  pve_populate_segments_sorted_map(from_file_lines_segments_sorted_map,
-                                   active_lines_segments_count,
-                                   (const void ** const) from_file_lines_segments,
-                                   (const void ** const) from_file_lines_segments_sorted);
+/**
+ * @brief Loads the pve structure from a binary file.
+ *
+ * @details Reads a binary file previously written by calling the function #pve_dump_to_binary_file.
+ *          The structure is rebuilt cell by cell, shared cells are shared again.
+ *          The statistics counters are restored from the file header.
+ *          Printing the PV doesn't require the structure, see #pve_dump_open.
+ *
+ * @param [in] in_file_path the path of the input file
+ * @return                  the pve stucture loaded from file, or `NULL` when the file is not a valid dump
+ */
+PVEnv *
+pve_load_from_binary_file (const char *const in_file_path)
+{
+  g_assert(in_file_path);
 
-  /*
-   * There are six address translation to execute:
-   *
-   * - The root_line field.
-   * - The field next in all cells. It is a pointer to another cell.
-   * - The field variant in all cells. It is a pointer to a line.
-   * - The "field" first_cell in all lines (lines are just pointers, not structures, ut conceptually ...).
-   *   It is a pointer to a cell.
-   * - The cells stack is composed by cell references.
-   * - The lines stack is composed by line references.
-   */
+  pve_dump_t *const dump = pve_dump_open(in_file_path);
+  if (!dump) return NULL;
 
-  /* Translates the root_line field. */
-  PVCell **translated_rl = pve_translate_ref(active_lines_segments_count,
-                                             from_file_lines_segments_sorted_sizes,
-                                             sizeof(PVCell *),
-                                             from_file_lines_segments_sorted_map,
-                                             (void **) from_file_lines_segments_sorted,
-                                             (void **) pve->lines_segments,
-                                             pve->root_line);
-  if (translated_rl) {
-    pve->root_line = translated_rl;
-  } else {
-    fprintf(stderr, "Error in translating address element for line address: pve->root_line=%p\n", (void *) pve->root_line);
-    abort();
-  }
+  const pve_dump_header_t *const h = dump->header;
+  const pve_dump_position_t *const rp = &dump->positions[h->root_position];
+  const GamePositionX root = { .blacks = rp->blacks, .whites = rp->whites, .player = rp->player };
+  PVEnv *const pve = pve_new(&root);
 
-  /*
-   * Computes and executes address translation for cell->next and cell->variant fields in all cell segments.
-   */
-  for (PVCell **segment_p = pve->cells_segments; segment_p < pve->cells_segments_head; segment_p++) {
-    PVCell *const segment = *segment_p;
-    const ptrdiff_t i = segment_p - pve->cells_segments;
-    const size_t segment_size = ((i == 0) ? 1 : (1ULL << (i - 1))) * pve->cells_first_size;
-    for (size_t j = 0; j < segment_size; j++) {
-      PVCell *c = segment + j;
-      g_assert(c);
-      if (c->next) {
-        PVCell *translated_element = pve_translate_ref(active_cells_segments_count,
-                                                       from_file_cells_segments_sorted_sizes,
-                                                       sizeof(PVCell),
-                                                       from_file_cells_segments_sorted_map,
-                                                       (void **) from_file_cells_segments_sorted,
-                                                       (void **) pve->cells_segments,
-                                                       c->next);
-        if (translated_element) {
-          c->next = translated_element;
-        } else {
-          fprintf(stderr, "Error in translating address element for cell address: c->next=%p\n", (void *) c->next);
-          abort();
-        }
-      }
-      if (c->variant) {
-        PVCell **translated_element = pve_translate_ref(active_lines_segments_count,
-                                                        from_file_lines_segments_sorted_sizes,
-                                                        sizeof(PVCell *),
-                                                        from_file_lines_segments_sorted_map,
-                                                        (void **) from_file_lines_segments_sorted,
-                                                        (void **) pve->lines_segments,
-                                                        c->variant);
-        if (translated_element) {
-          c->variant = translated_element;
-        } else {
-          fprintf(stderr, "Error in translating address element for line address: c->variant=%p\n", (void *) c->variant);
-          abort();
-        }
-      }
-    }
-  }
+  PVCell **const cell_map = (PVCell **) calloc(h->cell_count ? h->cell_count : 1, sizeof(PVCell *));
+  pve_dump_buffer_t stack = { NULL, 0, 0, sizeof(pve_dump_line_ref_t) };
+  g_assert(cell_map);
 
-  /*
-   * Computes and executes address translation for "first cell" fields in all line segments.
-   */
-  for (PVCell ***segment_p = pve->lines_segments; segment_p < pve->lines_segments_head; segment_p++) {
-    PVCell **const segment = *segment_p;
-    const ptrdiff_t i = segment_p - pve->lines_segments;
-    const size_t segment_size = ((i == 0) ? 1 : (1ULL << (i - 1))) * pve->lines_first_size;
-    for (size_t j = 0; j < segment_size; j++) {
-      PVCell **line = segment + j;
-      g_assert(line);
-      if (*line) {
-        PVCell *translated_element = pve_translate_ref(active_cells_segments_count,
-                                                       from_file_cells_segments_sorted_sizes,
-                                                       sizeof(PVCell),
-                                                       from_file_cells_segments_sorted_map,
-                                                       (void **) from_file_cells_segments_sorted,
-                                                       (void **) pve->cells_segments,
-                                                       *line);
-        if (translated_element) {
-          *line = translated_element;
-        } else {
-          fprintf(stderr, "Error in translating address element for cell address: *line=%p\n", (void *) *line);
-          abort();
-        }
-      }
-    }
-  }
+  pve_dump_line_ref_t *const root_ref = pve_dump_buffer_push(&stack);
+  root_ref->line = pve->root_line;
+  root_ref->index = h->root_line;
 
   /*
-   * Executes address translation for cells stack elements.
+   * Cells are prepended to lines, so the cells of a line are collected first,
+   * and then created backward, starting from the last one or from the first already created, being shared.
    */
-  for (size_t i = 0; i < pve->cells_size; i++) {
-    PVCell **element_ptr = pve->cells_stack + i;
-    if (*element_ptr) {
-      PVCell *translated_element = pve_translate_ref(active_cells_segments_count,
-                                                     from_file_cells_segments_sorted_sizes,
-                                                     sizeof(PVCell),
-                                                     from_file_cells_segments_sorted_map,
-                                                     (void **) from_file_cells_segments_sorted,
-                                                     (void **) pve->cells_segments,
-                                                     *element_ptr);
-      if (translated_element) {
-        *element_ptr = translated_element;
-      } else {
-        fprintf(stderr, "Error in translating address ref in cells stack: *element_ptr=%p\n", (void *) *element_ptr);
-        abort();
-      }
+  while (stack.count) {
+    const pve_dump_line_ref_t ref = ((pve_dump_line_ref_t *) stack.data)[--stack.count];
+    uint32_t chain[PV_MAX_LENGTH];
+    size_t chain_length = 0;
+    uint32_t i = dump->lines[ref.index];
+    while (i != PVE_DUMP_NULL_INDEX && !cell_map[i]) {
+      g_assert(chain_length < PV_MAX_LENGTH);
+      chain[chain_length++] = i;
+      i = dump->cells[i].next;
     }
-  }
-
-  /*
-   * Executes address translation for lines stack elements.
-   */
-  for (size_t i = 0; i < pve->lines_size; i++) {
-    PVCell ***element_ptr = pve->lines_stack + i;
-    if (*element_ptr) {
-      PVCell **translated_element = pve_translate_ref(active_lines_segments_count,
-                                                      from_file_lines_segments_sorted_sizes,
-                                                      sizeof(PVCell *),
-                                                      from_file_lines_segments_sorted_map,
-                                                      (void **) from_file_lines_segments_sorted,
-                                                      (void **) pve->lines_segments,
-                                                      *element_ptr);
-      if (translated_element) {
-        *element_ptr = translated_element;
-      } else {
-        fprintf(stderr, "Error in translating address ref in lines stack: *element_ptr=%p\n", (void *) *element_ptr);
-        abort();
+    PVCell *next = NULL;
+    if (i != PVE_DUMP_NULL_INDEX) {
+      next = cell_map[i];
+      pve_cell_ref(next);
+    }
+    while (chain_length) {
+      const uint32_t k = chain[--chain_length];
+      const pve_dump_cell_t *const dc = &dump->cells[k];
+      const pve_dump_position_t *const p = &dump->positions[dc->position];
+      const GamePositionX gpx = { .blacks = p->blacks, .whites = p->whites, .player = p->player };
+      PVCell *const c = pve_cell_new(pve, dc->move, &gpx);
+      c->next = pve_cell_to_index(pve, next);
+      if (dc->variant != PVE_DUMP_NULL_INDEX) {
+        PVCell **const variant = pve_line_create(pve);
+        c->variant = pve_line_to_index(pve, variant);
+        pve_dump_line_ref_t *const v = pve_dump_buffer_push(&stack);
+        v->line = variant;
+        v->index = dc->variant;
       }
+      cell_map[k] = c;
+      next = c;
     }
+    *ref.line = next;
   }
 
-  /*
-   * ************************************************************
-   * ADDRESS_TRANSLATION_END: pointer translation completes here.
-   * ************************************************************
-   */
+  pve->cells->max_used_count = h->cells_max_usage;
+  pve->lines->max_used_count = h->lines_max_usage;
+  pve->line_create_count = h->line_create_count;
+  pve->line_delete_count = h->line_delete_count;
+  pve->line_add_move_count = h->line_add_move_count;
+  pve->line_release_cell_count = h->line_release_cell_count;
+  pve->line_share_count = h->line_share_count;
 
-  int fclose_ret = fclose(fp);
-  g_assert(fclose_ret == 0);
-  (void) fclose_ret;
+  free(stack.data);
+  free(cell_map);
+  pve_dump_close(dump);
 
   return pve;
 }
@@ -1815,52 +1899,13 @@ pve_summary_from_binary_file_to_stream (const char *const in_file_path,
 {
   g_assert(in_file_path);
 
-  int fread_result;
-  PVEnv pve;
-
-  /* Opens the binary file for reading. */
-  FILE *fp = fopen(in_file_path, "r");
-  g_assert(fp);
-
-  /* Reads the pve structure from the file. */
-  fread_result = fread(&pve, sizeof(PVEnv), 1, fp);
-  g_assert(fread_result == 1);
-  (void) fread_result;
-
-  fprintf(stream, "# PVE STRUCTURE HEADER\n");
-  fprintf(stream, "state:                         0x%016lx  --  The internal state of the structure.\n", pve.state);
-  fprintf(stream, "root_game_position:          %20p  --  Root game position.\n", (void *) pve.root_game_position);
-  fprintf(stream, "root_line:                   %20p  --  Root line.\n", (void *) pve.root_line);
-  fprintf(stream, "cells_size:                  %20zu  --  Count of cells contained by the cells segments.\n", pve.cells_size);
-  fprintf(stream, "cells_segments_size:         %20zu  --  Count of cells segments.\n", pve.cells_segments_size);
-  fprintf(stream, "cells_first_size:            %20zu  --  Number of cells contained by the first segment.\n", pve.cells_first_size);
-  fprintf(stream, "cells_segments:              %20p  --  Segments are pointers to array of cells.\n", (void *) pve.cells_segments);
-  fprintf(stream, "cells_segments_head:         %20p  --  Next cells segment to be used.\n", (void *) pve.cells_segments_head);
-  fprintf(stream, "cells_segments_sorted_sizes: %20p  --  Array of sizes of cells segments in the sorted order.\n", (void *) pve.cells_segments_sorted_sizes);
-  fprintf(stream, "cells_segments_sorted:       %20p  --  Sorted cells segments, by means of the natural order of the memory adress.\n", (void *) pve.cells_segments_sorted);
-  fprintf(stream, "cells_stack:                 %20p  --  Array of pointers used to manage the cells.\n", (void *) pve.cells_stack);
-  fprintf(stream, "cells_stack_head:            %20p  --  Next, free to be assigned, pointer in the cells stack.\n", (void *) pve.cells_stack_head);
-  fprintf(stream, "cells_max_usage:             %20zu  --  The maximum number of cells in use.\n", pve.cells_max_usage);
-  fprintf(stream, "lines_size:                  %20zu  --  Count of lines contained by the lines segments.\n", pve.lines_size);
-  fprintf(stream, "lines_segments_size:         %20zu  --  Count of lines segments.\n", pve.lines_segments_size);
-  fprintf(stream, "lines_first_size:            %20zu  --  Number of lines contained by the first segment.\n", pve.lines_first_size);
-  fprintf(stream, "lines_segments:              %20p  --  Segments are pointers to array of lines.\n", (void *) pve.lines_segments);
-  fprintf(stream, "lines_segments_head:         %20p  --  Next lines segment to be used.\n", (void *) pve.lines_segments_head);
-  fprintf(stream, "lines_segments_sorted_sizes: %20p  --  Array of sizes of lines segments in the sorted order.\n", (void *) pve.lines_segments_sorted_sizes);
-  fprintf(stream, "lines_segments_sorted:       %20p  --  Sorted lines segments, by means of the natural order of the memory adress.\n", (void *) pve.lines_segments_sorted);
-  fprintf(stream, "lines_stack:                 %20p  --  Array of pointers used to manage the lines.\n", (void *) pve.lines_stack);
-  fprintf(stream, "lines_stack_head:            %20p  --  Next, free to be assigned, pointer in the lines stack.\n", (void *) pve.lines_stack_head);
-  fprintf(stream, "lines_max_usage:             %20zu  --  The maximum number of lines in use.\n", pve.lines_max_usage);
-  fprintf(stream, "line_create_count:           %20zu  --  The number of calls to the function pve_line_create().\n", pve.line_create_count);
-  fprintf(stream, "line_delete_count:           %20zu  --  The number of calls to the function pve_line_delete().\n", pve.line_delete_count);
-  fprintf(stream, "line_add_move_count:         %20zu  --  The number of calls to the function pve_line_add_move().\n", pve.line_add_move_count);
-  fprintf(stream, "line_release_cell_count:     %20zu  --  The number of times a cell is released in the pve_line_delete() function.\n", pve.line_release_cell_count);
-  fprintf(stream, "\n");
-
-  /* Closes the input file. */
-  int fclose_ret = fclose(fp);
-  g_assert(fclose_ret == 0);
-  (void) fclose_ret;
+  pve_dump_t *const dump = pve_dump_open(in_file_path);
+  if (!dump) {
+    fprintf(stream, "File \"%s\" is not a valid PVE dump.\n", in_file_path);
+    return;
+  }
+  pve_dump_summary_to_stream(dump, stream);
+  pve_dump_close(dump);
 }
 
 /**
@@ -1904,58 +1949,42 @@ pve_transform_to_standard_form(PVEnv *const pve)
      * during the iteration.
      * The current line pointer is set at the beginning of each iteration and is then used safely.
      */
-    PVCell **cp = *line_stack_header;
+    PVCell *c = **line_stack_header;
 
     /* Cycles over the moves of the line. If the move has a variant it is pushed on the stack of lines. */
-    while (*cp) {
-      PVCell **next_cp = NULL;
-      if ((*cp)->variant) {
+    while (c) {
+      if (c->variant != PVE_NULL_INDEX) {
 
-        *line_stack_header++ = (*cp)->variant;
+        *line_stack_header++ = pve_line_at(pve, c->variant);
 
         /*
          * Picks the smaller value [A1, B1, ... H8] and exchange it with the current PVCell.
          */
 
-        PVCell **firstp = cp;
-        PVCell **vp = cp;
-        while (vp) {
-          printf("%s  ", square_as_move_to_string((*vp)->move));
-          if ((*vp)->move < (*firstp)->move) firstp = vp;
-          vp = (*vp)->variant;
+        PVCell *first = c;
+        for (PVCell *v = c; v; ) {
+          printf("%s  ", square_as_move_to_string(v->move));
+          if (v->move < first->move) first = v;
+          PVCell **const v_line = pve_line_at(pve, v->variant);
+          v = v_line ? *v_line : NULL;
         }
-        printf("----  %s", square_as_move_to_string((*firstp)->move));
-
-        if (*firstp != *cp) {
-          /* We need to exchange the next field of the cell pointing to c,
-           * or the line pointer when c is the first cell in the line, with
-           * the line pointer of the choosen variant.
-           * Tricky ... we need a further level of indirection .... YES ONE MORE!
-           *
-           * Moving firstp on behalf of cp is fine, but pushing the variant line on the stack needs to be aware of this.
-           */
-          printf(" -> swap (*cp)->move=%s AND (*firstp)->move=%s\n", square_as_move_to_string((*cp)->move), square_as_move_to_string((*firstp)->move));
-          printf("  ..  ..  cp=%p, firstp=%p, *cp=%p, *firstp=%p\n", (void *) cp, (void *) firstp, (void *) *cp, (void *) *firstp);
-
-          PVCell *tmp = *cp;
-          *cp = *firstp;
-          *firstp = tmp;
-
-          pve_internals_to_stream(pve, stdout, 0x0020);
-          printf("  ..  ..  cp=%p, firstp=%p, *cp=%p, *firstp=%p\n", (void *) cp, (void *) firstp, (void *) *cp, (void *) *firstp);
-          abort();
+        printf("----  %s", square_as_move_to_string(first->move));
 
+        if (first != c) {
           /*
-           * Variants has to be swapped!!!! !!!! !!! !! !
+           * The line slot, or the next field of the previous cell, has to point to the choosen variant,
+           * and variants has to be swapped.
            */
-
+          printf(" -> swap c->move=%s AND first->move=%s\n", square_as_move_to_string(c->move), square_as_move_to_string(first->move));
+          printf("  ..  ..  c=%" PRId64 ", first=%" PRId64 "\n", pve_index_to_int64(pve_cell_to_index(pve, c)), pve_index_to_int64(pve_cell_to_index(pve, first)));
+          pve_internals_to_stream(pve, stdout, 0x0020);
+          abort();
         } else {
           printf(" -> ok\n");
         }
 
       }
-      if (!next_cp) next_cp = &(*cp)->next;
-      cp = next_cp;
+      c = pve_cell_at(pve, c->next);
       count++;
     }
   }
@@ -1964,6 +1993,146 @@ pve_transform_to_standard_form(PVEnv *const pve)
 }
 
 
+
+/****************************************************************/
+/* Function implementations for the search_checkpoint_t entity. */
+/****************************************************************/
+
+/**
+ * @brief Returns the path of the PVE dump belonging to a checkpoint.
+ *
+ * @details The returned string has to be freed by the caller by calling `g_free`.
+ *
+ * @param [in] file_path           the path of the checkpoint file
+ * @param [in] searched_move_count the field of the checkpoint
+ * @return                         the path of the PVE dump
+ */
+char *
+search_checkpoint_pve_file_path (const char *const file_path,
+                                 const uint32_t searched_move_count)
+{
+  g_assert(file_path);
+  return g_strdup_printf("%s.%" PRIu32 ".pve", file_path, searched_move_count);
+}
+
+/**
+ * @brief Writes a search checkpoint.
+ *
+ * @details The PVE, when not `NULL`, is dumped first, then the checkpoint file is written
+ *          to a temporary file, and renamed over the previous one.
+ *          The dump of the previous checkpoint, if any, is then removed.
+ *          When the PVE dump fails, the function returns false, and the previous checkpoint
+ *          and its dump are left untouched.
+ *          The field `pve_line_add_move_count` is assigned by the function.
+ *
+ * @param [in] file_path  the path of the checkpoint file
+ * @param [in] checkpoint the search state
+ * @param [in] pve        the PVE having the best line of the root node as root line, or `NULL`
+ * @return                true when the checkpoint file has been replaced
+ */
+bool
+search_checkpoint_write (const char *const file_path,
+                         const search_checkpoint_t *const checkpoint,
+                         const PVEnv *const pve)
+{
+  g_assert(file_path);
+  g_assert(checkpoint);
+
+  search_checkpoint_t c = *checkpoint;
+  memcpy(c.magic, SEARCH_CHECKPOINT_MAGIC, sizeof(c.magic));
+  c.version = SEARCH_CHECKPOINT_VERSION;
+  c.pve_line_add_move_count = pve ? pve->line_add_move_count : 0;
+
+  if (pve) {
+    char *const pve_file_path = search_checkpoint_pve_file_path(file_path, c.searched_move_count);
+    const bool is_dumped = pve_dump_to_binary_file(pve, pve_file_path);
+    g_free(pve_file_path);
+    if (!is_dumped) return false;
+  }
+
+  char *const tmp_file_path = g_strdup_printf("%s.tmp", file_path);
+  FILE *const fp = fopen(tmp_file_path, "w");
+  bool is_written = fp && fwrite(&c, sizeof(search_checkpoint_t), 1, fp) == 1;
+  if (fp && fclose(fp) != 0) is_written = false;
+  if (is_written) is_written = rename(tmp_file_path, file_path) == 0;
+  g_free(tmp_file_path);
+  if (!is_written) return false;
+
+  if (pve && c.searched_move_count > 0) {
+    char *const old_pve_file_path = search_checkpoint_pve_file_path(file_path, c.searched_move_count - 1);
+    remove(old_pve_file_path);
+    g_free(old_pve_file_path);
+  }
+
+  return true;
+}
+
+/**
+ * @brief Reads a search checkpoint.
+ *
+ * @details The checkpoint is valid when the file is complete, has the expected magic string
+ *          and version, and, when the PV is recorded, its PVE dump is valid and matches it.
+ *
+ * @param [in]  file_path  the path of the checkpoint file
+ * @param [out] checkpoint the search state
+ * @return                 true when the checkpoint is read and valid
+ */
+bool
+search_checkpoint_read (const char *const file_path,
+                        search_checkpoint_t *const checkpoint)
+{
+  g_assert(file_path);
+  g_assert(checkpoint);
+
+  FILE *fp = fopen(file_path, "r");
+  if (!fp) return false;
+  const size_t n = fread(checkpoint, sizeof(search_checkpoint_t), 1, fp);
+  fclose(fp);
+  if (n != 1 ||
+      memcmp(checkpoint->magic, SEARCH_CHECKPOINT_MAGIC, sizeof(checkpoint->magic)) != 0 ||
+      checkpoint->version != SEARCH_CHECKPOINT_VERSION ||
+      memchr(checkpoint->solver, '\0', sizeof(checkpoint->solver)) == NULL)
+    return false;
+
+  if (checkpoint->pv_flags & SEARCH_CHECKPOINT_PV_RECORDING) {
+    char *const pve_file_path = search_checkpoint_pve_file_path(file_path, checkpoint->searched_move_count);
+    pve_dump_t *const dump = pve_dump_open(pve_file_path);
+    g_free(pve_file_path);
+    if (!dump) return false;
+    const bool is_matching = dump->header->line_add_move_count == checkpoint->pve_line_add_move_count;
+    pve_dump_close(dump);
+    if (!is_matching) return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Loads the PVE saved by a search checkpoint.
+ *
+ * @details The root line of the returned PVE is the best line of the root node.
+ *          The index of the shared lines is not saved, lines searched after the resume
+ *          are not shared with the loaded ones.
+ *
+ * @param [in] file_path  the path of the checkpoint file
+ * @param [in] checkpoint the search state, as returned by #search_checkpoint_read
+ * @return                the loaded PVE, or `NULL` when the dump is not valid
+ */
+PVEnv *
+search_checkpoint_load_pve (const char *const file_path,
+                            const search_checkpoint_t *const checkpoint)
+{
+  g_assert(file_path);
+  g_assert(checkpoint);
+  g_assert(checkpoint->pv_flags & SEARCH_CHECKPOINT_PV_RECORDING);
+
+  char *const pve_file_path = search_checkpoint_pve_file_path(file_path, checkpoint->searched_move_count);
+  PVEnv *const pve = pve_load_from_binary_file(pve_file_path);
+  g_free(pve_file_path);
+  return pve;
+}
+
+
 /*******************************************************/
 /* Function implementations for the SearchNode entity. */
 /*******************************************************/
@@ -2147,279 +2316,443 @@ gts_generate_moves (GameTreeStack *const stack);
  */
 
 /**
- * @brief Doubles the cell count in the PV environment.
+ * @brief Takes a cell from the arena, and fills it with the move and the game position.
  *
- * @param [in,out] pve the principal variation environment pointer
+ * @details The cell is returned with a reference count of one, and is unlinked.
+ *          The game position is registered into the game position table.
+ *
+ * @param [in,out] pve  a pointer to the principal variation environment
+ * @param [in]     move the move value
+ * @param [in]     gpx  the game position after the move
+ * @return              the new cell
  */
-static void
-pve_double_cells_size (PVEnv *const pve)
+static PVCell *
+pve_cell_new (PVEnv *pve,
+              const Square move,
+              const GamePositionX *const gpx)
 {
-  g_assert(pve);
-
-  /* Doubleing cells_size can occur only if the stack is fully used. */
-  g_assert(pve->cells_size == pve->cells_stack_head - pve->cells_stack);
+  PVCell *cell = pve_cell_at(pve, mem_obj_alloc_index(pve->cells));
+  cell->move = move;
+  cell->ref_count = 1;
+  cell->next = PVE_NULL_INDEX;
+  cell->variant = PVE_NULL_INDEX;
+  cell->position = pve_position_acquire(pve, gpx);
+
+  return cell;
+}
 
-  /* The number of cells segments cannot grow further than the limit. */
-  size_t cells_segments_used = pve->cells_segments_head - pve->cells_segments;
-  g_assert(pve->cells_segments_size > cells_segments_used);
+/*
+ * Returns the index of the cell, or PVE_NULL_INDEX when cell is NULL.
+ */
+static uint32_t
+pve_cell_to_index (const PVEnv *const pve,
+                   const PVCell *const cell)
+{
+  if (!cell) return PVE_NULL_INDEX;
+  return mem_obj_index_of(pve->cells, cell);
+}
 
-  const size_t actual_cells_size = pve->cells_size;
-  const size_t cells_size_extension = pve->cells_size;
+/*
+ * Returns the index of the line, or PVE_NULL_INDEX when line is NULL.
+ */
+static uint32_t
+pve_line_to_index (const PVEnv *const pve,
+                   PVCell **const line)
+{
+  if (!line) return PVE_NULL_INDEX;
+  return mem_obj_index_of(pve->lines, line);
+}
 
-  /* Prepares the extension segment of cells. */
-  PVCell *cells_extension = (PVCell *) malloc(cells_size_extension * sizeof(PVCell));
-  g_assert(cells_extension);
-  *(pve->cells_segments_head) = cells_extension;
-  pve->cells_segments_head++;
-  cells_segments_used++;
-  pve->cells_size += cells_size_extension;
-  for (size_t i = 0; i < cells_size_extension; i++) {
-    (cells_extension + i)->move = invalid_move;
-    (cells_extension + i)->is_active = FALSE;
-    (cells_extension + i)->next = NULL;
-    (cells_extension + i)->variant = NULL;
+/*
+ * Increments the reference count of the cell, the count is held in 24 bits.
+ */
+static inline void
+pve_cell_ref (PVCell *const cell)
+{
+  if (cell->ref_count == PVE_CELL_MAX_REF_COUNT) {
+    fprintf(stderr, "PVCell reference count overflow.\n");
+    abort();
   }
+  cell->ref_count++;
+}
 
-  /* Creates the new cells stack and load it with the cells held in the extension segment. */
-  PVCell **new_cells_stack = (PVCell **) malloc(pve->cells_size * sizeof(PVCell *));
-  g_assert(new_cells_stack);
-  free(pve->cells_stack);
-  pve->cells_stack = new_cells_stack;
-  for (size_t i = 0; i < actual_cells_size; i++) {
-    *(pve->cells_stack + i) = NULL;
-  }
-  for (size_t i = 0; i < cells_size_extension; i++) {
-    *(pve->cells_stack + actual_cells_size + i) = cells_extension + i;
-  }
-  pve->cells_stack_head = pve->cells_stack + actual_cells_size;
+/*
+ * Returns the index as a signed value, PVE_NULL_INDEX is mapped to -1.
+ */
+static inline int64_t
+pve_index_to_int64 (const uint32_t index)
+{
+  return index == PVE_NULL_INDEX ? -1 : (int64_t) index;
+}
+
+/*
+ * Returns the hash value of the game position, it is well distributed on all the bits.
+ */
+static inline uint64_t
+pve_gpx_hash (const GamePositionX *const gpx)
+{
+  uint64_t h = (gpx->blacks * 0x9e3779b97f4a7c15ULL) ^ (gpx->whites * 0xc2b2ae3d27d4eb4fULL) ^ gpx->player;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
 
-  /* Re-compute the sorted cells segments array, and respective sizes. */
-  pve_sort_cells_segments(pve);
+/*
+ * Returns true when the two game positions are equal.
+ */
+static inline bool
+pve_gpx_equal (const GamePositionX *const a,
+               const GamePositionX *const b)
+{
+  return a->blacks == b->blacks && a->whites == b->whites && a->player == b->player;
 }
 
-/**
- * @brief Doubles the line count in the PV environment.
- *
- * @param [in,out] pve the principal variation environment pointer
+/*
+ * The hs_item_hash_f function of the positions index, items are indexes into the positions table.
  */
-static void
-pve_double_lines_size (PVEnv *const pve)
+static uint64_t
+pve_position_hash (const void *item,
+                   void *param)
 {
-  g_assert(pve);
+  const PVEnv *const pve = (PVEnv *) param;
+  return pve_gpx_hash(&pve->positions[*(const uint32_t *) item].gpx);
+}
 
-  /* Doubleing lines_size can occur only if the stack is fully used. */
-  g_assert(pve->lines_size == pve->lines_stack_head - pve->lines_stack);
+/*
+ * The hs_item_equal_f function of the positions index, keys are game positions.
+ */
+static bool
+pve_position_equal (const void *item,
+                    const void *key,
+                    void *param)
+{
+  const PVEnv *const pve = (PVEnv *) param;
+  return pve_gpx_equal(&pve->positions[*(const uint32_t *) item].gpx, (const GamePositionX *) key);
+}
 
-  /* The number of lines segments cannot grow further than the limit. */
-  size_t lines_segments_used = pve->lines_segments_head - pve->lines_segments;
-  g_assert(pve->lines_segments_size > lines_segments_used);
+/*
+ * Returns the index of the game position in the positions table, incrementing its reference count.
+ * A missing position takes a free entry, the table is doubled when no free entry is left.
+ */
+static uint32_t
+pve_position_acquire (PVEnv *pve,
+                      const GamePositionX *const gpx_ref)
+{
+  /* The copy protects from a reference into the table, that a reallocation would invalidate. */
+  const GamePositionX key = *gpx_ref;
+  bool inserted;
+  uint32_t *const slot = (uint32_t *) hs_probe(pve->positions_index, pve_gpx_hash(&key), &key, &inserted);
+  if (!inserted) {
+    pve->positions[*slot].ref_count++;
+    return *slot;
+  }
+
+  if (pve->positions_free == PVE_NULL_INDEX) {
+    const size_t old_size = pve->positions_size;
+    g_assert(2 * old_size < PVE_NULL_INDEX);
+    pve->positions_size = 2 * old_size;
+    pve->positions = (PVPosition *) realloc(pve->positions, pve->positions_size * sizeof(PVPosition));
+    g_assert(pve->positions);
+    for (size_t j = old_size; j < pve->positions_size; j++) {
+      pve->positions[j].ref_count = 0;
+      pve->positions[j].next_free = (j + 1 < pve->positions_size) ? j + 1 : PVE_NULL_INDEX;
+    }
+    pve->positions_free = old_size;
+  }
+  const uint32_t position = pve->positions_free;
+  PVPosition *const p = &pve->positions[position];
+  pve->positions_free = p->next_free;
+  p->gpx = key;
+  p->ref_count = 1;
+  p->next_free = PVE_NULL_INDEX;
+  pve->positions_count++;
+  *slot = position;
+  return position;
+}
 
-  const size_t actual_lines_size = pve->lines_size;
-  const size_t lines_size_extension = pve->lines_size;
+/*
+ * Decrements the reference count of the game position, when it reaches zero the position
+ * is removed from the index, and the entry is freed.
+ */
+static void
+pve_position_release (PVEnv *pve,
+                      const uint32_t position)
+{
+  PVPosition *const p = &pve->positions[position];
+  assert(p->ref_count > 0);
+  if (--p->ref_count) return;
 
-  /* Prepares the extension segment of lines. */
-  PVCell **lines_extension = (PVCell **) malloc(lines_size_extension * sizeof(PVCell *));
-  g_assert(lines_extension);
-  *(pve->lines_segments_head) = lines_extension;
-  pve->lines_segments_head++;
-  lines_segments_used++;
-  pve->lines_size += lines_size_extension;
-  for (size_t i = 0; i < lines_size_extension; i++) {
-    *(lines_extension + i) = NULL;
-  }
+  const bool deleted = hs_delete(pve->positions_index, pve_gpx_hash(&p->gpx), &p->gpx);
+  assert(deleted);
+  (void) deleted;
 
-  /* Creates the new lines stack and load it with the lines held in the extension segment. */
-  PVCell ***new_lines_stack = (PVCell ***) malloc(pve->lines_size * sizeof(PVCell **));
-  g_assert(new_lines_stack);
-  free(pve->lines_stack);
-  pve->lines_stack = new_lines_stack;
-  for (size_t i = 0; i < actual_lines_size; i++) {
-    *(pve->lines_stack + i) = NULL;
-  }
-  for (size_t i = 0; i < lines_size_extension; i++) {
-    *(pve->lines_stack + actual_lines_size + i) = lines_extension + i;
-  }
-  pve->lines_stack_head = pve->lines_stack + actual_lines_size;
+  p->next_free = pve->positions_free;
+  pve->positions_free = position;
+  pve->positions_count--;
+}
 
-  /* Re-compute the sorted lines segments array, and respective sizes. */
-  pve_sort_lines_segments(pve);
+/*
+ * Rounds the offset up to the alignment of the dump sections.
+ */
+static inline uint64_t
+pve_dump_align (const uint64_t offset)
+{
+  return (offset + PVE_DUMP_ALIGNMENT - 1) & ~((uint64_t) PVE_DUMP_ALIGNMENT - 1);
 }
 
-/**
- * @brief Sorts the stack of lines in natural order.
- *
- * @details The lines_stack array is sorted in place in two parts.
- *          The first part of the array is filled with the used lines,
- *          the second part is holding the free lines.
- *          The two sub-arrays are sorted in their natural order.
- *
- * @param [in,out] pve the principal variation environment pointer
+/*
+ * Appends an uninitialized item to the buffer, doubling the capacity when full.
+ * The returned pointer is valid until the next call.
  */
-static void
-pve_sort_lines_in_place (PVEnv *const pve)
-{
-  PVCell ***index = pve->lines_stack;
-
-  /* Here the index preparation. */
-  const size_t lines_in_use_count = pve->lines_stack_head - pve->lines_stack;
-  const size_t lines_not_in_use_count = pve->lines_size - lines_in_use_count;
-
-  PVCell ***lines_not_in_use_head = index +  lines_in_use_count;
-  sort_utils_insertionsort_asc_p ((void **) lines_not_in_use_head, lines_not_in_use_count);
-
-  PVCell ***free_lines_stack_cursor = pve->lines_stack_head;
-  PVCell ***used_lines_stack_cursor = pve->lines_stack;
-  size_t lines_segments_count = pve->lines_segments_head - pve->lines_segments;
-  for (size_t lines_segments_sorted_index = 0;
-       lines_segments_sorted_index < lines_segments_count;
-       lines_segments_sorted_index++) {
-    PVCell **first_line_in_segment = *(pve->lines_segments_sorted + lines_segments_sorted_index);
-    PVCell **segment_boundary = first_line_in_segment + *(pve->lines_segments_sorted_sizes + lines_segments_sorted_index);
-    for (PVCell **line = first_line_in_segment; line < segment_boundary; line++) {
-      if (line == *free_lines_stack_cursor) {
-        free_lines_stack_cursor++;
-      } else {
-        *used_lines_stack_cursor++ = line;
-      }
-    }
+static void *
+pve_dump_buffer_push (pve_dump_buffer_t *const b)
+{
+  if (b->count == b->capacity) {
+    b->capacity = b->capacity ? 2 * b->capacity : PVE_DUMP_BUFFER_FIRST_SIZE;
+    b->data = (void *) realloc(b->data, b->capacity * b->item_size);
+    g_assert(b->data);
   }
-
-  pve->state |= pve_state_lines_stack_sorted;
+  return (char *) b->data + b->item_size * b->count++;
 }
 
-static void
-pve_state_unset_lines_stack_sorted (PVEnv *const pve)
+/*
+ * Appends the game position to the positions of a dump being written, and returns its index.
+ */
+static uint32_t
+pve_dump_position_append (pve_dump_buffer_t *const positions,
+                          const GamePositionX *const gpx)
 {
-  if (pve->state & pve_state_lines_stack_sorted) { // Lines stack is sorted.
-    for (PVCell ***lines_stack_cursor = pve->lines_stack_head - 1; lines_stack_cursor >= pve->lines_stack; lines_stack_cursor--) {
-      *lines_stack_cursor = NULL;
-    }
-    pve->state &= ~pve_state_lines_stack_sorted;
-    return;
-  } else {
-    return;
-  }
+  g_assert(positions->count < PVE_DUMP_NULL_INDEX);
+  const uint32_t index = positions->count;
+  pve_dump_position_ref_t *const r = pve_dump_buffer_push(positions);
+  r->position.blacks = gpx->blacks;
+  r->position.whites = gpx->whites;
+  r->position.player = gpx->player;
+  r->position.padding = 0;
+  r->index = index;
+  return index;
 }
 
-/**
- * @brief Re-computes the sorted cells segments array, and respective sizes.
- *
- * @param [in,out] pve the principal variation environment pointer
+/*
+ * Compares two game positions of a dump, by blacks, then whites, then player.
  */
-static void
-pve_sort_cells_segments (PVEnv *const pve)
-{
-  const size_t cells_segments_used = pve->cells_segments_head - pve->cells_segments;
-  for (size_t i = 0; i < cells_segments_used; i++) {
-    *(pve->cells_segments_sorted + i) = *(pve->cells_segments + i);
-  }
-  sort_utils_insertionsort_asc_p ((void **) pve->cells_segments_sorted, cells_segments_used);
-  for (size_t i = 0; i < cells_segments_used; i++) {
-    PVCell *segment = *(pve->cells_segments_sorted + i);
-    size_t segment_size = pve->cells_first_size;
-    size_t segment_size_incr = 0;
-    for (size_t j = 0; j < cells_segments_used; j++, segment_size += segment_size_incr, segment_size_incr = segment_size) {
-      if (segment == *(pve->cells_segments + j)) break;
-    }
-    *(pve->cells_segments_sorted_sizes + i) = segment_size;
-  }
+static inline int
+pve_dump_position_cmp (const pve_dump_position_t *const a,
+                       const pve_dump_position_t *const b)
+{
+  if (a->blacks != b->blacks) return (a->blacks > b->blacks) ? +1 : -1;
+  if (a->whites != b->whites) return (a->whites > b->whites) ? +1 : -1;
+  return (a->player > b->player) - (a->player < b->player);
 }
 
-/**
- * @brief Re-computes the sorted lines segments array, and respective sizes.
- *
- * @param [in,out] pve the principal variation environment pointer
+/*
+ * Checks that every index stored in the cells and lines sections refers to an existing item.
+ * Next and variant references may be null, the position reference must not be, and moves must be valid.
  */
-static void
-pve_sort_lines_segments (PVEnv *const pve)
-{
-  const size_t lines_segments_used = pve->lines_segments_head - pve->lines_segments;
-  for (size_t i = 0; i < lines_segments_used; i++) {
-    *(pve->lines_segments_sorted + i) = *(pve->lines_segments + i);
-  }
-  sort_utils_insertionsort_asc_p ((void **) pve->lines_segments_sorted, lines_segments_used);
-  for (size_t i = 0; i < lines_segments_used; i++) {
-    PVCell **segment = *(pve->lines_segments_sorted + i);
-    size_t segment_size = pve->lines_first_size;
-    size_t segment_size_incr = 0;
-    for (size_t j = 0; j < lines_segments_used; j++, segment_size += segment_size_incr, segment_size_incr = segment_size) {
-      if (segment == *(pve->lines_segments + j)) break;
-    }
-    *(pve->lines_segments_sorted_sizes + i) = segment_size;
+static bool
+pve_dump_indexes_are_valid (const pve_dump_header_t *const h,
+                            const pve_dump_cell_t *const cells,
+                            const uint32_t *const lines)
+{
+  for (uint64_t i = 0; i < h->cell_count; i++) {
+    const pve_dump_cell_t *const c = &cells[i];
+    if (c->next != PVE_DUMP_NULL_INDEX && c->next >= h->cell_count) return false;
+    if (c->variant != PVE_DUMP_NULL_INDEX && c->variant >= h->line_count) return false;
+    if (c->position >= h->position_count) return false;
+    if (!square_is_valid_move(c->move)) return false;
   }
+  for (uint64_t i = 0; i < h->line_count; i++) {
+    if (lines[i] != PVE_DUMP_NULL_INDEX && lines[i] >= h->cell_count) return false;
+  }
+  return true;
 }
 
-/**
- * @brief Translate a reference from one env to another.
- *
- * @details The reference given by the `from_element` parameter is translated and returned
- *          as reference in a new environment.
- *
- *          A `NULL` pointer is returned on error.
+/*
+ * Checks that the cells, linked by next and variant references, form no cycle, and that no line,
+ * taking at each step any of the alternatives, is longer than PV_MAX_LENGTH.
+ * Indexes must have already been validated.
  *
- * @param [in] active_segments_count       the number of active segments
- * @param [in] segments_sizes              an array of segment sizes
- * @param [in] element_size                the element size in bytes
- * @param [in] from_to_segments_sorted_map the array of indexes that map from-to sorted segments
- * @param [in] from_segments               the array of segments from which translate
- * @param [in] to_segments                 the array of segments to which translate
- * @param [in] from_element                the reference of the element in the from env
- * @return                                 the translated pointer
+ * The cells are visited depth first, by an explicit stack. For each cell, the longest line found from it,
+ * counting the steps following the cell, is the greatest between the one of the next cell plus one,
+ * and the one of the next alternative, reached by the variant reference, that is at the same step.
  */
-static void *
-pve_translate_ref (size_t active_segments_count,
-                   size_t *segments_sizes,
-                   size_t element_size,
-                   size_t *from_to_segments_sorted_map,
-                   void **from_segments,
-                   void **to_segments,
-                   void *from_element)
-{
-  g_assert(from_segments);
-  g_assert(to_segments);
-  g_assert(from_element);
-
-  for (size_t k1 = active_segments_count; k1 > 0; k1--) {
-    const size_t k = k1 - 1;
-    const char *segment_base_adress = (char *) *(from_segments + k);
-    const size_t segment_size = *(segments_sizes + k);
-    if ((char *) from_element >= segment_base_adress) {
-      const ptrdiff_t d = (char *) from_element - segment_base_adress;
-      const size_t kk = *(from_to_segments_sorted_map + k);
-      if (d > segment_size * element_size) return NULL;
-      return ((char *) *(to_segments + kk)) + d;
+static bool
+pve_dump_chains_are_valid (const pve_dump_header_t *const h,
+                           const pve_dump_cell_t *const cells,
+                           const uint32_t *const lines)
+{
+  enum { UNVISITED = 0, OPEN, CLOSED };
+
+  if (h->cell_count == 0) return true;
+
+  bool is_valid = true;
+  uint8_t *const state = (uint8_t *) calloc(h->cell_count, sizeof(uint8_t));
+  uint8_t *const length = (uint8_t *) malloc(h->cell_count * sizeof(uint8_t));
+  uint32_t *const stack = (uint32_t *) malloc(h->cell_count * sizeof(uint32_t));
+  g_assert(state && length && stack);
+
+  for (uint64_t i = 0; i < h->cell_count && is_valid; i++) {
+    if (state[i] != UNVISITED) continue;
+    size_t top = 0;
+    stack[top++] = i;
+    state[i] = OPEN;
+    while (top && is_valid) {
+      const uint32_t c = stack[top - 1];
+      const uint32_t next = cells[c].next;
+      const uint32_t alternative = cells[c].variant == PVE_DUMP_NULL_INDEX ? PVE_DUMP_NULL_INDEX : lines[cells[c].variant];
+      const uint32_t children[2] = { next, alternative };
+      bool is_pushed = false;
+      for (int k = 0; k < 2 && !is_pushed; k++) {
+        const uint32_t x = children[k];
+        if (x == PVE_DUMP_NULL_INDEX || state[x] == CLOSED) continue;
+        if (state[x] == OPEN) {
+          is_valid = false;
+          break;
+        }
+        stack[top++] = x;
+        state[x] = OPEN;
+        is_pushed = true;
+      }
+      if (!is_valid || is_pushed) continue;
+      const int next_length = next == PVE_DUMP_NULL_INDEX ? 0 : length[next] + 1;
+      const int alternative_length = alternative == PVE_DUMP_NULL_INDEX ? 0 : length[alternative];
+      const int l = next_length > alternative_length ? next_length : alternative_length;
+      if (l + 1 > PV_MAX_LENGTH) is_valid = false;
+      length[c] = l;
+      state[c] = CLOSED;
+      top--;
     }
   }
-  return NULL;
+
+  free(state);
+  free(length);
+  free(stack);
+  return is_valid;
 }
 
+/*
+ * The sort_utils compare function of pve_dump_position_ref_t items.
+ */
+static int
+pve_dump_position_ref_cmp (const void *const a,
+                           const void *const b)
+{
+  return pve_dump_position_cmp(&((const pve_dump_position_ref_t *) a)->position,
+                               &((const pve_dump_position_ref_t *) b)->position);
+}
 
 /**
- * @brief Populates the array of index mappings between sorted and unsorted segments.
+ * @brief Traverses the mapped dump, in the same order followed by #pve_tree_walker.
  *
- * @param [out] segments_sorted_map   the result is stored in this array
- * @param [in]  active_segments_count the size of the active segments array
- * @param [in]  unsorted_segments     the unsorted segments array
- * @param [in]  sorted_segments       the sorted segments array
+ * @details When `as_table` is false, lines are printed in the human readable form, and shared cells
+ *          are expanded in every line that reaches them.
+ *          When `as_table` is true, a csv row is printed for each cell, and shared cells are printed once,
+ *          a line stops when it reaches a cell already printed.
+ *
+ * @param [in] dump     the dump view
+ * @param [in] stream   the stream collecting the output
+ * @param [in] as_table selects the output format
  */
 static void
-pve_populate_segments_sorted_map (size_t *const segments_sorted_map,
-                                  const size_t active_segments_count,
-                                  const void **const unsorted_segments,
-                                  const void **const sorted_segments)
-{
-  for (size_t i = 0; i < active_segments_count; i++) {
-    const void *const sorted_segment = *(sorted_segments + i);
-    for (size_t j = 0; j < active_segments_count; j++) {
-      const void *const unsorted_segment = *(unsorted_segments + j);
-      if (unsorted_segment == sorted_segment) {
-        segments_sorted_map[i] = j;
-        break;
+pve_dump_walker (const pve_dump_t *const dump,
+                 FILE *const stream,
+                 const bool as_table)
+{
+  /*
+   * The board has 64 squares, each move can have a pass, so
+   * keeping it simple, 128 is the theoretical upper bound.
+   */
+  static const size_t max_recursion_depth = 128;
+
+  typedef struct {
+    uint32_t     line;
+    unsigned int dist_lev_0;
+  } dump_row_t;
+
+  dump_row_t row_stack[max_recursion_depth];
+  dump_row_t *row_stack_header = row_stack;
+
+  uint64_t *visited = NULL;
+  if (as_table) {
+    visited = (uint64_t *) calloc(dump->header->cell_count / 64 + 1, sizeof(uint64_t));
+    g_assert(visited);
+  }
+
+  row_stack_header->line = dump->header->root_line;
+  row_stack_header->dist_lev_0 = 0;
+  row_stack_header++;
+
+  while (row_stack_header > row_stack) {
+    const dump_row_t row = *--row_stack_header;
+    unsigned int rel_distance = 0;
+
+    if (!as_table) {
+      for (size_t i = 0; i < row.dist_lev_0; i++) fprintf(stream, "    ");
+    }
+
+    for (uint32_t i = dump->lines[row.line]; i != PVE_DUMP_NULL_INDEX; i = dump->cells[i].next, rel_distance++) {
+      const pve_dump_cell_t *const c = &dump->cells[i];
+      if (as_table) {
+        if (visited[i / 64] & (1ULL << (i % 64))) break;
+        visited[i / 64] |= 1ULL << (i % 64);
+      }
+      if (c->variant != PVE_DUMP_NULL_INDEX) {
+        g_assert(row_stack_header - row_stack < max_recursion_depth);
+        row_stack_header->line = c->variant;
+        row_stack_header->dist_lev_0 = row.dist_lev_0 + rel_distance;
+        row_stack_header++;
+      }
+      if (as_table) {
+        const pve_dump_position_t *const p = &dump->positions[c->position];
+        const GamePositionX gpx = { .blacks = p->blacks, .whites = p->whites, .player = p->player };
+        fprintf(stream, "%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%2s;%2u;%2u;%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%1d\n",
+                (int64_t) row.line + 1,
+                (int64_t) i + 1,
+                (c->variant == PVE_DUMP_NULL_INDEX) ? (int64_t) 0 : (int64_t) c->variant + 1,
+                (c->next == PVE_DUMP_NULL_INDEX) ? (int64_t) 0 : (int64_t) c->next + 1,
+                square_as_move_to_string(c->move),
+                row.dist_lev_0,
+                rel_distance,
+                game_position_x_hash(&gpx),
+                gpx.blacks,
+                gpx.whites,
+                gpx.player);
+      } else {
+        fprintf(stream, "%s", square_as_move_to_string(c->move));
+        if (c->variant != PVE_DUMP_NULL_INDEX) {
+          fprintf(stream, ".");
+          if (c->next != PVE_DUMP_NULL_INDEX) fprintf(stream, " ");
+        } else {
+          if (c->next != PVE_DUMP_NULL_INDEX) fprintf(stream, "  ");
+        }
       }
     }
+
+    if (!as_table) fprintf(stream, "\n");
   }
+
+  free(visited);
 }
 
+/*
+ * Returns the cell having the smallest move greater than `lower_bound`, searching the chain
+ * of alternatives that starts with `cell`, or PVE_DUMP_NULL_INDEX when there is none.
+ * Alternatives have distinct moves, so the walk stops after pass_move + 1 cells, even on a cyclic chain.
+ */
+static uint32_t
+pve_dump_smallest_alternative (const pve_dump_t *const dump,
+                               uint32_t cell,
+                               const int lower_bound)
+{
+  uint32_t smallest = PVE_DUMP_NULL_INDEX;
+  for (int i = 0; cell != PVE_DUMP_NULL_INDEX && i <= pass_move; i++) {
+    const pve_dump_cell_t *const c = &dump->cells[cell];
+    if (c->move > lower_bound && (smallest == PVE_DUMP_NULL_INDEX || c->move < dump->cells[smallest].move)) smallest = cell;
+    cell = (c->variant == PVE_DUMP_NULL_INDEX) ? PVE_DUMP_NULL_INDEX : dump->lines[c->variant];
+  }
+  return smallest;
+}
 
 /**
  * @brief Traverses the PVE structure.
@@ -2485,10 +2818,10 @@ pve_tree_walker (const PVEnv *const pve,
     if (begin_of_line_action) begin_of_line_action(pve, stream, &current_row_copy);
 
     /* Cycles over the moves of the line. If the move has a variant it is pushed on the stack of rows. */
-    for (const PVCell *c = *current_row_copy.line; c != NULL; c = c->next, current_row_copy.rel_distance++) {
-      if (c->variant) {
+    for (const PVCell *c = *current_row_copy.line; c != NULL; c = pve_cell_at(pve, c->next), current_row_copy.rel_distance++) {
+      if (c->variant != PVE_NULL_INDEX) {
         pve_row_t *const v = row_stack_header++;
-        v->line = c->variant;
+        v->line = pve_line_at(pve, c->variant);
         v->dist_lev_0 = current_row_copy.dist_lev_0 + current_row_copy.rel_distance;
         if (compute_game_positions) game_position_x_copy(&current_row_copy.gp, &v->gp);
       }
@@ -2525,11 +2858,11 @@ pve_twa_cell (const PVEnv *const pve,
               const PVCell *const cell)
 {
   fprintf(stream, "%s", square_as_move_to_string(cell->move));
-  if (cell->variant) {
+  if (cell->variant != PVE_NULL_INDEX) {
     fprintf(stream, ".");
-    if (cell->next) fprintf(stream, " ");
+    if (cell->next != PVE_NULL_INDEX) fprintf(stream, " ");
   } else {
-    if (cell->next) fprintf(stream, "  ");
+    if (cell->next != PVE_NULL_INDEX) fprintf(stream, "  ");
   }
 }
 
@@ -2539,10 +2872,11 @@ pve_twa_cell_csv (const PVEnv *const pve,
                   pve_row_t *const row,
                   const PVCell *const cell)
 {
-  int64_t line_id = (int64_t) row->line;
-  int64_t cell_id = (int64_t) cell;
-  int64_t variant_id = (int64_t) cell->variant;
-  int64_t next_id = (int64_t) cell->next;
+  /* Ids are indexes shifted by one, zero meaning none. */
+  int64_t line_id = pve_index_to_int64(pve_line_to_index(pve, row->line)) + 1;
+  int64_t cell_id = pve_index_to_int64(pve_cell_to_index(pve, cell)) + 1;
+  int64_t variant_id = pve_index_to_int64(cell->variant) + 1;
+  int64_t next_id = pve_index_to_int64(cell->next) + 1;
   unsigned int head_level = row->dist_lev_0;
   unsigned int rel_level = row->rel_distance;
   uint64_t gp_hash = game_position_x_hash(&row->gp);
@@ -2563,19 +2897,443 @@ pve_twa_cell_csv (const PVEnv *const pve,
           gp_p);
 }
 
-static int
-pve_compare_cells (const void *item_a,
-                   const void *item_b,
-                   void *param)
+/*
+ * Releases the linked list of cells starting from `cell`.
+ *
+ * Each cell has its reference count decremented, the traversal stops when the count
+ * doesn't reach zero, being the cell, and the ones that follow, shared with other lines.
+ * Released cells are removed from the game position table, their variants are deleted,
+ * and they are returned to the cells arena.
+ * Parameter `gpx` is the game position that the first cell follows, when not `NULL`
+ * the first cell is removed from the line index.
+ */
+static void
+pve_release_cells (PVEnv *pve,
+                   PVCell *cell,
+                   const GamePositionX *const gpx)
 {
-  assert(item_a && item_b);
-  if (item_a == item_b) return 0;
-  const pve_gp_table_entry_t *a = (pve_gp_table_entry_t *) item_a;
-  const pve_gp_table_entry_t *b = (pve_gp_table_entry_t *) item_b;
-  return game_position_x_compare(&a->gpx, &b->gpx);
+  GamePositionX key = { .blacks = empty_square_set, .whites = empty_square_set, .player = BLACK_PLAYER };
+  bool has_key = gpx != NULL;
+  if (has_key) key = *gpx;
+  uint32_t index = pve_cell_to_index(pve, cell);
+  while (cell) {
+    assert(cell->ref_count > 0);
+    if (--cell->ref_count) break;
+    if (has_key && pve->line_index) pve_line_index_remove(pve, &key, cell);
+    key = pve->positions[cell->position].gpx;
+    has_key = true;
+    pve_position_release(pve, cell->position);
+    PVCell **v_line = pve_line_at(pve, cell->variant);
+    if (v_line) pve_line_delete(pve, v_line);
+    pve->line_release_cell_count++;
+    const uint32_t next = cell->next;
+    cell->move = invalid_move;
+    cell->next = PVE_NULL_INDEX;
+    cell->variant = PVE_NULL_INDEX;
+    cell->position = PVE_NULL_INDEX;
+    mem_obj_free_index(pve->cells, index);
+    index = next;
+    cell = pve_cell_at(pve, next);
+  }
 }
 
+/*
+ * The hs_item_hash_f function of the line index, entries are hashed by game position only,
+ * so that they can be found either by context or by head.
+ */
+static uint64_t
+pve_line_index_hash (const void *item,
+                     void *param)
+{
+  return pve_gpx_hash(&((const PVLineIndexEntry *) item)->gpx);
+}
 
+/*
+ * The hs_item_equal_f function of the line index.
+ * A key having the head field set matches by head, otherwise it matches by context.
+ */
+static bool
+pve_line_index_equal (const void *item,
+                      const void *key,
+                      void *param)
+{
+  const PVLineIndexEntry *const e = (const PVLineIndexEntry *) item;
+  const PVLineIndexEntry *const k = (const PVLineIndexEntry *) key;
+  if (!pve_gpx_equal(&e->gpx, &k->gpx)) return false;
+  return k->head ? e->head == k->head : e->context == k->context;
+}
+
+/*
+ * Returns the head of the line indexed by game position and context, or NULL when missing.
+ */
+static PVCell *
+pve_line_index_lookup (const PVEnv *const pve,
+                       const GamePositionX *const gpx,
+                       const uint64_t context)
+{
+  if (!pve->line_index) return NULL;
+  const PVLineIndexEntry key = { .gpx = *gpx, .context = context, .head = NULL };
+  const PVLineIndexEntry *const e = hs_find(pve->line_index, pve_gpx_hash(gpx), &key);
+  return e ? e->head : NULL;
+}
+
+/*
+ * Inserts the entry into the line index, the index is created on the first call.
+ */
+static void
+pve_line_index_insert (PVEnv *pve,
+                       const GamePositionX *const gpx,
+                       const uint64_t context,
+                       PVCell *const head)
+{
+  if (!pve->line_index) pve->line_index = hs_create(sizeof(PVLineIndexEntry), pve_line_index_hash, pve_line_index_equal, pve);
+  const PVLineIndexEntry key = { .gpx = *gpx, .context = context, .head = NULL };
+  PVLineIndexEntry *const e = hs_probe(pve->line_index, pve_gpx_hash(gpx), &key, NULL);
+  *e = key;
+  e->head = head;
+}
+
+/*
+ * Removes the entry having the given game position and head, if any.
+ */
+static void
+pve_line_index_remove (PVEnv *pve,
+                       const GamePositionX *const gpx,
+                       const PVCell *const head)
+{
+  const PVLineIndexEntry key = { .gpx = *gpx, .context = 0, .head = (PVCell *) head };
+  hs_delete(pve->line_index, pve_gpx_hash(gpx), &key);
+}
+
+/*
+ * Returns true when bit i of the bitmap is set.
+ */
+static inline bool
+pve_chk_bit (const uint64_t *const bitmap,
+             const uint32_t i)
+{
+  return bitmap[i / 64] & ((uint64_t) 1 << (i % 64));
+}
+
+/*
+ * Sets bit i of the bitmap, returns true when the bit was not already set.
+ * Concurrent claims of the same bit are won by exactly one thread.
+ */
+static inline bool
+pve_chk_claim (uint64_t *const bitmap,
+               const uint32_t i)
+{
+  const uint64_t bit = (uint64_t) 1 << (i % 64);
+  return !(__atomic_fetch_or(&bitmap[i / 64], bit, __ATOMIC_RELAXED) & bit);
+}
+
+/*
+ * Returns true when i is the index of an object in use of the arena.
+ */
+static inline bool
+pve_chk_is_used (const mem_obj_allocator_t *const a,
+                 const uint64_t *const free_bitmap,
+                 const uint32_t i)
+{
+  return i < a->top && !pve_chk_bit(free_bitmap, i);
+}
+
+/*
+ * Returns the number of online processors, limited to the range [1, PVE_MAX_THREADS].
+ */
+static size_t
+pve_thread_count (void)
+{
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1) return 1;
+  if (n > PVE_MAX_THREADS) return PVE_MAX_THREADS;
+  return (size_t) n;
+}
+
+/*
+ * The start routine of the threads running a pass.
+ */
+static void *
+pve_chk_task_run (void *arg)
+{
+  pve_chk_task_t *const t = (pve_chk_task_t *) arg;
+  t->error_code = t->pass(t->chk, t->begin, t->end);
+  return NULL;
+}
+
+/*
+ * Runs the pass over the [0, count) range, split into ranges made of whole grains.
+ * The first range is run by the calling thread, the others by new threads, a range is
+ * run by the calling thread as well when a thread cannot be created.
+ * Returns the error code of the first range that fails.
+ */
+static pve_error_code_t
+pve_chk_run (pve_chk_t *const chk,
+             pve_chk_pass_f *const pass,
+             const size_t count,
+             const size_t grain)
+{
+  const size_t grain_count = (count + grain - 1) / grain;
+  const size_t task_count = grain_count < chk->thread_count ? grain_count : chk->thread_count;
+  if (task_count <= 1) return pass(chk, 0, count);
+
+  pve_chk_task_t tasks[PVE_MAX_THREADS];
+  pthread_t threads[PVE_MAX_THREADS];
+  bool is_started[PVE_MAX_THREADS];
+
+  for (size_t k = 0; k < task_count; k++) {
+    pve_chk_task_t *const t = &tasks[k];
+    t->chk = chk;
+    t->pass = pass;
+    t->begin = grain_count * k / task_count * grain;
+    t->end = grain_count * (k + 1) / task_count * grain;
+    if (t->end > count) t->end = count;
+    t->error_code = PVE_ERROR_CODE_OK;
+    is_started[k] = k > 0 && pthread_create(&threads[k], NULL, pve_chk_task_run, t) == 0;
+  }
+  for (size_t k = 0; k < task_count; k++) {
+    if (!is_started[k]) pve_chk_task_run(&tasks[k]);
+  }
+
+  pve_error_code_t error_code = PVE_ERROR_CODE_OK;
+  for (size_t k = 0; k < task_count; k++) {
+    if (is_started[k]) pthread_join(threads[k], NULL);
+    if (error_code == PVE_ERROR_CODE_OK) error_code = tasks[k].error_code;
+  }
+  return error_code;
+}
+
+/*
+ * Counts the references from the lines in use to their first cell.
+ */
+static pve_error_code_t
+pve_chk_count_line_refs (pve_chk_t *const chk,
+                         const size_t begin,
+                         const size_t end)
+{
+  const PVEnv *const pve = chk->pve;
+  for (uint32_t i = begin; i < end; i++) {
+    if (pve_chk_bit(chk->free_lines, i)) continue;
+    const PVCell *const head = *pve_line_at(pve, i);
+    if (!head) continue;
+    const uint32_t c = mem_obj_index_of(pve->cells, head);
+    if (!pve_chk_is_used(pve->cells, chk->free_cells, c) || pve_cell_at(pve, c) != head)
+      return PVE_ERROR_CODE_LINE_HEAD_IS_INVALID;
+    __atomic_fetch_add(&chk->cell_refs[c], 1, __ATOMIC_RELAXED);
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Verifies the links of the cells in use, counting the references to the next cells,
+ * and to the variant lines.
+ */
+static pve_error_code_t
+pve_chk_count_cell_refs (pve_chk_t *const chk,
+                         const size_t begin,
+                         const size_t end)
+{
+  const PVEnv *const pve = chk->pve;
+  for (uint32_t i = begin; i < end; i++) {
+    if (pve_chk_bit(chk->free_cells, i)) continue;
+    const PVCell *const cell = pve_cell_at(pve, i);
+    if (cell->next != PVE_NULL_INDEX) {
+      if (!pve_chk_is_used(pve->cells, chk->free_cells, cell->next)) return PVE_ERROR_CODE_CELL_NEXT_IS_INVALID;
+      __atomic_fetch_add(&chk->cell_refs[cell->next], 1, __ATOMIC_RELAXED);
+    }
+    if (cell->variant != PVE_NULL_INDEX) {
+      if (!pve_chk_is_used(pve->lines, chk->free_lines, cell->variant)) return PVE_ERROR_CODE_CELL_VARIANT_IS_INVALID;
+      __atomic_fetch_add(&chk->line_refs[cell->variant], 1, __ATOMIC_RELAXED);
+    }
+    if (cell->position >= pve->positions_size || pve->positions[cell->position].ref_count == 0)
+      return PVE_ERROR_CODE_CELL_POSITION_IS_INVALID;
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Verifies that the reference count of the cells in use matches the references counted.
+ */
+static pve_error_code_t
+pve_chk_verify_cell_refs (pve_chk_t *const chk,
+                          const size_t begin,
+                          const size_t end)
+{
+  for (uint32_t i = begin; i < end; i++) {
+    if (pve_chk_bit(chk->free_cells, i)) continue;
+    if (pve_cell_at(chk->pve, i)->ref_count != chk->cell_refs[i]) return PVE_ERROR_CODE_CELL_REF_COUNT_IS_INCORRECT;
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Verifies that each line is the variant of one cell at most, and that the root line is not a variant.
+ */
+static pve_error_code_t
+pve_chk_verify_line_refs (pve_chk_t *const chk,
+                          const size_t begin,
+                          const size_t end)
+{
+  for (uint32_t i = begin; i < end; i++) {
+    if (chk->line_refs[i] + (i == chk->root_line) > 1) return PVE_ERROR_CODE_LINE_IS_A_VARIANT_MORE_THAN_ONCE;
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Marks the line, and its cells, as reached, pushing the variant lines on the pending stack.
+ * The walk stops at the first cell already reached, the rest of the line being shared,
+ * and already walked, or being walked, by another line.
+ */
+static pve_error_code_t
+pve_chk_walk_line (pve_chk_t *const chk,
+                   const uint32_t line,
+                   pve_dump_buffer_t *const pending)
+{
+  const PVEnv *const pve = chk->pve;
+  if (!pve_chk_claim(chk->reached_lines, line)) return PVE_ERROR_CODE_OK;
+  const PVCell *const head = *pve_line_at(pve, line);
+  uint32_t c = mem_obj_index_of(pve->cells, head);
+  if (head && (!pve_chk_is_used(pve->cells, chk->free_cells, c) || pve_cell_at(pve, c) != head))
+    return PVE_ERROR_CODE_LINE_HEAD_IS_INVALID;
+  while (c != PVE_NULL_INDEX) {
+    if (!pve_chk_claim(chk->reached_cells, c)) break;
+    const PVCell *const cell = pve_cell_at(pve, c);
+    if (cell->variant != PVE_NULL_INDEX) {
+      if (!pve_chk_is_used(pve->lines, chk->free_lines, cell->variant)) return PVE_ERROR_CODE_CELL_VARIANT_IS_INVALID;
+      *(uint32_t *) pve_dump_buffer_push(pending) = cell->variant;
+    }
+    c = cell->next;
+    if (c != PVE_NULL_INDEX && !pve_chk_is_used(pve->cells, chk->free_cells, c)) return PVE_ERROR_CODE_CELL_NEXT_IS_INVALID;
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Walks depth first the lines reachable from the walk roots in the [begin, end) range.
+ */
+static pve_error_code_t
+pve_chk_walk (pve_chk_t *const chk,
+              const size_t begin,
+              const size_t end)
+{
+  pve_error_code_t error_code = PVE_ERROR_CODE_OK;
+  pve_dump_buffer_t pending = { NULL, 0, 0, sizeof(uint32_t) };
+  for (size_t i = begin; i < end && error_code == PVE_ERROR_CODE_OK; i++) {
+    *(uint32_t *) pve_dump_buffer_push(&pending) = chk->walk_roots[i];
+    while (pending.count > 0 && error_code == PVE_ERROR_CODE_OK) {
+      const uint32_t line = ((uint32_t *) pending.data)[--pending.count];
+      error_code = pve_chk_walk_line(chk, line, &pending);
+    }
+  }
+  free(pending.data);
+  return error_code;
+}
+
+/*
+ * Verifies that the cells in use have been reached.
+ */
+static pve_error_code_t
+pve_chk_verify_reached_cells (pve_chk_t *const chk,
+                              const size_t begin,
+                              const size_t end)
+{
+  for (uint32_t i = begin; i < end; i++) {
+    if (!pve_chk_bit(chk->free_cells, i) && !pve_chk_bit(chk->reached_cells, i)) return PVE_ERROR_CODE_CELL_IS_NOT_REACHABLE;
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Verifies that the lines in use have been reached.
+ */
+static pve_error_code_t
+pve_chk_verify_reached_lines (pve_chk_t *const chk,
+                              const size_t begin,
+                              const size_t end)
+{
+  for (uint32_t i = begin; i < end; i++) {
+    if (!pve_chk_bit(chk->free_lines, i) && !pve_chk_bit(chk->reached_lines, i)) return PVE_ERROR_CODE_LINE_IS_NOT_REACHABLE;
+  }
+  return PVE_ERROR_CODE_OK;
+}
+
+/*
+ * Runs the links and reachability checks of pve_is_invariant_satisfied.
+ *
+ * Links are checked by two passes, the first counts the references to cells and lines,
+ * the second compares them with the reference counts. Passes are split by segments among threads.
+ * Reachability is checked by walking the lines from the root one, the walk is done breadth first
+ * by the calling thread until enough lines are pending, then the pending lines are walked
+ * depth first by concurrent threads. A last pass looks for cells and lines in use not reached.
+ */
+static pve_error_code_t
+pve_chk_links (const PVEnv *const pve,
+               const bool check_links,
+               const bool check_reachability)
+{
+  const mem_obj_allocator_t *const ca = pve->cells;
+  const mem_obj_allocator_t *const la = pve->lines;
+  const size_t cells_x_segment = (size_t) 1 << ca->segment_shift;
+  const size_t lines_x_segment = (size_t) 1 << la->segment_shift;
+
+  pve_chk_t chk;
+  memset(&chk, 0, sizeof(chk));
+  chk.pve = pve;
+  chk.thread_count = pve_thread_count();
+  chk.root_line = mem_obj_index_of(la, pve->root_line);
+  chk.free_cells = mem_obj_allocator_free_bitmap(ca);
+  chk.free_lines = mem_obj_allocator_free_bitmap(la);
+
+  pve_error_code_t error_code = PVE_ERROR_CODE_OK;
+
+  if (!pve_chk_is_used(la, chk.free_lines, chk.root_line) || pve_line_at(pve, chk.root_line) != pve->root_line) {
+    error_code = PVE_ERROR_CODE_LINE_IS_NOT_REACHABLE;
+    goto end;
+  }
+
+  if (check_links) {
+    chk.cell_refs = (uint32_t *) calloc(ca->top + 1, sizeof(uint32_t));
+    chk.line_refs = (uint32_t *) calloc(la->top + 1, sizeof(uint32_t));
+    g_assert(chk.cell_refs && chk.line_refs);
+    if ((error_code = pve_chk_run(&chk, pve_chk_count_line_refs, la->top, lines_x_segment))) goto end;
+    if ((error_code = pve_chk_run(&chk, pve_chk_count_cell_refs, ca->top, cells_x_segment))) goto end;
+    if ((error_code = pve_chk_run(&chk, pve_chk_verify_cell_refs, ca->top, cells_x_segment))) goto end;
+    if ((error_code = pve_chk_run(&chk, pve_chk_verify_line_refs, la->top, lines_x_segment))) goto end;
+  }
+
+  if (check_reachability) {
+    chk.reached_cells = (uint64_t *) calloc(ca->top / 64 + 1, sizeof(uint64_t));
+    chk.reached_lines = (uint64_t *) calloc(la->top / 64 + 1, sizeof(uint64_t));
+    g_assert(chk.reached_cells && chk.reached_lines);
+
+    /* The queue of lines is consumed from the front by the breadth first walk, the rest goes to the threads. */
+    pve_dump_buffer_t queue = { NULL, 0, 0, sizeof(uint32_t) };
+    *(uint32_t *) pve_dump_buffer_push(&queue) = chk.root_line;
+    size_t front = 0;
+    while (front < queue.count && queue.count - front < PVE_CHK_WALK_ROOTS_X_THREAD * chk.thread_count && !error_code) {
+      error_code = pve_chk_walk_line(&chk, ((uint32_t *) queue.data)[front++], &queue);
+    }
+    if (!error_code) {
+      chk.walk_roots = (uint32_t *) queue.data + front;
+      error_code = pve_chk_run(&chk, pve_chk_walk, queue.count - front, 1);
+    }
+    free(queue.data);
+    if (error_code) goto end;
+
+    if ((error_code = pve_chk_run(&chk, pve_chk_verify_reached_cells, ca->top, cells_x_segment))) goto end;
+    if ((error_code = pve_chk_run(&chk, pve_chk_verify_reached_lines, la->top, lines_x_segment))) goto end;
+  }
+
+ end:
+  free(chk.free_cells);
+  free(chk.free_lines);
+  free(chk.cell_refs);
+  free(chk.line_refs);
+  free(chk.reached_cells);
+  free(chk.reached_lines);
+  return error_code;
+}
 
 /**
  * @endcond
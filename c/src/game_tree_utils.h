@@ -57,11 +57,17 @@
  */
 #define MAX_LEGAL_MOVE_STACK_COUNT 1024
 
+/*
+ * Max number of plies, counted from the root, having the value of each move collected.
+ */
+#define EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH 4
+
 #include <stdbool.h>
 #include <glib.h>
 
 #include "board.h"
-#include "red_black_tree.h"
+#include "hash_set.h"
+#include "memory_manager.h"
 
 
 
@@ -73,10 +79,9 @@
  * These constants should be internal, but are in the header file for testing purposes.
  */
 
-#define PVE_CELLS_SEGMENTS_SIZE 26
-#define PVE_CELLS_FIRST_SIZE 64
-#define PVE_LINES_SEGMENTS_SIZE 28
-#define PVE_LINES_FIRST_SIZE 8
+#define PVE_CELLS_SEGMENT_SHIFT 16
+#define PVE_LINES_SEGMENT_SHIFT 14
+#define PVE_SEGMENTS_FIRST_SIZE 16
 
 /**
  * @endcond
@@ -94,23 +99,22 @@
  */
 typedef enum {
   PVE_ERROR_CODE_OK,                                              /**< No error detected. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_SIZE_IS_INCORRECT,                /**< Field `lines_segments_size` has a value different from `PVE_LINES_SEGMENTS_SIZE`. */
-  PVE_ERROR_CODE_LINES_FIRST_SIZE_IS_INCORRECT,                   /**< Field `lines_first_size` has a value different from `PVE_LINES_FIRST_SIZE`. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_HEAD_IS_NULL,                     /**< Field `lines_segments_head` is `NULL`. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_IS_NULL,                          /**< Field `lines_segments` is `NULL`. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_HEADS_PRECEDES_ARRAY_INDEX_0,     /**< Active lines segments count is negative. */
-  PVE_ERROR_CODE_ACTIVE_LINES_SEGMENTS_COUNT_EXCEEDS_BOUND,       /**< Active lines segments count is too big. */
-  PVE_ERROR_CODE_LINES_SIZE_MISMATCH,                             /**< Lines size doesn't match with allocated lines segments. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_HAS_AN_INVALID_NULL_VALUE,        /**< Array `lines_segments` has an invalid `NULL` value. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_HAS_AN_INVALID_NOT_NULL_VALUE,    /**< Array `lines_segments` has an invalid `NOT NULL` value. */
-  PVE_ERROR_CODE_LINES_SEGMENT_COMPUTED_INDEX_OUT_OF_RANGE,       /**< The index of a lines segment, computed from field `lines_segments_sorted_sizes`, is out of range. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_POS_0_AND_1_ANOMALY,              /**< Array `lines_segments` has an anomaly on positions zero and one, computed from field `lines_segments_sorted_sizes`. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_SORTED_AND_UNSORTED_DO_NOT_MATCH, /**< Array `lines_segments` does not match with array `lines_segments_sorted`. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_ARE_NOT_PROPERLY_SORTED,          /**< Array `lines_segments_sorted` is not in the proper ascending order. */
-  PVE_ERROR_CODE_LINES_SIZE_DOESNT_MATCH_WITH_CUMULATED,          /**< Field `lines_size` differs from the cumulated values in `lines_segments_sorted_sizes`. */
-  PVE_ERROR_CODE_LINES_SEGMENT_POSITION_0_NOT_FOUND,              /**< No position found having minimum size in array `lines_segments_sorted_sizes`. */
-  PVE_ERROR_CODE_LINES_SEGMENT_POSITION_0_OR_1_NOT_FOUND,         /**< Two positions not found having minimum size in array `lines_segments_sorted_sizes`. */
-  PVE_ERROR_CODE_LINES_SEGMENTS_UNUSED_SEGMENT_HAS_SIZE           /**< Unused positions in array `lines_segments_sorted_sizes` has size different from zero. */
+  PVE_ERROR_CODE_LINES_ARENA_IS_NULL,                             /**< Field `lines` is `NULL`. */
+  PVE_ERROR_CODE_LINES_ARENA_OBJECT_SIZE_IS_INCORRECT,            /**< The object size of the `lines` allocator is not the size of a line. */
+  PVE_ERROR_CODE_LINES_ARENA_SEGMENT_SHIFT_IS_INCORRECT,          /**< The segment shift of the `lines` allocator differs from `PVE_LINES_SEGMENT_SHIFT`. */
+  PVE_ERROR_CODE_LINES_ARENA_IS_NOT_CONSISTENT,                   /**< The `lines` allocator fails the #mem_obj_allocator_is_consistent check. */
+  PVE_ERROR_CODE_CELLS_ARENA_IS_NULL,                             /**< Field `cells` is `NULL`. */
+  PVE_ERROR_CODE_CELLS_ARENA_OBJECT_SIZE_IS_INCORRECT,            /**< The object size of the `cells` allocator is not the size of a cell. */
+  PVE_ERROR_CODE_CELLS_ARENA_SEGMENT_SHIFT_IS_INCORRECT,          /**< The segment shift of the `cells` allocator differs from `PVE_CELLS_SEGMENT_SHIFT`. */
+  PVE_ERROR_CODE_CELLS_ARENA_IS_NOT_CONSISTENT,                   /**< The `cells` allocator fails the #mem_obj_allocator_is_consistent check. */
+  PVE_ERROR_CODE_LINE_HEAD_IS_INVALID,                            /**< A line in use points to an address that is not a cell in use. */
+  PVE_ERROR_CODE_CELL_NEXT_IS_INVALID,                            /**< Field `next` of a cell in use is not the index of a cell in use. */
+  PVE_ERROR_CODE_CELL_VARIANT_IS_INVALID,                         /**< Field `variant` of a cell in use is not the index of a line in use. */
+  PVE_ERROR_CODE_CELL_POSITION_IS_INVALID,                        /**< Field `position` of a cell in use is not the index of a game position in use. */
+  PVE_ERROR_CODE_CELL_REF_COUNT_IS_INCORRECT,                     /**< Field `ref_count` of a cell in use differs from the count of lines and cells referring to it. */
+  PVE_ERROR_CODE_LINE_IS_A_VARIANT_MORE_THAN_ONCE,                /**< A line is the variant of two cells, or the root line is a variant. */
+  PVE_ERROR_CODE_CELL_IS_NOT_REACHABLE,                           /**< A cell in use is not reachable from the root line. */
+  PVE_ERROR_CODE_LINE_IS_NOT_REACHABLE                            /**< A line in use is not reachable from the root line. */
 } pve_error_code_t;
 
 /**
@@ -118,6 +122,17 @@ typedef enum {
  */
 typedef uint64_t switches_t;
 
+/**
+ * @brief The exact value of a move, played at a node within the first plies of the search.
+ */
+typedef struct {
+  Square   path[EXACT_SOLUTION_MOVE_VALUES_MAX_DEPTH]; /**< @brief The moves leading from the root to the node. */
+  int      ply;                              /**< @brief The node distance from the root, it is the length of the path. */
+  Square   move;                             /**< @brief The move played at the node. */
+  int      value;                            /**< @brief The move value, given from the point of view of the player moving at the node. */
+  uint64_t optimal_line_count;               /**< @brief The number of distinct optimal lines that follow the move. */
+} ExactSolutionMoveValue;
+
 /**
  * @brief An exact solution is an entity that holds the result of a #endgame_solver_f run.
  */
@@ -129,65 +144,246 @@ typedef struct {
   Board        *final_board;                 /**< @brief The final board state. */
   uint64_t      leaf_count;                  /**< @brief The count of leaf nodes searched by the solver. */
   uint64_t      node_count;                  /**< @brief The count of all nodes touched by the solver. */
+  uint64_t      optimal_line_count;          /**< @brief The number of distinct optimal lines, zero when not computed. */
+  ExactSolutionMoveValue *move_values;       /**< @brief The values of the moves within the first plies. */
+  size_t        move_values_count;           /**< @brief The number of elements in the `move_values` array. */
+  size_t        move_values_size;            /**< @brief The allocated size of the `move_values` array. */
 } ExactSolution;
 
+/**
+ * @brief The index value that means no reference, for cells, lines, and game positions.
+ */
+#define PVE_NULL_INDEX UINT32_MAX
+
+/**
+ * @brief The maximum value of the reference count of a cell.
+ */
+#define PVE_CELL_MAX_REF_COUNT 0xFFFFFF
+
 /**
  * @brief A principal variation cell.
+ *
+ * @details The cell is packed into sixteen bytes. Cells and lines are allocated into segments,
+ *          and are referred by their 32-bit ordinal index across the segments, translated into
+ *          pointers by #pve_cell_at and #pve_line_at.
+ *          The game position is stored once, into the game position table of the environment.
+ *          A free cell has a reference count equal to zero.
  */
 typedef struct PVCell_ {
-  Square           move;           /**< @brief The current move. */
-  gboolean         is_active;      /**< @brief True when the cell is used. */
-  GamePositionX    gpx;            /**< @brief Game position. */
-  size_t           ref_count;      /**< @brief Number of entries into the dictionary. */
-  struct PVCell_  *next;           /**< @brief The next move. */
-  struct PVCell_ **variant;        /**< @brief A variant move. */
+  uint32_t         next;           /**< @brief The index of the next cell, #PVE_NULL_INDEX for the last cell of the line. */
+  uint32_t         variant;        /**< @brief The index of the variant line, #PVE_NULL_INDEX when there is no variant. */
+  uint32_t         position;       /**< @brief The index of the game position after the move, into the game position table. */
+  unsigned int     ref_count : 24; /**< @brief Number of references to the cell, from lines and from cells, greater than one when shared. */
+  unsigned int     move : 8;       /**< @brief The current move. */
 } PVCell;
 
 /**
- * @brief A principal variation environment.
+ * @brief An entry of the PVE game position table.
+ */
+typedef struct {
+  GamePositionX    gpx;            /**< @brief The game position. */
+  uint32_t         ref_count;      /**< @brief Number of cells referring to the game position, zero when the entry is free. */
+  uint32_t         next_free;      /**< @brief The index of the next free entry, meaningful when the entry is free. */
+} PVPosition;
+
+/**
+ * @brief An entry of the PVE line index.
  *
- * @details Fields `cells_size` and `lines_size` are assigned by the #pve_new function based on the empty count parameter.
- *          Pointers `cells`, `cells_stack`, `lines`, and `lines_stack` are also assigned in the #pve_new function
- *          by calls to malloc. All these fields are immutable.
+ * @details The entry maps a game position, and a search context, to the first cell of the line
+ *          that follows it. Cells having the same game position can then share the line that follows.
+ */
+typedef struct {
+  GamePositionX    gpx;            /**< @brief The game position that the line follows. */
+  uint64_t         context;        /**< @brief The search context, lines are shared only within the same context. */
+  PVCell          *head;           /**< @brief The first cell of the line, `NULL` in a key searching by context. */
+} PVLineIndexEntry;
+
+/**
+ * @brief A principal variation environment.
  *
- *          Fields `cells_stack_head` and `lines_stack_head` are mutable.
+ * @details Cells and lines are objects of two #mem_obj_allocator_t arenas, created by the #pve_new function.
+ *          Segments have a constant size, memory grows by steps of `1 << PVE_CELLS_SEGMENT_SHIFT` cells and
+ *          `1 << PVE_LINES_SEGMENT_SHIFT` lines, and free cells and lines are threaded into the free lists of the arenas.
+ *          Indexes of cells and lines are the arena indexes.
  *
- *          Field `state` is a bitfield of flags collecting the structure state.
- *           - Bit zero (least significant bit) describes the lines stack state. When `0` the stack is not ordered
- *             and the used pointers must be `NULL`. When `1` the unused lines are sorted in ascending order, as well as the
- *             used pointers, no `NULL` pointers occurs.
+ *          Field `state` is a bitfield of flags collecting the structure state, no flag is defined at present.
  */
 typedef struct {
   switches_t      state;                         /**< @brief The internal state of the structure. */
   GamePositionX  *root_game_position;            /**< @brief A pointer to the root game position. */
   PVCell        **root_line;                     /**< @brief A reference to the root line. */
-  size_t          cells_size;                    /**< @brief The count of cells contained by the cells array. */
-  size_t          cells_segments_size;           /**< @brief The count of cells segments. */
-  size_t          cells_first_size;              /**< @brief The number of cells contained by the first segment. */
-  PVCell        **cells_segments;                /**< @brief Segments are pointers to array of cells. */
-  PVCell        **cells_segments_head;           /**< @brief The next cells segment to be used. */
-  size_t         *cells_segments_sorted_sizes;   /**< @brief Sizes of cells segments in the sorted order. */
-  PVCell        **cells_segments_sorted;         /**< @brief Sorted cells segments, by means of the natural order of the memory adress. */
-  PVCell        **cells_stack;                   /**< @brief The pointer to the array of pointers used to manage the cells. */
-  PVCell        **cells_stack_head;              /**< @brief The pointer to the next, free to be assigned, pointer in the stack. */
-  size_t          cells_max_usage;               /**< @brief The maximum number of cells in use. */
-  size_t          lines_size;                    /**< @brief The total count of lines contained by the lines segments. */
-  size_t          lines_segments_size;           /**< @brief The count of lines segments. */
-  size_t          lines_first_size;              /**< @brief The number of lines contained by the first segment. */
-  PVCell       ***lines_segments;                /**< @brief Segments are pointers to array of lines. */
-  PVCell       ***lines_segments_head;           /**< @brief The next lines segment to be used. */
-  size_t         *lines_segments_sorted_sizes;   /**< @brief Sizes of lines segments in the sorted order. */
-  PVCell       ***lines_segments_sorted;         /**< @brief Sorted lines segments, by means of the natural order of the memory adress. */
-  PVCell       ***lines_stack;                   /**< @brief The pointer to an array of pointers used to manage the lines. */
-  PVCell       ***lines_stack_head;              /**< @brief The pointer to the next, free to be assigned, pointer in the lines array. */
-  size_t          lines_max_usage;               /**< @brief The maximum number of lines in use. */
+  mem_obj_allocator_t *cells;                    /**< @brief The arena of the cells. */
+  mem_obj_allocator_t *lines;                    /**< @brief The arena of the lines, a line is a pointer to its first cell. */
   size_t          line_create_count;             /**< @brief The number of time the pve_line_create() function has been called. */
   size_t          line_delete_count;             /**< @brief The number of time the pve_line_delete() function has been called. */
   size_t          line_add_move_count;           /**< @brief The number of time the pve_line_add_move() function has been called. */
   size_t          line_release_cell_count;       /**< @brief The number of times a cell is released in the pve_line_delete() function. */
-  rbt_table_t    *gp_table;                      /**< @brief Collects the unique set of game positions touched by the principal variation. */
+  PVPosition     *positions;                     /**< @brief The game position table, collects the unique set of game positions touched by the principal variation. */
+  size_t          positions_size;                /**< @brief The number of entries of the game position table. */
+  size_t          positions_count;               /**< @brief The number of entries in use. */
+  uint32_t        positions_free;                /**< @brief The index of the first free entry. */
+  hs_table_t     *positions_index;               /**< @brief Set of the indexes of the entries in use, hashed by game position. */
+  hs_table_t     *line_index;                    /**< @brief Set of the #PVLineIndexEntry of the shared lines, `NULL` until the first shared move. */
+  size_t          line_share_count;              /**< @brief The number of times a line has been shared by the pve_line_add_move_shared() function. */
 } PVEnv;
 
+/**
+ * @brief The magic string, eight bytes including the terminating null, opening a PVE dump file.
+ */
+#define PVE_DUMP_MAGIC "PVEDUMP"
+
+/**
+ * @brief The version of the PVE dump file format, written by #pve_dump_to_binary_file.
+ */
+#define PVE_DUMP_VERSION 2
+
+/**
+ * @brief The index value that, in a PVE dump file, means no reference.
+ */
+#define PVE_DUMP_NULL_INDEX UINT32_MAX
+
+/**
+ * @brief The header of a PVE dump file.
+ *
+ * @details A dump file is relocatable, it has no pointers, and can be mapped into memory and read in place.
+ *          All the fields are in the native byte order, sections are aligned to eight bytes.
+ *          The file is organized as follow:
+ *           - The header.
+ *           - The cells section, an array of #pve_dump_cell_t, starting at `cells_offset`.
+ *           - The lines section, an array of `uint32_t` indexes of the first cell of each line, starting at `lines_offset`.
+ *           - The game positions section, an array of unique #pve_dump_position_t, starting at `positions_offset`,
+ *             sorted by blacks, then whites, then player, see #pve_dump_find_position.
+ *
+ *          References among cells, lines, and game positions are indexes into the respective arrays,
+ *          value #PVE_DUMP_NULL_INDEX means no reference.
+ */
+typedef struct {
+  char           magic[8];                       /**< @brief The #PVE_DUMP_MAGIC string. */
+  uint32_t       version;                        /**< @brief The #PVE_DUMP_VERSION value. */
+  uint32_t       header_size;                    /**< @brief The size of the header in bytes. */
+  uint64_t       file_size;                      /**< @brief The size of the file in bytes. */
+  uint64_t       cells_offset;                   /**< @brief The offset of the cells section. */
+  uint64_t       cell_count;                     /**< @brief The count of cells. */
+  uint64_t       lines_offset;                   /**< @brief The offset of the lines section. */
+  uint64_t       line_count;                     /**< @brief The count of lines. */
+  uint64_t       positions_offset;               /**< @brief The offset of the game positions section. */
+  uint64_t       position_count;                 /**< @brief The count of game positions. */
+  uint32_t       root_line;                      /**< @brief The index of the root line. */
+  uint32_t       root_position;                  /**< @brief The index of the root game position. */
+  uint64_t       cells_max_usage;                /**< @brief Copy of the `max_used_count` field of the ::PVEnv `cells` allocator. */
+  uint64_t       lines_max_usage;                /**< @brief Copy of the `max_used_count` field of the ::PVEnv `lines` allocator. */
+  uint64_t       line_create_count;              /**< @brief Copy of the same ::PVEnv field. */
+  uint64_t       line_delete_count;              /**< @brief Copy of the same ::PVEnv field. */
+  uint64_t       line_add_move_count;            /**< @brief Copy of the same ::PVEnv field. */
+  uint64_t       line_release_cell_count;        /**< @brief Copy of the same ::PVEnv field. */
+  uint64_t       line_share_count;               /**< @brief Copy of the same ::PVEnv field. */
+} pve_dump_header_t;
+
+/**
+ * @brief A cell of a PVE dump file.
+ */
+typedef struct {
+  uint32_t       next;                           /**< @brief The index of the next cell. */
+  uint32_t       variant;                        /**< @brief The index of the variant line. */
+  uint32_t       position;                       /**< @brief The index of the game position after the move. */
+  uint8_t        move;                           /**< @brief The move. */
+  uint8_t        padding[3];                     /**< @brief Unused, set to zero. */
+} pve_dump_cell_t;
+
+/**
+ * @brief A game position of a PVE dump file.
+ */
+typedef struct {
+  uint64_t       blacks;                         /**< @brief The blacks square set. */
+  uint64_t       whites;                         /**< @brief The whites square set. */
+  uint32_t       player;                         /**< @brief The player to move. */
+  uint32_t       padding;                        /**< @brief Unused, set to zero. */
+} pve_dump_position_t;
+
+/**
+ * @brief A read only view of a PVE dump file mapped into memory.
+ *
+ * @details The view is returned by #pve_dump_open, and released by #pve_dump_close.
+ */
+typedef struct {
+  void                      *base;               /**< @brief The address of the mapping. */
+  size_t                     size;               /**< @brief The size of the mapping. */
+  const pve_dump_header_t   *header;             /**< @brief The file header. */
+  const pve_dump_cell_t     *cells;              /**< @brief The cells section. */
+  const uint32_t            *lines;              /**< @brief The lines section. */
+  const pve_dump_position_t *positions;          /**< @brief The game positions section. */
+} pve_dump_t;
+
+/**
+ * @brief A cursor enumerating, one at a time, the complete lines of a PVE dump.
+ *
+ * @details A complete line goes from the root game position to the end of the principal variation,
+ *          taking at each step either the move recorded in the line or one of its variants.
+ *          Lines are enumerated in lexicographic order of the moves, A1 first and pass last.
+ *          The cursor holds only the current line, memory doesn't depend on the size of the dump.
+ *
+ *          The cursor is initialized by #pve_dump_cursor_init, and advanced by #pve_dump_cursor_next.
+ *          After a successful call to #pve_dump_cursor_next, the current line has `depth` moves,
+ *          and the move at step `i` is `dump->cells[cells[i]].move`.
+ */
+typedef struct {
+  const pve_dump_t *dump;                        /**< @brief The dump view being traversed. */
+  size_t            depth;                       /**< @brief The number of moves of the current line. */
+  uint32_t          heads[PV_MAX_LENGTH];        /**< @brief For each step, the first cell of the chain of alternatives. */
+  uint32_t          cells[PV_MAX_LENGTH];        /**< @brief For each step, the cell taken by the current line. */
+  uint64_t          line_count;                  /**< @brief The number of lines returned so far. */
+  bool              is_started;                  /**< @brief True after the first call to #pve_dump_cursor_next. */
+} pve_dump_cursor_t;
+
+/**
+ * @brief The magic string, eight bytes including the terminating null, opening a search checkpoint file.
+ */
+#define SEARCH_CHECKPOINT_MAGIC "SRCHCKP"
+
+/**
+ * @brief The version of the search checkpoint file format, written by #search_checkpoint_write.
+ */
+#define SEARCH_CHECKPOINT_VERSION 1
+
+/**
+ * @brief Flag of the `pv_flags` field of #search_checkpoint_t, the PV is recorded.
+ */
+#define SEARCH_CHECKPOINT_PV_RECORDING 0x1
+
+/**
+ * @brief Flag of the `pv_flags` field of #search_checkpoint_t, all the variants of the PV are recorded.
+ */
+#define SEARCH_CHECKPOINT_PV_FULL_RECORDING 0x2
+
+/**
+ * @brief The state of a search, saved after the completion of a move of the root node.
+ *
+ * @details Moves of the root node are searched in a deterministic order, so the search can be resumed
+ *          skipping the first `searched_move_count` moves, starting from the saved best value and best move.
+ *
+ *          The checkpoint is made by two files. The first one, having the given path, holds this structure.
+ *          When the PV is recorded, the second one is a PVE dump, see #pve_dump_header_t, having the path
+ *          completed by the `.<searched_move_count>.pve` suffix. Its root line is the best line
+ *          of the root node, with its variants.
+ *          A new checkpoint writes its dump first, and then replaces the first file, so that a checkpoint
+ *          is never left incomplete, the dump of the previous checkpoint is finally removed.
+ */
+typedef struct {
+  char           magic[8];                       /**< @brief The #SEARCH_CHECKPOINT_MAGIC string. */
+  uint32_t       version;                        /**< @brief The #SEARCH_CHECKPOINT_VERSION value. */
+  char           solver[8];                      /**< @brief The id of the solver, null terminated. */
+  uint32_t       pv_flags;                       /**< @brief A combination of the SEARCH_CHECKPOINT_PV_ flags. */
+  uint64_t       root_blacks;                    /**< @brief The blacks square set of the root game position. */
+  uint64_t       root_whites;                    /**< @brief The whites square set of the root game position. */
+  uint32_t       root_player;                    /**< @brief The player to move of the root game position. */
+  uint32_t       searched_move_count;            /**< @brief The count of the root moves already searched. */
+  int32_t        value;                          /**< @brief The best value found so far, in the solver own convention. */
+  int32_t        best_move;                      /**< @brief The best move found so far. */
+  uint64_t       node_count;                     /**< @brief The count of nodes searched so far. */
+  uint64_t       leaf_count;                     /**< @brief The count of leaves searched so far. */
+  uint64_t       pve_line_add_move_count;        /**< @brief The same field of the PVE header, it matches the checkpoint with its dump. */
+} search_checkpoint_t;
+
 /**
  * @brief A search node is the most simple structure returned by the implementations of the search function.
  */
@@ -324,7 +520,7 @@ static const switches_t pve_internals_cells_section                 = 0x0100;
 /**
  * @brief The PVE internals sorted cells section switch mask.
  *
- * @details This switch mask identifies the cells stack section when calling the function #pve_internals_to_stream.
+ * @details This switch mask identifies the cells free list section when calling the function #pve_internals_to_stream.
  */
 static const switches_t pve_internals_cells_stack_section           = 0x0200;
 
@@ -352,7 +548,7 @@ static const switches_t pve_internals_lines_section                 = 0x1000;
 /**
  * @brief The PVE internals lines stack section switch mask.
  *
- * @details This switch mask identifies the lines stack section when calling the function #pve_internals_to_stream.
+ * @details This switch mask identifies the lines free list section when calling the function #pve_internals_to_stream.
  */
 static const switches_t pve_internals_lines_stack_section           = 0x2000;
 
@@ -366,16 +562,29 @@ static const switches_t pve_internals_root_game_position            = 0x4000;
 
 
 /**
- * @brief A mask associated with ::PVEnv::state field that identifies if the stack is sorted.
+ * @brief The PVE mask that activates basic lines checks in #pve_is_invariant_satisfied.
  */
-static const switches_t pve_state_lines_stack_sorted = 0x0001;
+static const switches_t pve_chk_inv_lines_basic = 0x0001;
 
+/**
+ * @brief The PVE mask that activates basic cells checks in #pve_is_invariant_satisfied.
+ */
+static const switches_t pve_chk_inv_cells_basic = 0x0002;
 
+/**
+ * @brief The PVE mask that activates the checks of the links among cells, lines, and game positions,
+ *        and of the reference counts of cells, in #pve_is_invariant_satisfied.
+ */
+static const switches_t pve_chk_inv_links = 0x0004;
 
 /**
- * @brief The PVE mask that activates basic lines checks in #pve_is_invariant_satisfied.
+ * @brief The PVE mask that activates the check that all the cells and lines in use are reachable
+ *        from the root line in #pve_is_invariant_satisfied.
+ *
+ * @details The check is satisfied by a complete PVE, as the one loaded from a dump file,
+ *          but not during the search, when lines being built are not yet linked to the root line.
  */
-static const switches_t pve_chk_inv_lines_basic = 0x0001;
+static const switches_t pve_chk_inv_reachability = 0x0008;
 
 
 
@@ -399,12 +608,50 @@ extern void
 exact_solution_set_solved_game_position_x (ExactSolution *const es,
                                            const GamePositionX *const gpx);
 
+extern void
+exact_solution_add_move_value (ExactSolution *const es,
+                               const Square *const path,
+                               const int ply,
+                               const Square move,
+                               const int value,
+                               const uint64_t optimal_line_count);
+
 
 
 /*********************************************/
 /* Function prototypes for the PVEnv entity. */
 /*********************************************/
 
+/**
+ * @brief Returns the cell having the given `index`.
+ *
+ * @param [in] pve   a pointer to the principal variation environment
+ * @param [in] index the cell index
+ * @return           a pointer to the cell, `NULL` when `index` is #PVE_NULL_INDEX
+ */
+inline static PVCell *
+pve_cell_at (const PVEnv *const pve,
+             const uint32_t index)
+{
+  if (index == PVE_NULL_INDEX) return NULL;
+  return (PVCell *) mem_obj_at(pve->cells, index);
+}
+
+/**
+ * @brief Returns the line having the given `index`.
+ *
+ * @param [in] pve   a pointer to the principal variation environment
+ * @param [in] index the line index
+ * @return           a pointer to the line, `NULL` when `index` is #PVE_NULL_INDEX
+ */
+inline static PVCell **
+pve_line_at (const PVEnv *const pve,
+             const uint32_t index)
+{
+  if (index == PVE_NULL_INDEX) return NULL;
+  return (PVCell **) mem_obj_at(pve->lines, index);
+}
+
 extern PVEnv *
 pve_new (const GamePositionX *const root_game_position);
 
@@ -435,6 +682,13 @@ pve_line_add_move2 (PVEnv *pve,
                     Square move,
                     GamePositionX *gpx);
 
+extern void
+pve_line_add_move_shared (PVEnv *pve,
+                          PVCell **line,
+                          Square move,
+                          GamePositionX *gpx,
+                          uint64_t context);
+
 extern void
 pve_line_add_variant (PVEnv *pve,
                       PVCell **line,
@@ -463,7 +717,7 @@ pve_line_copy_to_exact_solution (const PVEnv *const pve,
                                  const PVCell **const line,
                                  ExactSolution *const es);
 
-extern void
+extern bool
 pve_dump_to_binary_file (const PVEnv *const pve,
                          const char *const out_file_path);
 
@@ -474,11 +728,68 @@ extern void
 pve_summary_from_binary_file_to_stream (const char *const in_file_path,
                                         FILE *const stream);
 
+extern pve_dump_t *
+pve_dump_open (const char *const in_file_path);
+
+extern void
+pve_dump_close (pve_dump_t *dump);
+
+extern uint32_t
+pve_dump_find_position (const pve_dump_t *const dump,
+                        const GamePositionX *const gpx);
+
+extern void
+pve_dump_summary_to_stream (const pve_dump_t *const dump,
+                            FILE *const stream);
+
+extern void
+pve_dump_line_with_variants_to_stream (const pve_dump_t *const dump,
+                                       FILE *const stream);
+
+extern void
+pve_dump_root_line_as_table_to_stream (const pve_dump_t *const dump,
+                                       FILE *const stream);
+
+extern void
+pve_dump_cursor_init (pve_dump_cursor_t *const cursor,
+                      const pve_dump_t *const dump);
+
+extern bool
+pve_dump_cursor_next (pve_dump_cursor_t *const cursor);
+
+extern void
+pve_dump_lines_to_stream (const pve_dump_t *const dump,
+                          FILE *const stream,
+                          const bool as_csv);
+
 extern void
 pve_transform_to_standard_form(PVEnv *const pve);
 
 
 
+/**************************************************************/
+/* Function prototypes for the search_checkpoint_t structure. */
+/**************************************************************/
+
+extern char *
+search_checkpoint_pve_file_path (const char *const file_path,
+                                 const uint32_t searched_move_count);
+
+extern bool
+search_checkpoint_write (const char *const file_path,
+                         const search_checkpoint_t *const checkpoint,
+                         const PVEnv *const pve);
+
+extern bool
+search_checkpoint_read (const char *const file_path,
+                        search_checkpoint_t *const checkpoint);
+
+extern PVEnv *
+search_checkpoint_load_pve (const char *const file_path,
+                            const search_checkpoint_t *const checkpoint);
+
+
+
 /**************************************************/
 /* Function prototypes for the SearchNode entity. */
 /**************************************************/
@@ -0,0 +1,386 @@
+/**
+ * @file
+ *
+ * @brief Hash set module implementation.
+ *
+ * @par hash_set.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bit_works.h"
+#include "hash_set.h"
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Control byte values, a full slot holds the seven lowest bits of the item hash.
+ */
+#define HS_CTRL_EMPTY   ((uint8_t) 0x80)
+#define HS_CTRL_DELETED ((uint8_t) 0xFE)
+
+/*
+ * The slot count of a new set.
+ */
+#define HS_FIRST_SIZE HS_GROUP_WIDTH
+
+
+
+/*
+ * Prototypes for internal functions.
+ */
+
+static inline uint32_t
+hs_group_match (const uint8_t *const ctrl,
+                const uint8_t h2);
+
+static inline uint32_t
+hs_group_match_empty_or_deleted (const uint8_t *const ctrl);
+
+static inline void
+hs_set_ctrl (hs_table_t *const table,
+             const size_t i,
+             const uint8_t value);
+
+static size_t
+hs_find_free_slot (const hs_table_t *const table,
+                   const uint64_t hash);
+
+static void
+hs_alloc (hs_table_t *const table,
+          const size_t size);
+
+static void
+hs_resize (hs_table_t *const table,
+           const size_t size);
+
+/**
+ * @endcond
+ */
+
+
+
+/*********************************************************/
+/* Function implementations for the hs_table_t structure. */
+/*********************************************************/
+
+/**
+ * @brief Creates a new empty set.
+ *
+ * @param [in] item_size the size of the items
+ * @param [in] hash      the function computing the hash value of an item
+ * @param [in] equal     the function comparing an item with a key
+ * @param [in] param     a pointer passed to the hash and equal functions
+ * @return               the new set
+ */
+hs_table_t *
+hs_create (size_t item_size,
+           hs_item_hash_f *hash,
+           hs_item_equal_f *equal,
+           void *param)
+{
+  assert(item_size > 0);
+  assert(hash);
+  assert(equal);
+
+  hs_table_t *const table = (hs_table_t *) malloc(sizeof(hs_table_t));
+  assert(table);
+  table->item_size = item_size;
+  table->hash = hash;
+  table->equal = equal;
+  table->param = param;
+  hs_alloc(table, HS_FIRST_SIZE);
+  return table;
+}
+
+/**
+ * @brief Frees the set.
+ *
+ * @param [in,out] table the set, when `NULL` no action occurs
+ */
+void
+hs_destroy (hs_table_t *table)
+{
+  if (!table) return;
+  free(table->ctrl);
+  free(table->slots);
+  free(table);
+}
+
+/**
+ * @brief Searches the set for an item matching the key.
+ *
+ * @param [in] table the set
+ * @param [in] hash  the hash value of the key
+ * @param [in] key   the key
+ * @return           the matching item, or `NULL` when missing
+ */
+void *
+hs_find (const hs_table_t *table,
+         uint64_t hash,
+         const void *key)
+{
+  assert(table);
+
+  const size_t mask = table->size - 1;
+  const uint8_t h2 = hash & 0x7F;
+  size_t pos = (hash >> 7) & mask;
+  for (size_t step = HS_GROUP_WIDTH; ; step += HS_GROUP_WIDTH) {
+    const uint8_t *const group = table->ctrl + pos;
+    for (uint32_t m = hs_group_match(group, h2); m; m &= m - 1) {
+      char *const item = table->slots + ((pos + bit_works_bitscanLS1B_64_bsf(m)) & mask) * table->item_size;
+      if (table->equal(item, key, table->param)) return item;
+    }
+    if (hs_group_match(group, HS_CTRL_EMPTY)) return NULL;
+    pos = (pos + step) & mask;
+  }
+}
+
+/**
+ * @brief Searches the set for an item matching the key, and takes a slot for it when missing.
+ *
+ * @details When the key is missing, the returned slot is uninitialized, and the caller has to
+ *          write the item into it, before any other call on the set.
+ *          The item written must match the key, and must have the given hash value.
+ *
+ * @param [in,out] table    the set
+ * @param [in]     hash     the hash value of the key
+ * @param [in]     key      the key
+ * @param [out]    inserted set to true when the slot has been taken, it can be `NULL`
+ * @return                  the matching item, or the new slot
+ */
+void *
+hs_probe (hs_table_t *table,
+          uint64_t hash,
+          const void *key,
+          bool *inserted)
+{
+  void *item = hs_find(table, hash, key);
+  if (inserted) *inserted = item == NULL;
+  if (item) return item;
+
+  /* Resizing keeps at least one eighth of the slots empty. */
+  if (table->count + table->deleted + 1 > table->size - table->size / 8) {
+    hs_resize(table, (2 * (table->count + 1) > table->size - table->size / 8) ? 2 * table->size : table->size);
+  }
+  const size_t i = hs_find_free_slot(table, hash);
+  if (table->ctrl[i] == HS_CTRL_DELETED) table->deleted--;
+  hs_set_ctrl(table, i, hash & 0x7F);
+  table->count++;
+  return table->slots + i * table->item_size;
+}
+
+/**
+ * @brief Removes the item matching the key.
+ *
+ * @param [in,out] table the set
+ * @param [in]     hash  the hash value of the key
+ * @param [in]     key   the key
+ * @return               true when an item has been removed
+ */
+bool
+hs_delete (hs_table_t *table,
+           uint64_t hash,
+           const void *key)
+{
+  char *const item = hs_find(table, hash, key);
+  if (!item) return false;
+  const size_t i = (item - table->slots) / table->item_size;
+
+  /*
+   * The slot can be marked empty only when no probe sequence can have met the slot
+   * full, and then continued: that is when the groups starting at the slot, and ending at it,
+   * have an empty slot each, and the run of full slots around the slot is shorter than a group.
+   */
+  const size_t mask = table->size - 1;
+  const uint32_t after = hs_group_match(table->ctrl + i, HS_CTRL_EMPTY);
+  const uint32_t before = hs_group_match(table->ctrl + ((i - HS_GROUP_WIDTH) & mask), HS_CTRL_EMPTY);
+  const int leading_full_after = after ? bit_works_bitscanLS1B_64_bsf(after) : HS_GROUP_WIDTH;
+  const int trailing_full_before = before ? HS_GROUP_WIDTH - 1 - bit_works_bitscanMS1B_64_bsr(before) : HS_GROUP_WIDTH;
+  if (leading_full_after + trailing_full_before < HS_GROUP_WIDTH) {
+    hs_set_ctrl(table, i, HS_CTRL_EMPTY);
+  } else {
+    hs_set_ctrl(table, i, HS_CTRL_DELETED);
+    table->deleted++;
+  }
+  table->count--;
+  return true;
+}
+
+/**
+ * @brief Returns the next item, following the slot order.
+ *
+ * @details The cursor has to be set to zero to get the first item.
+ *          The set must not be changed during the iteration.
+ *
+ * @param [in]     table  the set
+ * @param [in,out] cursor the iteration state
+ * @return                the next item, or `NULL` when the iteration is completed
+ */
+void *
+hs_next (const hs_table_t *table,
+         size_t *cursor)
+{
+  assert(table);
+  assert(cursor);
+
+  while (*cursor < table->size) {
+    const size_t i = (*cursor)++;
+    if (!(table->ctrl[i] & 0x80)) return table->slots + i * table->item_size;
+  }
+  return NULL;
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Returns a bit mask, having bit i set when the control byte i of the group is equal to h2.
+ */
+static inline uint32_t
+hs_group_match (const uint8_t *const ctrl,
+                const uint8_t h2)
+{
+#ifdef __SSE2__
+  const __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+  return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) h2)));
+#else
+  uint32_t m = 0;
+  for (int i = 0; i < HS_GROUP_WIDTH; i++) m |= (uint32_t) (ctrl[i] == h2) << i;
+  return m;
+#endif
+}
+
+/*
+ * Returns a bit mask, having bit i set when the slot i of the group is empty or deleted.
+ */
+static inline uint32_t
+hs_group_match_empty_or_deleted (const uint8_t *const ctrl)
+{
+#ifdef __SSE2__
+  const __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+  return (uint32_t) _mm_movemask_epi8(group);
+#else
+  uint32_t m = 0;
+  for (int i = 0; i < HS_GROUP_WIDTH; i++) m |= (uint32_t) (ctrl[i] >> 7) << i;
+  return m;
+#endif
+}
+
+/*
+ * Sets the control byte of slot i, and its replica when the slot is in the first group.
+ */
+static inline void
+hs_set_ctrl (hs_table_t *const table,
+             const size_t i,
+             const uint8_t value)
+{
+  table->ctrl[i] = value;
+  if (i < HS_GROUP_WIDTH) table->ctrl[table->size + i] = value;
+}
+
+/*
+ * Returns the first empty or deleted slot met by the probe sequence of the hash.
+ */
+static size_t
+hs_find_free_slot (const hs_table_t *const table,
+                   const uint64_t hash)
+{
+  const size_t mask = table->size - 1;
+  size_t pos = (hash >> 7) & mask;
+  for (size_t step = HS_GROUP_WIDTH; ; step += HS_GROUP_WIDTH) {
+    const uint32_t m = hs_group_match_empty_or_deleted(table->ctrl + pos);
+    if (m) return (pos + bit_works_bitscanLS1B_64_bsf(m)) & mask;
+    pos = (pos + step) & mask;
+  }
+}
+
+/*
+ * Allocates empty storage having the given slot count.
+ */
+static void
+hs_alloc (hs_table_t *const table,
+          const size_t size)
+{
+  assert(size >= HS_GROUP_WIDTH && (size & (size - 1)) == 0);
+  table->size = size;
+  table->count = 0;
+  table->deleted = 0;
+  table->ctrl = (uint8_t *) malloc(size + HS_GROUP_WIDTH);
+  assert(table->ctrl);
+  memset(table->ctrl, HS_CTRL_EMPTY, size + HS_GROUP_WIDTH);
+  table->slots = (char *) malloc(size * table->item_size);
+  assert(table->slots);
+}
+
+/*
+ * Moves the items into new storage having the given slot count, deleted slots are dropped.
+ * The rehash is never done in place: when the slot count is unchanged, fresh storage of the
+ * same size is allocated, so reclaiming tombstones temporarily needs twice the table memory.
+ */
+static void
+hs_resize (hs_table_t *const table,
+           const size_t size)
+{
+  uint8_t *const old_ctrl = table->ctrl;
+  char *const old_slots = table->slots;
+  const size_t old_size = table->size;
+  hs_alloc(table, size);
+  for (size_t i = 0; i < old_size; i++) {
+    if (old_ctrl[i] & 0x80) continue;
+    const char *const item = old_slots + i * table->item_size;
+    const uint64_t hash = table->hash(item, table->param);
+    const size_t j = hs_find_free_slot(table, hash);
+    hs_set_ctrl(table, j, hash & 0x7F);
+    memcpy(table->slots + j * table->item_size, item, table->item_size);
+    table->count++;
+  }
+  free(old_ctrl);
+  free(old_slots);
+}
+
+/**
+ * @endcond
+ */
@@ -0,0 +1,181 @@
+/**
+ * @file
+ *
+ * @brief A hash set is an unordered collection of items, stored by open addressing.
+ *
+ * @details This module defines a set, the items are all of the same type and size, and are
+ *          stored by value into a single array of slots. It complements the red-black tree module
+ *          when the order of the items is not relevant, trading traversal in sorted order for
+ *          constant time lookups.
+ *
+ * The layout follows the one known as SwissTable. Each slot has a control byte, that is
+ *    either empty, deleted, or holds the seven lowest bits of the item hash.
+ *    Lookups read the control bytes sixteen at a time, and compare them in parallel with the
+ *    hash bits of the key, by means of SSE2 instructions when available, so that items are
+ *    compared only when the hash bits match.
+ *    The remaining bits of the hash select the first group of slots probed, groups are then
+ *    probed following the triangular sequence, that visits every group when the slot count is a
+ *    power of two.
+ *
+ * Hash values are computed by the caller, and passed to the lookup functions together with
+ *    the key, the key can then be of a type different from the item one, as far as the
+ *    equality function of the set knows how to compare them.
+ *    The set calls the hash function it is created with only when it is resized, to compute the
+ *    hash value of the items already collected.
+ *    Hash values must be well distributed on all the bits.
+ *
+ * Items are addressed by pointers into the slot array, that are invalidated by any insertion
+ *    that resizes the set.
+ *
+ * See:
+ * - Matt Kulukundis, Designing a Fast, Efficient, Cache-friendly Hash Table, Step by Step, CppCon 2017.
+ * - The Abseil project: <a href="https://abseil.io/about/design/swisstables" target="_blank"> Swiss Tables Design Notes</a>.
+ *
+ * @par hash_set.h
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#ifndef HASH_SET_H
+#define HASH_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+
+/****************************/
+/* Pre-processor constants. */
+/****************************/
+
+/**
+ * @brief The number of control bytes compared at once.
+ */
+#define HS_GROUP_WIDTH 16
+
+
+
+/*************************/
+/* Pre-processor macros. */
+/*************************/
+
+/**
+ * @brief Returns the number of items collected by `table`.
+ */
+#define hs_count(table) ((size_t) (table)->count)
+
+
+
+/*******************/
+/* Function types. */
+/*******************/
+
+/**
+ * @brief Returns the hash value of the item.
+ *
+ * @details The value must be equal to the one passed to the lookup functions
+ *          when the key matches the item.
+ *
+ * @param [in]     item  a pointer to the item
+ * @param [in,out] param a utility pointer used to exchange info to and from the function
+ * @return               the hash value
+ */
+typedef uint64_t
+hs_item_hash_f (const void *item,
+                void *param);
+
+/**
+ * @brief Returns true when the `item` matches the `key`.
+ *
+ * @param [in]     item  a pointer to the item stored in the set
+ * @param [in]     key   a pointer to the key given to the lookup function
+ * @param [in,out] param a utility pointer used to exchange info to and from the function
+ * @return               true when the two match
+ */
+typedef bool
+hs_item_equal_f (const void *item,
+                 const void *key,
+                 void *param);
+
+
+
+/*********************/
+/* Type definitions. */
+/*********************/
+
+/**
+ * @brief Hash set data structure.
+ */
+typedef struct hs_table {
+  uint8_t         *ctrl;                        /**< @brief Control bytes, the first group is replicated after the last slot. */
+  char            *slots;                       /**< @brief Item storage. */
+  size_t           item_size;                   /**< @brief The size of an item. */
+  size_t           size;                        /**< @brief The number of slots, a power of two. */
+  size_t           count;                       /**< @brief Number of items in the set. */
+  size_t           deleted;                     /**< @brief Number of slots marked as deleted. */
+  hs_item_hash_f  *hash;                        /**< @brief Hash function, used when resizing. */
+  hs_item_equal_f *equal;                       /**< @brief Equality function. */
+  void            *param;                       /**< @brief Extra argument to hash and equality functions. */
+} hs_table_t;
+
+
+
+/**********************************************/
+/* Function prototypes for the set structure. */
+/**********************************************/
+
+extern hs_table_t *
+hs_create (size_t item_size,
+           hs_item_hash_f *hash,
+           hs_item_equal_f *equal,
+           void *param);
+
+extern void
+hs_destroy (hs_table_t *table);
+
+extern void *
+hs_find (const hs_table_t *table,
+         uint64_t hash,
+         const void *key);
+
+extern void *
+hs_probe (hs_table_t *table,
+          uint64_t hash,
+          const void *key,
+          bool *inserted);
+
+extern bool
+hs_delete (hs_table_t *table,
+           uint64_t hash,
+           const void *key);
+
+extern void *
+hs_next (const hs_table_t *table,
+         size_t *cursor);
+
+
+
+#endif /* HASH_SET_H */
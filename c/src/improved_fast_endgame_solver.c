@@ -38,6 +38,7 @@
 #include <string.h>
 
 #include "game_tree_logger.h"
+#include "game_tree_stats.h"
 #include "improved_fast_endgame_solver.h"
 
 
@@ -81,6 +82,11 @@ static GamePosition *
 ifes_game_position_translation (uint8_t *board,
                                 int color);
 
+static void
+ifes_game_position_x_translation (const uint8_t *const board,
+                                  const int color,
+                                  GamePositionX *const gpx);
+
 static void
 game_position_to_ifes_board (const GamePosition *const gp,
                              uint8_t *b,
@@ -316,6 +322,9 @@ static const uint8_t flipping_dir_mask_table[91] =
 /* The logging environment structure. */
 static LogEnv *log_env = NULL;
 
+/* The game tree statistics, NULL when turned off. */
+static GameTreeStats *tree_stats = NULL;
+
 /* The total number of call to the recursive function that traverse the game DAG. */
 static uint64_t call_count = 0;
 
@@ -431,8 +440,10 @@ game_position_ifes_solve (const GamePositionX *const root,
 
   if (log_env->log_is_on) {
     gp_hash_stack[0] = 0;
+    game_tree_log_set_filters(log_env, env->log_max_depth, env->log_sample_rate, env->log_root_moves);
     game_tree_log_open_h(log_env);
   }
+  if (env->tree_stats) tree_stats = game_tree_stats_new();
 
   result = exact_solution_new();
   result->solved_game_position = game_position_clone(root_gp);
@@ -471,6 +482,12 @@ game_position_ifes_solve (const GamePositionX *const root,
 
   game_tree_log_close(log_env);
 
+  if (tree_stats) {
+    game_tree_stats_print(tree_stats, stdout);
+    game_tree_stats_free(tree_stats);
+    tree_stats = NULL;
+  }
+
   return result;
 }
 
@@ -543,9 +560,26 @@ static GamePosition *
 ifes_game_position_translation (uint8_t *board,
                                 int color)
 {
-  SquareSet blacks = 0ULL;
-  SquareSet whites = 0ULL;
-  Player    p      = (color == IFES_WHITE) ? WHITE_PLAYER : BLACK_PLAYER;
+  GamePositionX gpx;
+  ifes_game_position_x_translation(board, color, &gpx);
+  return game_position_new(board_new(gpx.blacks, gpx.whites), gpx.player);
+}
+
+/**
+ * @brief Translates board and color into the correspondig game position x, without allocating memory.
+ *
+ * @param [in]  board a board
+ * @param [in]  color a color
+ * @param [out] gpx   the equivalent game position x
+ */
+static void
+ifes_game_position_x_translation (const uint8_t *const board,
+                                  const int color,
+                                  GamePositionX *const gpx)
+{
+  gpx->blacks = 0ULL;
+  gpx->whites = 0ULL;
+  gpx->player = (color == IFES_WHITE) ? WHITE_PLAYER : BLACK_PLAYER;
 
   for (int i = 0; i < 64; i++) {
     const int col = i % 8;
@@ -554,16 +588,15 @@ ifes_game_position_translation (uint8_t *board,
     const SquareSet mask = 1ULL << i;
     switch (board[index]) {
     case IFES_WHITE:
-      whites |= mask;
+      gpx->whites |= mask;
       break;
     case IFES_BLACK:
-      blacks |= mask;
+      gpx->blacks |= mask;
       break;
     default:
       break;
     }
   }
-  return game_position_new(board_new(blacks, whites), p);
 }
 
 /**
@@ -1265,9 +1298,9 @@ fastest_first_end_solve (ExactSolution *solution, uint8_t *board, int alpha, int
     }
   }
 
+  if (log_env->log_is_on || tree_stats) gp_hash_stack_fill_point++;
   if (log_env->log_is_on) {
     call_count++;
-    gp_hash_stack_fill_point++;
     GamePosition *gp = ifes_game_position_translation(board, color);
     LogDataH log_data;
     log_data.sub_run_id = 0;
@@ -1281,9 +1314,15 @@ fastest_first_end_solve (ExactSolution *solution, uint8_t *board, int alpha, int
     gchar *json_doc = game_tree_log_data_h_json_doc(gp_hash_stack_fill_point, gp);
     log_data.json_doc = json_doc;
     log_data.json_doc_len = strlen(json_doc);
+    log_data.call_level = gp_hash_stack_fill_point;
     game_tree_log_write_h(log_env, &log_data);
     g_free(json_doc);
   }
+  if (tree_stats) {
+    GamePositionX gpx;
+    ifes_game_position_x_translation(board, color, &gpx);
+    game_tree_stats_add_node(tree_stats, gp_hash_stack_fill_point - 1, &gpx);
+  }
 
   if (moves != 0) {
     for (int i = 0; i < moves; i++) {
@@ -1357,7 +1396,7 @@ fastest_first_end_solve (ExactSolution *solution, uint8_t *board, int alpha, int
  end:
   ;
 
-  if (log_env->log_is_on) {
+  if (log_env->log_is_on || tree_stats) {
     gp_hash_stack_fill_point--;
   }
 
@@ -0,0 +1,309 @@
+/**
+ * @file
+ *
+ * @brief LZ block module implementation.
+ *
+ * @par lz_block.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "lz_block.h"
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Matches are at least four bytes long.
+ */
+#define LZ_MIN_MATCH 4
+
+/*
+ * The last five bytes of the block are literals, and the last match starts twelve bytes before the end.
+ */
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+
+/*
+ * The largest offset of a match.
+ */
+#define LZ_MAX_OFFSET 65535
+
+/*
+ * The hash table has 2^LZ_HASH_BITS entries.
+ */
+#define LZ_HASH_BITS 12
+
+
+
+/*
+ * Prototypes for internal functions.
+ */
+
+static inline uint32_t
+lz_read32 (const uint8_t *const p);
+
+static inline uint32_t
+lz_hash (const uint32_t sequence);
+
+static uint8_t *
+lz_put_length (uint8_t *op,
+               const uint8_t *const op_end,
+               size_t len);
+
+static uint8_t *
+lz_put_sequence (uint8_t *op,
+                 const uint8_t *const op_end,
+                 const uint8_t *const literals,
+                 const size_t literal_len,
+                 const size_t offset,
+                 const size_t match_len);
+
+static int
+lz_get_length (const uint8_t **ip,
+               const uint8_t *const ip_end,
+               size_t *const len);
+
+/**
+ * @endcond
+ */
+
+
+
+/********************************************************/
+/* Function implementations for the LZ block functions. */
+/********************************************************/
+
+/**
+ * @brief Compresses the source buffer into a block.
+ *
+ * @details A destination capacity of #lz_block_bound of the source length is always enough.
+ *
+ * @param [in]  src          the data to be compressed
+ * @param [in]  src_len      the length of the data
+ * @param [out] dst          the buffer receiving the block
+ * @param [in]  dst_capacity the size of the destination buffer
+ * @return                   the size of the block, or zero when it does not fit the destination buffer
+ */
+size_t
+lz_block_compress (const uint8_t *src,
+                   size_t src_len,
+                   uint8_t *dst,
+                   size_t dst_capacity)
+{
+  assert(src || src_len == 0);
+  assert(dst);
+
+  uint32_t table[1 << LZ_HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  uint8_t *op = dst;
+  const uint8_t *const op_end = dst + dst_capacity;
+  size_t anchor = 0;
+
+  if (src_len > LZ_MATCH_LIMIT) {
+    const size_t match_limit = src_len - LZ_MATCH_LIMIT;
+    const size_t match_end_limit = src_len - LZ_LAST_LITERALS;
+    size_t ip = 0;
+    while (ip < match_limit) {
+      const uint32_t sequence = lz_read32(src + ip);
+      const uint32_t h = lz_hash(sequence);
+      const size_t candidate = table[h];
+      table[h] = ip;
+      if (candidate >= ip || ip - candidate > LZ_MAX_OFFSET || lz_read32(src + candidate) != sequence) {
+        ip++;
+        continue;
+      }
+      size_t len = LZ_MIN_MATCH;
+      while (ip + len < match_end_limit && src[candidate + len] == src[ip + len]) len++;
+      op = lz_put_sequence(op, op_end, src + anchor, ip - anchor, ip - candidate, len);
+      if (!op) return 0;
+      ip += len;
+      anchor = ip;
+    }
+  }
+
+  /* The last sequence has only literals. */
+  op = lz_put_sequence(op, op_end, src + anchor, src_len - anchor, 0, 0);
+  if (!op) return 0;
+  return op - dst;
+}
+
+/**
+ * @brief Decompresses the block.
+ *
+ * @param [in]  src          the block
+ * @param [in]  src_len      the size of the block
+ * @param [out] dst          the buffer receiving the data
+ * @param [in]  dst_capacity the size of the destination buffer
+ * @return                   the length of the data, or #LZ_BLOCK_ERROR when the block is not valid,
+ *                           or when the data does not fit the destination buffer
+ */
+size_t
+lz_block_decompress (const uint8_t *src,
+                     size_t src_len,
+                     uint8_t *dst,
+                     size_t dst_capacity)
+{
+  assert(src || src_len == 0);
+  assert(dst || dst_capacity == 0);
+
+  const uint8_t *ip = src;
+  const uint8_t *const ip_end = src + src_len;
+  uint8_t *op = dst;
+  const uint8_t *const op_end = dst + dst_capacity;
+
+  if (src_len == 0) return LZ_BLOCK_ERROR;
+
+  for (;;) {
+    if (ip >= ip_end) return LZ_BLOCK_ERROR;
+    const uint8_t token = *ip++;
+
+    size_t literal_len = token >> 4;
+    if (literal_len == 15 && !lz_get_length(&ip, ip_end, &literal_len)) return LZ_BLOCK_ERROR;
+    if (literal_len > (size_t) (ip_end - ip) || literal_len > (size_t) (op_end - op)) return LZ_BLOCK_ERROR;
+    memcpy(op, ip, literal_len);
+    ip += literal_len;
+    op += literal_len;
+
+    if (ip == ip_end) break;
+
+    if (ip_end - ip < 2) return LZ_BLOCK_ERROR;
+    const size_t offset = ip[0] | (size_t) ip[1] << 8;
+    ip += 2;
+    if (offset == 0 || offset > (size_t) (op - dst)) return LZ_BLOCK_ERROR;
+
+    size_t match_len = token & 0x0F;
+    if (match_len == 15 && !lz_get_length(&ip, ip_end, &match_len)) return LZ_BLOCK_ERROR;
+    match_len += LZ_MIN_MATCH;
+    if (match_len > (size_t) (op_end - op)) return LZ_BLOCK_ERROR;
+
+    /* The match can overlap the bytes it is producing, it is copied one byte at a time. */
+    const uint8_t *match = op - offset;
+    for (size_t i = 0; i < match_len; i++) op[i] = match[i];
+    op += match_len;
+  }
+
+  return op - dst;
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+static inline uint32_t
+lz_read32 (const uint8_t *const p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/*
+ * Fibonacci hashing of the four byte sequence.
+ */
+static inline uint32_t
+lz_hash (const uint32_t sequence)
+{
+  return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/*
+ * Writes the part of a length that exceeds the four bits of the token, as a run of 255 bytes closed by a smaller one.
+ * Returns NULL when the output does not fit.
+ */
+static uint8_t *
+lz_put_length (uint8_t *op,
+               const uint8_t *const op_end,
+               size_t len)
+{
+  for (; len >= 255; len -= 255) {
+    if (op == op_end) return NULL;
+    *op++ = 255;
+  }
+  if (op == op_end) return NULL;
+  *op++ = (uint8_t) len;
+  return op;
+}
+
+/*
+ * Writes a sequence, a match length of zero marks the last sequence, that has only literals.
+ * Returns NULL when the output does not fit.
+ */
+static uint8_t *
+lz_put_sequence (uint8_t *op,
+                 const uint8_t *const op_end,
+                 const uint8_t *const literals,
+                 const size_t literal_len,
+                 const size_t offset,
+                 const size_t match_len)
+{
+  const size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+  if (op == op_end) return NULL;
+  *op++ = (uint8_t) (((literal_len < 15 ? literal_len : 15) << 4) | (match_code < 15 ? match_code : 15));
+  if (literal_len >= 15 && !(op = lz_put_length(op, op_end, literal_len - 15))) return NULL;
+  if (literal_len > (size_t) (op_end - op)) return NULL;
+  memcpy(op, literals, literal_len);
+  op += literal_len;
+  if (match_len == 0) return op;
+  if (op_end - op < 2) return NULL;
+  *op++ = (uint8_t) offset;
+  *op++ = (uint8_t) (offset >> 8);
+  if (match_code >= 15 && !(op = lz_put_length(op, op_end, match_code - 15))) return NULL;
+  return op;
+}
+
+/*
+ * Adds to len the bytes of an extended length, returns zero when the block ends before the length does.
+ */
+static int
+lz_get_length (const uint8_t **ip,
+               const uint8_t *const ip_end,
+               size_t *const len)
+{
+  uint8_t b;
+  do {
+    if (*ip >= ip_end) return 0;
+    b = *(*ip)++;
+    *len += b;
+  } while (b == 255);
+  return 1;
+}
+
+/**
+ * @endcond
+ */
@@ -0,0 +1,99 @@
+/**
+ * @file
+ *
+ * @brief An in-tree implementation of the LZ4 block compression format.
+ *
+ * @details This module compresses a buffer into a block, and decompresses it back.
+ *          It is used where large binary files, as the game tree log, are written in blocks,
+ *          and the time spent writing them is larger than the one spent compressing them.
+ *
+ * The compressed block follows the LZ4 block format, a sequence of literal runs, each one followed
+ *    by a match, given as an offset back into the decompressed data, not farther than 64 KiB,
+ *    and a length. The block does not carry its decompressed size, that has to be stored by the caller.
+ *    Blocks written by this module can be decompressed by any LZ4 implementation, and the other
+ *    way around.
+ *
+ * The compressor is the greedy one: four byte sequences are hashed into a table
+ *    remembering their last position, and a match is taken as soon as one is found.
+ *    The decompressor checks all the offsets and lengths it reads, and never reads or writes
+ *    out of the given buffers, also when the block is corrupted.
+ *
+ * See:
+ * - <a href="https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md" target="_blank"> LZ4 Block Format Description</a>.
+ *
+ * @par lz_block.h
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+/****************************/
+/* Pre-processor constants. */
+/****************************/
+
+/**
+ * @brief The value returned by #lz_block_decompress when the block is not valid.
+ */
+#define LZ_BLOCK_ERROR ((size_t) -1)
+
+
+
+/*************************/
+/* Pre-processor macros. */
+/*************************/
+
+/**
+ * @brief Returns the largest size of the block compressing `n` bytes.
+ */
+#define lz_block_bound(n) ((size_t) (n) + (size_t) (n) / 255 + 16)
+
+
+
+/******************************************/
+/* Function prototypes for the LZ blocks. */
+/******************************************/
+
+extern size_t
+lz_block_compress (const uint8_t *src,
+                   size_t src_len,
+                   uint8_t *dst,
+                   size_t dst_capacity);
+
+extern size_t
+lz_block_decompress (const uint8_t *src,
+                     size_t src_len,
+                     uint8_t *dst,
+                     size_t dst_capacity);
+
+
+
+#endif /* LZ_BLOCK_H */
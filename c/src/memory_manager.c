@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <string.h>
 
 
 #include "memory_manager.h"
@@ -335,3 +336,303 @@ mem_dbg_fail (const char *message, ...)
 /*
  * End of emory tracker mem_dbg_allocator_t implementation.
  */
+
+
+
+/*
+ * Object allocator mem_obj_allocator_t implementation.
+ */
+
+/* Static functions. */
+static void *mem_obj_allocate (mem_allocator_t *allocator, size_t size);
+static void mem_obj_deallocate (mem_allocator_t *allocator, void *block);
+static void mem_obj_segment_new (mem_obj_allocator_t *a);
+static inline uint32_t mem_obj_link_get (const mem_obj_allocator_t *a, const uint32_t index);
+static inline void mem_obj_link_set (mem_obj_allocator_t *a, const uint32_t index, const uint32_t link);
+
+/**
+ * @brief Returns a newly created object allocator.
+ *
+ * @details No memory is reserved for objects until the first allocation.
+ *          The table of segments starts with `segments_in_stack` entries, and it is doubled when full,
+ *          that is the only reallocation done by the allocator.
+ *
+ * @param [in] object_size       the size of the objects, it must not be lower than the size of an `uint32_t`
+ * @param [in] objects_x_segment the number of objects of a segment, it must be a power of two
+ * @param [in] segments_in_stack the initial size of the table of segments, it must be greater than zero
+ * @return                       a pointer to the new allocator
+ */
+mem_obj_allocator_t *
+mem_obj_allocator_new (const size_t object_size,
+                       const size_t objects_x_segment,
+                       const size_t segments_in_stack)
+{
+  assert(object_size >= sizeof(uint32_t));
+  assert(objects_x_segment > 0 && (objects_x_segment & (objects_x_segment - 1)) == 0);
+  assert(objects_x_segment <= (size_t) 1 << 31);
+  assert(segments_in_stack > 0);
+
+  mem_obj_allocator_t *a = mem_dbg_malloc(sizeof(mem_obj_allocator_t));
+  a->allocator.malloc = mem_obj_allocate;
+  a->allocator.free = mem_obj_deallocate;
+  a->object_size = object_size;
+  a->segment_shift = 0;
+  while (((size_t) 1 << a->segment_shift) < objects_x_segment) a->segment_shift++;
+  a->segments_size = segments_in_stack;
+  a->segments_count = 0;
+  a->segments = mem_dbg_malloc(segments_in_stack * sizeof(char *));
+  a->segments_sorted = mem_dbg_malloc(segments_in_stack * sizeof(mem_obj_segment_t));
+  a->top = 0;
+  a->free_head = MEM_OBJ_NULL_INDEX;
+  a->used_count = 0;
+  a->max_used_count = 0;
+  return a;
+}
+
+/**
+ * @brief Frees the allocator, and all the objects it has handed out.
+ *
+ * @details If a null pointer is passed as argument, no action occurs.
+ *
+ * @param [in,out] a the object allocator
+ */
+void
+mem_obj_allocator_free (mem_obj_allocator_t *a)
+{
+  if (!a) return;
+  for (size_t i = 0; i < a->segments_count; i++) free(a->segments[i]);
+  free(a->segments);
+  free(a->segments_sorted);
+  free(a);
+}
+
+/**
+ * @brief Returns the mem_allocator_t field associated with `a`.
+ *
+ * @details Blocks requested through the generic interface cannot be larger than the object size.
+ *
+ * @param [in] a the object allocator
+ * @return       the associated allocator
+ */
+mem_allocator_t *
+mem_obj_allocator (mem_obj_allocator_t *a)
+{
+  return &a->allocator;
+}
+
+/**
+ * @brief Frees all the objects at once.
+ *
+ * @details Segments are kept, and reused by the following allocations, objects
+ *          are handed out again starting from index zero.
+ *
+ * @param [in,out] a the object allocator
+ */
+void
+mem_obj_allocator_reset (mem_obj_allocator_t *a)
+{
+  assert(a);
+  a->top = 0;
+  a->free_head = MEM_OBJ_NULL_INDEX;
+  a->used_count = 0;
+}
+
+/**
+ * @brief Verifies the allocator internal structure.
+ *
+ * @details Checks that segments cover the objects ever handed out, that the sorted table
+ *          matches the allocation order one, and that the free list is made of valid indexes,
+ *          having a length consistent with the count of objects in use.
+ *
+ * @param [in] a the object allocator
+ * @return       true when the structure is consistent
+ */
+bool
+mem_obj_allocator_is_consistent (const mem_obj_allocator_t *a)
+{
+  if (!a || !a->segments || !a->segments_sorted) return false;
+  if (a->segments_count > a->segments_size) return false;
+  if (a->top > (uint64_t) a->segments_count << a->segment_shift) return false;
+  if (a->used_count > a->top || a->used_count > a->max_used_count) return false;
+  for (size_t i = 0; i < a->segments_count; i++) {
+    const mem_obj_segment_t *s = &a->segments_sorted[i];
+    if (s->ordinal >= a->segments_count || a->segments[s->ordinal] != s->content) return false;
+    if (i > 0 && (uintptr_t) s->content <= (uintptr_t) a->segments_sorted[i - 1].content) return false;
+  }
+  const size_t free_count = a->top - a->used_count;
+  size_t n = 0;
+  for (uint32_t i = a->free_head; i != MEM_OBJ_NULL_INDEX; i = mem_obj_link_get(a, i)) {
+    if (i >= a->top || ++n > free_count) return false;
+  }
+  return n == free_count;
+}
+
+/**
+ * @brief Returns a bitmap having a bit set for each free object.
+ *
+ * @details The bitmap has a bit for each object ever handed out, bit `i` is set when
+ *          object `i` is on the free list. The caller is responsible for freeing it.
+ *
+ * @param [in] a the object allocator
+ * @return       the bitmap, an array of `top / 64 + 1` words
+ */
+uint64_t *
+mem_obj_allocator_free_bitmap (const mem_obj_allocator_t *a)
+{
+  assert(a);
+  uint64_t *bitmap = calloc(a->top / 64 + 1, sizeof(uint64_t));
+  if (!bitmap) mem_dbg_fail("out of memory");
+  for (uint32_t i = a->free_head; i != MEM_OBJ_NULL_INDEX; i = mem_obj_link_get(a, i)) {
+    bitmap[i / 64] |= (uint64_t) 1 << (i % 64);
+  }
+  return bitmap;
+}
+
+/**
+ * @brief Takes an object, and returns its index.
+ *
+ * @details The object content is undefined, the last freed object is reused first.
+ *          Aborts when memory is exhausted, or when the index space is.
+ *
+ * @param [in,out] a the object allocator
+ * @return           the index of the object
+ */
+uint32_t
+mem_obj_alloc_index (mem_obj_allocator_t *a)
+{
+  uint32_t index = a->free_head;
+  if (index != MEM_OBJ_NULL_INDEX) {
+    a->free_head = mem_obj_link_get(a, index);
+  } else {
+    if (a->top == MEM_OBJ_NULL_INDEX) mem_dbg_fail("object index space exhausted");
+    if (a->top == (uint64_t) a->segments_count << a->segment_shift) mem_obj_segment_new(a);
+    index = a->top++;
+  }
+  if (++a->used_count > a->max_used_count) a->max_used_count = a->used_count;
+  return index;
+}
+
+/**
+ * @brief Returns the object to the allocator.
+ *
+ * @details The first four bytes of the object are overwritten by the free list link.
+ *
+ * @param [in,out] a     the object allocator
+ * @param [in]     index the index of the object, it must be in use
+ */
+void
+mem_obj_free_index (mem_obj_allocator_t *a,
+                    const uint32_t index)
+{
+  assert(index < a->top);
+  mem_obj_link_set(a, index, a->free_head);
+  a->free_head = index;
+  a->used_count--;
+}
+
+/**
+ * @brief Returns the index of the object having the given address.
+ *
+ * @details The search is a bisection on the segments sorted by address.
+ *          Returns #MEM_OBJ_NULL_INDEX when `object` is `NULL`, or when it is not
+ *          an object of the allocator.
+ *
+ * @param [in] a      the object allocator
+ * @param [in] object the address of the object
+ * @return            the object index
+ */
+uint32_t
+mem_obj_index_of (const mem_obj_allocator_t *a,
+                  const void *object)
+{
+  if (!object) return MEM_OBJ_NULL_INDEX;
+  const uintptr_t address = (uintptr_t) object;
+  size_t lo = 0, hi = a->segments_count;
+  while (hi - lo > 1) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if ((uintptr_t) a->segments_sorted[mid].content <= address) lo = mid;
+    else hi = mid;
+  }
+  if (hi == 0) return MEM_OBJ_NULL_INDEX;
+  const mem_obj_segment_t *s = &a->segments_sorted[lo];
+  const uintptr_t offset = address - (uintptr_t) s->content;
+  if (address < (uintptr_t) s->content || offset >= a->object_size << a->segment_shift) return MEM_OBJ_NULL_INDEX;
+  return (uint32_t) ((s->ordinal << a->segment_shift) + offset / a->object_size);
+}
+
+/*
+ * The mem_allocator_t malloc function of the object allocator.
+ */
+static void *
+mem_obj_allocate (mem_allocator_t *allocator,
+                  size_t size)
+{
+  mem_obj_allocator_t *a = (mem_obj_allocator_t *) allocator;
+  if (size == 0 || size > a->object_size) return NULL;
+  return mem_obj_at(a, mem_obj_alloc_index(a));
+}
+
+/*
+ * The mem_allocator_t free function of the object allocator.
+ */
+static void
+mem_obj_deallocate (mem_allocator_t *allocator,
+                    void *block)
+{
+  mem_obj_allocator_t *a = (mem_obj_allocator_t *) allocator;
+  if (!block) return;
+  const uint32_t index = mem_obj_index_of(a, block);
+  if (index == MEM_OBJ_NULL_INDEX) mem_dbg_fail("attempt to free unknown block %p", block);
+  mem_obj_free_index(a, index);
+}
+
+/*
+ * Allocates a new segment, doubling the tables of segments when full.
+ * The sorted table is kept in order by inserting the new segment in place.
+ */
+static void
+mem_obj_segment_new (mem_obj_allocator_t *a)
+{
+  if (a->segments_count == a->segments_size) {
+    a->segments_size *= 2;
+    a->segments = realloc(a->segments, a->segments_size * sizeof(char *));
+    a->segments_sorted = realloc(a->segments_sorted, a->segments_size * sizeof(mem_obj_segment_t));
+    if (!a->segments || !a->segments_sorted) mem_dbg_fail("out of memory");
+  }
+  char *content = mem_dbg_malloc(a->object_size << a->segment_shift);
+  a->segments[a->segments_count] = content;
+  size_t i = a->segments_count;
+  for ( ; i > 0 && (uintptr_t) a->segments_sorted[i - 1].content > (uintptr_t) content; i--) {
+    a->segments_sorted[i] = a->segments_sorted[i - 1];
+  }
+  a->segments_sorted[i].content = content;
+  a->segments_sorted[i].ordinal = a->segments_count;
+  a->segments_count++;
+}
+
+/*
+ * Reads the free list link stored into the object.
+ */
+static inline uint32_t
+mem_obj_link_get (const mem_obj_allocator_t *a,
+                  const uint32_t index)
+{
+  uint32_t link;
+  memcpy(&link, mem_obj_at(a, index), sizeof(uint32_t));
+  return link;
+}
+
+/*
+ * Writes the free list link into the object.
+ */
+static inline void
+mem_obj_link_set (mem_obj_allocator_t *a,
+                  const uint32_t index,
+                  const uint32_t link)
+{
+  memcpy(mem_obj_at(a, index), &link, sizeof(uint32_t));
+}
+
+/*
+ * End of object allocator mem_obj_allocator_t implementation.
+ */
@@ -35,6 +35,10 @@
 #ifndef MEMORY_MANAGER_H
 #define MEMORY_MANAGER_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
 
 
 /*************************/
@@ -242,54 +246,75 @@ mem_dbg_allocator (mem_dbg_allocator_t *mt);
 
 /*
  *
- * Object memory tracker.
+ * Object allocator.
  *
  */
 
+/*****************************************************/
+/* Pre-processor constants for the object allocator. */
+/*****************************************************/
+
+/**
+ * @brief The index value that does not identify any object.
+ */
+#define MEM_OBJ_NULL_INDEX UINT32_MAX
+
+
+
 /*********************************************************/
 /* Type declarations for the object allocator structure. */
 /*********************************************************/
 
+/**
+ * @brief A segment of the object allocator, as recorded in the table sorted by address.
+ */
+typedef struct mem_obj_segment {
+  char   *content;                   /**< @brief Allocated region. */
+  size_t  ordinal;                   /**< @brief Position of the segment in the allocation order. */
+} mem_obj_segment_t;
+
 /**
  * @brief Memory object allocator.
  *
- * @details This allocator provides block allocation for specific structures (objects).
+ * @details This allocator provides block allocation for specific structures (objects), all having the same size.
+ *
+ * Objects are carved out of segments, all having the same number of objects, a power of two.
+ *    Segments are never moved, so objects keep their address for the life of the allocator,
+ *    and memory grows by a constant step, instead of by doubling it.
+ *    Each object has an index, that is its position counting from the first object of the first segment,
+ *    so that an index is turned into an address by means of a shift and a mask, see #mem_obj_at.
+ *    The reverse mapping is done by #mem_obj_index_of, with a binary search in the table of segments
+ *    sorted by address.
+ *
+ * Objects are handed out from the free list when it is not empty, otherwise from the top of the
+ *    last segment, and a new segment is allocated when it is full.
+ *    The free list is threaded into the first four bytes of the freed objects, that must be
+ *    at least as large as an `uint32_t`. Memory never used is then never touched.
+ *
+ * The allocator is not synchronized, each thread must own the allocators it uses.
  */
 typedef struct mem_obj_allocator {
-  mem_allocator_t allocator;         /**< @brief Allocator. Must be first member. */
+  mem_allocator_t     allocator;       /**< @brief Allocator. Must be first member. */
   /* Settings. */
-  size_t object_size;                /**< @brief The object size in bytes. */
-  size_t segment_size;               /**< @brief The segment size in bytes. */
-  size_t stack_size;                 /**< @brief The stack size in bytes. */
+  size_t              object_size;     /**< @brief The object size in bytes. */
+  unsigned int        segment_shift;   /**< @brief Base two logarithm of the number of objects in a segment. */
+  /* Current state. */
+  char              **segments;        /**< @brief Segments in the allocation order, the object having index `i` is in segment `i >> segment_shift`. */
+  mem_obj_segment_t  *segments_sorted; /**< @brief Segments sorted by address. */
+  size_t              segments_size;   /**< @brief Capacity of the two tables of segments. */
+  size_t              segments_count;  /**< @brief Number of allocated segments. */
+  uint32_t            top;             /**< @brief Number of objects ever handed out, the index of the next object on top of the last segment. */
+  uint32_t            free_head;       /**< @brief Index of the first free object, #MEM_OBJ_NULL_INDEX when the free list is empty. */
+  size_t              used_count;      /**< @brief Number of objects in use. */
+  size_t              max_used_count;  /**< @brief The maximum number of objects in use. */
 } mem_obj_allocator_t;
 
-typedef struct mem_obj_segment {
-  struct mem_obj_segment *next;      /**< @brief Next in linked list. */
-  void *content;                     /**< @brief Allocated region. */
-} mem_obj_segment_t;
-
 
 
 /*******************************************************************/
-/* Function prototypes for the memory tracker allocator structure. */
+/* Function prototypes for the memory object allocator structure. */
 /*******************************************************************/
 
-/*
- * In order to have a stack size that is not as big as the allocated size, when
- * we free "too much" we have to free a block.
- * Freeing blocks requires to compact the data.
- * Compacting the data has two requirements:
- * - data (objects) are not referenced outside the module.
- * - references to objects moved from one block to another has to be updated as well ...
- *
- * Taking as example the red-black tree, if we exchange a node we have to update the parent,
- * and invalidate traversers.
- * Updating the parent is at no cost having the child to parent link, otherwise we have to
- * search for it.
- *
- * This is an open point ....
- */
-
 extern mem_obj_allocator_t *
 mem_obj_allocator_new (const size_t object_size,
                        const size_t objects_x_segment,
@@ -301,6 +326,41 @@ mem_obj_allocator_free (mem_obj_allocator_t *a);
 extern mem_allocator_t *
 mem_obj_allocator (mem_obj_allocator_t *a);
 
+extern void
+mem_obj_allocator_reset (mem_obj_allocator_t *a);
+
+extern bool
+mem_obj_allocator_is_consistent (const mem_obj_allocator_t *a);
+
+extern uint64_t *
+mem_obj_allocator_free_bitmap (const mem_obj_allocator_t *a);
+
+extern uint32_t
+mem_obj_alloc_index (mem_obj_allocator_t *a);
+
+extern void
+mem_obj_free_index (mem_obj_allocator_t *a,
+                    const uint32_t index);
+
+extern uint32_t
+mem_obj_index_of (const mem_obj_allocator_t *a,
+                  const void *object);
+
+/**
+ * @brief Returns the address of the object having the given `index`.
+ *
+ * @param [in] a     the object allocator
+ * @param [in] index the object index, it must be lower than the `top` field
+ * @return           the address of the object
+ */
+static inline void *
+mem_obj_at (const mem_obj_allocator_t *a,
+            const uint32_t index)
+{
+  const uint32_t mask = ((uint32_t) 1 << a->segment_shift) - 1;
+  return a->segments[index >> a->segment_shift] + (size_t) (index & mask) * a->object_size;
+}
+
 
 
 #endif /* MEMORY_MANAGER_H */
@@ -66,6 +66,7 @@
 #include <assert.h>
 
 #include "game_tree_logger.h"
+#include "game_tree_stats.h"
 #include "minimax_solver.h"
 
 
@@ -82,6 +83,7 @@ static void
 game_position_solve_impl (ExactSolution *const result,
                           GameTreeStack *const stack,
                           const LogEnv *const log_env,
+                          GameTreeStats *const tree_stats,
                           const bool alpha_beta_pruning,
                           const bool randomize_move_order,
                           prng_mt19937_t *const prng,
@@ -91,6 +93,7 @@ static void
 game_position_random_sammpler_impl (ExactSolution *const result,
                                     GameTreeStack *const stack,
                                     const LogEnv *const log_env,
+                                    GameTreeStats *const tree_stats,
                                     prng_mt19937_t *const prng,
                                     const unsigned long int sub_run_id);
 
@@ -219,7 +222,11 @@ game_position_mab_solve (const GamePositionX *const root,
 
   LogEnv *const log_env = game_tree_log_init(env->log_file);
 
-  if (log_env->log_is_on) game_tree_log_open_h(log_env);
+  if (log_env->log_is_on) {
+    game_tree_log_set_filters(log_env, env->log_max_depth, env->log_sample_rate, env->log_root_moves);
+    game_tree_log_open_h(log_env);
+  }
+  GameTreeStats *const tree_stats = env->tree_stats ? game_tree_stats_new() : NULL;
 
   prng_mt19937_t *prng = NULL;
   unsigned long int n_run = 1;
@@ -244,9 +251,9 @@ game_position_mab_solve (const GamePositionX *const root,
     exact_solution_set_solved_game_position_x(result, root);
 
     if (random_sampler) {
-      game_position_random_sammpler_impl(result, stack, log_env, prng, sub_run_id);
+      game_position_random_sammpler_impl(result, stack, log_env, tree_stats, prng, sub_run_id);
     } else {
-      game_position_solve_impl(result, stack, log_env, alpha_beta_pruning, randomize_move_order, prng, sub_run_id);
+      game_position_solve_impl(result, stack, log_env, tree_stats, alpha_beta_pruning, randomize_move_order, prng, sub_run_id);
     }
 
     result->pv[0] = stack->nodes[1].best_move;
@@ -259,6 +266,11 @@ game_position_mab_solve (const GamePositionX *const root,
   game_tree_stack_free(stack);
   game_tree_log_close(log_env);
 
+  if (tree_stats) {
+    game_tree_stats_print(tree_stats, stdout);
+    game_tree_stats_free(tree_stats);
+  }
+
   return result;
 }
 
@@ -266,6 +278,7 @@ static void
 game_position_solve_impl (ExactSolution *const result,
                           GameTreeStack *const stack,
                           const LogEnv *const log_env,
+                          GameTreeStats *const tree_stats,
                           const bool alpha_beta_pruning,
                           const bool randomize_move_order,
                           prng_mt19937_t *const prng,
@@ -284,6 +297,7 @@ game_position_solve_impl (ExactSolution *const result,
   if (randomize_move_order) prng_mt19937_shuffle_array_uint8(prng, c->head_of_legal_move_list, c->move_count);
   if (stack->hash_is_on) gts_compute_hash(stack);
   if (log_env->log_is_on) do_log(result, stack, sub_run_id, log_env);
+  if (tree_stats) game_tree_stats_add_node(tree_stats, c - root - 1, &c->gpx);
 
   if (gts_is_terminal_node(stack)) {
     result->leaf_count++;
@@ -311,6 +325,7 @@ game_position_solve_impl (ExactSolution *const result,
   }
 
  end:
+  if (log_env->log_is_on) do_log_exit(result, stack, sub_run_id, log_env);
   c = --stack->active_node;
   if (stack->active_node == root) return;
   goto entry;
@@ -320,6 +335,7 @@ static void
 game_position_random_sammpler_impl (ExactSolution *const result,
                                     GameTreeStack *const stack,
                                     const LogEnv *const log_env,
+                                    GameTreeStats *const tree_stats,
                                     prng_mt19937_t *const prng,
                                     const unsigned long int sub_run_id)
 {
@@ -334,6 +350,7 @@ game_position_random_sammpler_impl (ExactSolution *const result,
     prng_mt19937_shuffle_array_uint8(prng, c->head_of_legal_move_list, c->move_count);
     if (stack->hash_is_on) gts_compute_hash(stack);
     if (log_env->log_is_on) do_log(result, stack, sub_run_id, log_env);
+    if (tree_stats) game_tree_stats_add_node(tree_stats, c - root - 1, &c->gpx);
 
     if (gts_is_terminal_node(stack)) {
       result->leaf_count++;
@@ -341,17 +358,20 @@ game_position_random_sammpler_impl (ExactSolution *const result,
       c->alpha = game_position_x_final_value(&c->gpx);
       goto unroll;
     } else if (!c->move_set) {
+      c->best_move = pass_move;
       if (stack->hash_is_on) {
         stack->flip_count = 1;
         *stack->flips = pass_move;
       }
     } else {
+      c->best_move = *(c->move_cursor);
       gts_make_move(stack);
     }
   }
 
  unroll:
   while (true) {
+    if (log_env->log_is_on) do_log_exit(result, stack, sub_run_id, log_env);
     c = --stack->active_node;
     if (stack->active_node == root) return;
     c->alpha = - (c + 1)->alpha;
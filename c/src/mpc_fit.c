@@ -0,0 +1,295 @@
+/**
+ * @file
+ *
+ * @brief Fits the Multi-ProbCut parameters used by the es2 solver.
+ * @details This executable loads a game position database, samples positions reached by
+ * random play from each entry, and for each of them computes both the shallow search value
+ * used by the selective search and the exact value. The two values are related by a linear
+ * regression, one for each empty count, and the resulting parameters are printed as a C
+ * initializer ready to be pasted into the mpc_parameters table of exact_solver2.c.
+ *
+ * @par mpc_fit.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2016 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "board.h"
+#include "prng.h"
+#include "game_position_db.h"
+#include "exact_solver2.h"
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Sums collected for the linear regression of the exact value on the shallow value.
+ */
+typedef struct {
+  int    n;                              /**< @brief Number of samples. */
+  double sx;                             /**< @brief Sum of the shallow values. */
+  double sy;                             /**< @brief Sum of the exact values. */
+  double sxx;                            /**< @brief Sum of the squared shallow values. */
+  double sxy;                            /**< @brief Sum of the products. */
+  double syy;                            /**< @brief Sum of the squared exact values. */
+} RegressionSums;
+
+/*
+ * Environment passed to the database traversal function.
+ */
+typedef struct {
+  prng_mt19937_t *prng;                  /**< @brief The random number generator. */
+  RegressionSums *sums;                  /**< @brief Sums indexed by empty count. */
+} FitEnv;
+
+
+
+/* Static constants. */
+
+static const gchar *program_documentation_string =
+  "Description:\n"
+  "Multi-ProbCut fit is a program that learns the cut parameters used by the es2 solver selective search.\n"
+  "Positions are sampled by random play from each entry of the database, until the required empty count is reached.\n"
+  "Each sample is evaluated by the shallow search used by the cut, and then solved exactly.\n"
+  "A linear regression for each empty count gives the parameters, printed as a C initializer.\n"
+  "A sample call is:\n"
+  "  $ mpc_fit -f db/gpdb-ffo.txt -e 16 -E 20 -n 4\n"
+  "\n"
+  "Author:\n"
+  "   Written by Roberto Corradini <rob_corradini@yahoo.it>\n"
+  "\n"
+  "Copyright (c) 2016 Roberto Corradini. All rights reserved.\n"
+  "License GPLv3+: GNU GPL version 3 or later <http://gnu.org/licenses/gpl.html>.\n"
+  "This is free software: you are free to change and redistribute it. There is NO WARRANTY, to the extent permitted by law.\n"
+  ;
+
+
+
+/* Static variables. */
+
+static gchar *input_file  = NULL;
+static gint   min_empties = 16;
+static gint   max_empties = 20;
+static gint   samples     = 4;
+static gint64 seed        = 1;
+
+static const GOptionEntry entries[] =
+  {
+    { "file",        'f', 0, G_OPTION_ARG_FILENAME, &input_file,  "Input file name     - Mandatory",                           NULL },
+    { "min-empties", 'e', 0, G_OPTION_ARG_INT,      &min_empties, "Min empty count     - Default is 16",                       NULL },
+    { "max-empties", 'E', 0, G_OPTION_ARG_INT,      &max_empties, "Max empty count     - Default is 20",                       NULL },
+    { "samples",     'n', 0, G_OPTION_ARG_INT,      &samples,     "Samples             - For each entry and empty count",      NULL },
+    { "seed",        's', 0, G_OPTION_ARG_INT64,    &seed,        "Seed                - Random number generator seed",        NULL },
+    { NULL }
+  };
+
+
+
+/*
+ * Prototypes for internal functions.
+ */
+
+static gboolean
+sample_entry (gpointer key,
+              gpointer value,
+              gpointer data);
+
+static bool
+random_play (prng_mt19937_t *const prng,
+             const int empties,
+             GamePositionX *const gpx);
+
+/**
+ * @endcond
+ */
+
+
+
+/**
+ * @brief Main entry for the Multi-ProbCut fit utility.
+ */
+int
+main (int argc, char *argv[])
+{
+  GamePositionDb *db;
+  GamePositionDbSyntaxErrorLog *syntax_error_log;
+  FILE *fp;
+
+  /* GLib command line options and argument parsing. */
+  GError *error = NULL;
+  GOptionGroup *option_group = g_option_group_new("name", "description", "help_description", NULL, NULL);
+  GOptionContext *context = g_option_context_new("- Fits the Multi-ProbCut parameters");
+  g_option_context_add_main_entries(context, entries, NULL);
+  g_option_context_add_group(context, option_group);
+  g_option_context_set_description(context, program_documentation_string);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_print("Option parsing failed: %s\n", error->message);
+    return -1;
+  }
+
+  /* Checks command line options for consistency. */
+  if (!input_file) {
+    g_print("Option -f, --file is mandatory.\n");
+    return -2;
+  }
+  if (min_empties < 1 || max_empties > 60 || min_empties > max_empties) {
+    g_print("Options -e, --min-empties, and -E, --max-empties, are out of range.\n");
+    return -3;
+  }
+  if (samples < 1) {
+    g_print("Option -n, --samples, is out of range.\n");
+    return -4;
+  }
+
+  /* Loads the game position database. */
+  fp = fopen(input_file, "r");
+  if (!fp) {
+    g_print("Unable to open database resource for reading, file \"%s\" does not exist.\n", input_file);
+    return -5;
+  }
+  db = gpdb_new(g_strdup(input_file));
+  syntax_error_log = NULL;
+  gpdb_load(fp, input_file, db, &syntax_error_log, &error);
+  fclose(fp);
+  if (gpdb_syntax_error_log_length(syntax_error_log) != 0) {
+    g_print("The database resource, file \"%s\" contains errors, debug it using the gpdb_verify utility.\n", input_file);
+    return -6;
+  }
+
+  board_module_init();
+
+  RegressionSums sums[61] = { { 0 } };
+  FitEnv fit_env = { .prng = prng_mt19937_new(), .sums = sums };
+  prng_mt19937_init_by_seed(fit_env.prng, seed);
+
+  g_tree_foreach(db->tree, sample_entry, &fit_env);
+
+  printf("static const MpcParameters mpc_parameters[] = {\n");
+  bool first = true;
+  for (int e = min_empties; e <= max_empties; e++) {
+    const RegressionSums *const s = &sums[e];
+    if (s->n < 3) continue;
+    const double sxx = s->sxx - s->sx * s->sx / s->n;
+    const double sxy = s->sxy - s->sx * s->sy / s->n;
+    const double syy = s->syy - s->sy * s->sy / s->n;
+    if (sxx <= 0.0) continue;
+    const double a = sxy / sxx;
+    const double b = (s->sy - a * s->sx) / s->n;
+    const double residual = syy - a * sxy;
+    const double sigma = sqrt((residual > 0.0 ? residual : 0.0) / (s->n - 2));
+    printf("%s  { %2d, %.4f, %+.4f, %.4f }", first ? "" : ",\n", e, a, b, sigma);
+    first = false;
+  }
+  printf("\n};\n");
+  for (int e = min_empties; e <= max_empties; e++)
+    fprintf(stderr, "empties=%2d, samples=%d\n", e, sums[e].n);
+
+  prng_mt19937_free(fit_env.prng);
+  gpdb_free(db, TRUE);
+  if (syntax_error_log)
+    gpdb_syntax_error_log_free(syntax_error_log);
+  g_option_context_free(context);
+
+  return 0;
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * GTraverseFunc function, it samples the positions reachable from the database entry,
+ * and adds them to the regression sums.
+ */
+static gboolean
+sample_entry (gpointer key,
+              gpointer value,
+              gpointer data)
+{
+  const GamePositionDbEntry *const entry = (GamePositionDbEntry *) value;
+  FitEnv *const env = (FitEnv *) data;
+  const endgame_solver_env_t solver_env = { .selectivity = 0 };
+
+  GamePositionX *const root = game_position_x_gp_to_gpx(entry->game_position);
+  const int root_empties = bit_works_bitcount_64_popcnt(game_position_x_empties(root));
+  for (int e = min_empties; e <= max_empties && e <= root_empties; e++) {
+    for (int i = 0; i < samples; i++) {
+      GamePositionX gpx = *root;
+      if (!random_play(env->prng, e, &gpx)) continue;
+      const int shallow = game_position_es2_shallow_value(&gpx);
+      ExactSolution *const solution = game_position_es2_solve(&gpx, &solver_env);
+      const int exact = solution->outcome;
+      exact_solution_free(solution);
+      RegressionSums *const s = &env->sums[e];
+      s->n++;
+      s->sx += shallow;
+      s->sy += exact;
+      s->sxx += (double) shallow * shallow;
+      s->sxy += (double) shallow * exact;
+      s->syy += (double) exact * exact;
+    }
+  }
+  free(root);
+  return FALSE;
+}
+
+/*
+ * Plays random moves from the game position until the empty count reaches `empties`.
+ * Returns false when the game ends before, or when the player to move has to pass.
+ */
+static bool
+random_play (prng_mt19937_t *const prng,
+             const int empties,
+             GamePositionX *const gpx)
+{
+  GamePositionX next;
+  while (bit_works_bitcount_64_popcnt(game_position_x_empties(gpx)) > empties) {
+    const SquareSet moves = game_position_x_legal_moves(gpx);
+    if (moves) {
+      game_position_x_make_move(gpx, square_set_random_selection(prng, moves), &next);
+    } else {
+      game_position_x_pass(gpx, &next);
+      if (!game_position_x_legal_moves(&next)) return false;
+    }
+    *gpx = next;
+  }
+  return game_position_x_legal_moves(gpx) != 0;
+}
+
+/**
+ * @endcond
+ */
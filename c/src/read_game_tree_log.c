@@ -34,7 +34,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "game_tree_logger.h"
 
@@ -49,6 +52,14 @@
 static const gchar *program_documentation_string =
   "Description:\n"
   "Read Game Tree Log dump is a program that loads a binary dump file representation of a game tree log, and output it as a table.\n"
+  "The file is the head log written by the solvers when logging is turned on.\n"
+  "Blocks of records are independent, they are located by the index closing the file, decoded in parallel by the number of threads\n"
+  "given by option -j, by default one for each processor, and written in the order of the file.\n"
+  "The table is written to the standard output as CSV, or, with option -b, in the PostgreSQL binary COPY format.\n"
+  "With option -e the exit records, having the value, the best move, and the node count of the nodes searched, are written\n"
+  "as CSV instead of the records entering the nodes.\n"
+  "The binary output is loaded into the game_tree_log_staging table by the command:\n"
+  "  \\COPY game_tree_log_staging (sub_run_id, call_id, hash, parent_hash, blacks, whites, player, json_doc) FROM file WITH (FORMAT binary)\n"
   "\n"
   "Author:\n"
   "   Written by Roberto Corradini <rob_corradini@yahoo.it>\n"
@@ -63,13 +74,130 @@ static const gchar *program_documentation_string =
 /* Static variables. */
 
 static gchar *input_file = NULL;
+static gboolean pg_binary = FALSE;
+static gboolean exit_records = FALSE;
+static gint jobs = 0;
 
 static const GOptionEntry entries[] =
   {
     { "input-file",        'f', 0, G_OPTION_ARG_FILENAME, &input_file,        "Input file name - Mandatory", NULL },
+    { "pg-binary",         'b', 0, G_OPTION_ARG_NONE,     &pg_binary,         "Writes the PostgreSQL binary COPY format instead of CSV", NULL },
+    { "exit-records",      'e', 0, G_OPTION_ARG_NONE,     &exit_records,      "Writes the exit records instead of the node records", NULL },
+    { "jobs",              'j', 0, G_OPTION_ARG_INT,      &jobs,              "Number of decoding threads - Defaults to the number of processors", NULL },
     { NULL }
   };
 
+
+
+/* Types. */
+
+/*
+ * A growing buffer collecting the rows formatted from a block.
+ */
+typedef struct {
+  char   *data;
+  size_t  len;
+  size_t  capacity;
+} text_buffer_t;
+
+typedef struct block_reader_s block_reader_t;
+
+/*
+ * A decoding thread, it takes the blocks having index equal to its id modulo the number of threads.
+ * Rows are formatted into the work buffer, that is swapped with the out buffer once the main thread
+ * has written the previous one.
+ */
+typedef struct {
+  block_reader_t *r;           /* The shared state. */
+  int             id;          /* The index of the thread. */
+  pthread_t       thread;      /* The thread. */
+  FILE           *fp;          /* The thread own handle of the file. */
+  LogBlockH       block;       /* The block being decoded. */
+  text_buffer_t   work;        /* The rows of the block being decoded. */
+  text_buffer_t   out;         /* The rows of the block ready to be written. */
+  bool            is_ready;    /* Set by the thread when out is ready, cleared by the main thread when out has been written. */
+  int             error;       /* Zero, or the error met decoding the block in out. */
+  uint64_t        call_id;     /* The call id of the record not fitting the staging table. */
+} block_reader_worker_t;
+
+/*
+ * The state shared by the main thread and the decoding threads.
+ */
+struct block_reader_s {
+  const char                *file_name;   /* The head log file name. */
+  const LogBlockIndexEntryH *index;       /* The block index. */
+  size_t                     block_count; /* The number of blocks. */
+  int                        worker_count;/* The number of decoding threads. */
+  block_reader_worker_t     *workers;     /* The decoding threads. */
+  bool                       pg_binary;   /* Selects the output format. */
+  bool                       exit_records;/* Selects the exit records instead of the node records. */
+  bool                       is_aborted;  /* Set by the main thread when an error has been met. */
+  pthread_mutex_t            mutex;       /* The mutex guarding the condition. */
+  pthread_cond_t             cond;        /* The condition signaled when a buffer is ready, or has been written. */
+};
+
+/*
+ * Errors met by the decoding threads.
+ */
+enum {
+  BLOCK_READER_CORRUPTED = 1,
+  BLOCK_READER_CALL_ID_OVERFLOW = 2
+};
+
+
+
+/* Static functions. */
+
+static void *
+block_reader_worker_run (void *arg);
+
+static int
+block_reader_decode (block_reader_worker_t *const w,
+                     const size_t k);
+
+static inline char *
+text_buffer_reserve (text_buffer_t *const b,
+                     const size_t size);
+
+static char *
+csv_row_put (char *p,
+             const LogDataH *const record,
+             const char *const json_doc,
+             const size_t json_doc_len);
+
+static char *
+csv_exit_row_put (char *p,
+                  const LogDataH *const record);
+
+static inline char *
+csv_put_uint (char *p,
+              uint64_t v,
+              const int width,
+              const char sign);
+
+static inline char *
+csv_put_int (char *p,
+             const int64_t v,
+             const int width,
+             const bool plus);
+
+static uint8_t *
+pg_binary_row_put (uint8_t *p,
+                   const LogDataH *const record,
+                   const char *const json_doc);
+
+static inline uint8_t *
+pg_put_int16 (uint8_t *p,
+              const int16_t v);
+
+static inline uint8_t *
+pg_put_int32 (uint8_t *p,
+              const int32_t v);
+
+static inline uint8_t *
+pg_put_int64 (uint8_t *p,
+              const int64_t v);
+
 /**
  * @endcond
  */
@@ -82,9 +210,6 @@ static const GOptionEntry entries[] =
 int
 main (int argc, char *argv[])
 {
-  LogDataH record;
-  char json_doc[game_tree_log_max_json_doc_len];
-
   /* GLib command line options and argument parsing. */
   GError *error = NULL;
   GOptionGroup *option_group = g_option_group_new("name", "description", "help_description", NULL, NULL);
@@ -102,44 +227,430 @@ main (int argc, char *argv[])
     g_print("Option -f, --file is mandatory.\n");
     return -2;
   }
+  if (jobs < 0) {
+    g_print("Option -j, --jobs is out of range.\n");
+    return -7;
+  }
+  if (exit_records && pg_binary) {
+    g_print("Options -e, --exit-records and -b, --pg-binary are not compatible.\n");
+    return -8;
+  }
+  if (jobs == 0) {
+    const long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = processor_count > 0 ? processor_count : 1;
+  }
 
   board_module_init();
 
-  /* Opens the binary file for reading. */
+  /* Opens the binary file for reading, and reads the block index. */
   FILE *fp = fopen(input_file, "r");
-  g_assert(fp);
-
-  fprintf(stdout, "%s;%s;%s;%s;%s;%s;%s;%s\n",
-          "SUB_RUN_ID",
-          "CALL_ID",
-          "HASH",
-          "PARENT_HASH",
-          "BLACKS",
-          "WHITES",
-          "PLAYER",
-          "JSON_DOC");
-
-  while (fread(&record, sizeof(LogDataH), 1, fp)) {
+  if (!fp) {
+    fprintf(stderr, "Unable to open file \"%s\".\n", input_file);
+    return -3;
+  }
+  if (game_tree_log_h_read_header(fp) != 0) {
+    fprintf(stderr, "File \"%s\" is not a game tree head log, or its format version is not supported.\n", input_file);
+    fclose(fp);
+    return -4;
+  }
+  LogBlockIndexEntryH *index = NULL;
+  size_t block_count = 0;
+  if (game_tree_log_h_read_index(fp, &index, &block_count) != 0) {
+    fprintf(stderr, "File \"%s\" is corrupted.\n", input_file);
+    fclose(fp);
+    return -5;
+  }
+  fclose(fp);
+
+  if (pg_binary) {
+    /* Signature, flags, and header extension length. */
+    static const char pg_header[] = "PGCOPY\n\377\r\n\0\0\0\0\0\0\0\0\0";
+    fwrite(pg_header, sizeof(pg_header) - 1, 1, stdout);
+  } else if (exit_records) {
+    fprintf(stdout, "%s;%s;%s;%s;%s;%s;%s;%s;%s\n",
+            "SUB_RUN_ID",
+            "CALL_ID",
+            "HASH",
+            "PARENT_HASH",
+            "CALL_LEVEL",
+            "VALUE",
+            "BEST_MOVE",
+            "NODE_COUNT",
+            "JSON_DOC");
+  } else {
+    fprintf(stdout, "%s;%s;%s;%s;%s;%s;%s;%s\n",
+            "SUB_RUN_ID",
+            "CALL_ID",
+            "HASH",
+            "PARENT_HASH",
+            "BLACKS",
+            "WHITES",
+            "PLAYER",
+            "JSON_DOC");
+  }
+
+  /* Starts the decoding threads. */
+  block_reader_t r;
+  r.file_name = input_file;
+  r.index = index;
+  r.block_count = block_count;
+  r.worker_count = (size_t) jobs < block_count ? jobs : block_count;
+  r.pg_binary = pg_binary;
+  r.exit_records = exit_records;
+  r.is_aborted = false;
+  pthread_mutex_init(&r.mutex, NULL);
+  pthread_cond_init(&r.cond, NULL);
+  r.workers = (block_reader_worker_t *) calloc(r.worker_count ? r.worker_count : 1, sizeof(block_reader_worker_t));
+  g_assert(r.workers);
+  for (int i = 0; i < r.worker_count; i++) {
+    block_reader_worker_t *const w = &r.workers[i];
+    w->r = &r;
+    w->id = i;
+    game_tree_log_block_h_init(&w->block);
+    w->fp = fopen(input_file, "r");
+    if (!w->fp) {
+      fprintf(stderr, "Unable to open file \"%s\".\n", input_file);
+      abort();
+    }
+  }
+  for (int i = 0; i < r.worker_count; i++) {
+    block_reader_worker_t *const w = &r.workers[i];
+    if (pthread_create(&w->thread, NULL, block_reader_worker_run, w) != 0) {
+      fprintf(stderr, "Unable to start a decoding thread.\n");
+      abort();
+    }
+  }
+
+  /* Writes the blocks in the order of the file. */
+  int ret = 0;
+  for (size_t k = 0; k < block_count; k++) {
+    block_reader_worker_t *const w = &r.workers[k % r.worker_count];
+    pthread_mutex_lock(&r.mutex);
+    while (!w->is_ready) pthread_cond_wait(&r.cond, &r.mutex);
+    pthread_mutex_unlock(&r.mutex);
+    if (w->error == BLOCK_READER_CORRUPTED) {
+      fprintf(stderr, "File \"%s\" is corrupted.\n", input_file);
+      ret = -5;
+    } else if (w->error == BLOCK_READER_CALL_ID_OVERFLOW) {
+      fprintf(stderr, "Call id %" PRIu64 " does not fit the INTEGER column of the staging table.\n", w->call_id);
+      ret = -6;
+    }
+    if (w->out.len) fwrite(w->out.data, w->out.len, 1, stdout);
+    pthread_mutex_lock(&r.mutex);
+    w->is_ready = false;
+    if (ret) r.is_aborted = true;
+    pthread_cond_broadcast(&r.cond);
+    pthread_mutex_unlock(&r.mutex);
+    if (ret) break;
+  }
+
+  for (int i = 0; i < r.worker_count; i++) {
+    block_reader_worker_t *const w = &r.workers[i];
+    pthread_join(w->thread, NULL);
+    fclose(w->fp);
+    game_tree_log_block_h_release(&w->block);
+    free(w->work.data);
+    free(w->out.data);
+  }
+  free(r.workers);
+  pthread_cond_destroy(&r.cond);
+  pthread_mutex_destroy(&r.mutex);
+  free(index);
+  if (ret) return ret;
+
+  if (pg_binary) {
+    /* The file trailer is a field count of -1. */
+    uint8_t trailer[2];
+    pg_put_int16(trailer, -1);
+    fwrite(trailer, sizeof(trailer), 1, stdout);
+  }
+
+  return 0;
+}
+
+
+
+/**
+ * @cond
+ */
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * The decoding thread, it stops after its last block, after an error, or when the main thread aborts.
+ */
+static void *
+block_reader_worker_run (void *arg)
+{
+  block_reader_worker_t *const w = (block_reader_worker_t *) arg;
+  block_reader_t *const r = w->r;
+
+  for (size_t k = w->id; k < r->block_count; k += r->worker_count) {
+    const int error = block_reader_decode(w, k);
+
+    /* Waits for the main thread to write the previous block, then hands over the rows. */
+    pthread_mutex_lock(&r->mutex);
+    while (w->is_ready && !r->is_aborted) pthread_cond_wait(&r->cond, &r->mutex);
+    const bool is_aborted = r->is_aborted;
+    if (!is_aborted) {
+      const text_buffer_t tmp = w->out;
+      w->out = w->work;
+      w->work = tmp;
+      w->error = error;
+      w->is_ready = true;
+      pthread_cond_broadcast(&r->cond);
+    }
+    pthread_mutex_unlock(&r->mutex);
+    if (is_aborted || error) break;
+  }
+  return NULL;
+}
+
+/*
+ * Reads the block k, and formats its records into the work buffer.
+ * Returns zero, or the error met.
+ */
+static int
+block_reader_decode (block_reader_worker_t *const w,
+                     const size_t k)
+{
+  LogDataH record;
+  char json_doc[game_tree_log_max_json_doc_len];
+
+  /*
+   * The size of the rows, json excluded, in the worst case: integer fields are at most
+   * eleven characters wide, sub_run_id, call_level, and value, or twenty, the 64 bit ones.
+   * The binary tuple has the field count, and for each field its length and its value.
+   */
+  static const size_t csv_row_max_size = 11 + 20 + 4 * 20 + 1 + 7 + 1;
+  static const size_t csv_exit_row_max_size = 11 + 20 + 2 * 20 + 11 + 11 + 2 + 20 + 8 + 1;
+  static const size_t pg_binary_row_max_size = 2 + 2 * (4 + 4) + 4 * (4 + 8) + (4 + 2) + 4;
+
+  w->work.len = 0;
+  if (fseeko(w->fp, w->r->index[k].offset, SEEK_SET) != 0) return BLOCK_READER_CORRUPTED;
+  if (game_tree_log_block_h_read(&w->block, w->fp) != 1) return BLOCK_READER_CORRUPTED;
+
+  int ret;
+  while ((ret = game_tree_log_block_h_next(&w->block, &record, json_doc)) > 0) {
+    if ((record.type == LOG_RECORD_EXIT) != w->r->exit_records) continue;
+    if (record.type == LOG_RECORD_EXIT) {
+      char *const p = text_buffer_reserve(&w->work, csv_exit_row_max_size + record.json_doc_len);
+      w->work.len = csv_exit_row_put(p, &record) - w->work.data;
+      continue;
+    }
+    /* A document read from the log is shorter than the buffer, a computed one is a few hundred characters. */
+    size_t json_doc_len = record.json_doc_len;
     if (!record.json_doc) {
       GamePositionX gpx = { .blacks = record.blacks, .whites = record.whites, .player = record.player };
-      const int json_doc_len  = game_tree_log_data_h_json_doc3(json_doc, record.call_level, &gpx);
-      if (json_doc_len > game_tree_log_max_json_doc_len) abort();
+      json_doc_len = game_tree_log_data_h_json_doc3(json_doc, record.call_level, &gpx);
+    }
+    if (json_doc_len >= game_tree_log_max_json_doc_len) abort();
+    char *const p = text_buffer_reserve(&w->work, (w->r->pg_binary ? pg_binary_row_max_size : csv_row_max_size) + json_doc_len);
+    char *end;
+    if (w->r->pg_binary) {
+      end = (char *) pg_binary_row_put((uint8_t *) p, &record, json_doc);
+      if (!end) {
+        w->call_id = record.call_id;
+        return BLOCK_READER_CALL_ID_OVERFLOW;
+      }
     } else {
-      size_t len = fread(json_doc, record.json_doc_len + 1, 1, fp);
-      if (len != 1) abort();
+      end = csv_row_put(p, &record, json_doc, json_doc_len);
     }
-    fprintf(stdout, "%6d;%8" PRIu64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%1d;%s\n",
-            record.sub_run_id,
-            record.call_id,
-            (int64_t) record.hash,
-            (int64_t) record.parent_hash,
-            (int64_t) record.blacks,
-            (int64_t) record.whites,
-            record.player,
-            json_doc);
+    w->work.len = end - w->work.data;
   }
+  return ret < 0 ? BLOCK_READER_CORRUPTED : 0;
+}
 
-  fclose(fp);
+/*
+ * Returns a pointer to the end of the buffer, having at least size free bytes.
+ */
+static inline char *
+text_buffer_reserve (text_buffer_t *const b,
+                     const size_t size)
+{
+  if (b->len + size > b->capacity) {
+    b->capacity = b->len + size > 2 * b->capacity ? b->len + size : 2 * b->capacity;
+    b->data = (char *) realloc(b->data, b->capacity);
+    g_assert(b->data);
+  }
+  return b->data + b->len;
+}
 
-  return 0;
+/*
+ * Formats the record as a CSV row, the json field is already quoted.
+ * The row is the same printed by the format "%6d;%8" PRIu64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%+20" PRId64 ";%1d;%s\n".
+ * Returns the end of the row.
+ */
+static char *
+csv_row_put (char *p,
+             const LogDataH *const record,
+             const char *const json_doc,
+             const size_t json_doc_len)
+{
+  p = csv_put_int(p, record->sub_run_id, 6, false);
+  *p++ = ';';
+  p = csv_put_uint(p, record->call_id, 8, 0);
+  *p++ = ';';
+  p = csv_put_int(p, (int64_t) record->hash, 20, true);
+  *p++ = ';';
+  p = csv_put_int(p, (int64_t) record->parent_hash, 20, true);
+  *p++ = ';';
+  p = csv_put_int(p, (int64_t) record->blacks, 20, true);
+  *p++ = ';';
+  p = csv_put_int(p, (int64_t) record->whites, 20, true);
+  *p++ = ';';
+  p = csv_put_int(p, record->player, 1, false);
+  *p++ = ';';
+  memcpy(p, json_doc, json_doc_len);
+  p += json_doc_len;
+  *p++ = '\n';
+  return p;
+}
+
+/*
+ * Formats the exit record as a CSV row, the json field is empty when the record has none.
+ * The row is the same printed by the format "%6d;%8" PRIu64 ";%+20" PRId64 ";%+20" PRId64 ";%3d;%+3d;%s;%8" PRIu64 ";%s\n".
+ * Returns the end of the row.
+ */
+static char *
+csv_exit_row_put (char *p,
+                  const LogDataH *const record)
+{
+  p = csv_put_int(p, record->sub_run_id, 6, false);
+  *p++ = ';';
+  p = csv_put_uint(p, record->call_id, 8, 0);
+  *p++ = ';';
+  p = csv_put_int(p, (int64_t) record->hash, 20, true);
+  *p++ = ';';
+  p = csv_put_int(p, (int64_t) record->parent_hash, 20, true);
+  *p++ = ';';
+  p = csv_put_int(p, record->call_level, 3, false);
+  *p++ = ';';
+  p = csv_put_int(p, record->value, 3, true);
+  *p++ = ';';
+  const char *const move = square_as_move_to_string(record->best_move);
+  *p++ = move[0];
+  *p++ = move[1];
+  *p++ = ';';
+  p = csv_put_uint(p, record->node_count, 8, 0);
+  *p++ = ';';
+  if (record->json_doc) {
+    memcpy(p, record->json_doc, record->json_doc_len);
+    p += record->json_doc_len;
+  }
+  *p++ = '\n';
+  return p;
 }
+
+/*
+ * Writes the value right aligned in a field of width characters, preceded by the sign when not null.
+ */
+static inline char *
+csv_put_uint (char *p,
+              uint64_t v,
+              const int width,
+              const char sign)
+{
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v);
+  for (int pad = width - n - (sign != 0); pad > 0; pad--) *p++ = ' ';
+  if (sign) *p++ = sign;
+  while (n) *p++ = digits[--n];
+  return p;
+}
+
+static inline char *
+csv_put_int (char *p,
+             const int64_t v,
+             const int width,
+             const bool plus)
+{
+  const uint64_t u = v < 0 ? -(uint64_t) v : (uint64_t) v;
+  const char sign = v < 0 ? '-' : (plus ? '+' : 0);
+  return csv_put_uint(p, u, width, sign);
+}
+
+/*
+ * Formats the record as a tuple of the PostgreSQL binary COPY format, matching the columns of the staging table:
+ * sub_run_id and call_id are INTEGER, hash, parent_hash, blacks and whites are BIGINT, player is SMALLINT,
+ * and json_doc is JSON, that is sent as text.
+ * The json field is quoted for CSV, quotes are removed.
+ * Returns the end of the tuple, or NULL when the call id does not fit the column.
+ */
+static uint8_t *
+pg_binary_row_put (uint8_t *p,
+                   const LogDataH *const record,
+                   const char *const json_doc)
+{
+  if (record->call_id > INT32_MAX) return NULL;
+
+  p = pg_put_int16(p, 8);
+  p = pg_put_int32(p, 4);
+  p = pg_put_int32(p, record->sub_run_id);
+  p = pg_put_int32(p, 4);
+  p = pg_put_int32(p, (int32_t) record->call_id);
+  p = pg_put_int32(p, 8);
+  p = pg_put_int64(p, (int64_t) record->hash);
+  p = pg_put_int32(p, 8);
+  p = pg_put_int64(p, (int64_t) record->parent_hash);
+  p = pg_put_int32(p, 8);
+  p = pg_put_int64(p, (int64_t) record->blacks);
+  p = pg_put_int32(p, 8);
+  p = pg_put_int64(p, (int64_t) record->whites);
+  p = pg_put_int32(p, 2);
+  p = pg_put_int16(p, record->player);
+
+  uint8_t *const json_len = p;
+  p += 4;
+  const char *c = json_doc;
+  const char *end = json_doc + strlen(json_doc);
+  if (end - c >= 2 && *c == '"' && *(end - 1) == '"') {
+    c++;
+    end--;
+  }
+  while (c < end) {
+    if (*c == '"' && c + 1 < end && *(c + 1) == '"') c++;
+    *p++ = *c++;
+  }
+  pg_put_int32(json_len, p - json_len - 4);
+
+  return p;
+}
+
+/*
+ * Integers are written in network byte order.
+ */
+static inline uint8_t *
+pg_put_int16 (uint8_t *p,
+              const int16_t v)
+{
+  *p++ = (uint8_t) ((uint16_t) v >> 8);
+  *p++ = (uint8_t) v;
+  return p;
+}
+
+static inline uint8_t *
+pg_put_int32 (uint8_t *p,
+              const int32_t v)
+{
+  for (int i = 3; i >= 0; i--) *p++ = (uint8_t) ((uint32_t) v >> (8 * i));
+  return p;
+}
+
+static inline uint8_t *
+pg_put_int64 (uint8_t *p,
+              const int64_t v)
+{
+  for (int i = 7; i >= 0; i--) *p++ = (uint8_t) ((uint64_t) v >> (8 * i));
+  return p;
+}
+
+/**
+ * @endcond
+ */
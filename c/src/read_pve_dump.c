@@ -48,14 +48,25 @@
 static const gchar *program_documentation_string =
   "Description:\n"
   "Read Principal Variation Environment dump is a program that load a binary dump file representation of a PVE.\n"
+  "The dump file is mapped into memory, options -s, -p, -t, -l, and -L read it in place, without loading the PVE.\n"
   "\n"
   "Details on Application Options:\n"
   "\n"
   "  -s, --print-summary\n"
   "\n"
+  "  -t, --print-pv-as-table\n"
+  "    Identifiers are the dump indexes plus one, zero means no reference. Cells shared by more lines are printed once.\n"
+  "\n"
+  "  -l, --print-lines\n"
+  "    Prints all the complete lines, from the root to the end of the PV, one for each row, in lexicographic order.\n"
+  "    Lines are streamed, memory doesn't depend on the number of lines.\n"
+  "\n"
+  "  -L, --print-lines-as-csv\n"
+  "    Prints the complete lines as a csv file, each row has the line id, the length, the moves, and the final game position.\n"
+  "\n"
   "  -i, --internals\n"
-  "    Shows the internal PVE data selected by the switches turned on, the structure is read and then activated, this\n"
-  "    last process translates all the memory references in the structure. The data shown is the memory view after translation.\n"
+  "    Shows the internal PVE data selected by the switches turned on, the structure is rebuilt from the dump file,\n"
+  "    the data shown is the memory view of the rebuilt structure.\n"
   "    The available sections are:\n"
   "    -00- PVE HEADER ... ... ... ... ... ... 0x0001, or ... 1\n"
   "    -01- PVE INDEX  ... ... ... ... ... ... 0x0002, or ... 2\n"
@@ -91,15 +102,19 @@ static gboolean  print_summary     = FALSE;
 static gboolean  print_pv          = FALSE;
 static gboolean  print_pv_as_table = FALSE;
 static gboolean  check_invariant   = FALSE;
+static gboolean  print_lines       = FALSE;
+static gboolean  print_lines_csv   = FALSE;
 
 static const GOptionEntry entries[] =
   {
-    { "input-file",        'f', 0, G_OPTION_ARG_FILENAME, &input_file,        "Input file name     - Mandatory", NULL },
-    { "internals",         'i', 0, G_OPTION_ARG_INT64,    &internals,         "Print PVE internals - Switches in hex form", NULL },
-    { "print-summary",     's', 0, G_OPTION_ARG_NONE,     &print_summary,     "Print summary       - Reads only the file header and exits", NULL },
-    { "print-pv",          'p', 0, G_OPTION_ARG_NONE,     &print_pv,          "Print pv            - Prints human readable PV", NULL },
-    { "print-pv-as-table", 't', 0, G_OPTION_ARG_NONE,     &print_pv_as_table, "Print pv as table   - Prints PV as a csv file ready for an SQL loader", NULL },
-    { "check-invariant",   'c', 0, G_OPTION_ARG_NONE,     &check_invariant,   "Check PVE invariant - Stops execution if a violation is detected", NULL },
+    { "input-file",         'f', 0, G_OPTION_ARG_FILENAME, &input_file,        "Input file name     - Mandatory", NULL },
+    { "internals",          'i', 0, G_OPTION_ARG_INT64,    &internals,         "Print PVE internals - Switches in hex form", NULL },
+    { "print-summary",      's', 0, G_OPTION_ARG_NONE,     &print_summary,     "Print summary       - Reads only the file header and exits", NULL },
+    { "print-pv",           'p', 0, G_OPTION_ARG_NONE,     &print_pv,          "Print pv            - Prints human readable PV", NULL },
+    { "print-pv-as-table",  't', 0, G_OPTION_ARG_NONE,     &print_pv_as_table, "Print pv as table   - Prints PV as a csv file ready for an SQL loader", NULL },
+    { "check-invariant",    'c', 0, G_OPTION_ARG_NONE,     &check_invariant,   "Check PVE invariant - Stops execution if a violation is detected", NULL },
+    { "print-lines",        'l', 0, G_OPTION_ARG_NONE,     &print_lines,       "Print lines         - Streams the complete PV lines", NULL },
+    { "print-lines-as-csv", 'L', 0, G_OPTION_ARG_NONE,     &print_lines_csv,   "Print lines as csv  - Streams the complete PV lines as a csv file", NULL },
     { NULL }
   };
 
@@ -138,42 +153,61 @@ main (int argc, char *argv[])
     return -3;
   }
 
+  /* Maps the dump file. */
+  pve_dump_t *dump = pve_dump_open(input_file);
+  if (!dump) {
+    g_print("File \"%s\" is not a valid PVE dump.\n", input_file);
+    return -5;
+  }
+
   /* Prints summary when the specific option is on. */
   if (print_summary) {
-    pve_summary_from_binary_file_to_stream(input_file, stdout);
+    pve_dump_summary_to_stream(dump, stdout);
+    pve_dump_close(dump);
     return 0;
   }
 
-  /* Loads the full PVE data structure. */
-  PVEnv *pve = pve_load_from_binary_file(input_file);
+  if (internals || check_invariant) {
+
+    /* Loads the full PVE data structure. */
+    PVEnv *pve = pve_load_from_binary_file(input_file);
 
-  /* Runs a complete check on PVE invariant. */
-  if (check_invariant) {
-    pve_error_code_t error_code = PVE_ERROR_CODE_OK;
-    if (!pve_is_invariant_satisfied(pve, &error_code, 0xFFFFFFFFFFFFFFFF)) {
-      printf("Running function pve_is_invariant_satisfied an error has been detected. Error code is: %d\n", error_code);
-      free(pve);
-      return -4;
+    /* Runs a complete check on PVE invariant. */
+    if (check_invariant) {
+      pve_error_code_t error_code = PVE_ERROR_CODE_OK;
+      if (!pve_is_invariant_satisfied(pve, &error_code, 0xFFFFFFFFFFFFFFFF)) {
+        printf("Running function pve_is_invariant_satisfied an error has been detected. Error code is: %d\n", error_code);
+        pve_free(pve);
+        pve_dump_close(dump);
+        return -4;
+      }
     }
-  }
 
-  /* Prints selected internals depending on the specific option switches. */
-  if (internals) {
-    pve_internals_to_stream(pve, stdout, internals);
-    return 0;
+    /* Prints selected internals depending on the specific option switches. */
+    if (internals) {
+      pve_internals_to_stream(pve, stdout, internals);
+      pve_free(pve);
+      pve_dump_close(dump);
+      return 0;
+    }
+
+    pve_free(pve);
   }
 
   if (print_pv) {
-    pve_transform_to_standard_form(pve);
-    pve_line_with_variants_to_stream(pve, stdout);
+    pve_dump_line_with_variants_to_stream(dump, stdout);
   }
 
   if (print_pv_as_table) {
     board_module_init();
-    pve_root_line_as_table_to_stream(pve, stdout);
+    pve_dump_root_line_as_table_to_stream(dump, stdout);
+  }
+
+  if (print_lines || print_lines_csv) {
+    pve_dump_lines_to_stream(dump, stdout, print_lines_csv);
   }
 
-  free(pve);
+  pve_dump_close(dump);
 
   return 0;
 }
@@ -45,7 +45,7 @@
  *   - Smooth-sort
  *   - Quick-sort
  *   - Shell-sort
- *   - Merge-sort
+ *   - Merge-sort, also in a multi-threaded version
  *   - Tim-sort
  *
  * There are mainly three different approaches when we have to rearrange records of information in a given order:
@@ -87,8 +87,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 #include <glib.h>
 
@@ -100,10 +102,53 @@
  * @cond
  */
 
+/*
+ * Arrays, or merged pairs of arrays, shorter than the threshold are not split among threads.
+ */
+#define SORT_UTILS_MERGESORT_MT_THRESHOLD 8192
+
+/*
+ * The arguments of a branch of the multi-threaded merge-sort.
+ * The array `a` is sorted, using `aux` as auxiliary space, the result goes into `aux`
+ * when `into_aux` is true, into `a` otherwise.
+ */
+typedef struct {
+  char                        *a;
+  char                        *aux;
+  size_t                       count;
+  size_t                       es;
+  sort_utils_compare_function  cmp;
+  int                          thread_count;
+  bool                         into_aux;
+} mergesort_mt_task_t;
+
+/*
+ * The arguments of a branch of the multi-threaded merge, the sorted arrays `l` and `r`
+ * are merged into `out`.
+ */
+typedef struct {
+  const char                  *l;
+  size_t                       lc;
+  const char                  *r;
+  size_t                       rc;
+  char                        *out;
+  size_t                       es;
+  sort_utils_compare_function  cmp;
+  int                          thread_count;
+} merge_mt_task_t;
+
+
+
 /*
  * Prototypes for internal functions.
  */
 
+static void *
+mergesort_mt_run (void *arg);
+
+static void *
+merge_mt_run (void *arg);
+
 static void
 copy (void *const dest,
       const void *const src,
@@ -1633,7 +1678,7 @@ sort_utils_shellsort_dsc_i (int *const a,
  *
  * @details The vector `a` having length equal to `count` is sorted
  *          using auxiliary space applying the merge-sort algorithm.
- *          The compare function is a predicate and must return `TRUE` or `FALSE`.
+ *          Equal elements keep their relative order, the sort is stable.
  *
  * @param [in,out] a            the array to be sorted
  * @param [in]     count        the number of element in array
@@ -1646,7 +1691,7 @@ sort_utils_mergesort (void *const a,
                       const size_t element_size,
                       const sort_utils_compare_function cmp)
 {
-  void *aux = malloc(sizeof(element_size) * count);
+  void *aux = malloc(element_size * count);
   sort_utils_mergesort_a(a, count, element_size, cmp, aux);
   free(aux);
 }
@@ -1656,7 +1701,7 @@ sort_utils_mergesort (void *const a,
  *
  * @details The vector `a` having length equal to `count` is sorted
  *          using auxiliary space applying the merge-sort algorithm.
- *          The compare function is a predicate and must return `TRUE` or `FALSE`.
+ *          Equal elements keep their relative order, the sort is stable.
  *          The auxiliary space must have the same size of the `a` array or larger,
  *          the content of it when the function returns is garbage.
  *
@@ -1697,12 +1742,12 @@ sort_utils_mergesort_a (void *const a,
   char *one_past_last_for_left = ca + hc * es;
   char *one_past_last_for_right = ca + count * es;
   while (left < one_past_last_for_left && right < one_past_last_for_right) {
-    if (cmp(left, right) < 0) {
-      copy(aux_ptr, left, es);
-      left += es;
-    } else {
+    if (cmp(right, left) < 0) {
       copy(aux_ptr, right, es);
       right += es;
+    } else {
+      copy(aux_ptr, left, es);
+      left += es;
     }
     aux_ptr += es;
   }
@@ -1719,6 +1764,41 @@ sort_utils_mergesort_a (void *const a,
   memcpy(ca, caux, es * count);
 }
 
+/**
+ * @brief Sorts the `a` array, splitting the work among threads.
+ *
+ * @details The vector `a` having length equal to `count` is sorted
+ *          using auxiliary space applying the merge-sort algorithm.
+ *          The two halves of the array are sorted by two branches running concurrently,
+ *          each one taking half of the threads, and then are merged by as many threads
+ *          as the two branches had: the larger array is split at its median element,
+ *          and the other one at the position that the median takes into it, so that the
+ *          two lower parts, and the two upper ones, are merged independently.
+ *          Branches having one thread, or a small array, run the sequential merge-sort.
+ *          Equal elements keep their relative order, the sort is stable.
+ *          When a thread cannot be created its branch is run by the calling one.
+ *
+ * @param [in,out] a            the array to be sorted
+ * @param [in]     count        the number of element in array
+ * @param [in]     element_size the number of bytes used by one element
+ * @param [in]     cmp          the compare function applied by the algorithm
+ * @param [in]     thread_count the maximum number of threads used, the calling one included
+ */
+void
+sort_utils_mergesort_mt (void *const a,
+                         const size_t count,
+                         const size_t element_size,
+                         const sort_utils_compare_function cmp,
+                         const int thread_count)
+{
+  if (count < 2) return;
+  void *aux = malloc(element_size * count);
+  g_assert(aux);
+  mergesort_mt_task_t t = { a, aux, count, element_size, cmp, thread_count, false };
+  mergesort_mt_run(&t);
+  free(aux);
+}
+
 /**
  * @brief Sorts in ascending order the `a` array of doubles.
  *
@@ -2783,6 +2863,106 @@ sort_utils_timsort_dsc_i (int *const a,
  * Internal functions used by more than one algorithm.
  */
 
+/*
+ * Runs a branch of the multi-threaded merge-sort.
+ * The halves are sorted into the buffer that is not the destination, and then merged into it.
+ */
+static void *
+mergesort_mt_run (void *arg)
+{
+  const mergesort_mt_task_t *const t = (mergesort_mt_task_t *) arg;
+
+  if (t->thread_count < 2 || t->count < SORT_UTILS_MERGESORT_MT_THRESHOLD) {
+    sort_utils_mergesort_a(t->a, t->count, t->es, t->cmp, t->aux);
+    if (t->into_aux) memcpy(t->aux, t->a, t->count * t->es);
+    return NULL;
+  }
+
+  const size_t hc = t->count / 2;
+  const int lt = t->thread_count / 2;
+  mergesort_mt_task_t left = { t->a, t->aux, hc, t->es, t->cmp, lt, !t->into_aux };
+  mergesort_mt_task_t right = { t->a + hc * t->es, t->aux + hc * t->es, t->count - hc, t->es, t->cmp, t->thread_count - lt, !t->into_aux };
+
+  pthread_t thread;
+  const bool is_started = pthread_create(&thread, NULL, mergesort_mt_run, &left) == 0;
+  mergesort_mt_run(&right);
+  if (is_started) pthread_join(thread, NULL);
+  else mergesort_mt_run(&left);
+
+  const char *const src = t->into_aux ? t->a : t->aux;
+  char *const dst = t->into_aux ? t->aux : t->a;
+  merge_mt_task_t m = { src, hc, src + hc * t->es, t->count - hc, dst, t->es, t->cmp, t->thread_count };
+  merge_mt_run(&m);
+  return NULL;
+}
+
+/*
+ * Runs a branch of the multi-threaded merge.
+ * An element of the right array is taken first only when it is lesser than the left one,
+ * the merge is then stable. Splitting keeps the same rule: elements of the right array equal
+ * to a left median go to the upper part, elements of the left array equal to a right median
+ * go to the lower part.
+ */
+static void *
+merge_mt_run (void *arg)
+{
+  const merge_mt_task_t *const t = (merge_mt_task_t *) arg;
+  const size_t es = t->es;
+
+  if (t->thread_count < 2 || t->lc + t->rc < SORT_UTILS_MERGESORT_MT_THRESHOLD) {
+    const char *l = t->l;
+    const char *r = t->r;
+    const char *const l_end = t->l + t->lc * es;
+    const char *const r_end = t->r + t->rc * es;
+    char *out = t->out;
+    while (l < l_end && r < r_end) {
+      if (t->cmp(r, l) < 0) {
+        copy(out, r, es);
+        r += es;
+      } else {
+        copy(out, l, es);
+        l += es;
+      }
+      out += es;
+    }
+    memcpy(out, l, l_end - l);
+    memcpy(out + (l_end - l), r, r_end - r);
+    return NULL;
+  }
+
+  size_t li, ri;
+  if (t->lc >= t->rc) {
+    li = t->lc / 2;
+    size_t lo = 0, hi = t->rc;
+    while (lo < hi) {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (t->cmp(t->r + mid * es, t->l + li * es) < 0) lo = mid + 1;
+      else hi = mid;
+    }
+    ri = lo;
+  } else {
+    ri = t->rc / 2;
+    size_t lo = 0, hi = t->lc;
+    while (lo < hi) {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (t->cmp(t->l + mid * es, t->r + ri * es) <= 0) lo = mid + 1;
+      else hi = mid;
+    }
+    li = lo;
+  }
+
+  const int lt = t->thread_count / 2;
+  merge_mt_task_t lower = { t->l, li, t->r, ri, t->out, es, t->cmp, lt };
+  merge_mt_task_t upper = { t->l + li * es, t->lc - li, t->r + ri * es, t->rc - ri, t->out + (li + ri) * es, es, t->cmp, t->thread_count - lt };
+
+  pthread_t thread;
+  const bool is_started = pthread_create(&thread, NULL, merge_mt_run, &lower) == 0;
+  merge_mt_run(&upper);
+  if (is_started) pthread_join(thread, NULL);
+  else merge_mt_run(&lower);
+  return NULL;
+}
+
 /**
  * @brief Copies values from `src` to `dest` pointers.
  *
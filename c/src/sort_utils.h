@@ -348,6 +348,13 @@ sort_utils_mergesort_a (void *const a,
                         const sort_utils_compare_function cmp,
                         void *const aux);
 
+extern void
+sort_utils_mergesort_mt (void *const a,
+                         const size_t count,
+                         const size_t element_size,
+                         const sort_utils_compare_function cmp,
+                         const int thread_count);
+
 extern void
 sort_utils_mergesort_asc_d (double *const a,
                             const int count);
@@ -42,6 +42,7 @@
 #include "exact_solver.h"
 #include "improved_fast_endgame_solver.h"
 #include "minimax_solver.h"
+#include "exact_solver2.h"
 
 
 /**
@@ -233,6 +234,14 @@ static void
 game_position_ab_solve_test (GamePositionDbFixture *fixture,
                              gconstpointer test_data);
 
+static void
+game_position_es2_solve_test (GamePositionDbFixture *fixture,
+                              gconstpointer test_data);
+
+static void
+game_position_es2_move_values_test (GamePositionDbFixture *fixture,
+                                    gconstpointer test_data);
+
 
 
 /* Helper function prototypes. */
@@ -305,6 +314,20 @@ main (int   argc,
              game_position_ab_solve_test,
              gpdb_fixture_teardown);
 
+  g_test_add("/es2/ffo_05",
+             GamePositionDbFixture,
+             (gconstpointer) ffo_05,
+             gpdb_ffo_fixture_setup,
+             game_position_es2_solve_test,
+             gpdb_fixture_teardown);
+
+  g_test_add("/es2/ffo_05_move_values",
+             GamePositionDbFixture,
+             (gconstpointer) NULL,
+             gpdb_ffo_fixture_setup,
+             game_position_es2_move_values_test,
+             gpdb_fixture_teardown);
+
   if (g_test_slow ()) {
     g_test_add("/minimax/ffo_05",
                GamePositionDbFixture,
@@ -330,6 +353,12 @@ main (int   argc,
                gpdb_ffo_fixture_setup,
                game_position_ab_solve_test,
                gpdb_fixture_teardown);
+    g_test_add("/es2/ffo_01_19",
+               GamePositionDbFixture,
+               (gconstpointer) ffo_01_19,
+               gpdb_ffo_fixture_setup,
+               game_position_es2_solve_test,
+               gpdb_fixture_teardown);
     g_test_add("/es/ffo_20_29",
                GamePositionDbFixture,
                (gconstpointer) ffo_20_29,
@@ -413,6 +442,54 @@ game_position_ab_solve_test (GamePositionDbFixture *fixture,
   run_test_case_array(db, tcap, game_position_ab_solve);
 }
 
+static void
+game_position_es2_solve_test (GamePositionDbFixture *fixture,
+                              gconstpointer test_data)
+{
+  GamePositionDb *db = fixture->db;
+  TestCase *tcap = (TestCase *) test_data;
+  run_test_case_array(db, tcap, game_position_es2_solve);
+}
+
+static void
+game_position_es2_move_values_test (GamePositionDbFixture *fixture,
+                                    gconstpointer test_data)
+{
+  /* ffo-05 description: G8:+32. G2:+12. B2:-20. G6:-26. G1:-32. G7:-34. */
+  const Square moves[] = { G8, G2, B2, G6, G1, G7 };
+  const int values[] = { +32, +12, -20, -26, -32, -34 };
+  const int move_count = sizeof(moves) / sizeof(moves[0]);
+
+  endgame_solver_env_t env =
+    { .log_file = NULL,
+      .pve_dump_file = NULL,
+      .repeats = 0,
+      .move_values_depth = 1
+    };
+
+  GamePositionX *const gpx = game_position_x_gp_to_gpx(get_gp_from_db(fixture->db, "ffo-05"));
+  ExactSolution *const solution = game_position_es2_solve(gpx, &env);
+
+  g_assert_cmpint(+32, ==, solution->outcome);
+  g_assert(solution->optimal_line_count == 2);
+  g_assert(solution->move_values_count == move_count);
+  for (int i = 0; i < move_count; i++) {
+    bool found = false;
+    for (size_t j = 0; j < solution->move_values_count; j++) {
+      const ExactSolutionMoveValue *const mv = &solution->move_values[j];
+      g_assert(mv->ply == 0);
+      if (mv->move != moves[i]) continue;
+      g_assert_cmpint(values[i], ==, mv->value);
+      if (mv->move == G8) g_assert(mv->optimal_line_count == solution->optimal_line_count);
+      found = true;
+    }
+    g_assert(found);
+  }
+
+  exact_solution_free(solution);
+  free(gpx);
+}
+
 
 
 /*
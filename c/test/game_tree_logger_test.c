@@ -0,0 +1,759 @@
+/**
+ * @file
+ *
+ * @brief Game tree logger unit test suite.
+ * @details Collects tests and helper methods for the game tree logger module.
+ *
+ * @par game_tree_logger_test.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "game_tree_logger.h"
+
+
+
+/* Test function prototypes. */
+
+static void game_tree_log_init_test (void);
+static void game_tree_log_write_h_test (void);
+static void game_tree_log_write_h_uncompressed_test (void);
+static void game_tree_log_h_read_header_test (void);
+static void game_tree_log_h_read_index_test (void);
+static void game_tree_log_h_hash_index_test (void);
+static void game_tree_log_filter_max_depth_test (void);
+static void game_tree_log_filter_root_moves_test (void);
+static void game_tree_log_filter_sample_test (void);
+static void game_tree_log_write_t_test (void);
+
+
+
+/* Helper function prototypes. */
+
+static void
+prepare_record (LogDataH *const data,
+                char *const json_doc,
+                const uint64_t i);
+
+static void
+write_and_read_back (const bool compression);
+
+static uint64_t
+write_tree (LogEnv *const env,
+            const int sub_run_id,
+            const int level,
+            const uint64_t parent_hash,
+            const SquareSet blacks,
+            uint64_t *const call_id);
+
+static uint64_t
+write_tree_with_exits (LogEnv *const env,
+                       const int sub_run_id,
+                       const int level,
+                       const uint64_t parent_hash,
+                       const SquareSet blacks,
+                       uint64_t *const call_id,
+                       char *const json_doc);
+
+static uint64_t
+read_tree_with_exits (const char *const h_file_name,
+                      uint64_t *const exit_count,
+                      size_t *const block_count);
+
+static uint64_t
+write_filtered_trees (const int max_depth,
+                      const uint32_t sample_rate,
+                      const SquareSet root_moves,
+                      int *const max_read_depth,
+                      SquareSet *const read_root_moves);
+
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/game_tree_logger/game_tree_log_init_test", game_tree_log_init_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_write_h_test", game_tree_log_write_h_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_write_h_uncompressed_test", game_tree_log_write_h_uncompressed_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_h_read_header_test", game_tree_log_h_read_header_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_h_read_index_test", game_tree_log_h_read_index_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_h_hash_index_test", game_tree_log_h_hash_index_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_filter_max_depth_test", game_tree_log_filter_max_depth_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_filter_root_moves_test", game_tree_log_filter_root_moves_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_filter_sample_test", game_tree_log_filter_sample_test);
+  g_test_add_func("/game_tree_logger/game_tree_log_write_t_test", game_tree_log_write_t_test);
+
+  return g_test_run();
+}
+
+
+
+/*
+ * Test functions.
+ */
+
+static void
+game_tree_log_init_test (void)
+{
+  LogEnv *env = game_tree_log_init(NULL);
+  g_assert(env);
+  g_assert(!env->log_is_on);
+  g_assert(!env->h_writer);
+
+  LogWriterStats stats;
+  game_tree_log_h_stats(env, &stats);
+  g_assert(stats.record_count == 0);
+  g_assert(stats.batch_count == 0);
+
+  game_tree_log_close(env);
+}
+
+static void
+game_tree_log_write_h_test (void)
+{
+  write_and_read_back(true);
+}
+
+static void
+game_tree_log_write_h_uncompressed_test (void)
+{
+  write_and_read_back(false);
+}
+
+static void
+game_tree_log_h_read_header_test (void)
+{
+  static const char *const file_name = "build/test/game_tree_logger_test_header.dat";
+
+  FILE *fp = fopen(file_name, "w+");
+  g_assert(fp);
+  fwrite("NOTALOGFILE-0123", 16, 1, fp);
+  rewind(fp);
+  g_assert(game_tree_log_h_read_header(fp) < 0);
+  fclose(fp);
+
+  fp = fopen(file_name, "w+");
+  g_assert(fp);
+  fwrite(GAME_TREE_LOG_H_MAGIC, 8, 1, fp);
+  rewind(fp);
+  g_assert(game_tree_log_h_read_header(fp) < 0);
+  fclose(fp);
+}
+
+static void
+game_tree_log_h_read_index_test (void)
+{
+  static const char *const file_name_prefix = "build/test/game_tree_logger_test_index";
+
+  const uint64_t record_count = 16 * game_tree_log_ring_size + 3;
+
+  LogDataH data;
+  char json_doc[game_tree_log_max_json_doc_len];
+
+  LogEnv *env = game_tree_log_init(file_name_prefix);
+  game_tree_log_open_h(env);
+  for (uint64_t i = 0; i < record_count; i++) {
+    prepare_record(&data, json_doc, i);
+    game_tree_log_write_h(env, &data);
+  }
+  LogWriterStats stats;
+  game_tree_log_h_stats(env, &stats);
+  gchar *h_file_name = g_strdup(env->h_file_name);
+  game_tree_log_close(env);
+
+  FILE *fp = fopen(h_file_name, "r");
+  g_assert(fp);
+  LogBlockIndexEntryH *index;
+  size_t block_count;
+  g_assert(game_tree_log_h_read_index(fp, &index, &block_count) == 0);
+  g_assert(block_count > 1);
+
+  /* Each block is read by seeking its offset, and holds the records up to the next one. */
+  LogBlockH block;
+  LogDataH record;
+  game_tree_log_block_h_init(&block);
+  for (size_t k = 0; k < block_count; k++) {
+    g_assert(fseeko(fp, index[k].offset, SEEK_SET) == 0);
+    g_assert(game_tree_log_block_h_read(&block, fp) == 1);
+    const uint64_t next_first_record = k + 1 < block_count ? index[k + 1].first_record : record_count;
+    g_assert(index[k].first_record + block.record_count == next_first_record);
+    g_assert(game_tree_log_block_h_next(&block, &record, json_doc) == 1);
+    g_assert(record.call_id == index[k].first_record + 1);
+  }
+  /* The block index ends the sequence of blocks. */
+  g_assert(fseeko(fp, index[block_count - 1].offset, SEEK_SET) == 0);
+  g_assert(game_tree_log_block_h_read(&block, fp) == 1);
+  g_assert(game_tree_log_block_h_read(&block, fp) == 0);
+  game_tree_log_block_h_release(&block);
+  fclose(fp);
+
+  /* Without the index, as when the file has not been closed, the index is rebuilt from the block headers. */
+  fp = fopen(h_file_name, "r+");
+  g_assert(fp);
+  g_assert(ftruncate(fileno(fp), index[block_count - 1].offset) == 0);
+  LogBlockIndexEntryH *rebuilt_index;
+  size_t rebuilt_block_count;
+  g_assert(game_tree_log_h_read_index(fp, &rebuilt_index, &rebuilt_block_count) == 0);
+  g_assert(rebuilt_block_count == block_count - 1);
+  g_assert(memcmp(index, rebuilt_index, rebuilt_block_count * sizeof(LogBlockIndexEntryH)) == 0);
+  fclose(fp);
+
+  free(rebuilt_index);
+  free(index);
+  g_free(h_file_name);
+}
+
+static void
+game_tree_log_h_hash_index_test (void)
+{
+  static const char *const file_name_prefix = "build/test/game_tree_logger_test_hash_index";
+  static const char *const index_file_name = "build/test/game_tree_logger_test_hash_index.hix";
+  static const uint64_t tree_size = 1 + 3 + 9 + 27 + 81 + 243;
+
+  /* Two trees, and a third root sharing the hash of the first one. */
+  LogEnv *env = game_tree_log_init(file_name_prefix);
+  game_tree_log_open_h(env);
+  uint64_t call_id = 0;
+  write_tree(env, 0, 3, 0, 0x01, &call_id);
+  write_tree(env, 1, 3, 0, 0x01, &call_id);
+  LogDataH data;
+  memset(&data, 0, sizeof(LogDataH));
+  data.sub_run_id = 2;
+  data.call_id = ++call_id;
+  data.hash = 0x9E3779B97F4A7C15ULL;
+  data.blacks = 0x01;
+  data.call_level = 3;
+  game_tree_log_write_h(env, &data);
+  gchar *h_file_name = g_strdup(env->h_file_name);
+  game_tree_log_close(env);
+  const uint64_t record_count = 2 * tree_size + 1;
+
+  FILE *fp = fopen(h_file_name, "r");
+  g_assert(fp);
+  FILE *ifp = fopen(index_file_name, "w");
+  g_assert(ifp);
+  g_assert(game_tree_log_h_hash_index_write(fp, ifp) == 0);
+  fclose(ifp);
+
+  LogHashIndexH index;
+  ifp = fopen(index_file_name, "r");
+  g_assert(ifp);
+  g_assert(game_tree_log_h_hash_index_open(&index, ifp) == 0);
+  g_assert(index.record_count == record_count);
+  g_assert(fseeko(fp, 0, SEEK_END) == 0);
+  g_assert(index.log_size == (uint64_t) ftello(fp));
+
+  /* The root of the first tree, and the third root. */
+  uint64_t *ordinals;
+  size_t ordinal_count;
+  g_assert(game_tree_log_h_hash_index_lookup(&index, LOG_HASH_INDEX_BY_HASH, 0x9E3779B97F4A7C15ULL, &ordinals, &ordinal_count) == 0);
+  g_assert(ordinal_count == 2);
+  g_assert(ordinals[0] == 0);
+  g_assert(ordinals[1] == record_count - 1);
+  free(ordinals);
+
+  /* The three children of the root of the first tree. */
+  g_assert(game_tree_log_h_hash_index_lookup(&index, LOG_HASH_INDEX_BY_PARENT_HASH, 0x9E3779B97F4A7C15ULL, &ordinals, &ordinal_count) == 0);
+  g_assert(ordinal_count == 3);
+  for (size_t i = 0; i < 3; i++) g_assert(ordinals[i] == 1 + i * (tree_size - 1) / 3);
+  free(ordinals);
+
+  /* A missing hash. */
+  g_assert(game_tree_log_h_hash_index_lookup(&index, LOG_HASH_INDEX_BY_HASH, 12345, &ordinals, &ordinal_count) == 0);
+  g_assert(ordinal_count == 0);
+  free(ordinals);
+
+  /* The path from the last leaf of the first tree to its root. */
+  LogBlockIndexEntryH *blocks;
+  size_t block_count;
+  g_assert(game_tree_log_h_read_index(fp, &blocks, &block_count) == 0);
+  LogBlockH block;
+  LogDataH record;
+  char json_doc[game_tree_log_max_json_doc_len];
+  game_tree_log_block_h_init(&block);
+  uint64_t ordinal = tree_size - 1;
+  uint64_t parent_hash = 0;
+  int path_length = 0;
+  while (ordinal != GAME_TREE_LOG_H_NO_PARENT) {
+    g_assert(game_tree_log_h_read_record(fp, blocks, block_count, ordinal, &block, &record, json_doc) == 0);
+    g_assert(record.call_id == ordinal + 1);
+    g_assert(record.sub_run_id == 0);
+    g_assert(path_length == 0 || record.hash == parent_hash);
+    g_assert(record.call_level == 8 - path_length);
+    parent_hash = record.parent_hash;
+    path_length++;
+    g_assert(game_tree_log_h_hash_index_parent(&index, ordinal, &ordinal) == 0);
+  }
+  g_assert(path_length == 6);
+
+  /* Roots have no parent, the third root belongs to another sub run. */
+  g_assert(game_tree_log_h_hash_index_parent(&index, tree_size, &ordinal) == 0);
+  g_assert(ordinal == GAME_TREE_LOG_H_NO_PARENT);
+  g_assert(game_tree_log_h_hash_index_parent(&index, record_count - 1, &ordinal) == 0);
+  g_assert(ordinal == GAME_TREE_LOG_H_NO_PARENT);
+  g_assert(game_tree_log_h_hash_index_parent(&index, record_count, &ordinal) == -1);
+  g_assert(game_tree_log_h_read_record(fp, blocks, block_count, record_count, &block, &record, json_doc) == -1);
+
+  game_tree_log_block_h_release(&block);
+  free(blocks);
+  fclose(ifp);
+  fclose(fp);
+  g_free(h_file_name);
+}
+
+static void
+game_tree_log_filter_max_depth_test (void)
+{
+  int max_read_depth;
+  SquareSet read_root_moves;
+  const uint64_t n = write_filtered_trees(2, 0, empty_square_set, &max_read_depth, &read_root_moves);
+  g_assert(n == 2 * (1 + 3 + 9));
+  g_assert(max_read_depth == 2);
+  g_assert(read_root_moves == 0x0E);
+}
+
+static void
+game_tree_log_filter_root_moves_test (void)
+{
+  int max_read_depth;
+  SquareSet read_root_moves;
+  const uint64_t n = write_filtered_trees(-1, 0, 0x04, &max_read_depth, &read_root_moves);
+  g_assert(n == 2 * (1 + 1 + 3 + 9 + 27 + 81));
+  g_assert(max_read_depth == 5);
+  g_assert(read_root_moves == 0x04);
+}
+
+static void
+game_tree_log_filter_sample_test (void)
+{
+  int max_read_depth;
+  SquareSet read_root_moves;
+  const uint64_t all = write_filtered_trees(-1, 1, empty_square_set, &max_read_depth, &read_root_moves);
+  g_assert(all == 2 * 364);
+  const uint64_t n = write_filtered_trees(-1, 10, empty_square_set, &max_read_depth, &read_root_moves);
+  g_assert(n > 2 * 364 / 10 && n < 2 * 364);
+  g_assert(n == write_filtered_trees(-1, 10, empty_square_set, &max_read_depth, &read_root_moves));
+}
+
+
+
+static void
+game_tree_log_write_t_test (void)
+{
+  static const char *const file_name_prefix = "build/test/game_tree_logger_test_exit";
+  static const uint64_t tree_size = 1 + 3 + 9 + 27 + 81 + 243;
+
+  /* Records entering the nodes have a long json field, so that exit records are found in blocks following the ones of their nodes. */
+  char json_doc[game_tree_log_max_json_doc_len];
+  memset(json_doc, 'x', 2000);
+  json_doc[2000] = '\0';
+
+  LogEnv *env = game_tree_log_init(file_name_prefix);
+  game_tree_log_open_h(env);
+  uint64_t call_id = 0;
+  for (int sub_run_id = 0; sub_run_id < 3; sub_run_id++) {
+    g_assert(write_tree_with_exits(env, sub_run_id, 3, 0, 0x01, &call_id, json_doc) == tree_size);
+  }
+  gchar *h_file_name = g_strdup(env->h_file_name);
+  game_tree_log_close(env);
+
+  uint64_t exit_count;
+  size_t block_count;
+  g_assert(read_tree_with_exits(h_file_name, &exit_count, &block_count) == 3 * tree_size);
+  g_assert(exit_count == 3 * tree_size);
+  g_assert(block_count > 1);
+
+  /* Filters drop the exit records of the nodes they drop. */
+  env = game_tree_log_init(file_name_prefix);
+  game_tree_log_set_filters(env, 2, 0, 0x02);
+  game_tree_log_open_h(env);
+  call_id = 0;
+  for (int sub_run_id = 0; sub_run_id < 3; sub_run_id++) {
+    write_tree_with_exits(env, sub_run_id, 3, 0, 0x01, &call_id, NULL);
+  }
+  LogWriterStats stats;
+  game_tree_log_h_stats(env, &stats);
+  game_tree_log_close(env);
+
+  g_assert(read_tree_with_exits(h_file_name, &exit_count, &block_count) == 3 * (1 + 1 + 3));
+  g_assert(exit_count == 3 * (1 + 1 + 3));
+  g_assert(stats.filtered_count == 2 * 3 * (tree_size - 5));
+
+  g_free(h_file_name);
+}
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Fills the i-th record of the test, one record every three has a json field.
+ */
+static void
+prepare_record (LogDataH *const data,
+                char *const json_doc,
+                const uint64_t i)
+{
+  memset(data, 0, sizeof(LogDataH));
+  data->sub_run_id = i % 5;
+  data->call_id = i + 1;
+  data->hash = i * 0x9E3779B97F4A7C15ULL;
+  data->parent_hash = (i / 2) * 0x9E3779B97F4A7C15ULL;
+  data->blacks = ~i;
+  data->whites = i << 3;
+  data->player = i % 2;
+  data->call_level = i % 61;
+  /* Most records have the parent hash of the previous call level, and the computed hash. */
+  if (i % 7) {
+    const GamePositionX gpx = { .blacks = data->blacks & ~data->whites, .whites = data->whites, .player = data->player };
+    data->blacks = gpx.blacks;
+    data->hash = game_position_x_hash(&gpx);
+    data->call_level = i % 7;
+    data->parent_hash = i - 1;
+  } else {
+    data->parent_hash = i;
+  }
+  if (i % 3 == 0) {
+    data->json_doc_len = sprintf(json_doc, "{ \"i\": %" PRIu64 ", \"pad\": \"%*s\" }", i, (int) (i % 200), "");
+    data->json_doc = json_doc;
+  }
+}
+
+/*
+ * Writes the records with the logger, reads them back, and checks them.
+ * Records are more than the ring slots, and more than a block holds.
+ */
+static void
+write_and_read_back (const bool compression)
+{
+  static const char *const file_name_prefix = "build/test/game_tree_logger_test";
+
+  const uint64_t record_count = 64 * game_tree_log_ring_size + 7;
+
+  LogDataH data;
+  char json_doc[game_tree_log_max_json_doc_len];
+
+  LogEnv *env = game_tree_log_init(file_name_prefix);
+  g_assert(env->log_is_on);
+  env->h_compression = compression;
+  game_tree_log_open_h(env);
+  g_assert(env->h_file);
+  g_assert(env->h_writer);
+
+  for (uint64_t i = 0; i < record_count; i++) {
+    prepare_record(&data, json_doc, i);
+    game_tree_log_write_h(env, &data);
+    /* The record is copied by the logger, the caller can change it. */
+    memset(json_doc, 'x', sizeof(json_doc));
+  }
+
+  LogWriterStats stats;
+  game_tree_log_h_stats(env, &stats);
+  g_assert(stats.record_count <= record_count);
+  g_assert(stats.max_ring_usage <= game_tree_log_ring_size);
+
+  gchar *h_file_name = g_strdup(env->h_file_name);
+  game_tree_log_close(env);
+
+  /* Reads back the records. */
+  FILE *fp = fopen(h_file_name, "r");
+  g_assert(fp);
+  g_assert(game_tree_log_h_read_header(fp) == 0);
+
+  LogBlockH block;
+  LogDataH record;
+  char expected_json_doc[game_tree_log_max_json_doc_len];
+  char read_json_doc[game_tree_log_max_json_doc_len];
+  uint64_t i = 0;
+  size_t block_count = 0;
+  size_t stored_size = 0;
+  size_t raw_size = 0;
+  game_tree_log_block_h_init(&block);
+  int ret;
+  while ((ret = game_tree_log_block_h_read(&block, fp)) > 0) {
+    block_count++;
+    stored_size += block.stored_size;
+    raw_size += block.raw_size;
+    g_assert(block.compression == (compression ? LOG_BLOCK_LZ : LOG_BLOCK_RAW));
+    while ((ret = game_tree_log_block_h_next(&block, &record, read_json_doc)) > 0) {
+      g_assert(i < record_count);
+      prepare_record(&data, expected_json_doc, i);
+      g_assert(record.sub_run_id == data.sub_run_id);
+      g_assert(record.call_id == data.call_id);
+      g_assert(record.hash == data.hash);
+      g_assert(record.parent_hash == data.parent_hash);
+      g_assert(record.blacks == data.blacks);
+      g_assert(record.whites == data.whites);
+      g_assert(record.player == data.player);
+      g_assert(record.call_level == data.call_level);
+      g_assert((record.json_doc != NULL) == (data.json_doc != NULL));
+      if (record.json_doc) {
+        g_assert(record.json_doc == read_json_doc);
+        g_assert(record.json_doc_len == data.json_doc_len);
+        g_assert(strcmp(read_json_doc, expected_json_doc) == 0);
+      }
+      i++;
+    }
+    g_assert(ret == 0);
+  }
+  g_assert(ret == 0);
+  g_assert(i == record_count);
+  g_assert(block_count > 1);
+  if (compression) g_assert(stored_size < raw_size);
+  else g_assert(stored_size == raw_size);
+
+  game_tree_log_block_h_release(&block);
+  fclose(fp);
+  g_free(h_file_name);
+}
+
+/*
+ * Writes a complete tree, having three children for each node, and five levels below the root.
+ * The root has square A1 occupied, each child adds a square, root moves are B1, C1, and D1.
+ * Returns the number of records written.
+ */
+static uint64_t
+write_tree (LogEnv *const env,
+            const int sub_run_id,
+            const int level,
+            const uint64_t parent_hash,
+            const SquareSet blacks,
+            uint64_t *const call_id)
+{
+  static const int root_level = 3;
+  static const int leaf_level = root_level + 5;
+
+  LogDataH data;
+  memset(&data, 0, sizeof(LogDataH));
+  data.sub_run_id = sub_run_id;
+  data.call_id = ++*call_id;
+  data.hash = (*call_id + 1000 * sub_run_id) * 0x9E3779B97F4A7C15ULL;
+  data.parent_hash = parent_hash;
+  data.blacks = blacks;
+  data.call_level = level;
+  game_tree_log_write_h(env, &data);
+
+  uint64_t count = 1;
+  if (level < leaf_level) {
+    for (int c = 0; c < 3; c++) {
+      const SquareSet move = (SquareSet) 1 << (1 + 3 * (level - root_level) + c);
+      count += write_tree(env, sub_run_id, level + 1, data.hash, blacks | move, call_id);
+    }
+  }
+  return count;
+}
+
+/*
+ * Writes a complete tree, as write_tree does, followed by an exit record for each node.
+ * The value of a node is its call level negated, the best move is the square of its first child, or a pass for leaves.
+ * When json_doc is not NULL, it is the json field of the records entering the nodes.
+ * Returns the number of nodes written.
+ */
+static uint64_t
+write_tree_with_exits (LogEnv *const env,
+                       const int sub_run_id,
+                       const int level,
+                       const uint64_t parent_hash,
+                       const SquareSet blacks,
+                       uint64_t *const call_id,
+                       char *const json_doc)
+{
+  static const int root_level = 3;
+  static const int leaf_level = root_level + 5;
+
+  LogDataH data;
+  memset(&data, 0, sizeof(LogDataH));
+  data.sub_run_id = sub_run_id;
+  data.call_id = ++*call_id;
+  data.hash = (*call_id + 1000 * sub_run_id) * 0x9E3779B97F4A7C15ULL;
+  data.parent_hash = parent_hash;
+  data.blacks = blacks;
+  data.call_level = level;
+  data.json_doc = json_doc;
+  data.json_doc_len = json_doc ? strlen(json_doc) : 0;
+  game_tree_log_write_h(env, &data);
+
+  uint64_t count = 1;
+  Square best_move = pass_move;
+  if (level < leaf_level) {
+    best_move = (Square) (1 + 3 * (level - root_level));
+    for (int c = 0; c < 3; c++) {
+      const SquareSet move = (SquareSet) 1 << (1 + 3 * (level - root_level) + c);
+      count += write_tree_with_exits(env, sub_run_id, level + 1, data.hash, blacks | move, call_id, json_doc);
+    }
+  }
+
+  const LogDataT exit_data =
+    { .sub_run_id   = sub_run_id,
+      .call_id      = data.call_id,
+      .hash         = data.hash,
+      .parent_hash  = parent_hash,
+      .json_doc     = NULL,
+      .json_doc_len = 0,
+      .call_level   = level,
+      .value        = -level,
+      .best_move    = best_move,
+      .node_count   = count };
+  game_tree_log_write_t(env, &exit_data);
+  return count;
+}
+
+/*
+ * Reads the records written by write_tree_with_exits, and checks that each exit record follows
+ * the records of the subtree of its node, and matches the record entering it.
+ * Returns the number of records entering nodes, the number of exit records, and the number of blocks.
+ */
+static uint64_t
+read_tree_with_exits (const char *const h_file_name,
+                      uint64_t *const exit_count,
+                      size_t *const block_count)
+{
+  FILE *fp = fopen(h_file_name, "r");
+  g_assert(fp);
+  g_assert(game_tree_log_h_read_header(fp) == 0);
+
+  LogDataH open_nodes[256];
+  bool is_open[257];
+  memset(is_open, 0, sizeof(is_open));
+  uint64_t enter_count = 0;
+  *exit_count = 0;
+  *block_count = 0;
+
+  LogBlockH block;
+  LogDataH record;
+  char json_doc[game_tree_log_max_json_doc_len];
+  game_tree_log_block_h_init(&block);
+  while (game_tree_log_block_h_read(&block, fp) > 0) {
+    (*block_count)++;
+    int ret;
+    while ((ret = game_tree_log_block_h_next(&block, &record, json_doc)) > 0) {
+      const int level = record.call_level;
+      if (record.type == LOG_RECORD_ENTER) {
+        g_assert(!is_open[level]);
+        open_nodes[level] = record;
+        is_open[level] = true;
+        enter_count++;
+      } else {
+        g_assert(record.type == LOG_RECORD_EXIT);
+        g_assert(is_open[level] && !is_open[level + 1]);
+        const LogDataH *const node = &open_nodes[level];
+        g_assert(record.sub_run_id == node->sub_run_id);
+        g_assert(record.call_id == node->call_id);
+        g_assert(record.hash == node->hash);
+        g_assert(record.parent_hash == node->parent_hash);
+        g_assert(record.value == -level);
+        g_assert(!record.json_doc);
+        g_assert(record.blacks == empty_square_set && record.whites == empty_square_set);
+        if (record.node_count == 1) g_assert(record.best_move == pass_move);
+        else g_assert(record.best_move == (Square) (1 + 3 * (level - 3)));
+        is_open[level] = false;
+        (*exit_count)++;
+      }
+    }
+    g_assert(ret == 0);
+  }
+  for (int i = 0; i < 257; i++) g_assert(!is_open[i]);
+
+  game_tree_log_block_h_release(&block);
+  fclose(fp);
+  return enter_count;
+}
+
+/*
+ * Writes two trees, belonging to two sub runs, with the given filters, reads them back,
+ * and checks that the parent of every record, but the roots, has been written before it.
+ * Returns the number of records read, the largest depth, and the root moves met.
+ */
+static uint64_t
+write_filtered_trees (const int max_depth,
+                      const uint32_t sample_rate,
+                      const SquareSet root_moves,
+                      int *const max_read_depth,
+                      SquareSet *const read_root_moves)
+{
+  static const char *const file_name_prefix = "build/test/game_tree_logger_test_filter";
+
+  LogEnv *env = game_tree_log_init(file_name_prefix);
+  game_tree_log_set_filters(env, max_depth, sample_rate, root_moves);
+  game_tree_log_open_h(env);
+  g_assert(env->h_writer);
+
+  uint64_t call_id = 0;
+  uint64_t written = 0;
+  for (int sub_run_id = 0; sub_run_id < 2; sub_run_id++) {
+    written += write_tree(env, sub_run_id, 3, 0, 0x01, &call_id);
+  }
+
+  LogWriterStats stats;
+  game_tree_log_h_stats(env, &stats);
+  gchar *h_file_name = g_strdup(env->h_file_name);
+  game_tree_log_close(env);
+
+  FILE *fp = fopen(h_file_name, "r");
+  g_assert(fp);
+  g_assert(game_tree_log_h_read_header(fp) == 0);
+
+  uint64_t *hashes = (uint64_t *) malloc(written * sizeof(uint64_t));
+  g_assert(hashes);
+  uint64_t n = 0;
+  LogBlockH block;
+  LogDataH record;
+  char json_doc[game_tree_log_max_json_doc_len];
+  *max_read_depth = 0;
+  *read_root_moves = empty_square_set;
+  game_tree_log_block_h_init(&block);
+  while (game_tree_log_block_h_read(&block, fp) > 0) {
+    while (game_tree_log_block_h_next(&block, &record, json_doc) > 0) {
+      g_assert(n < written);
+      const int depth = record.call_level - 3;
+      if (depth > 0) {
+        bool parent_is_written = false;
+        for (uint64_t i = 0; i < n; i++) parent_is_written |= hashes[i] == record.parent_hash;
+        g_assert(parent_is_written);
+      }
+      if (depth > *max_read_depth) *max_read_depth = depth;
+      if (depth == 1) *read_root_moves |= record.blacks & ~0x01;
+      hashes[n++] = record.hash;
+    }
+  }
+  g_assert(n + stats.filtered_count == written);
+
+  game_tree_log_block_h_release(&block);
+  free(hashes);
+  fclose(fp);
+  g_free(h_file_name);
+  return n;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file
+ *
+ * @brief Game tree statistics unit test suite.
+ * @details Collects tests and helper methods for the game tree statistics module.
+ *
+ * @par game_tree_stats_test.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "bit_works.h"
+#include "game_tree_stats.h"
+
+
+
+/* Test function prototypes. */
+
+static void creation_and_destruction_test (void);
+static void full_tree_test (void);
+static void cut_test (void);
+static void pass_and_leaf_test (void);
+static void print_test (void);
+
+
+
+/* Helper function prototypes. */
+
+static void
+initial_position (GamePositionX *const gpx);
+
+static uint64_t
+visit_full_tree (GameTreeStats *const stats,
+                 const GamePositionX *const gpx,
+                 const int depth,
+                 const int max_depth);
+
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/game_tree_stats/creation_and_destruction_test", creation_and_destruction_test);
+  g_test_add_func("/game_tree_stats/full_tree_test", full_tree_test);
+  g_test_add_func("/game_tree_stats/cut_test", cut_test);
+  g_test_add_func("/game_tree_stats/pass_and_leaf_test", pass_and_leaf_test);
+  g_test_add_func("/game_tree_stats/print_test", print_test);
+
+  return g_test_run();
+}
+
+
+
+/*
+ * Test functions.
+ */
+
+static void
+creation_and_destruction_test (void)
+{
+  GameTreeStats *stats = game_tree_stats_new();
+  g_assert(stats);
+  g_assert(stats->depth == -1);
+  g_assert(stats->max_depth == -1);
+  g_assert(stats->levels[0].node_count == 0);
+  g_assert(game_tree_stats_distinct_hash_count(stats) == 0);
+  game_tree_stats_free(stats);
+  game_tree_stats_free(NULL);
+}
+
+static void
+full_tree_test (void)
+{
+  /*
+   * The tree of the first four moves, searched without cuts: the counts by depth are
+   * the known perft values 1, 4, 12, 56, 244, and many positions are reached by transposition.
+   */
+  const uint64_t expected[] = {1, 4, 12, 56, 244};
+  GameTreeStats *stats = game_tree_stats_new();
+  GamePositionX root;
+  initial_position(&root);
+
+  const uint64_t node_count = visit_full_tree(stats, &root, 0, 4);
+  game_tree_stats_close_nodes(stats);
+
+  g_assert(node_count == 1 + 4 + 12 + 56 + 244);
+  g_assert(stats->max_depth == 4);
+  for (int d = 0; d <= 4; d++) {
+    const GameTreeStatsLevel *const l = &stats->levels[d];
+    g_assert(l->node_count == expected[d]);
+    if (d < 4) {
+      g_assert(l->interior_count == expected[d]);
+      g_assert(l->legal_move_count == expected[d + 1]);
+      g_assert(l->cut_count == 0);
+      g_assert(l->searched_count == l->child_count);
+    }
+  }
+  /* Nodes at the horizon have moves, but no child searched, they are neither interior nor cut nodes. */
+  g_assert(stats->levels[4].horizon_count == expected[4]);
+  g_assert(stats->levels[4].interior_count == 0);
+  g_assert(stats->levels[4].cut_count == 0);
+  for (int d = 0; d < 4; d++) g_assert(stats->levels[d].horizon_count == 0);
+  g_assert(hs_count(stats->positions) < node_count);
+  g_assert(game_tree_stats_distinct_hash_count(stats) == hs_count(stats->positions));
+
+  /* The initial position has four moves, and sixty empty squares. */
+  g_assert(stats->mobility[60][4] == 1);
+
+  game_tree_stats_free(stats);
+}
+
+static void
+cut_test (void)
+{
+  GameTreeStats *stats = game_tree_stats_new();
+  GamePositionX root, child;
+  initial_position(&root);
+  const SquareSet moves = game_position_x_legal_moves(&root);
+
+  /* The first root searches one child out of four, the second root searches two. */
+  game_tree_stats_add_node(stats, 0, &root);
+  game_position_x_make_move(&root, bit_works_bitscanLS1B_64(moves), &child);
+  game_tree_stats_add_node(stats, 1, &child);
+
+  game_tree_stats_add_node(stats, 0, &root);
+  g_assert(stats->levels[0].interior_count == 1);
+  g_assert(stats->levels[0].cut_count == 1);
+  g_assert(stats->levels[0].first_child_cut_count == 1);
+
+  game_tree_stats_add_node(stats, 1, &child);
+  game_position_x_make_move(&root, bit_works_bitscanMS1B_64(moves), &child);
+  game_tree_stats_add_node(stats, 1, &child);
+  game_tree_stats_close_nodes(stats);
+  g_assert(stats->depth == -1);
+
+  const GameTreeStatsLevel *const l = &stats->levels[0];
+  g_assert(l->node_count == 2);
+  g_assert(l->interior_count == 2);
+  g_assert(l->child_count == 8);
+  g_assert(l->searched_count == 3);
+  g_assert(l->cut_count == 2);
+  g_assert(l->first_child_cut_count == 1);
+
+  /* Two distinct positions at depth one, the first visited twice. */
+  g_assert(stats->levels[1].node_count == 3);
+  g_assert(hs_count(stats->positions) == 3);
+
+  game_tree_stats_free(stats);
+}
+
+static void
+pass_and_leaf_test (void)
+{
+  GameTreeStats *stats = game_tree_stats_new();
+
+  /* White has no move, black has: the node has one child, the pass. */
+  const GamePositionX pass = { 0x0000000000000001, 0x0000000000000002, WHITE_PLAYER };
+  /* Only black discs: the game is over. */
+  const GamePositionX leaf = { 0x0000000000000003, 0x0000000000000000, WHITE_PLAYER };
+
+  game_tree_stats_add_node(stats, 0, &pass);
+  game_tree_stats_add_node(stats, 1, &leaf);
+  game_tree_stats_close_nodes(stats);
+
+  g_assert(stats->levels[0].pass_count == 1);
+  g_assert(stats->levels[0].leaf_count == 0);
+  g_assert(stats->levels[0].child_count == 1);
+  g_assert(stats->levels[0].searched_count == 1);
+  g_assert(stats->levels[0].cut_count == 0);
+  g_assert(stats->levels[1].leaf_count == 1);
+  g_assert(stats->levels[1].interior_count == 0);
+  g_assert(stats->levels[1].horizon_count == 0);
+
+  /* Pass and leaf nodes are not in the mobility table. */
+  for (int e = 0; e < GAME_TREE_STATS_MOBILITY_SIZE; e++)
+    for (int m = 0; m < GAME_TREE_STATS_MOBILITY_SIZE; m++)
+      g_assert(stats->mobility[e][m] == 0);
+
+  game_tree_stats_free(stats);
+}
+
+static void
+print_test (void)
+{
+  GameTreeStats *stats = game_tree_stats_new();
+  GamePositionX root;
+  initial_position(&root);
+  visit_full_tree(stats, &root, 0, 3);
+
+  char buf[8192];
+  FILE *stream = tmpfile();
+  g_assert(stream);
+  game_tree_stats_print(stats, stream);
+  rewind(stream);
+  const size_t len = fread(buf, 1, sizeof(buf) - 1, stream);
+  buf[len] = '\0';
+  fclose(stream);
+
+  g_assert(stats->depth == -1);
+  g_assert(strstr(buf, "Game tree statistics:"));
+  g_assert(strstr(buf, "nodes: 73, leaves: 0, passes: 0, horizon nodes: 56, max depth: 3"));
+
+  game_tree_stats_free(stats);
+}
+
+
+
+/*
+ * Internal functions.
+ */
+
+static void
+initial_position (GamePositionX *const gpx)
+{
+  gpx->blacks = 0x0000000810000000;
+  gpx->whites = 0x0000001008000000;
+  gpx->player = BLACK_PLAYER;
+}
+
+/*
+ * Adds to stats all the nodes of the tree rooted at gpx, down to max_depth, and returns their count.
+ */
+static uint64_t
+visit_full_tree (GameTreeStats *const stats,
+                 const GamePositionX *const gpx,
+                 const int depth,
+                 const int max_depth)
+{
+  game_tree_stats_add_node(stats, depth, gpx);
+  if (depth == max_depth) return 1;
+  uint64_t count = 1;
+  GamePositionX next;
+  for (SquareSet moves = game_position_x_legal_moves(gpx); moves; moves &= moves - 1) {
+    game_position_x_make_move(gpx, bit_works_bitscanLS1B_64(moves), &next);
+    count += visit_full_tree(stats, &next, depth + 1, max_depth);
+  }
+  return count;
+}
@@ -33,8 +33,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include "game_tree_utils.h"
 
@@ -46,6 +48,12 @@ static void dummy_test (void);
 static void pve_create_test (void);
 static void pve_internals_to_stream_test (void);
 static void pve_is_invariant_satisfied_test (void);
+static void pve_is_invariant_satisfied_links_test (void);
+static void pve_line_add_move_shared_test (void);
+static void pve_positions_test (void);
+static void pve_dump_test (void);
+static void pve_dump_cursor_test (void);
+static void search_checkpoint_test (void);
 
 
 int
@@ -58,6 +66,12 @@ main (int   argc,
   g_test_add_func("/game_tree_utils/pve_create_test", pve_create_test);
   g_test_add_func("/game_tree_utils/pve_internals_to_stream_test", pve_internals_to_stream_test);
   g_test_add_func("/game_tree_utils/pve_is_invariant_satisfied_test", pve_is_invariant_satisfied_test);
+  g_test_add_func("/game_tree_utils/pve_is_invariant_satisfied_links_test", pve_is_invariant_satisfied_links_test);
+  g_test_add_func("/game_tree_utils/pve_line_add_move_shared_test", pve_line_add_move_shared_test);
+  g_test_add_func("/game_tree_utils/pve_positions_test", pve_positions_test);
+  g_test_add_func("/game_tree_utils/pve_dump_test", pve_dump_test);
+  g_test_add_func("/game_tree_utils/pve_dump_cursor_test", pve_dump_cursor_test);
+  g_test_add_func("/game_tree_utils/search_checkpoint_test", search_checkpoint_test);
 
   return g_test_run();
 }
@@ -79,11 +93,7 @@ pve_is_invariant_satisfied_test (void)
 {
   PVEnv *pve;
   pve_error_code_t error_code;
-  PVCell ***lines_segments_tmp;
-  PVCell ***lines_segments_head_tmp;
-  size_t lines_size_tmp;
-  PVCell **lines_segment_tmp;
-  ptrdiff_t active_lines_segments_count;
+  mem_obj_allocator_t *arena_tmp;
 
   gboolean is_consistent = TRUE;
   switches_t check_mask = 0xFFFFFFFF;
@@ -94,125 +104,183 @@ pve_is_invariant_satisfied_test (void)
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  pve->lines_segments_size = 0; // 0 is a wrong value.
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENTS_SIZE_IS_INCORRECT));
+  g_assert(is_consistent && (error_code == PVE_ERROR_CODE_OK));
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  pve->lines_first_size = 0; // 0 is a wrong value.
+  arena_tmp = pve->lines;
+  pve->lines = NULL; // NULL is a wrong value.
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_FIRST_SIZE_IS_INCORRECT));
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_ARENA_IS_NULL));
+  pve->lines = arena_tmp;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  lines_segments_head_tmp = pve->lines_segments_head;
-  pve->lines_segments_head = NULL; // NULL is a wrong value.
+  pve->lines->object_size++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENTS_HEAD_IS_NULL));
-  pve->lines_segments_head = lines_segments_head_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_ARENA_OBJECT_SIZE_IS_INCORRECT));
+  pve->lines->object_size--;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  lines_segments_tmp = pve->lines_segments;
-  pve->lines_segments = NULL; // NULL is a wrong value.
+  pve->lines->segment_shift++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENTS_IS_NULL));
-  pve->lines_segments = lines_segments_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_ARENA_SEGMENT_SHIFT_IS_INCORRECT));
+  pve->lines->segment_shift--;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  lines_segments_tmp = pve->lines_segments;
-  lines_segments_head_tmp = pve->lines_segments_head;
-  pve->lines_segments = lines_segments_head_tmp;
-  pve->lines_segments_head = lines_segments_tmp;
+  pve->lines->used_count++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENTS_HEADS_PRECEDES_ARRAY_INDEX_0));
-  pve->lines_segments = lines_segments_tmp;
-  pve->lines_segments_head = lines_segments_head_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_ARENA_IS_NOT_CONSISTENT));
+  pve->lines->used_count--;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  lines_segments_head_tmp = pve->lines_segments_head;
-  pve->lines_segments_head = pve->lines_segments + pve->lines_segments_size + 1;
+  pve->lines->free_head = pve->lines->top + 5; // The free list cannot point beyond the top.
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_ACTIVE_LINES_SEGMENTS_COUNT_EXCEEDS_BOUND));
-  pve->lines_segments_head = lines_segments_head_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_ARENA_IS_NOT_CONSISTENT));
+  pve->lines->free_head = MEM_OBJ_NULL_INDEX;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  lines_size_tmp = pve->lines_size;
-  pve->lines_size++;
+  arena_tmp = pve->cells;
+  pve->cells = NULL; // NULL is a wrong value.
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SIZE_MISMATCH));
-  pve->lines_size = lines_size_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_CELLS_ARENA_IS_NULL));
+  pve->cells = arena_tmp;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  lines_segment_tmp = *pve->lines_segments;
-  *pve->lines_segments = NULL;
+  pve->cells->object_size++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENTS_HAS_AN_INVALID_NULL_VALUE));
-  *pve->lines_segments = lines_segment_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_CELLS_ARENA_OBJECT_SIZE_IS_INCORRECT));
+  pve->cells->object_size--;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
-  PVCell *line_fake_value;
   pve = pve_new(dummy_gpx);
-  active_lines_segments_count = pve->lines_segments_head - pve->lines_segments;
-  lines_segment_tmp = *(pve->lines_segments + active_lines_segments_count); // The first unused lines segment is saved, and then corrupted.
-  *(pve->lines_segments + active_lines_segments_count) = &line_fake_value;
+  pve->cells->segment_shift--;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENTS_HAS_AN_INVALID_NOT_NULL_VALUE));
-  *(pve->lines_segments + active_lines_segments_count) = lines_segment_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_CELLS_ARENA_SEGMENT_SHIFT_IS_INCORRECT));
+  pve->cells->segment_shift++;
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  size_t size_tmp = *pve->lines_segments_sorted_sizes;
-  *pve->lines_segments_sorted_sizes = PVE_LINES_FIRST_SIZE * 4;
+  pve->cells->used_count++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_LINES_SEGMENT_COMPUTED_INDEX_OUT_OF_RANGE));
-  *pve->lines_segments_sorted_sizes = size_tmp;
+  g_assert(!is_consistent && (error_code == PVE_ERROR_CODE_CELLS_ARENA_IS_NOT_CONSISTENT));
+  pve->cells->used_count--;
   pve_free(pve);
 
-  /*
-   * These seven error codes are not tested. They require more than one active segment,
-   * and the api to increase the lines segments are not exported.
-   *
-   * PVE_ERROR_CODE_LINES_SEGMENTS_POS_0_AND_1_ANOMALY
-   * PVE_ERROR_CODE_LINES_SEGMENTS_SORTED_AND_UNSORTED_DO_NOT_MATCH
-   * PVE_ERROR_CODE_LINES_SEGMENTS_ARE_NOT_PROPERLY_SORTED
-   * PVE_ERROR_CODE_LINES_SIZE_DOESNT_MATCH_WITH_CUMULATED
-   * PVE_ERROR_CODE_LINES_SEGMENT_POSITION_0_NOT_FOUND
-   * PVE_ERROR_CODE_LINES_SEGMENT_POSITION_0_OR_1_NOT_FOUND
-   * PVE_ERROR_CODE_LINES_SEGMENTS_UNUSED_SEGMENT_HAS_SIZE
-   */
-
-
-
-
-
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  pve->lines_stack_head = pve->lines_stack - 1;
+  pve->line_create_count++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == 1004));
+  g_assert(!is_consistent && (error_code == 1100));
   pve_free(pve);
 
   error_code = PVE_ERROR_CODE_OK;
   pve = pve_new(dummy_gpx);
-  pve->lines_stack_head = pve->lines_stack + pve->lines_size;
+  pve->line_add_move_count++;
   is_consistent = pve_is_invariant_satisfied(pve, &error_code, check_mask);
-  g_assert(!is_consistent && (error_code == 1009));
+  g_assert(!is_consistent && (error_code == 1101));
+  pve_free(pve);
+
+  game_position_x_free(dummy_gpx);
+}
+
+static void
+pve_is_invariant_satisfied_links_test (void)
+{
+  static const int variant_count = 40000;
+  static const int variant_length = 4;
+
+  pve_error_code_t error_code;
+  PVCell *cell;
+  uint32_t tmp;
+
+  GamePositionX *root = game_position_x_new(empty_square_set, empty_square_set, BLACK_PLAYER);
+  GamePositionX x = { .blacks = 0x0000000000000001, .whites = 0x0000000000000002, .player = WHITE_PLAYER };
+
+  /* The PVE spans several segments of cells and lines, variants are chained to the only move of the root line. */
+  PVEnv *pve = pve_new(root);
+  pve_line_add_move2(pve, pve->root_line, A1, &x);
+  for (int i = 0; i < variant_count; i++) {
+    PVCell **variant = pve_line_create(pve);
+    for (int j = 0; j < variant_length; j++) pve_line_add_move2(pve, variant, B1 + j, &x);
+    pve_line_add_variant(pve, pve->root_line, variant);
+  }
+  g_assert(pve->cells->segments_count > 2);
+  g_assert(pve->lines->segments_count > 2);
+
+  error_code = PVE_ERROR_CODE_OK;
+  g_assert(pve_is_invariant_satisfied(pve, &error_code, 0xFF));
+  g_assert(error_code == PVE_ERROR_CODE_OK);
+
+  cell = pve_cell_at(pve, 1000);
+
+  cell->ref_count++;
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(error_code == PVE_ERROR_CODE_CELL_REF_COUNT_IS_INCORRECT);
+  cell->ref_count--;
+
+  tmp = cell->next;
+  cell->next = pve->cells->top;
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(error_code == PVE_ERROR_CODE_CELL_NEXT_IS_INVALID);
+  cell->next = tmp;
+
+  tmp = cell->position;
+  cell->position = pve->positions_size;
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(error_code == PVE_ERROR_CODE_CELL_POSITION_IS_INVALID);
+  cell->position = tmp;
+
+  cell = *pve->root_line;
+
+  tmp = cell->variant;
+  cell->variant = pve->lines->top;
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(error_code == PVE_ERROR_CODE_CELL_VARIANT_IS_INVALID);
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_reachability));
+  g_assert(error_code == PVE_ERROR_CODE_CELL_VARIANT_IS_INVALID);
+  cell->variant = mem_obj_index_of(pve->lines, pve->root_line);
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(error_code == PVE_ERROR_CODE_LINE_IS_A_VARIANT_MORE_THAN_ONCE);
+  cell->variant = tmp;
+
+  *pve->root_line = (PVCell *) ((char *) cell + 1);
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(error_code == PVE_ERROR_CODE_LINE_HEAD_IS_INVALID);
+  *pve->root_line = cell;
+
+  /* Lines not linked to the root line satisfy the links check, but not the reachability one. */
+  PVCell **detached = pve_line_create(pve);
+  g_assert(pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_reachability));
+  g_assert(error_code == PVE_ERROR_CODE_LINE_IS_NOT_REACHABLE);
+  pve_line_add_move2(pve, detached, C1, &x);
+  g_assert(pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_links));
+  g_assert(!pve_is_invariant_satisfied(pve, &error_code, pve_chk_inv_reachability));
+  g_assert(error_code == PVE_ERROR_CODE_CELL_IS_NOT_REACHABLE);
+  pve_line_delete(pve, detached);
+
+  error_code = PVE_ERROR_CODE_OK;
+  g_assert(pve_is_invariant_satisfied(pve, &error_code, 0xFF));
+  g_assert(error_code == PVE_ERROR_CODE_OK);
+
   pve_free(pve);
+  game_position_x_free(root);
 }
 
 static void
@@ -251,3 +319,333 @@ pve_internals_to_stream_test (void)
 
   g_assert(TRUE);
 }
+
+static void
+pve_line_add_move_shared_test (void)
+{
+  GamePositionX *dummy_gpx = game_position_x_new(empty_square_set,
+                                                 empty_square_set,
+                                                 BLACK_PLAYER);
+  GamePositionX x = { .blacks = 0x0000000000000001, .whites = 0x0000000000000002, .player = WHITE_PLAYER };
+  GamePositionX y = { .blacks = 0x0000000000000003, .whites = 0x0000000000000004, .player = BLACK_PLAYER };
+
+  PVEnv *pve = pve_new(dummy_gpx);
+
+  /* Line a records the line following x, that is indexed. */
+  PVCell **line_a = pve_line_create(pve);
+  pve_line_add_move2(pve, line_a, A1, &y);
+  pve_line_add_move_shared(pve, line_a, B1, &x, 7);
+  g_assert(pve->line_share_count == 0);
+  g_assert(hs_count(pve->line_index) == 1);
+
+  /* Line b reaches x within the same context, the line following x is shared. */
+  PVCell **line_b = pve_line_create(pve);
+  pve_line_add_move2(pve, line_b, A1, &y);
+  pve_line_add_move_shared(pve, line_b, C1, &x, 7);
+  g_assert(pve->line_share_count == 1);
+  g_assert((*line_a)->next == (*line_b)->next);
+  g_assert(pve_cell_at(pve, (*line_a)->next)->ref_count == 2);
+  g_assert(pve->cells->used_count == 3);
+  g_assert(pve->positions_count == 2);
+
+  /* Line c reaches x within a different context, nothing is shared. */
+  PVCell **line_c = pve_line_create(pve);
+  pve_line_add_move2(pve, line_c, A1, &y);
+  pve_line_add_move_shared(pve, line_c, D1, &x, 8);
+  g_assert(pve->line_share_count == 1);
+  g_assert(hs_count(pve->line_index) == 2);
+  g_assert(pve->cells->used_count == 5);
+
+  /* Deleting line a leaves the shared cell in use. */
+  pve_line_delete(pve, line_a);
+  g_assert(pve->cells->used_count == 4);
+  g_assert(pve_cell_at(pve, (*line_b)->next)->ref_count == 1);
+  g_assert(hs_count(pve->line_index) == 2);
+
+  /* Deleting all the lines releases all the cells and empties the index. */
+  pve_line_delete(pve, line_b);
+  pve_line_delete(pve, line_c);
+  g_assert(pve->cells->used_count == 0);
+  g_assert(hs_count(pve->line_index) == 0);
+  g_assert(pve->positions_count == 0);
+  g_assert(pve_is_invariant_satisfied(pve, NULL, 0xFF));
+
+  pve_free(pve);
+  game_position_x_free(dummy_gpx);
+}
+
+static void
+pve_positions_test (void)
+{
+  static const int line_length = 200;
+  GamePositionX *dummy_gpx = game_position_x_new(empty_square_set,
+                                                 empty_square_set,
+                                                 BLACK_PLAYER);
+  g_assert(sizeof(PVCell) == 16);
+
+  PVEnv *pve = pve_new(dummy_gpx);
+
+  /* Two lines reach the same positions, each one is recorded once, the tables have to grow. */
+  PVCell **line_a = pve_line_create(pve);
+  PVCell **line_b = pve_line_create(pve);
+  for (int i = 0; i < line_length; i++) {
+    GamePositionX gpx = { .blacks = i, .whites = 0, .player = BLACK_PLAYER };
+    pve_line_add_move2(pve, line_a, A1, &gpx);
+    pve_line_add_move2(pve, line_b, B1, &gpx);
+  }
+  g_assert(pve->positions_count == line_length);
+  g_assert(pve->positions_size >= line_length);
+
+  /* Cells are linked by index across segments, and each cell refers to its own position. */
+  int count = 0;
+  for (const PVCell *c = *line_a; c; c = pve_cell_at(pve, c->next), count++) {
+    g_assert(c->move == A1);
+    g_assert(pve->positions[c->position].gpx.blacks == line_length - 1 - count);
+    g_assert(pve->positions[c->position].ref_count == 2);
+  }
+  g_assert(count == line_length);
+
+  /* Positions are released with the last cell referring to them. */
+  pve_line_delete(pve, line_a);
+  g_assert(pve->positions_count == line_length);
+  pve_line_delete(pve, line_b);
+  g_assert(pve->positions_count == 0);
+  g_assert(pve_is_invariant_satisfied(pve, NULL, 0xFF));
+
+  pve_free(pve);
+  game_position_x_free(dummy_gpx);
+}
+
+static void
+pve_dump_test (void)
+{
+  static const char *const file_name = "build/test/pve_dump_test.dat";
+
+  GamePositionX *root = game_position_x_new(0x0000000000000010, 0x0000000000000020, BLACK_PLAYER);
+  GamePositionX x = { .blacks = 0x0000000000000001, .whites = 0x0000000000000002, .player = WHITE_PLAYER };
+  GamePositionX y = { .blacks = 0x0000000000000003, .whites = 0x0000000000000004, .player = BLACK_PLAYER };
+
+  PVEnv *pve = pve_new(root);
+
+  /* The root line is B1 A1, the variant is C1 A1, and the two lines share the A1 cell. */
+  pve_line_add_move2(pve, pve->root_line, A1, &y);
+  pve_line_add_move_shared(pve, pve->root_line, B1, &x, 0);
+  PVCell **variant = pve_line_create(pve);
+  pve_line_add_move2(pve, variant, A1, &y);
+  pve_line_add_move_shared(pve, variant, C1, &x, 0);
+  pve_line_add_variant(pve, pve->root_line, variant);
+  g_assert(pve->line_share_count == 1);
+
+  const bool is_dumped = pve_dump_to_binary_file(pve, file_name);
+  g_assert(is_dumped);
+
+  pve_dump_t *dump = pve_dump_open(file_name);
+  g_assert(dump);
+  g_assert(dump->header->version == PVE_DUMP_VERSION);
+  g_assert(dump->header->cell_count == 3);
+  g_assert(dump->header->line_count == 2);
+  g_assert(dump->header->position_count == 3);
+  g_assert(dump->header->line_share_count == 1);
+
+  const pve_dump_cell_t *first = &dump->cells[dump->lines[dump->header->root_line]];
+  g_assert(first->move == B1);
+  g_assert(first->variant != PVE_DUMP_NULL_INDEX);
+  const pve_dump_cell_t *second = &dump->cells[dump->lines[first->variant]];
+  g_assert(second->move == C1);
+  g_assert(second->next == first->next);
+  g_assert(dump->cells[first->next].move == A1);
+  g_assert(dump->positions[dump->cells[first->next].position].blacks == y.blacks);
+
+  /* Positions are sorted, and are found by bisection. */
+  for (uint64_t i = 1; i < dump->header->position_count; i++) {
+    g_assert(dump->positions[i - 1].blacks < dump->positions[i].blacks);
+  }
+  g_assert(pve_dump_find_position(dump, root) == dump->header->root_position);
+  g_assert(pve_dump_find_position(dump, &x) == first->position);
+  g_assert(pve_dump_find_position(dump, &y) == dump->cells[first->next].position);
+  GamePositionX z = { .blacks = 0x0000000000000003, .whites = 0x0000000000000004, .player = WHITE_PLAYER };
+  g_assert(pve_dump_find_position(dump, &z) == PVE_DUMP_NULL_INDEX);
+  pve_dump_close(dump);
+
+  PVEnv *loaded = pve_load_from_binary_file(file_name);
+  g_assert(loaded);
+  g_assert(pve_is_invariant_satisfied(loaded, NULL, 0xFF));
+  g_assert(loaded->root_game_position->blacks == root->blacks);
+  g_assert((*loaded->root_line)->move == B1);
+  PVCell **loaded_variant = pve_line_at(loaded, (*loaded->root_line)->variant);
+  g_assert((*loaded_variant)->move == C1);
+  g_assert((*loaded->root_line)->next == (*loaded_variant)->next);
+  g_assert(pve_cell_at(loaded, (*loaded->root_line)->next)->ref_count == 2);
+  g_assert(loaded->cells->used_count == 3);
+  pve_free(loaded);
+
+  /* A dump having a cell that refers to a missing game position is rejected. */
+  FILE *fp = fopen(file_name, "r+b");
+  pve_dump_header_t h;
+  size_t n = fread(&h, sizeof(h), 1, fp);
+  g_assert(n == 1);
+  pve_dump_cell_t cell;
+  fseek(fp, h.cells_offset, SEEK_SET);
+  n = fread(&cell, sizeof(cell), 1, fp);
+  g_assert(n == 1);
+  const uint32_t position = cell.position;
+  cell.position = h.position_count;
+  fseek(fp, h.cells_offset, SEEK_SET);
+  n = fwrite(&cell, sizeof(cell), 1, fp);
+  g_assert(n == 1);
+  fclose(fp);
+  g_assert(!pve_dump_open(file_name));
+
+  /* A dump having a cell that is the next of itself is rejected. */
+  fp = fopen(file_name, "r+b");
+  cell.position = position;
+  cell.next = 0;
+  fseek(fp, h.cells_offset, SEEK_SET);
+  n = fwrite(&cell, sizeof(cell), 1, fp);
+  g_assert(n == 1);
+  fclose(fp);
+  g_assert(!pve_dump_open(file_name));
+
+  /* A file not having the dump format is rejected. */
+  fp = fopen(file_name, "w");
+  fprintf(fp, "Not a dump.\n");
+  fclose(fp);
+  g_assert(!pve_dump_open(file_name));
+  g_assert(!pve_load_from_binary_file(file_name));
+
+  pve_free(pve);
+  game_position_x_free(root);
+}
+
+static void
+pve_dump_cursor_test (void)
+{
+  static const char *const file_name = "build/test/pve_dump_cursor_test.dat";
+
+  GamePositionX *root = game_position_x_new(empty_square_set, empty_square_set, BLACK_PLAYER);
+  GamePositionX x = { .blacks = 0x0000000000000001, .whites = 0x0000000000000002, .player = WHITE_PLAYER };
+
+  PVEnv *pve = pve_new(root);
+
+  /* The root line is C1 A1, with A1 having the variant B1, and C1 having the variants D1 and B1 A1. */
+  PVCell **a1_variant = pve_line_create(pve);
+  pve_line_add_move2(pve, a1_variant, B1, &x);
+  pve_line_add_move2(pve, pve->root_line, A1, &x);
+  pve_line_add_variant(pve, pve->root_line, a1_variant);
+  pve_line_add_move2(pve, pve->root_line, C1, &x);
+  PVCell **d1_variant = pve_line_create(pve);
+  pve_line_add_move2(pve, d1_variant, D1, &x);
+  pve_line_add_variant(pve, pve->root_line, d1_variant);
+  PVCell **b1_variant = pve_line_create(pve);
+  pve_line_add_move2(pve, b1_variant, A1, &x);
+  pve_line_add_move2(pve, b1_variant, B1, &x);
+  pve_line_add_variant(pve, pve->root_line, b1_variant);
+
+  const bool is_dumped = pve_dump_to_binary_file(pve, file_name);
+  g_assert(is_dumped);
+  pve_dump_t *dump = pve_dump_open(file_name);
+  g_assert(dump);
+
+  static const char *const expected[] = { "B1 A1", "C1 A1", "C1 B1", "D1" };
+  const size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+
+  pve_dump_cursor_t cursor;
+  pve_dump_cursor_init(&cursor, dump);
+  for (size_t k = 0; k < expected_count; k++) {
+    g_assert(pve_dump_cursor_next(&cursor));
+    GString *line = g_string_new("");
+    for (size_t i = 0; i < cursor.depth; i++) {
+      g_string_append_printf(line, "%s%s", (i == 0) ? "" : " ", square_as_move_to_string(dump->cells[cursor.cells[i]].move));
+    }
+    g_assert_cmpstr(line->str, ==, expected[k]);
+    g_string_free(line, TRUE);
+  }
+  g_assert(!pve_dump_cursor_next(&cursor));
+  g_assert(cursor.line_count == expected_count);
+
+  pve_dump_close(dump);
+  pve_free(pve);
+  game_position_x_free(root);
+}
+
+static void
+search_checkpoint_test (void)
+{
+  static const char *const file_name = "build/test/search_checkpoint_test.ckp";
+
+  GamePositionX *root = game_position_x_new(0x0000000000000010, 0x0000000000000020, BLACK_PLAYER);
+  GamePositionX x = { .blacks = 0x0000000000000001, .whites = 0x0000000000000002, .player = WHITE_PLAYER };
+
+  PVEnv *pve = pve_new(root);
+  pve_line_add_move2(pve, pve->root_line, A1, &x);
+  pve_line_add_move2(pve, pve->root_line, B1, &x);
+
+  search_checkpoint_t ckp;
+  memset(&ckp, 0, sizeof(ckp));
+  strcpy(ckp.solver, "es");
+  ckp.pv_flags = SEARCH_CHECKPOINT_PV_RECORDING;
+  ckp.root_blacks = root->blacks;
+  ckp.root_whites = root->whites;
+  ckp.root_player = root->player;
+  ckp.value = -4;
+  ckp.best_move = B1;
+  ckp.node_count = 123;
+  ckp.leaf_count = 45;
+
+  /* Each checkpoint removes the PVE dump of the previous one. */
+  for (uint32_t n = 1; n <= 2; n++) {
+    ckp.searched_move_count = n;
+    g_assert(search_checkpoint_write(file_name, &ckp, pve));
+  }
+  char *old_pve_file_name = search_checkpoint_pve_file_path(file_name, 1);
+  g_assert(!g_file_test(old_pve_file_name, G_FILE_TEST_EXISTS));
+  g_free(old_pve_file_name);
+
+  search_checkpoint_t read;
+  g_assert(search_checkpoint_read(file_name, &read));
+  g_assert_cmpstr(read.solver, ==, "es");
+  g_assert(read.searched_move_count == 2);
+  g_assert(read.value == -4);
+  g_assert(read.best_move == B1);
+  g_assert(read.node_count == 123);
+  g_assert(read.leaf_count == 45);
+  g_assert(read.pve_line_add_move_count == pve->line_add_move_count);
+
+  PVEnv *loaded = search_checkpoint_load_pve(file_name, &read);
+  g_assert(loaded);
+  g_assert(pve_is_invariant_satisfied(loaded, NULL, 0xFF));
+  g_assert((*loaded->root_line)->move == B1);
+  g_assert(pve_cell_at(loaded, (*loaded->root_line)->next)->move == A1);
+  pve_free(loaded);
+
+  /* When the PVE dump cannot be written, the previous checkpoint and its dump are kept. */
+  char *next_pve_file_name = search_checkpoint_pve_file_path(file_name, 3);
+  char *next_pve_tmp_file_name = g_strdup_printf("%s.tmp", next_pve_file_name);
+  const int mkdir_ret = g_mkdir(next_pve_tmp_file_name, 0755);
+  g_assert(mkdir_ret == 0);
+  ckp.searched_move_count = 3;
+  const bool is_written = search_checkpoint_write(file_name, &ckp, pve);
+  g_assert(!is_written);
+  g_assert(!g_file_test(next_pve_file_name, G_FILE_TEST_EXISTS));
+  const int rmdir_ret = remove(next_pve_tmp_file_name);
+  g_assert(rmdir_ret == 0);
+  g_free(next_pve_tmp_file_name);
+  g_free(next_pve_file_name);
+  g_assert(search_checkpoint_read(file_name, &read));
+  g_assert(read.searched_move_count == 2);
+
+  /* A checkpoint missing its PVE dump is rejected. */
+  char *pve_file_name = search_checkpoint_pve_file_path(file_name, 2);
+  g_assert(remove(pve_file_name) == 0);
+  g_free(pve_file_name);
+  g_assert(!search_checkpoint_read(file_name, &read));
+
+  /* A file not having the checkpoint format is rejected. */
+  FILE *fp = fopen(file_name, "w");
+  fprintf(fp, "Not a checkpoint.\n");
+  fclose(fp);
+  g_assert(!search_checkpoint_read(file_name, &read));
+
+  pve_free(pve);
+  game_position_x_free(root);
+}
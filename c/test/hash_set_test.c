@@ -0,0 +1,439 @@
+/**
+ * @file
+ *
+ * @brief Hash set unit test suite.
+ * @details Collects tests and helper methods for the hash set module.
+ *
+ * @par hash_set_test.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "hash_set.h"
+#include "prng.h"
+
+
+
+/* Test data types. */
+
+/*
+ * An item having a key and a payload, the set is searched by key.
+ */
+typedef struct {
+  int key;
+  int value;
+} pair_t;
+
+
+
+/* Test function prototypes. */
+
+static void creation_and_destruction_test (void);
+static void probe_test (void);
+static void find_test (void);
+static void delete_test (void);
+static void item_hash_f_test (void);
+static void volume_test (void);
+static void tombstone_test (void);
+static void next_test (void);
+static void colliding_hash_test (void);
+
+
+
+/* Helper function prototypes. */
+
+static uint64_t
+hash_int (const int key);
+
+static uint64_t
+pair_hash (const void *item,
+           void *param);
+
+static uint64_t
+pair_hash_and_increment_param (const void *item,
+                               void *param);
+
+static uint64_t
+constant_hash (const void *item,
+               void *param);
+
+static bool
+pair_equal (const void *item,
+            const void *key,
+            void *param);
+
+static pair_t *
+insert_pair (hs_table_t *table,
+             const int key,
+             const int value);
+
+static int *
+prepare_data_array (const size_t len,
+                    const int seed);
+
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/hash_set/creation_and_destruction_test", creation_and_destruction_test);
+  g_test_add_func("/hash_set/probe_test", probe_test);
+  g_test_add_func("/hash_set/find_test", find_test);
+  g_test_add_func("/hash_set/delete_test", delete_test);
+  g_test_add_func("/hash_set/item_hash_f_test", item_hash_f_test);
+  g_test_add_func("/hash_set/volume_test", volume_test);
+  g_test_add_func("/hash_set/tombstone_test", tombstone_test);
+  g_test_add_func("/hash_set/next_test", next_test);
+  g_test_add_func("/hash_set/colliding_hash_test", colliding_hash_test);
+
+  return g_test_run();
+}
+
+
+
+/*
+ * Test functions for the set structure.
+ */
+
+static void
+creation_and_destruction_test (void)
+{
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+  g_assert(table);
+  g_assert(hs_count(table) == 0);
+
+  const int key = 0;
+  g_assert(hs_find(table, hash_int(key), &key) == NULL);
+
+  hs_destroy(table);
+  hs_destroy(NULL);
+}
+
+static void
+probe_test (void)
+{
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+
+  /* Inserts the [0..9] set of keys. */
+  for (int i = 0; i < 10; i++) {
+    bool inserted = false;
+    pair_t *p = hs_probe(table, hash_int(i), &i, &inserted);
+    g_assert(inserted);
+    p->key = i;
+    p->value = 10 * i;
+    g_assert(hs_count(table) == i + 1);
+  }
+
+  /* Probing again returns the items already in the set. */
+  for (int i = 0; i < 10; i++) {
+    bool inserted = true;
+    pair_t *p = hs_probe(table, hash_int(i), &i, &inserted);
+    g_assert(!inserted);
+    g_assert(p->key == i);
+    g_assert(p->value == 10 * i);
+    g_assert(hs_count(table) == 10);
+  }
+
+  hs_destroy(table);
+}
+
+static void
+find_test (void)
+{
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+
+  for (int i = 0; i < 100; i += 2) insert_pair(table, i, -i);
+
+  for (int i = 0; i < 100; i++) {
+    const pair_t *p = hs_find(table, hash_int(i), &i);
+    if (i % 2) {
+      g_assert(p == NULL);
+    } else {
+      g_assert(p);
+      g_assert(p->key == i);
+      g_assert(p->value == -i);
+    }
+  }
+
+  hs_destroy(table);
+}
+
+static void
+delete_test (void)
+{
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+
+  for (int i = 0; i < 10; i++) insert_pair(table, i, i);
+
+  int key = 3;
+  g_assert(hs_delete(table, hash_int(key), &key));
+  g_assert(hs_count(table) == 9);
+  g_assert(hs_find(table, hash_int(key), &key) == NULL);
+
+  /* Deleting a missing key has no effect. */
+  g_assert(!hs_delete(table, hash_int(key), &key));
+  g_assert(hs_count(table) == 9);
+
+  for (int i = 0; i < 10; i++) {
+    if (i == 3) continue;
+    g_assert(hs_find(table, hash_int(i), &i));
+  }
+
+  /* The key can be inserted again. */
+  insert_pair(table, key, 33);
+  const pair_t *p = hs_find(table, hash_int(key), &key);
+  g_assert(p && p->value == 33);
+  g_assert(hs_count(table) == 10);
+
+  hs_destroy(table);
+}
+
+static void
+item_hash_f_test (void)
+{
+  /* The set calls the hash function only when moving the items into a larger storage. */
+  int hash_call_count = 0;
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash_and_increment_param, pair_equal, &hash_call_count);
+
+  insert_pair(table, 1, 1);
+  g_assert(hash_call_count == 0);
+
+  for (int i = 2; i <= 1000; i++) insert_pair(table, i, i);
+  g_assert(hash_call_count > 0);
+
+  hs_destroy(table);
+}
+
+static void
+volume_test (void)
+{
+  const size_t n = 100000;
+  int *keys = prepare_data_array(n, 1234);
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+
+  for (size_t i = 0; i < n; i++) insert_pair(table, keys[i], keys[i] + 1);
+  g_assert(hs_count(table) == n);
+
+  for (size_t i = 0; i < n; i++) {
+    const pair_t *p = hs_find(table, hash_int(keys[i]), &keys[i]);
+    g_assert(p && p->key == keys[i] && p->value == keys[i] + 1);
+  }
+
+  /* Deletes the first half, in shuffled order. */
+  for (size_t i = 0; i < n / 2; i++) g_assert(hs_delete(table, hash_int(keys[i]), &keys[i]));
+  g_assert(hs_count(table) == n - n / 2);
+
+  for (size_t i = 0; i < n; i++) {
+    const pair_t *p = hs_find(table, hash_int(keys[i]), &keys[i]);
+    if (i < n / 2) g_assert(p == NULL);
+    else g_assert(p && p->key == keys[i]);
+  }
+
+  hs_destroy(table);
+  free(keys);
+}
+
+static void
+tombstone_test (void)
+{
+  /*
+   * A set kept at a constant count, with keys always changing, must not grow:
+   * deleted slots are reclaimed by rehashing in place.
+   */
+  const int live = 500;
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+
+  for (int i = 0; i < live; i++) insert_pair(table, i, i);
+
+  size_t size = 0;
+  for (int i = live; i < 100 * live; i++) {
+    const int old_key = i - live;
+    g_assert(hs_delete(table, hash_int(old_key), &old_key));
+    insert_pair(table, i, i);
+    g_assert(hs_count(table) == live);
+    /* The first rehash may double the set, when more than half full, then its size is stable. */
+    if (i == 20 * live) size = table->size;
+    if (i > 20 * live) g_assert(table->size == size);
+  }
+  g_assert(table->count + table->deleted < table->size);
+
+  for (int i = 99 * live; i < 100 * live; i++) g_assert(hs_find(table, hash_int(i), &i));
+
+  hs_destroy(table);
+}
+
+static void
+next_test (void)
+{
+  const int n = 1000;
+  hs_table_t *table = hs_create(sizeof(pair_t), pair_hash, pair_equal, NULL);
+
+  size_t cursor = 0;
+  g_assert(hs_next(table, &cursor) == NULL);
+
+  for (int i = 0; i < n; i++) insert_pair(table, i, i);
+  for (int i = 0; i < n; i += 3) g_assert(hs_delete(table, hash_int(i), &i));
+
+  bool *seen = (bool *) calloc(n, sizeof(bool));
+  size_t count = 0;
+  cursor = 0;
+  for (pair_t *p = hs_next(table, &cursor); p; p = hs_next(table, &cursor)) {
+    g_assert(p->key >= 0 && p->key < n);
+    g_assert(p->key % 3 != 0);
+    g_assert(!seen[p->key]);
+    seen[p->key] = true;
+    count++;
+  }
+  g_assert(count == hs_count(table));
+
+  free(seen);
+  hs_destroy(table);
+}
+
+static void
+colliding_hash_test (void)
+{
+  /* Items sharing all the hash bits are told apart by the equality function. */
+  const int n = 100;
+  hs_table_t *table = hs_create(sizeof(pair_t), constant_hash, pair_equal, NULL);
+
+  for (int i = 0; i < n; i++) {
+    pair_t *p = hs_probe(table, 42, &i, NULL);
+    p->key = i;
+    p->value = i;
+  }
+  g_assert(hs_count(table) == n);
+
+  for (int i = 0; i < n; i++) {
+    const pair_t *p = hs_find(table, 42, &i);
+    g_assert(p && p->key == i);
+  }
+  for (int i = 0; i < n; i += 2) g_assert(hs_delete(table, 42, &i));
+  for (int i = 0; i < n; i++) {
+    const pair_t *p = hs_find(table, 42, &i);
+    g_assert((p != NULL) == (i % 2 == 1));
+  }
+
+  hs_destroy(table);
+}
+
+
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Returns the hash value of the key, it is the finalizer of the MurmurHash3 function.
+ */
+static uint64_t
+hash_int (const int key)
+{
+  uint64_t h = (uint64_t) key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t
+pair_hash (const void *item,
+           void *param)
+{
+  return hash_int(((const pair_t *) item)->key);
+}
+
+static uint64_t
+pair_hash_and_increment_param (const void *item,
+                               void *param)
+{
+  (*(int *) param)++;
+  return pair_hash(item, NULL);
+}
+
+static uint64_t
+constant_hash (const void *item,
+               void *param)
+{
+  return 42;
+}
+
+/*
+ * Keys are plain integers, compared with the key field of the item.
+ */
+static bool
+pair_equal (const void *item,
+            const void *key,
+            void *param)
+{
+  return ((const pair_t *) item)->key == *(const int *) key;
+}
+
+static pair_t *
+insert_pair (hs_table_t *table,
+             const int key,
+             const int value)
+{
+  bool inserted;
+  pair_t *p = hs_probe(table, hash_int(key), &key, &inserted);
+  g_assert(inserted);
+  p->key = key;
+  p->value = value;
+  return p;
+}
+
+/*
+ * Returns an array of len elements, having the [0..len-1] values shuffled.
+ */
+static int *
+prepare_data_array (const size_t len,
+                    const int seed)
+{
+  int *a = (int *) malloc(len * sizeof(int));
+  g_assert(a);
+
+  for (size_t i = 0; i < len; i++) {
+    a[i] = i;
+  }
+
+  prng_mt19937_t *prng = prng_mt19937_new();
+  g_assert(prng);
+  prng_mt19937_init_by_seed(prng, seed);
+  prng_mt19937_shuffle_array_int(prng, a, len);
+  prng_mt19937_free(prng);
+
+  return a;
+}
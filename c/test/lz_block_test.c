@@ -0,0 +1,272 @@
+/**
+ * @file
+ *
+ * @brief LZ block unit test suite.
+ * @details Collects tests and helper methods for the LZ block module.
+ *
+ * @par lz_block_test.c
+ * <tt>
+ * This file is part of the reversi program
+ * http://github.com/rcrr/reversi
+ * </tt>
+ * @author Roberto Corradini mailto:rob_corradini@yahoo.it
+ * @copyright 2017 Roberto Corradini. All rights reserved.
+ *
+ * @par License
+ * <tt>
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3, or (at your option) any
+ * later version.
+ * \n
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * \n
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA
+ * or visit the site <http://www.gnu.org/licenses/>.
+ * </tt>
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "lz_block.h"
+#include "prng.h"
+
+
+
+/* Test function prototypes. */
+
+static void empty_test (void);
+static void short_test (void);
+static void repetitive_test (void);
+static void random_test (void);
+static void overlapping_match_test (void);
+static void small_destination_test (void);
+static void corrupted_block_test (void);
+
+
+
+/* Helper function prototypes. */
+
+static size_t
+round_trip (const uint8_t *const data,
+            const size_t len);
+
+static uint8_t *
+prepare_random_data (const size_t len,
+                     const int seed,
+                     const int alphabet_size);
+
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/lz_block/empty_test", empty_test);
+  g_test_add_func("/lz_block/short_test", short_test);
+  g_test_add_func("/lz_block/repetitive_test", repetitive_test);
+  g_test_add_func("/lz_block/random_test", random_test);
+  g_test_add_func("/lz_block/overlapping_match_test", overlapping_match_test);
+  g_test_add_func("/lz_block/small_destination_test", small_destination_test);
+  g_test_add_func("/lz_block/corrupted_block_test", corrupted_block_test);
+
+  return g_test_run();
+}
+
+
+
+/*
+ * Test functions.
+ */
+
+static void
+empty_test (void)
+{
+  uint8_t block[lz_block_bound(0)];
+  const size_t block_len = lz_block_compress(NULL, 0, block, sizeof(block));
+  g_assert(block_len == 1);
+  g_assert(block[0] == 0);
+
+  uint8_t out[1];
+  g_assert(lz_block_decompress(block, block_len, out, sizeof(out)) == 0);
+  g_assert(lz_block_decompress(block, 0, out, sizeof(out)) == LZ_BLOCK_ERROR);
+}
+
+static void
+short_test (void)
+{
+  /* Up to twelve bytes there is no room for a match. */
+  const uint8_t data[] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  for (size_t len = 1; len < sizeof(data); len++) {
+    const size_t block_len = round_trip(data, len);
+    if (len <= 12) g_assert(block_len == len + 1);
+  }
+}
+
+static void
+repetitive_test (void)
+{
+  const size_t len = 1 << 20;
+  uint8_t *data = (uint8_t *) malloc(len);
+  g_assert(data);
+  for (size_t i = 0; i < len; i++) data[i] = "reversi "[i % 8] + (i / 4096) % 3;
+  const size_t block_len = round_trip(data, len);
+  g_assert(block_len < len / 50);
+  free(data);
+}
+
+static void
+random_test (void)
+{
+  static const size_t lens[] = { 13, 100, 4096, 65536, 70000, 1 << 20 };
+  static const int alphabets[] = { 2, 16, 256 };
+  for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+    for (size_t j = 0; j < sizeof(alphabets) / sizeof(alphabets[0]); j++) {
+      uint8_t *data = prepare_random_data(lens[i], 17 * i + j, alphabets[j]);
+      const size_t block_len = round_trip(data, lens[i]);
+      g_assert(block_len <= lz_block_bound(lens[i]));
+      free(data);
+    }
+  }
+}
+
+static void
+overlapping_match_test (void)
+{
+  /* Literal "ab", then a match of offset 2 and length 16, then the literals closing the block. */
+  const uint8_t block[] = { 0x2C, 'a', 'b', 0x02, 0x00, 0x50, 'x', 'y', 'z', 'w', 'v' };
+  const char expected[] = "ababababababababab" "xyzwv";
+  uint8_t out[64];
+  const size_t len = lz_block_decompress(block, sizeof(block), out, sizeof(out));
+  g_assert(len == strlen(expected));
+  g_assert(memcmp(out, expected, len) == 0);
+}
+
+static void
+small_destination_test (void)
+{
+  const size_t len = 10000;
+  uint8_t *data = prepare_random_data(len, 3, 256);
+  uint8_t *block = (uint8_t *) malloc(lz_block_bound(len));
+  g_assert(block);
+
+  /* Random bytes do not compress, the block does not fit a buffer as large as the data. */
+  g_assert(lz_block_compress(data, len, block, len) == 0);
+  const size_t block_len = lz_block_compress(data, len, block, lz_block_bound(len));
+  g_assert(block_len > len);
+
+  uint8_t *out = (uint8_t *) malloc(len);
+  g_assert(out);
+  g_assert(lz_block_decompress(block, block_len, out, len - 1) == LZ_BLOCK_ERROR);
+  g_assert(lz_block_decompress(block, block_len, out, len) == len);
+
+  free(out);
+  free(block);
+  free(data);
+}
+
+static void
+corrupted_block_test (void)
+{
+  uint8_t out[64];
+
+  /* The offset points before the start of the data. */
+  const uint8_t bad_offset[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+  g_assert(lz_block_decompress(bad_offset, sizeof(bad_offset), out, sizeof(out)) == LZ_BLOCK_ERROR);
+
+  /* The offset is zero. */
+  const uint8_t zero_offset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+  g_assert(lz_block_decompress(zero_offset, sizeof(zero_offset), out, sizeof(out)) == LZ_BLOCK_ERROR);
+
+  /* The literals run past the end of the block. */
+  const uint8_t short_literals[] = { 0x50, 'a', 'b' };
+  g_assert(lz_block_decompress(short_literals, sizeof(short_literals), out, sizeof(out)) == LZ_BLOCK_ERROR);
+
+  /* The block ends after a match. */
+  const uint8_t no_last_literals[] = { 0x10, 'a', 0x01, 0x00 };
+  g_assert(lz_block_decompress(no_last_literals, sizeof(no_last_literals), out, sizeof(out)) == LZ_BLOCK_ERROR);
+
+  /* The extended length is truncated. */
+  const uint8_t truncated_length[] = { 0xF0, 0xFF };
+  g_assert(lz_block_decompress(truncated_length, sizeof(truncated_length), out, sizeof(out)) == LZ_BLOCK_ERROR);
+
+  /* Every truncation of a valid block is either rejected, or decodes a prefix of the data. */
+  const size_t len = 5000;
+  uint8_t *data = prepare_random_data(len, 5, 4);
+  uint8_t *block = (uint8_t *) malloc(lz_block_bound(len));
+  uint8_t *decoded = (uint8_t *) malloc(len);
+  g_assert(block && decoded);
+  const size_t block_len = lz_block_compress(data, len, block, lz_block_bound(len));
+  g_assert(block_len > 0);
+  for (size_t i = 0; i < block_len; i++) {
+    const size_t n = lz_block_decompress(block, i, decoded, len);
+    if (n != LZ_BLOCK_ERROR) {
+      g_assert(n < len);
+      g_assert(memcmp(decoded, data, n) == 0);
+    }
+  }
+  free(decoded);
+  free(block);
+  free(data);
+}
+
+
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Compresses and decompresses the data, checks that it is unchanged, and returns the block length.
+ */
+static size_t
+round_trip (const uint8_t *const data,
+            const size_t len)
+{
+  const size_t capacity = lz_block_bound(len);
+  uint8_t *block = (uint8_t *) malloc(capacity);
+  uint8_t *out = (uint8_t *) malloc(len);
+  g_assert(block && out);
+
+  const size_t block_len = lz_block_compress(data, len, block, capacity);
+  g_assert(block_len > 0 && block_len <= capacity);
+  g_assert(lz_block_decompress(block, block_len, out, len) == len);
+  g_assert(memcmp(data, out, len) == 0);
+
+  free(out);
+  free(block);
+  return block_len;
+}
+
+/*
+ * Returns an array of len random bytes, taking values in [0..alphabet_size-1].
+ */
+static uint8_t *
+prepare_random_data (const size_t len,
+                     const int seed,
+                     const int alphabet_size)
+{
+  uint8_t *a = (uint8_t *) malloc(len);
+  g_assert(a);
+
+  prng_mt19937_t *prng = prng_mt19937_new();
+  g_assert(prng);
+  prng_mt19937_init_by_seed(prng, seed);
+  for (size_t i = 0; i < len; i++) {
+    a[i] = prng_mt19937_get_uint64(prng) % alphabet_size;
+  }
+  prng_mt19937_free(prng);
+
+  return a;
+}
@@ -91,6 +91,7 @@ static void traverser_on_changing_table_test (void);
 static void performance_test (void);
 static void creation_and_destruction_mem_dbg_test (void);
 static void probe_mem_dbg_test (void);
+static void delete_mem_obj_test (void);
 
 
 
@@ -183,6 +184,7 @@ main (int   argc,
 
   g_test_add_func("/red_black_tree/creation_and_destruction_mem_dbg_test", creation_and_destruction_mem_dbg_test);
   g_test_add_func("/red_black_tree/probe_mem_dbg_test", probe_mem_dbg_test);
+  g_test_add_func("/red_black_tree/delete_mem_obj_test", delete_mem_obj_test);
 
   if (g_test_perf()) {
     g_test_add_func("/red_black_tree/performance_test", performance_test);
@@ -1399,6 +1401,47 @@ probe_mem_dbg_test (void)
 
 }
 
+static void
+delete_mem_obj_test (void)
+{
+  const size_t data_size = 4096;
+  int *data = prepare_data_array(data_size, 20170901);
+
+  /* The arena objects have to fit both the table and the nodes. */
+  const size_t object_size = sizeof(rbt_table_t) > sizeof(rbt_node_t) ? sizeof(rbt_table_t) : sizeof(rbt_node_t);
+  mem_obj_allocator_t *arena = mem_obj_allocator_new(object_size, 256, 4);
+  mem_allocator_t *alloc = mem_obj_allocator(arena);
+
+  for (int round = 0; round < 2; round++) {
+    rbt_table_t *table = rbt_create(compare_int, NULL, alloc);
+    g_assert(table);
+
+    for (size_t i = 0; i < data_size; i++) rbt_probe(table, &data[i]);
+    g_assert(rbt_count(table) == data_size);
+    g_assert(arena->used_count == data_size + 1);
+    g_assert(verify_tree(table, data, data_size));
+
+    /* Deleted nodes go back to the arena, and are reused by the following insertions. */
+    const size_t top = arena->top;
+    for (size_t i = 0; i < data_size / 2; i++) g_assert(rbt_delete(table, &data[i]) == &data[i]);
+    g_assert(arena->used_count == data_size - data_size / 2 + 1);
+    for (size_t i = 0; i < data_size / 2; i++) rbt_probe(table, &data[i]);
+    g_assert(arena->top == top);
+    g_assert(verify_tree(table, data, data_size));
+    g_assert(mem_obj_allocator_is_consistent(arena));
+
+    /* The table is dropped at once, without visiting the nodes, by resetting the arena. */
+    mem_obj_allocator_reset(arena);
+    g_assert(arena->used_count == 0);
+    g_assert(mem_obj_allocator_is_consistent(arena));
+  }
+
+  g_assert(arena->segments_count == (data_size + 1 + 255) / 256);
+
+  mem_obj_allocator_free(arena);
+  free(data);
+}
+
 
 
 /*
@@ -864,6 +864,7 @@ static void sort_utils_mergesort_asc_d_n_rand_test (void);
 static void sort_utils_mergesort_dsc_d_1_rand_test (void);
 static void sort_utils_mergesort_dsc_d_n_rand_test (void);
 static void sort_utils_mergesort_asc_d_rand_perf_test (void);
+static void sort_utils_mergesort_mt_test (void);
 
 static void sort_utils_timsort_asc_d_1_rand_test (void);
 static void sort_utils_timsort_asc_d_n_rand_test (void);
@@ -918,6 +919,10 @@ static void
 sort_utils_qsort_dsc_d (double *const a,
                         const int count);
 
+static int
+hlp_key_seq_cmp (const void *const a,
+                 const void *const b);
+
 
 
 int
@@ -1154,6 +1159,7 @@ main (argc, argv)
   g_test_add_func("/sort_utils/sort_utils_mergesort_dsc_d_1_rand_test", sort_utils_mergesort_dsc_d_1_rand_test);
   g_test_add_func("/sort_utils/sort_utils_mergesort_asc_d_n_rand_test", sort_utils_mergesort_asc_d_n_rand_test);
   g_test_add_func("/sort_utils/sort_utils_mergesort_dsc_d_n_rand_test", sort_utils_mergesort_dsc_d_n_rand_test);
+  g_test_add_func("/sort_utils/sort_utils_mergesort_mt_test", sort_utils_mergesort_mt_test);
 
 
   g_test_add("/sort_utils/double_base_timsort",
@@ -1683,6 +1689,40 @@ sort_utils_mergesort_asc_d_rand_perf_test (void)
   hlp_run_sort_d_random_test(sort_utils_mergesort_asc_d, 1024, 15, 2, 175, ASC);
 }
 
+static void
+sort_utils_mergesort_mt_test (void)
+{
+  /* Keys are drawn from a small range, so that equal keys are frequent, and stability is checked on seq. */
+  const size_t n = 100003;
+  const int thread_counts[] = { 0, 1, 2, 3, 4, 7, 16 };
+
+  uint32_t *const data = (uint32_t *) malloc(2 * n * sizeof(uint32_t));
+  uint32_t *const a = (uint32_t *) malloc(2 * n * sizeof(uint32_t));
+  g_assert(data && a);
+
+  prng_mt19937_t *prng = prng_mt19937_new();
+  prng_mt19937_init_by_seed(prng, 9731);
+  for (size_t i = 0; i < n; i++) {
+    data[2 * i] = prng_mt19937_get_uint64(prng) % 1000;
+    data[2 * i + 1] = i;
+  }
+  prng_mt19937_free(prng);
+
+  for (size_t k = 0; k < sizeof(thread_counts) / sizeof(thread_counts[0]); k++) {
+    for (size_t len = 0; len <= n; len += (len < 4) ? 1 : n / 3) {
+      memcpy(a, data, 2 * len * sizeof(uint32_t));
+      sort_utils_mergesort_mt(a, len, 2 * sizeof(uint32_t), hlp_key_seq_cmp, thread_counts[k]);
+      for (size_t i = 1; i < len; i++) {
+        g_assert(a[2 * (i - 1)] <= a[2 * i]);
+        if (a[2 * (i - 1)] == a[2 * i]) g_assert(a[2 * (i - 1) + 1] < a[2 * i + 1]);
+      }
+    }
+  }
+
+  free(data);
+  free(a);
+}
+
 
 
 /**************************************/
@@ -1976,3 +2016,15 @@ sort_utils_qsort_dsc_d (double *const a,
 {
   qsort(a, count, sizeof(double), sort_utils_double_icmp);
 }
+
+/*
+ * Compares the first of two uint32_t values, the second one is not part of the key.
+ */
+static int
+hlp_key_seq_cmp (const void *const a,
+                 const void *const b)
+{
+  const uint32_t x = *(const uint32_t *) a;
+  const uint32_t y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}